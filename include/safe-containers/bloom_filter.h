@@ -0,0 +1,299 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/hash.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+#include <safe-containers/span.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace safe_containers
+{
+
+// `blocked_bloom_filter` is an approximate set, answering whether a key may have been
+// inserted with no false negatives, & false positives at a rate depending on the
+// bits per key. Its storage is a single allocation made by `Create`.
+//
+// Keys are hashed to one 256-bit block, & set one bit in each of its eight 32-bit
+// words, so inserting & probing touch a single cache line. The bit of each word is
+// picked by multiplying the hash with a per-word odd constant, which maps directly to
+// AVX2 instructions when enabled at compile time. `contains` over a span of keys
+// hashes a batch of keys & prefetches their blocks before probing any of them, so
+// the cache misses of a batch overlap.
+template <
+    typename Key,
+    typename Hash = std::hash<Key>,
+    typename AllocatorType = std::allocator<Key>>
+class blocked_bloom_filter
+{
+    struct alignas(32) block
+    {
+        std::uint32_t words[8];
+    };
+
+    using traits = std::allocator_traits<AllocatorType>;
+    using block_allocator = typename traits::template rebind_alloc<block>;
+
+    static constexpr std::uint32_t kSalts[8] = {
+        0x47b6137bU,
+        0x44974d91U,
+        0x8824ad5bU,
+        0xa2b7289dU,
+        0x705495c7U,
+        0x2df1424bU,
+        0x9efc4947U,
+        0x5c6bfb31U};
+
+    // Number of keys hashed & prefetched ahead of probing in bulk lookups.
+    static constexpr std::size_t kBatchSize = 16;
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using key_type = Key;
+    using hasher = Hash;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+
+    // About 1% false positives when filled with the expected number of keys.
+    static constexpr size_type kDefaultBitsPerKey = 10;
+    static constexpr size_type kBlockBits = 256;
+
+    explicit blocked_bloom_filter(const allocator_type& alloc, const Hash& hash = Hash()) noexcept
+        : alloc_(alloc),
+          hash_(hash)
+    {
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    blocked_bloom_filter(const blocked_bloom_filter&) = delete;
+    blocked_bloom_filter& operator=(const blocked_bloom_filter&) = delete;
+
+    blocked_bloom_filter(blocked_bloom_filter&& other) noexcept
+        : blocked_bloom_filter(other.alloc_, other.hash_)
+    {
+        swap(other);
+    }
+
+    blocked_bloom_filter& operator=(blocked_bloom_filter&& other) noexcept
+    {
+        blocked_bloom_filter tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    ~blocked_bloom_filter() { Destroy(); }
+
+    // Creates a filter sized for `expected_keys` keys with `bits_per_key` bits each.
+    static result<blocked_bloom_filter> Create(
+        size_type expected_keys,
+        size_type bits_per_key,
+        const allocator_type& alloc,
+        const Hash& hash = Hash()) noexcept
+    {
+        if (bits_per_key == 0 || expected_keys > (size_type{1} << 40) / bits_per_key)
+        {
+            return cpp::fail(ContainerError{});
+        }
+        const size_type bits = std::max<size_type>(expected_keys * bits_per_key, 1);
+        blocked_bloom_filter filter(alloc, hash);
+        TRY(filter.Allocate((bits + kBlockBits - 1) / kBlockBits));
+        return filter;
+    }
+
+    static result<blocked_bloom_filter> Create(
+        size_type expected_keys, const allocator_type& alloc, const Hash& hash = Hash()) noexcept
+    {
+        return Create(expected_keys, kDefaultBitsPerKey, alloc, hash);
+    }
+
+    result<blocked_bloom_filter> Clone() const noexcept
+    {
+        blocked_bloom_filter filter(alloc_, hash_);
+        TRY(filter.Allocate(block_count_));
+        std::memcpy(
+            static_cast<void*>(filter.blocks_),
+            static_cast<const void*>(blocks_),
+            block_count_ * sizeof(block));
+        return filter;
+    }
+
+    allocator_type get_allocator() const noexcept { return alloc_; }
+
+    size_type bit_count() const noexcept { return block_count_ * kBlockBits; }
+
+    // Adds `key`. Fails if the filter has no blocks, e.g. once moved from.
+    result<void> insert(const Key& key) noexcept
+    {
+        if (block_count_ == 0)
+        {
+            return cpp::fail(ContainerError{});
+        }
+        InsertHash(HashOf(key));
+        return {};
+    }
+
+    // Whether `key` may have been inserted.
+    bool contains(const Key& key) const noexcept
+    {
+        return block_count_ > 0 && ContainsHash(HashOf(key));
+    }
+
+    // Sets `results[i]` to whether `keys[i]` may have been inserted. `results` must
+    // be at least as long as `keys`.
+    void contains(span<const Key> keys, span<bool> results) const noexcept
+    {
+        if (block_count_ == 0)
+        {
+            std::fill(results.begin(), results.begin() + keys.size(), false);
+            return;
+        }
+        std::uint64_t hashes[kBatchSize];
+        for (size_type first = 0; first < keys.size(); first += kBatchSize)
+        {
+            const size_type n = std::min(kBatchSize, keys.size() - first);
+            for (size_type i = 0; i < n; ++i)
+            {
+                hashes[i] = HashOf(keys[first + i]);
+                __builtin_prefetch(&blocks_[BlockOf(hashes[i])]);
+            }
+            for (size_type i = 0; i < n; ++i)
+            {
+                results[first + i] = ContainsHash(hashes[i]);
+            }
+        }
+    }
+
+    // Forgets all keys.
+    void clear() noexcept
+    {
+        if (blocks_ != nullptr)
+        {
+            std::memset(static_cast<void*>(blocks_), 0, block_count_ * sizeof(block));
+        }
+    }
+
+    void swap(blocked_bloom_filter& other) noexcept
+    {
+        std::swap(alloc_, other.alloc_);
+        std::swap(hash_, other.hash_);
+        std::swap(blocks_, other.blocks_);
+        std::swap(block_count_, other.block_count_);
+    }
+
+   private:
+    std::uint64_t HashOf(const Key& key) const noexcept
+    {
+        return detail::MixHash(static_cast<std::uint64_t>(hash_(key)));
+    }
+
+    // Maps the high half of `h` onto the blocks, without a division.
+    size_type BlockOf(std::uint64_t h) const noexcept
+    {
+        return static_cast<size_type>(((h >> 32) * block_count_) >> 32);
+    }
+
+#if defined(__AVX2__)
+    static __m256i MaskOf(std::uint32_t h) noexcept
+    {
+        const __m256i salts = _mm256_setr_epi32(
+            static_cast<int>(kSalts[0]),
+            static_cast<int>(kSalts[1]),
+            static_cast<int>(kSalts[2]),
+            static_cast<int>(kSalts[3]),
+            static_cast<int>(kSalts[4]),
+            static_cast<int>(kSalts[5]),
+            static_cast<int>(kSalts[6]),
+            static_cast<int>(kSalts[7]));
+        const __m256i product = _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(h)), salts);
+        const __m256i bits = _mm256_srli_epi32(product, 27);
+        return _mm256_sllv_epi32(_mm256_set1_epi32(1), bits);
+    }
+
+    void InsertHash(std::uint64_t h) noexcept
+    {
+        auto* b = reinterpret_cast<__m256i*>(&blocks_[BlockOf(h)]);
+        _mm256_store_si256(
+            b, _mm256_or_si256(_mm256_load_si256(b), MaskOf(static_cast<std::uint32_t>(h))));
+    }
+
+    bool ContainsHash(std::uint64_t h) const noexcept
+    {
+        const auto* b = reinterpret_cast<const __m256i*>(&blocks_[BlockOf(h)]);
+        return _mm256_testc_si256(_mm256_load_si256(b), MaskOf(static_cast<std::uint32_t>(h)));
+    }
+#else
+    static std::uint32_t BitOf(std::uint32_t h, std::size_t word) noexcept
+    {
+        return std::uint32_t{1} << ((h * kSalts[word]) >> 27);
+    }
+
+    void InsertHash(std::uint64_t h) noexcept
+    {
+        block& b = blocks_[BlockOf(h)];
+        for (std::size_t i = 0; i < 8; ++i)
+        {
+            b.words[i] |= BitOf(static_cast<std::uint32_t>(h), i);
+        }
+    }
+
+    bool ContainsHash(std::uint64_t h) const noexcept
+    {
+        const block& b = blocks_[BlockOf(h)];
+        std::uint32_t missing = 0;
+        for (std::size_t i = 0; i < 8; ++i)
+        {
+            const std::uint32_t bit = BitOf(static_cast<std::uint32_t>(h), i);
+            missing |= ~b.words[i] & bit;
+        }
+        return missing == 0;
+    }
+#endif
+
+    result<void> Allocate(size_type count) noexcept
+    {
+        block_allocator alloc(alloc_);
+        auto blocks = detail::Allocate(alloc, count);
+        if (blocks.has_error())
+        {
+            return cpp::fail(std::move(blocks).error());
+        }
+        blocks_ = blocks.value();
+        block_count_ = count;
+        clear();
+        return {};
+    }
+
+    void Destroy() noexcept
+    {
+        if (blocks_ != nullptr)
+        {
+            block_allocator alloc(alloc_);
+            detail::Deallocate(alloc, blocks_, block_count_);
+            blocks_ = nullptr;
+            block_count_ = 0;
+        }
+    }
+
+    allocator_type alloc_;
+    hasher hash_;
+    block* blocks_ = nullptr;
+    size_type block_count_ = 0;
+};
+
+}  // namespace safe_containers
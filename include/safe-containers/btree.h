@@ -0,0 +1,870 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace safe_containers
+{
+namespace detail
+{
+
+// Storage for a `T` which is constructed & destroyed explicitly.
+template <typename T>
+struct uninitialized_slot
+{
+    alignas(T) unsigned char bytes[sizeof(T)];
+
+    T* get() noexcept { return std::launder(reinterpret_cast<T*>(bytes)); }
+    const T* get() const noexcept { return std::launder(reinterpret_cast<const T*>(bytes)); }
+};
+
+struct btree_identity_key
+{
+    template <typename T>
+    const T& operator()(const T& value) const noexcept
+    {
+        return value;
+    }
+};
+
+struct btree_pair_first_key
+{
+    template <typename P>
+    const auto& operator()(const P& value) const noexcept
+    {
+        return value.first;
+    }
+};
+
+// B+tree with unique keys, shared by `btree_map` & `btree_set`.
+//
+// Values live only in the leaves, which are linked to their neighbours, while the
+// internal nodes hold separator keys: child `i` holds the keys in
+// `[keys[i - 1], keys[i])`.
+template <typename Key, typename Value, typename KeyOf, typename Compare, typename AllocatorType>
+class btree
+{
+    static_assert(
+        std::is_nothrow_move_constructible_v<Key> && std::is_nothrow_move_constructible_v<Value>,
+        "Keys & values must be nothrow move constructible, so nodes can be split safely");
+
+    static constexpr std::size_t kLineSize = SAFE_CONTAINERS_CACHE_LINE_SIZE;
+    static constexpr std::size_t kNodeBytes = 4 * kLineSize;
+
+    struct node
+    {
+        std::uint16_t count = 0;
+    };
+
+    static constexpr std::size_t kLeafSlots =
+        std::max<std::size_t>(4, (kNodeBytes - 3 * sizeof(void*)) / sizeof(Value));
+    static constexpr std::size_t kInternalSlots = std::max<std::size_t>(
+        4, (kNodeBytes - 2 * sizeof(void*)) / (sizeof(Key) + sizeof(void*)));
+
+    struct alignas(kLineSize) leaf_node : node
+    {
+        leaf_node* prev = nullptr;
+        leaf_node* next = nullptr;
+        uninitialized_slot<Value> values[kLeafSlots];
+
+        Value& value(std::size_t i) noexcept { return *values[i].get(); }
+        const Value& value(std::size_t i) const noexcept { return *values[i].get(); }
+    };
+
+    struct alignas(kLineSize) internal_node : node
+    {
+        node* children[kInternalSlots + 1];
+        uninitialized_slot<Key> keys[kInternalSlots];
+
+        Key& key(std::size_t i) noexcept { return *keys[i].get(); }
+        const Key& key(std::size_t i) const noexcept { return *keys[i].get(); }
+    };
+
+    using traits = std::allocator_traits<AllocatorType>;
+    using leaf_allocator = typename traits::template rebind_alloc<leaf_node>;
+    using internal_allocator = typename traits::template rebind_alloc<internal_node>;
+
+    // Splitting a node requires at least `kInternalSlots / 2 >= 2` new children, so
+    // a tree can't grow taller than this with fewer than 2^64 insertions.
+    static constexpr std::size_t kMaxHeight = 64;
+
+    struct path_entry
+    {
+        internal_node* node;
+        std::size_t index;
+    };
+
+    template <bool Const>
+    class basic_iterator
+    {
+        using leaf_pointer = std::conditional_t<Const, const leaf_node*, leaf_node*>;
+
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const Value*, Value*>;
+        using reference = std::conditional_t<Const, const Value&, Value&>;
+
+        basic_iterator() noexcept = default;
+
+        // Allow conversion from iterator to const_iterator.
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        basic_iterator(const basic_iterator<false>& other) noexcept
+            : leaf_(other.leaf_),
+              pos_(other.pos_)
+        {
+        }
+
+        reference operator*() const noexcept { return leaf_->value(pos_); }
+        pointer operator->() const noexcept { return &leaf_->value(pos_); }
+
+        basic_iterator& operator++() noexcept
+        {
+            if (++pos_ == leaf_->count)
+            {
+                leaf_ = leaf_->next;
+                pos_ = 0;
+            }
+            return *this;
+        }
+
+        basic_iterator operator++(int) noexcept
+        {
+            basic_iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        friend bool operator==(const basic_iterator& a, const basic_iterator& b) noexcept
+        {
+            return a.leaf_ == b.leaf_ && a.pos_ == b.pos_;
+        }
+
+        friend bool operator!=(const basic_iterator& a, const basic_iterator& b) noexcept
+        {
+            return !(a == b);
+        }
+
+       private:
+        friend class btree;
+        friend class basic_iterator<true>;
+
+        // Positions past the end of a leaf continue at the next leaf.
+        basic_iterator(leaf_pointer leaf, std::size_t pos) noexcept
+        {
+            while (leaf != nullptr && pos == leaf->count)
+            {
+                leaf = leaf->next;
+                pos = 0;
+            }
+            leaf_ = leaf;
+            pos_ = pos;
+        }
+
+        leaf_pointer leaf_ = nullptr;
+        std::size_t pos_ = 0;
+    };
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using key_type = Key;
+    using value_type = Value;
+    using key_compare = Compare;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    static constexpr size_type kLeafCapacity = kLeafSlots;
+    static constexpr size_type kInternalCapacity = kInternalSlots;
+
+    explicit btree(const allocator_type& alloc, const Compare& comp = Compare()) noexcept
+        : comp_(comp),
+          alloc_(alloc)
+    {
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    btree(const btree&) = delete;
+    btree& operator=(const btree&) = delete;
+
+    btree(btree&& other) noexcept
+        : btree(other.alloc_, other.comp_)
+    {
+        swap(other);
+    }
+
+    btree& operator=(btree&& other) noexcept
+    {
+        btree tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    ~btree() { clear(); }
+
+    allocator_type get_allocator() const noexcept { return alloc_; }
+
+    iterator begin() noexcept { return iterator(first_, 0); }
+    const_iterator begin() const noexcept { return const_iterator(first_, 0); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return iterator(); }
+    const_iterator end() const noexcept { return const_iterator(); }
+    const_iterator cend() const noexcept { return end(); }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    size_type size() const noexcept { return size_; }
+
+    // Number of internal levels above the leaves.
+    size_type height() const noexcept { return height_; }
+
+    void clear() noexcept
+    {
+        if (root_ != nullptr)
+        {
+            Free(root_, height_);
+        }
+        root_ = nullptr;
+        first_ = nullptr;
+        height_ = 0;
+        size_ = 0;
+    }
+
+    iterator lower_bound(const Key& key) noexcept
+    {
+        leaf_node* leaf = FindLeaf(key);
+        return iterator(leaf, leaf == nullptr ? 0 : LeafLowerBound(leaf, key));
+    }
+
+    const_iterator lower_bound(const Key& key) const noexcept
+    {
+        return const_cast<btree*>(this)->lower_bound(key);
+    }
+
+    iterator upper_bound(const Key& key) noexcept
+    {
+        iterator it = lower_bound(key);
+        return it != end() && !comp_(key, KeyOf()(*it)) ? ++it : it;
+    }
+
+    const_iterator upper_bound(const Key& key) const noexcept
+    {
+        return const_cast<btree*>(this)->upper_bound(key);
+    }
+
+    iterator find(const Key& key) noexcept
+    {
+        leaf_node* leaf = FindLeaf(key);
+        if (leaf == nullptr)
+        {
+            return end();
+        }
+        const size_type pos = LeafLowerBound(leaf, key);
+        if (pos == leaf->count || comp_(key, KeyOf()(leaf->value(pos))))
+        {
+            return end();
+        }
+        return iterator(leaf, pos);
+    }
+
+    const_iterator find(const Key& key) const noexcept
+    {
+        return const_cast<btree*>(this)->find(key);
+    }
+
+    bool contains(const Key& key) const noexcept { return find(key) != end(); }
+    size_type count(const Key& key) const noexcept { return contains(key) ? 1 : 0; }
+
+    size_type erase(const Key& key) noexcept
+    {
+        if (root_ == nullptr)
+        {
+            return 0;
+        }
+        path_entry path[kMaxHeight];
+        leaf_node* leaf = Descend(key, path);
+        const size_type pos = LeafLowerBound(leaf, key);
+        if (pos == leaf->count || comp_(key, KeyOf()(leaf->value(pos))))
+        {
+            return 0;
+        }
+        Remove(path, leaf, pos);
+        return 1;
+    }
+
+    // Erases the element at `pos`, returning an iterator to the element after it.
+    iterator erase(const_iterator pos) noexcept
+    {
+        path_entry path[kMaxHeight];
+        const Key& key = KeyOf()(*pos);
+        leaf_node* leaf = Descend(key, path);
+        return Remove(path, leaf, LeafLowerBound(leaf, key));
+    }
+
+    void swap(btree& other) noexcept
+    {
+        std::swap(alloc_, other.alloc_);
+        std::swap(comp_, other.comp_);
+        std::swap(root_, other.root_);
+        std::swap(first_, other.first_);
+        std::swap(height_, other.height_);
+        std::swap(size_, other.size_);
+    }
+
+   protected:
+    // Inserts `Value(args...)` unless `key` is present.
+    template <typename... Args>
+    result<std::pair<iterator, bool>> EmplaceUnique(const Key& key, Args&&... args) noexcept
+    {
+        if (root_ == nullptr)
+        {
+            auto leaf = NewLeaf();
+            if (leaf.has_error())
+            {
+                return cpp::fail(std::move(leaf).error());
+            }
+            root_ = leaf.value();
+            first_ = leaf.value();
+        }
+
+        path_entry path[kMaxHeight];
+        leaf_node* leaf = Descend(key, path);
+        const size_type pos = LeafLowerBound(leaf, key);
+        if (pos != leaf->count && !comp_(key, KeyOf()(leaf->value(pos))))
+        {
+            return std::pair<iterator, bool>(iterator(leaf, pos), false);
+        }
+
+        // Construct the value up front, so a throwing constructor leaves the tree as is.
+        std::optional<Value> value;
+        SAFE_CONTAINERS_CATCH_OOM(value.emplace(std::forward<Args>(args)...));
+        if (leaf->count < kLeafSlots)
+        {
+            InsertIntoLeaf(leaf, pos, std::move(*value));
+            ++size_;
+            return std::pair<iterator, bool>(iterator(leaf, pos), true);
+        }
+        return SplitAndInsert(path, leaf, pos, std::move(*value));
+    }
+
+    // Inserts the values in order, which fills up the leaves of `out` as appending
+    // doesn't split leaves in half.
+    result<void> CloneInto(btree& out) const noexcept
+    {
+        for (const Value& value : *this)
+        {
+            auto res = out.EmplaceUnique(KeyOf()(value), value);
+            if (res.has_error())
+            {
+                return cpp::fail(std::move(res).error());
+            }
+        }
+        return {};
+    }
+
+    Compare comp_;
+
+   private:
+    result<leaf_node*> NewLeaf() noexcept
+    {
+        leaf_allocator alloc(alloc_);
+        auto p = detail::Allocate(alloc, 1);
+        if (p.has_error())
+        {
+            return cpp::fail(std::move(p).error());
+        }
+        return ::new (static_cast<void*>(p.value())) leaf_node;
+    }
+
+    result<internal_node*> NewInternal() noexcept
+    {
+        internal_allocator alloc(alloc_);
+        auto p = detail::Allocate(alloc, 1);
+        if (p.has_error())
+        {
+            return cpp::fail(std::move(p).error());
+        }
+        return ::new (static_cast<void*>(p.value())) internal_node;
+    }
+
+    void FreeLeaf(leaf_node* leaf) noexcept
+    {
+        std::destroy(leaf->values[0].get(), leaf->values[0].get() + leaf->count);
+        leaf->~leaf_node();
+        leaf_allocator alloc(alloc_);
+        detail::Deallocate(alloc, leaf, 1);
+    }
+
+    void FreeInternal(internal_node* n) noexcept
+    {
+        for (size_type i = 0; i < n->count; ++i)
+        {
+            std::destroy_at(&n->key(i));
+        }
+        n->~internal_node();
+        internal_allocator alloc(alloc_);
+        detail::Deallocate(alloc, n, 1);
+    }
+
+    // Frees the subtree at `n`, which has `height` internal levels.
+    void Free(node* n, size_type height) noexcept
+    {
+        if (height == 0)
+        {
+            FreeLeaf(static_cast<leaf_node*>(n));
+            return;
+        }
+        auto* in = static_cast<internal_node*>(n);
+        for (size_type i = 0; i <= in->count; ++i)
+        {
+            Free(in->children[i], height - 1);
+        }
+        FreeInternal(in);
+    }
+
+    // Index of the child of `n` which holds `key`.
+    size_type ChildIndex(const internal_node* n, const Key& key) const noexcept
+    {
+        size_type first = 0;
+        size_type count = n->count;
+        while (count > 0)
+        {
+            const size_type half = count / 2;
+            if (!comp_(key, n->key(first + half)))
+            {
+                first += half + 1;
+                count -= half + 1;
+            }
+            else
+            {
+                count = half;
+            }
+        }
+        return first;
+    }
+
+    size_type LeafLowerBound(const leaf_node* leaf, const Key& key) const noexcept
+    {
+        size_type first = 0;
+        size_type count = leaf->count;
+        while (count > 0)
+        {
+            const size_type half = count / 2;
+            if (comp_(KeyOf()(leaf->value(first + half)), key))
+            {
+                first += half + 1;
+                count -= half + 1;
+            }
+            else
+            {
+                count = half;
+            }
+        }
+        return first;
+    }
+
+    leaf_node* FindLeaf(const Key& key) const noexcept
+    {
+        node* n = root_;
+        for (size_type level = 0; n != nullptr && level < height_; ++level)
+        {
+            auto* in = static_cast<internal_node*>(n);
+            n = in->children[ChildIndex(in, key)];
+        }
+        return static_cast<leaf_node*>(n);
+    }
+
+    // Walks from the root to the leaf holding `key`, recording the path taken.
+    leaf_node* Descend(const Key& key, path_entry* path) const noexcept
+    {
+        node* n = root_;
+        for (size_type level = 0; level < height_; ++level)
+        {
+            auto* in = static_cast<internal_node*>(n);
+            const size_type index = ChildIndex(in, key);
+            path[level] = path_entry{in, index};
+            n = in->children[index];
+        }
+        return static_cast<leaf_node*>(n);
+    }
+
+    // Moves `count` constructed slots starting at `from` to the slots starting at `to`.
+    template <typename T>
+    static void Relocate(uninitialized_slot<T>* from, uninitialized_slot<T>* to, size_type count)
+        noexcept
+    {
+        if (to < from)
+        {
+            for (size_type i = 0; i < count; ++i)
+            {
+                ::new (static_cast<void*>(to[i].bytes)) T(std::move(*from[i].get()));
+                std::destroy_at(from[i].get());
+            }
+        }
+        else
+        {
+            for (size_type i = count; i-- > 0;)
+            {
+                ::new (static_cast<void*>(to[i].bytes)) T(std::move(*from[i].get()));
+                std::destroy_at(from[i].get());
+            }
+        }
+    }
+
+    static void InsertIntoLeaf(leaf_node* leaf, size_type pos, Value&& value) noexcept
+    {
+        Relocate(leaf->values + pos, leaf->values + pos + 1, leaf->count - pos);
+        ::new (static_cast<void*>(leaf->values[pos].bytes)) Value(std::move(value));
+        ++leaf->count;
+    }
+
+    // Inserts `key` & the child to its right after child `index` of `n`.
+    static void InsertIntoInternal(internal_node* n, size_type index, Key&& key, node* child)
+        noexcept
+    {
+        Relocate(n->keys + index, n->keys + index + 1, n->count - index);
+        std::move_backward(
+            n->children + index + 1, n->children + n->count + 1, n->children + n->count + 2);
+        ::new (static_cast<void*>(n->keys[index].bytes)) Key(std::move(key));
+        n->children[index + 1] = child;
+        ++n->count;
+    }
+
+    // Inserts into the full `leaf`, splitting it & as many of its ancestors as needed.
+    // All new nodes are allocated before the tree is modified, so a failed allocation
+    // leaves it unchanged.
+    result<std::pair<iterator, bool>> SplitAndInsert(
+        path_entry* path, leaf_node* leaf, size_type pos, Value&& value) noexcept
+    {
+        // The left leaf keeps the first `left` of the `kLeafSlots + 1` values. Appending
+        // to the last leaf keeps it full, so ascending insertions fill up the leaves.
+        const size_type left =
+            pos == kLeafSlots && leaf->next == nullptr ? kLeafSlots : (kLeafSlots + 1) / 2;
+        const Value& first_right =
+            pos == left ? value : leaf->value(pos < left ? left - 1 : left);
+        std::optional<Key> separator;
+        SAFE_CONTAINERS_CATCH_OOM(separator.emplace(KeyOf()(first_right)));
+
+        size_type full = 0;
+        while (full < height_ && path[height_ - 1 - full].node->count == kInternalSlots)
+        {
+            ++full;
+        }
+        const size_type internal_count = full == height_ ? full + 1 : full;
+
+        auto right_leaf = NewLeaf();
+        if (right_leaf.has_error())
+        {
+            return cpp::fail(std::move(right_leaf).error());
+        }
+        internal_node* spare[kMaxHeight + 1];
+        for (size_type i = 0; i < internal_count; ++i)
+        {
+            auto n = NewInternal();
+            if (n.has_error())
+            {
+                for (size_type j = 0; j < i; ++j)
+                {
+                    FreeInternal(spare[j]);
+                }
+                FreeLeaf(right_leaf.value());
+                return cpp::fail(std::move(n).error());
+            }
+            spare[i] = n.value();
+        }
+
+        leaf_node* right = right_leaf.value();
+        const size_type split = pos < left ? left - 1 : left;
+        Relocate(leaf->values + split, right->values, kLeafSlots - split);
+        right->count = static_cast<std::uint16_t>(kLeafSlots - split);
+        leaf->count = static_cast<std::uint16_t>(split);
+        right->prev = leaf;
+        right->next = leaf->next;
+        if (leaf->next != nullptr)
+        {
+            leaf->next->prev = right;
+        }
+        leaf->next = right;
+
+        iterator inserted;
+        if (pos < left)
+        {
+            InsertIntoLeaf(leaf, pos, std::move(value));
+            inserted = iterator(leaf, pos);
+        }
+        else
+        {
+            InsertIntoLeaf(right, pos - left, std::move(value));
+            inserted = iterator(right, pos - left);
+        }
+        ++size_;
+
+        // Push the separator up, splitting full ancestors on the way.
+        constexpr size_type kMid = kInternalSlots / 2;
+        Key key = std::move(*separator);
+        node* child = right;
+        size_type used = 0;
+        for (size_type level = height_; level-- > 0;)
+        {
+            internal_node* parent = path[level].node;
+            const size_type index = path[level].index;
+            if (parent->count < kInternalSlots)
+            {
+                InsertIntoInternal(parent, index, std::move(key), child);
+                return std::pair<iterator, bool>(inserted, true);
+            }
+
+            // Keys `[0, kMid)` stay, key `kMid` moves up & the rest move to `sibling`.
+            internal_node* sibling = spare[used++];
+            Key up = std::move(parent->key(kMid));
+            std::destroy_at(&parent->key(kMid));
+            Relocate(parent->keys + kMid + 1, sibling->keys, kInternalSlots - kMid - 1);
+            std::copy(
+                parent->children + kMid + 1,
+                parent->children + kInternalSlots + 1,
+                sibling->children);
+            sibling->count = static_cast<std::uint16_t>(kInternalSlots - kMid - 1);
+            parent->count = static_cast<std::uint16_t>(kMid);
+            if (index <= kMid)
+            {
+                InsertIntoInternal(parent, index, std::move(key), child);
+            }
+            else
+            {
+                InsertIntoInternal(sibling, index - kMid - 1, std::move(key), child);
+            }
+            key = std::move(up);
+            child = sibling;
+        }
+
+        internal_node* root = spare[used];
+        ::new (static_cast<void*>(root->keys[0].bytes)) Key(std::move(key));
+        root->children[0] = root_;
+        root->children[1] = child;
+        root->count = 1;
+        root_ = root;
+        ++height_;
+        return std::pair<iterator, bool>(inserted, true);
+    }
+
+    // Removes value `pos` of `leaf`. Leaves are freed once empty, but never merged
+    // with their siblings, so erasing doesn't allocate nor move values across nodes.
+    iterator Remove(path_entry* path, leaf_node* leaf, size_type pos) noexcept
+    {
+        std::destroy_at(&leaf->value(pos));
+        Relocate(leaf->values + pos + 1, leaf->values + pos, leaf->count - pos - 1);
+        --leaf->count;
+        --size_;
+        if (leaf->count > 0 || leaf == root_)
+        {
+            return iterator(leaf, pos);
+        }
+
+        leaf_node* next = leaf->next;
+        if (leaf->prev != nullptr)
+        {
+            leaf->prev->next = next;
+        }
+        else
+        {
+            first_ = next;
+        }
+        if (next != nullptr)
+        {
+            next->prev = leaf->prev;
+        }
+        FreeLeaf(leaf);
+
+        for (size_type level = height_; level-- > 0;)
+        {
+            internal_node* parent = path[level].node;
+            const size_type index = path[level].index;
+            if (parent->count > 0)
+            {
+                // Drop the separator on either side of the removed child.
+                const size_type key_index = index > 0 ? index - 1 : 0;
+                std::destroy_at(&parent->key(key_index));
+                Relocate(
+                    parent->keys + key_index + 1,
+                    parent->keys + key_index,
+                    parent->count - key_index - 1);
+                std::copy(
+                    parent->children + index + 1,
+                    parent->children + parent->count + 1,
+                    parent->children + index);
+                --parent->count;
+                break;
+            }
+            // The removed child was the only one.
+            FreeInternal(parent);
+        }
+
+        while (height_ > 0 && root_->count == 0)
+        {
+            auto* old_root = static_cast<internal_node*>(root_);
+            root_ = old_root->children[0];
+            FreeInternal(old_root);
+            --height_;
+        }
+        return iterator(next, 0);
+    }
+
+    allocator_type alloc_;
+    node* root_ = nullptr;
+    leaf_node* first_ = nullptr;
+    size_type height_ = 0;
+    size_type size_ = 0;
+};
+
+}  // namespace detail
+
+// `btree_map` is an ordered map stored as an in-memory B+tree, with fallible
+// allocation handling using `result` types.
+//
+// Nodes span a few whole cache lines & hold many keys each, so a lookup touches
+// `O(log_B n)` nodes instead of chasing a pointer per level like `std::map`. Values
+// are only stored in the leaves, which are linked for cheap in-order iteration.
+// Nodes are allocated through the container's allocator; when an insertion can't
+// allocate the nodes it needs, an error is returned and the map is unchanged.
+//
+// Inserting or erasing invalidates iterators. Keys must not be modified through
+// iterators.
+template <
+    typename K,
+    typename V,
+    typename Compare = std::less<K>,
+    typename AllocatorType = std::allocator<std::pair<K, V>>>
+class btree_map : public detail::btree<
+                      K,
+                      std::pair<K, V>,
+                      detail::btree_pair_first_key,
+                      Compare,
+                      AllocatorType>
+{
+    using base =
+        detail::btree<K, std::pair<K, V>, detail::btree_pair_first_key, Compare, AllocatorType>;
+
+   public:
+    template <typename R>
+    using result = cpp::result<R, ContainerError>;
+
+    using mapped_type = V;
+    using typename base::allocator_type;
+    using typename base::const_iterator;
+    using typename base::iterator;
+    using typename base::value_type;
+
+    using base::base;
+
+    // Utility wrapper around the plain `btree_map` so `Create` can be
+    // used regardless of fallibility.
+    static result<btree_map> Create(const allocator_type& alloc) noexcept
+    {
+        return result<btree_map>(cpp::in_place, alloc);
+    }
+
+    result<btree_map> Clone() const noexcept
+    {
+        btree_map m(this->get_allocator(), this->comp_);
+        TRY(this->CloneInto(m));
+        return m;
+    }
+
+    // Inserts `(key, V(args...))` if `key` is absent. Returns the element with this key
+    // and whether it was inserted.
+    template <typename... Args>
+    result<std::pair<iterator, bool>> try_emplace(const K& key, Args&&... args) noexcept
+    {
+        return this->EmplaceUnique(
+            key,
+            std::piecewise_construct,
+            std::forward_as_tuple(key),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    result<std::pair<iterator, bool>> insert(const value_type& value) noexcept
+    {
+        return this->EmplaceUnique(value.first, value);
+    }
+
+    result<std::pair<iterator, bool>> insert(value_type&& value) noexcept
+    {
+        return this->EmplaceUnique(value.first, std::move(value));
+    }
+
+    template <typename M>
+    result<std::pair<iterator, bool>> insert_or_assign(const K& key, M&& value) noexcept
+    {
+        auto res = try_emplace(key, std::forward<M>(value));
+        if (res.has_value() && !res.value().second)
+        {
+            SAFE_CONTAINERS_CATCH_OOM(res.value().first->second = std::forward<M>(value));
+        }
+        return res;
+    }
+};
+
+// `btree_set` is an ordered set stored as an in-memory B+tree, see `btree_map`.
+template <
+    typename K,
+    typename Compare = std::less<K>,
+    typename AllocatorType = std::allocator<K>>
+class btree_set
+    : public detail::btree<K, K, detail::btree_identity_key, Compare, AllocatorType>
+{
+    using base = detail::btree<K, K, detail::btree_identity_key, Compare, AllocatorType>;
+
+   public:
+    template <typename R>
+    using result = cpp::result<R, ContainerError>;
+
+    using typename base::allocator_type;
+    using typename base::iterator;
+
+    using base::base;
+
+    // Utility wrapper around the plain `btree_set` so `Create` can be
+    // used regardless of fallibility.
+    static result<btree_set> Create(const allocator_type& alloc) noexcept
+    {
+        return result<btree_set>(cpp::in_place, alloc);
+    }
+
+    result<btree_set> Clone() const noexcept
+    {
+        btree_set s(this->get_allocator(), this->comp_);
+        TRY(this->CloneInto(s));
+        return s;
+    }
+
+    result<std::pair<iterator, bool>> insert(const K& value) noexcept
+    {
+        return this->EmplaceUnique(value, value);
+    }
+
+    result<std::pair<iterator, bool>> insert(K&& value) noexcept
+    {
+        return this->EmplaceUnique(value, std::move(value));
+    }
+};
+
+}  // namespace safe_containers
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/flat_hash_map.h>
+#include <safe-containers/hash.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `concurrent_hash_map` is a hash map which can be used from any number of threads.
+//
+// Keys are distributed over a fixed number of shards, each being a `flat_hash_map`
+// guarded by its own mutex on a separate cache line. Threads working on keys in
+// different shards don't contend, and a shard that grows only rehashes its own
+// elements while holding its own lock.
+//
+// Every operation that may allocate returns a `result`; if a shard fails to grow,
+// the insertion is rejected and the shard is left unchanged.
+//
+// References to elements are never handed out, as they would outlive the shard lock.
+// Use `visit` to access an element while its shard is locked.
+template <
+    typename K,
+    typename V,
+    typename Hash = std::hash<K>,
+    typename KeyEqual = std::equal_to<K>,
+    typename AllocatorType = std::allocator<std::pair<K, V>>>
+class concurrent_hash_map
+{
+    using map_type = flat_hash_map<K, V, Hash, KeyEqual, AllocatorType>;
+
+    struct alignas(SAFE_CONTAINERS_CACHE_LINE_SIZE) shard
+    {
+        explicit shard(const AllocatorType& alloc) noexcept
+            : map(alloc)
+        {
+        }
+
+        mutable std::mutex mutex;
+        map_type map;
+    };
+
+    using shard_allocator =
+        typename std::allocator_traits<AllocatorType>::template rebind_alloc<shard>;
+
+   public:
+    template <typename R>
+    using result = cpp::result<R, ContainerError>;
+
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using allocator_type = AllocatorType;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = std::size_t;
+
+    static constexpr size_type kDefaultShardCount = 16;
+
+    // Creates a map with at least `shard_count` shards. The shard count is rounded up
+    // to a power of two.
+    static result<concurrent_hash_map> Create(
+        size_type shard_count, const allocator_type& alloc) noexcept
+    {
+        const size_type rounded = detail::NextPowerOfTwo(std::max<size_type>(shard_count, 1));
+        // Shards are picked using bits 32 & up of the hash, see `ShardOf`.
+        if (rounded == 0 || rounded > (size_type{1} << 24))
+        {
+            return cpp::fail(ContainerError{});
+        }
+        shard_allocator shard_alloc(alloc);
+        auto shards = detail::Allocate(shard_alloc, rounded);
+        if (shards.has_error())
+        {
+            return cpp::fail(std::move(shards).error());
+        }
+        for (size_type i = 0; i < rounded; ++i)
+        {
+            new (&shards.value()[i]) shard(alloc);
+        }
+        return concurrent_hash_map(alloc, shards.value(), rounded);
+    }
+
+    static result<concurrent_hash_map> Create(const allocator_type& alloc) noexcept
+    {
+        return Create(kDefaultShardCount, alloc);
+    }
+
+    concurrent_hash_map(const concurrent_hash_map&) = delete;
+    concurrent_hash_map& operator=(const concurrent_hash_map&) = delete;
+
+    // Moving is only allowed while no other thread accesses either map. A moved-from
+    // map has no shards, so it only supports `size`, `clear` & `reserve`.
+    concurrent_hash_map(concurrent_hash_map&& other) noexcept
+        : alloc_(std::move(other.alloc_)),
+          hash_(std::move(other.hash_)),
+          shards_(std::exchange(other.shards_, nullptr)),
+          shard_count_(std::exchange(other.shard_count_, 0))
+    {
+    }
+
+    concurrent_hash_map& operator=(concurrent_hash_map&&) = delete;
+
+    ~concurrent_hash_map()
+    {
+        for (size_type i = 0; i < shard_count_; ++i)
+        {
+            std::destroy_at(&shards_[i]);
+        }
+        if (shards_ != nullptr)
+        {
+            shard_allocator shard_alloc(alloc_);
+            detail::Deallocate(shard_alloc, shards_, shard_count_);
+        }
+    }
+
+    size_type shard_count() const noexcept { return shard_count_; }
+
+    // Number of elements; only exact when no thread modifies the map concurrently.
+    size_type size() const noexcept
+    {
+        size_type total = 0;
+        for (size_type i = 0; i < shard_count_; ++i)
+        {
+            std::lock_guard<std::mutex> lock(shards_[i].mutex);
+            total += shards_[i].map.size();
+        }
+        return total;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    // Grows every shard to hold its share of `count` elements without rehashing.
+    // Fails on a moved-from map, which has no shards.
+    result<void> reserve(size_type count) noexcept
+    {
+        if (shard_count_ == 0)
+        {
+            return cpp::fail(ContainerError{});
+        }
+        const size_type per_shard = count / shard_count_ + 1;
+        for (size_type i = 0; i < shard_count_; ++i)
+        {
+            std::lock_guard<std::mutex> lock(shards_[i].mutex);
+            TRY(shards_[i].map.reserve(per_shard));
+        }
+        return {};
+    }
+
+    // Inserts `(key, V(args...))` if `key` is absent. Returns whether it was inserted.
+    template <typename Key, typename... Args>
+    result<bool> try_emplace(Key&& key, Args&&... args) noexcept
+    {
+        shard& s = ShardOf(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto res = s.map.try_emplace(std::forward<Key>(key), std::forward<Args>(args)...);
+        if (res.has_error())
+        {
+            return cpp::fail(std::move(res).error());
+        }
+        return res.value().second;
+    }
+
+    result<bool> insert(const value_type& value) noexcept
+    {
+        return try_emplace(value.first, value.second);
+    }
+
+    result<bool> insert(value_type&& value) noexcept
+    {
+        return try_emplace(std::move(value.first), std::move(value.second));
+    }
+
+    // Inserts or overwrites the value of `key`. Returns whether it was inserted.
+    template <typename Key, typename M>
+    result<bool> insert_or_assign(Key&& key, M&& value) noexcept
+    {
+        shard& s = ShardOf(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto res = s.map.insert_or_assign(std::forward<Key>(key), std::forward<M>(value));
+        if (res.has_error())
+        {
+            return cpp::fail(std::move(res).error());
+        }
+        return res.value().second;
+    }
+
+    // Calls `f(V&)` on the value of `key` while its shard is locked. Returns false if
+    // `key` is absent.
+    template <typename F>
+    bool visit(const K& key, F&& f) noexcept(noexcept(f(std::declval<V&>())))
+    {
+        shard& s = ShardOf(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.map.find(key);
+        if (it == s.map.end())
+        {
+            return false;
+        }
+        std::forward<F>(f)(it->second);
+        return true;
+    }
+
+    template <typename F>
+    bool visit(const K& key, F&& f) const noexcept(noexcept(f(std::declval<const V&>())))
+    {
+        const shard& s = ShardOf(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.map.find(key);
+        if (it == s.map.end())
+        {
+            return false;
+        }
+        std::forward<F>(f)(it->second);
+        return true;
+    }
+
+    bool contains(const K& key) const noexcept
+    {
+        const shard& s = ShardOf(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.map.contains(key);
+    }
+
+    // Returns whether `key` was present.
+    bool erase(const K& key) noexcept
+    {
+        shard& s = ShardOf(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.map.erase(key) != 0;
+    }
+
+    // Calls `f(const K&, V&)` on every element, locking one shard at a time. Elements
+    // inserted or erased concurrently may or may not be visited.
+    template <typename F>
+    void for_each(F&& f)
+    {
+        for (size_type i = 0; i < shard_count_; ++i)
+        {
+            std::lock_guard<std::mutex> lock(shards_[i].mutex);
+            for (auto& [key, value] : shards_[i].map)
+            {
+                f(static_cast<const K&>(key), value);
+            }
+        }
+    }
+
+    void clear() noexcept
+    {
+        for (size_type i = 0; i < shard_count_; ++i)
+        {
+            std::lock_guard<std::mutex> lock(shards_[i].mutex);
+            shards_[i].map.clear();
+        }
+    }
+
+   private:
+    concurrent_hash_map(const allocator_type& alloc, shard* shards, size_type count) noexcept
+        : alloc_(alloc),
+          shards_(shards),
+          shard_count_(count)
+    {
+    }
+
+    // Uses bits which don't overlap with those the shard tables use for their slot
+    // index (low bits) & control bytes (top 7 bits).
+    size_type IndexOf(const K& key) const noexcept
+    {
+        const std::uint64_t h = detail::MixHash(static_cast<std::uint64_t>(hash_(key)));
+        return static_cast<size_type>(h >> 32) & (shard_count_ - 1);
+    }
+
+    shard& ShardOf(const K& key) noexcept { return shards_[IndexOf(key)]; }
+    const shard& ShardOf(const K& key) const noexcept { return shards_[IndexOf(key)]; }
+
+    // Read-only after construction.
+    allocator_type alloc_;
+    Hash hash_;
+    shard* shards_;
+    size_type shard_count_;
+};
+
+}  // namespace safe_containers
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+#include <safe-containers/type_traits.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `concurrent_vector` is an append-only vector which any number of threads can grow
+// concurrently, without a global lock.
+//
+// Elements are stored in buckets of power-of-two increasing size: bucket `k` holds
+// `FirstBucketSize * 2^k` elements. Buckets are never moved or freed before the
+// vector is destroyed, so references to elements remain valid across growth, and
+// growing never copies existing elements.
+//
+// Every growth step is a single bucket allocation, reported as a `ContainerError` on
+// failure. An index is only claimed once its bucket exists, so a failed push leaves
+// no gap. Element construction must not throw for the same reason.
+//
+// `size()` includes elements which are still being constructed by other threads;
+// readers racing with writers must check `is_ready(i)` before reading element `i`.
+template <
+    typename T,
+    typename AllocatorType = std::allocator<T>,
+    std::size_t FirstBucketSize = 64>
+class concurrent_vector
+{
+    static_assert(
+        FirstBucketSize > 0 && (FirstBucketSize & (FirstBucketSize - 1)) == 0,
+        "The first bucket size must be a power of two");
+
+    using word = std::atomic<std::uint64_t>;
+
+    struct bucket
+    {
+        T* elements;
+        // One bit per element, set once the element is constructed.
+        word* ready;
+    };
+
+    using traits = std::allocator_traits<AllocatorType>;
+    using bucket_allocator = typename traits::template rebind_alloc<bucket>;
+    using word_allocator = typename traits::template rebind_alloc<word>;
+
+    static constexpr std::size_t Log2(std::size_t n) noexcept
+    {
+        std::size_t log = 0;
+        while (n >>= 1)
+        {
+            ++log;
+        }
+        return log;
+    }
+
+    static constexpr std::size_t kFirstBucketLog = Log2(FirstBucketSize);
+    static constexpr std::size_t kMaxBuckets = sizeof(std::size_t) * 8 - kFirstBucketLog;
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using value_type = T;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+    using reference = T&;
+    using const_reference = const T&;
+
+    static_assert(
+        std::is_same_v<typename traits::pointer, T*>, "Fancy allocator pointers are not supported");
+
+    MAYBE_CONSTEXPR explicit concurrent_vector(const allocator_type& alloc) noexcept
+        : alloc_(alloc)
+    {
+    }
+
+    // Copying would need to allocate, and moving would invalidate references held by
+    // other threads.
+    concurrent_vector(const concurrent_vector&) = delete;
+    concurrent_vector& operator=(const concurrent_vector&) = delete;
+
+    ~concurrent_vector()
+    {
+        const size_type count = size_.load(std::memory_order_acquire);
+        for (size_type i = 0; i < count; ++i)
+        {
+            if (is_ready(i))
+            {
+                traits::destroy(alloc_, &(*this)[i]);
+            }
+        }
+        for (size_type k = 0; k < kMaxBuckets; ++k)
+        {
+            FreeBucket(k, buckets_[k].load(std::memory_order_relaxed));
+        }
+    }
+
+    // Number of claimed elements, including those still under construction.
+    size_type size() const noexcept { return size_.load(std::memory_order_acquire); }
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    // Number of elements which fit in the buckets allocated so far.
+    size_type capacity() const noexcept
+    {
+        size_type k = 0;
+        while (k < kMaxBuckets && buckets_[k].load(std::memory_order_acquire) != nullptr)
+        {
+            ++k;
+        }
+        return FirstBucketSize * ((size_type{1} << k) - 1);
+    }
+
+    // Whether element `pos` has been fully constructed.
+    bool is_ready(size_type pos) const noexcept
+    {
+        const size_type k = BucketOf(pos);
+        const bucket* b = buckets_[k].load(std::memory_order_acquire);
+        if (b == nullptr)
+        {
+            return false;
+        }
+        const size_type offset = OffsetOf(pos, k);
+        const std::uint64_t bits = b->ready[offset / 64].load(std::memory_order_acquire);
+        return (bits >> (offset % 64)) & 1;
+    }
+
+    // The element must be ready, see `is_ready`.
+    reference operator[](size_type pos) noexcept
+    {
+        const size_type k = BucketOf(pos);
+        return buckets_[k].load(std::memory_order_acquire)->elements[OffsetOf(pos, k)];
+    }
+
+    const_reference operator[](size_type pos) const noexcept
+    {
+        const size_type k = BucketOf(pos);
+        return buckets_[k].load(std::memory_order_acquire)->elements[OffsetOf(pos, k)];
+    }
+
+    // Allocates buckets for at least `count` elements, so pushing up to that many
+    // elements cannot fail.
+    result<void> reserve(size_type count) noexcept
+    {
+        if (count == 0)
+        {
+            return {};
+        }
+        const size_type last = BucketOf(count - 1);
+        for (size_type k = 0; k <= last; ++k)
+        {
+            TRY(EnsureBucket(k));
+        }
+        return {};
+    }
+
+    template <typename... Args>
+    result<void> push_back(Args&&... args) noexcept
+    {
+        auto res = emplace_back(std::forward<Args>(args)...);
+        if (res.has_error())
+        {
+            return cpp::fail(std::move(res).error());
+        }
+        return {};
+    }
+
+    template <typename... Args>
+    result<reference> emplace_back(Args&&... args) noexcept
+    {
+        static_assert(
+            !contains_type<allocator_type, Args...>::value,
+            "Arguments cannot contain an allocator type");
+        static_assert(
+            std::is_nothrow_constructible_v<T, Args...>,
+            "Elements must be nothrow constructible from the arguments");
+
+        // Only claim an index once its bucket exists, so failures leave no gaps.
+        size_type pos = size_.load(std::memory_order_relaxed);
+        size_type k = 0;
+        do
+        {
+            k = BucketOf(pos);
+            TRY(EnsureBucket(k));
+        } while (!size_.compare_exchange_weak(
+            pos, pos + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+        bucket* b = buckets_[k].load(std::memory_order_acquire);
+        const size_type offset = OffsetOf(pos, k);
+        T* element = &b->elements[offset];
+        traits::construct(alloc_, element, std::forward<Args>(args)...);
+        b->ready[offset / 64].fetch_or(
+            std::uint64_t{1} << (offset % 64), std::memory_order_release);
+        return *element;
+    }
+
+   private:
+    static size_type BucketSize(size_type k) noexcept { return FirstBucketSize << k; }
+
+    static size_type BucketOf(size_type pos) noexcept
+    {
+        return detail::FloorLog2(pos + FirstBucketSize) - kFirstBucketLog;
+    }
+
+    static size_type OffsetOf(size_type pos, size_type k) noexcept
+    {
+        return pos + FirstBucketSize - BucketSize(k);
+    }
+
+    static size_type WordsOf(size_type k) noexcept { return (BucketSize(k) + 63) / 64; }
+
+    // Allocates & publishes bucket `k`, unless another thread already did.
+    result<void> EnsureBucket(size_type k) noexcept
+    {
+        if (k >= kMaxBuckets)
+        {
+            return cpp::fail(ContainerError{});
+        }
+        if (buckets_[k].load(std::memory_order_acquire) != nullptr)
+        {
+            return {};
+        }
+
+        bucket_allocator bucket_alloc(alloc_);
+        auto b = detail::Allocate(bucket_alloc, 1);
+        if (b.has_error())
+        {
+            return cpp::fail(std::move(b).error());
+        }
+        auto elements = detail::Allocate(alloc_, BucketSize(k));
+        if (elements.has_error())
+        {
+            detail::Deallocate(bucket_alloc, b.value(), 1);
+            return cpp::fail(std::move(elements).error());
+        }
+        word_allocator word_alloc(alloc_);
+        auto ready = detail::Allocate(word_alloc, WordsOf(k));
+        if (ready.has_error())
+        {
+            detail::Deallocate(alloc_, elements.value(), BucketSize(k));
+            detail::Deallocate(bucket_alloc, b.value(), 1);
+            return cpp::fail(std::move(ready).error());
+        }
+        for (size_type i = 0; i < WordsOf(k); ++i)
+        {
+            new (&ready.value()[i]) word(0);
+        }
+
+        bucket* fresh = new (b.value()) bucket{elements.value(), ready.value()};
+        bucket* expected = nullptr;
+        if (!buckets_[k].compare_exchange_strong(
+                expected, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            // Another thread published the bucket first.
+            FreeBucket(k, fresh);
+        }
+        return {};
+    }
+
+    void FreeBucket(size_type k, bucket* b) noexcept
+    {
+        if (b == nullptr)
+        {
+            return;
+        }
+        word_allocator word_alloc(alloc_);
+        detail::Deallocate(word_alloc, b->ready, WordsOf(k));
+        detail::Deallocate(alloc_, b->elements, BucketSize(k));
+        bucket_allocator bucket_alloc(alloc_);
+        detail::Deallocate(bucket_alloc, b, 1);
+    }
+
+    allocator_type alloc_;
+    std::atomic<size_type> size_{0};
+    std::atomic<bucket*> buckets_[kMaxBuckets] = {};
+};
+
+}  // namespace safe_containers
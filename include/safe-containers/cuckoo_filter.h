@@ -0,0 +1,369 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/hash.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+#include <safe-containers/span.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `cuckoo_filter` is an approximate set which, unlike a Bloom filter, supports
+// erasing keys. It answers whether a key may have been inserted with no false
+// negatives, & about 0.01% false positives. Its storage is a single allocation made
+// by `Create`.
+//
+// Each key is reduced to a 16-bit fingerprint, stored in one of two buckets of four
+// fingerprints: its home bucket, or the home bucket XOR a hash of the fingerprint, so
+// either bucket can be found from the other & a fingerprint alone. When both buckets
+// are full, a random fingerprint is evicted to its alternate bucket, up to
+// `kMaxKicks` times. If that doesn't free a slot, the evictions are undone & an error
+// is returned, leaving the filter unchanged. Filters fill to about 95% of their slots
+// before inserts start failing.
+//
+// A bucket is a 64-bit word, so probing compares the four fingerprints of a bucket at
+// once with SWAR arithmetic. `contains` over a span of keys hashes a batch of keys &
+// prefetches their buckets before probing any of them.
+template <
+    typename Key,
+    typename Hash = std::hash<Key>,
+    typename AllocatorType = std::allocator<Key>>
+class cuckoo_filter
+{
+    using bucket = std::uint64_t;
+    using traits = std::allocator_traits<AllocatorType>;
+    using bucket_allocator = typename traits::template rebind_alloc<bucket>;
+
+    static constexpr std::size_t kSlots = 4;
+    static constexpr bucket kLanes = 0x0001000100010001ULL;
+    static constexpr bucket kHighBits = 0x8000800080008000ULL;
+    // Number of keys hashed & prefetched ahead of probing in bulk lookups.
+    static constexpr std::size_t kBatchSize = 16;
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using key_type = Key;
+    using hasher = Hash;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+
+    static constexpr size_type kMaxKicks = 500;
+
+    explicit cuckoo_filter(const allocator_type& alloc, const Hash& hash = Hash()) noexcept
+        : alloc_(alloc),
+          hash_(hash)
+    {
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    cuckoo_filter(const cuckoo_filter&) = delete;
+    cuckoo_filter& operator=(const cuckoo_filter&) = delete;
+
+    cuckoo_filter(cuckoo_filter&& other) noexcept
+        : cuckoo_filter(other.alloc_, other.hash_)
+    {
+        swap(other);
+    }
+
+    cuckoo_filter& operator=(cuckoo_filter&& other) noexcept
+    {
+        cuckoo_filter tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    ~cuckoo_filter() { Destroy(); }
+
+    // Creates a filter with room for at least `capacity` keys.
+    static result<cuckoo_filter> Create(
+        size_type capacity, const allocator_type& alloc, const Hash& hash = Hash()) noexcept
+    {
+        if (capacity > (size_type{1} << 34))
+        {
+            return cpp::fail(ContainerError{});
+        }
+        // Size for a 90% load, comfortably below where inserts start failing, rounding up,
+        // plus a spare bucket, as small filters fail inserts at lower loads.
+        const size_type slots = capacity + (capacity + 8) / 9 + kSlots;
+        const size_type needed = (slots + kSlots - 1) / kSlots;
+        const size_type count = detail::NextPowerOfTwo(needed);
+        if (count == 0 || count > (size_type{1} << 32))
+        {
+            return cpp::fail(ContainerError{});
+        }
+        cuckoo_filter filter(alloc, hash);
+        TRY(filter.Allocate(count));
+        return filter;
+    }
+
+    result<cuckoo_filter> Clone() const noexcept
+    {
+        cuckoo_filter filter(alloc_, hash_);
+        TRY(filter.Allocate(bucket_count_));
+        std::memcpy(filter.buckets_, buckets_, bucket_count_ * sizeof(bucket));
+        filter.size_ = size_;
+        filter.rng_ = rng_;
+        return filter;
+    }
+
+    allocator_type get_allocator() const noexcept { return alloc_; }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    size_type size() const noexcept { return size_; }
+    size_type capacity() const noexcept { return bucket_count_ * kSlots; }
+
+    // Adds `key`. Inserting a key more than once stores it more than once, so each
+    // copy can be erased. Fails if no slot can be freed for it.
+    result<void> insert(const Key& key) noexcept
+    {
+        if (bucket_count_ == 0)
+        {
+            return cpp::fail(ContainerError{});
+        }
+        const std::uint64_t h = HashOf(key);
+        std::uint16_t fp = FingerprintOf(h);
+        size_type i = HomeOf(h);
+        if (TryPlace(i, fp) || TryPlace(AlternateOf(i, fp), fp))
+        {
+            ++size_;
+            return {};
+        }
+
+        // Evict random fingerprints along a path, recording it to undo it on failure.
+        struct kick
+        {
+            std::uint32_t bucket;
+            std::uint8_t slot;
+        };
+        kick path[kMaxKicks];
+        for (size_type n = 0; n < kMaxKicks; ++n)
+        {
+            const auto slot = static_cast<std::uint8_t>(NextRandom() % kSlots);
+            path[n] = kick{static_cast<std::uint32_t>(i), slot};
+            fp = Exchange(i, slot, fp);
+            i = AlternateOf(i, fp);
+            if (TryPlace(i, fp))
+            {
+                ++size_;
+                return {};
+            }
+        }
+        for (size_type n = kMaxKicks; n-- > 0;)
+        {
+            fp = Exchange(path[n].bucket, path[n].slot, fp);
+        }
+        return cpp::fail(ContainerError{});
+    }
+
+    // Whether `key` may have been inserted.
+    bool contains(const Key& key) const noexcept
+    {
+        return bucket_count_ > 0 && ContainsHash(HashOf(key));
+    }
+
+    // Sets `results[i]` to whether `keys[i]` may have been inserted. `results` must
+    // be at least as long as `keys`.
+    void contains(span<const Key> keys, span<bool> results) const noexcept
+    {
+        if (bucket_count_ == 0)
+        {
+            std::fill(results.begin(), results.begin() + keys.size(), false);
+            return;
+        }
+        std::uint64_t hashes[kBatchSize];
+        for (size_type first = 0; first < keys.size(); first += kBatchSize)
+        {
+            const size_type n = std::min(kBatchSize, keys.size() - first);
+            for (size_type i = 0; i < n; ++i)
+            {
+                hashes[i] = HashOf(keys[first + i]);
+                const size_type home = HomeOf(hashes[i]);
+                __builtin_prefetch(&buckets_[home]);
+                __builtin_prefetch(&buckets_[AlternateOf(home, FingerprintOf(hashes[i]))]);
+            }
+            for (size_type i = 0; i < n; ++i)
+            {
+                results[first + i] = ContainsHash(hashes[i]);
+            }
+        }
+    }
+
+    // Removes one copy of `key`. Returns whether one was found. Only keys which were
+    // inserted may be erased, as the fingerprint of another key may match.
+    bool erase(const Key& key) noexcept
+    {
+        if (bucket_count_ == 0)
+        {
+            return false;
+        }
+        const std::uint64_t h = HashOf(key);
+        const std::uint16_t fp = FingerprintOf(h);
+        const size_type home = HomeOf(h);
+        if (Remove(home, fp) || Remove(AlternateOf(home, fp), fp))
+        {
+            --size_;
+            return true;
+        }
+        return false;
+    }
+
+    // Forgets all keys.
+    void clear() noexcept
+    {
+        if (buckets_ != nullptr)
+        {
+            std::memset(buckets_, 0, bucket_count_ * sizeof(bucket));
+        }
+        size_ = 0;
+    }
+
+    void swap(cuckoo_filter& other) noexcept
+    {
+        std::swap(alloc_, other.alloc_);
+        std::swap(hash_, other.hash_);
+        std::swap(buckets_, other.buckets_);
+        std::swap(bucket_count_, other.bucket_count_);
+        std::swap(size_, other.size_);
+        std::swap(rng_, other.rng_);
+    }
+
+   private:
+    std::uint64_t HashOf(const Key& key) const noexcept
+    {
+        return detail::MixHash(static_cast<std::uint64_t>(hash_(key)));
+    }
+
+    // The fingerprint of `h`. 0 marks an empty slot, so it's never a fingerprint.
+    static std::uint16_t FingerprintOf(std::uint64_t h) noexcept
+    {
+        const auto fp = static_cast<std::uint16_t>(h >> 48);
+        return fp == 0 ? 1 : fp;
+    }
+
+    size_type HomeOf(std::uint64_t h) const noexcept
+    {
+        return static_cast<size_type>(h) & (bucket_count_ - 1);
+    }
+
+    // Flipping at least the lowest bit, so the two buckets of a key always differ once
+    // there are two buckets, which small filters depend on to reach their capacity.
+    size_type AlternateOf(size_type i, std::uint16_t fp) const noexcept
+    {
+        const auto offset = static_cast<size_type>(detail::MixHash(fp)) | 1;
+        return (i ^ offset) & (bucket_count_ - 1);
+    }
+
+    static std::uint16_t SlotOf(bucket b, size_type slot) noexcept
+    {
+        return static_cast<std::uint16_t>(b >> (16 * slot));
+    }
+
+    // Whether any 16-bit lane of `b` is 0.
+    static bool HasZeroLane(bucket b) noexcept
+    {
+        return ((b - kLanes) & ~b & kHighBits) != 0;
+    }
+
+    bool ContainsHash(std::uint64_t h) const noexcept
+    {
+        const std::uint16_t fp = FingerprintOf(h);
+        const bucket lanes = kLanes * fp;
+        const size_type home = HomeOf(h);
+        return HasZeroLane(buckets_[home] ^ lanes) ||
+               HasZeroLane(buckets_[AlternateOf(home, fp)] ^ lanes);
+    }
+
+    // Stores `fp` in a free slot of bucket `i`, if any.
+    bool TryPlace(size_type i, std::uint16_t fp) noexcept
+    {
+        for (size_type slot = 0; slot < kSlots; ++slot)
+        {
+            if (SlotOf(buckets_[i], slot) == 0)
+            {
+                Exchange(i, slot, fp);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Clears a slot of bucket `i` holding `fp`, if any.
+    bool Remove(size_type i, std::uint16_t fp) noexcept
+    {
+        for (size_type slot = 0; slot < kSlots; ++slot)
+        {
+            if (SlotOf(buckets_[i], slot) == fp)
+            {
+                Exchange(i, slot, 0);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Stores `fp` in `slot` of bucket `i`, returning the previous fingerprint.
+    std::uint16_t Exchange(size_type i, size_type slot, std::uint16_t fp) noexcept
+    {
+        const std::uint16_t previous = SlotOf(buckets_[i], slot);
+        const size_type shift = 16 * slot;
+        buckets_[i] = (buckets_[i] & ~(bucket{0xffff} << shift)) | (bucket{fp} << shift);
+        return previous;
+    }
+
+    // xorshift64, picking the slots to evict.
+    std::uint64_t NextRandom() noexcept
+    {
+        rng_ ^= rng_ << 13;
+        rng_ ^= rng_ >> 7;
+        rng_ ^= rng_ << 17;
+        return rng_;
+    }
+
+    result<void> Allocate(size_type count) noexcept
+    {
+        bucket_allocator alloc(alloc_);
+        auto buckets = detail::Allocate(alloc, count);
+        if (buckets.has_error())
+        {
+            return cpp::fail(std::move(buckets).error());
+        }
+        buckets_ = buckets.value();
+        bucket_count_ = count;
+        clear();
+        return {};
+    }
+
+    void Destroy() noexcept
+    {
+        if (buckets_ != nullptr)
+        {
+            bucket_allocator alloc(alloc_);
+            detail::Deallocate(alloc, buckets_, bucket_count_);
+            buckets_ = nullptr;
+            bucket_count_ = 0;
+        }
+    }
+
+    allocator_type alloc_;
+    hasher hash_;
+    bucket* buckets_ = nullptr;
+    size_type bucket_count_ = 0;
+    size_type size_ = 0;
+    std::uint64_t rng_ = 0x9e3779b97f4a7c15ULL;
+};
+
+}  // namespace safe_containers
@@ -0,0 +1,564 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+#include <safe-containers/type_traits.h>
+
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `deque` is a double-ended queue with fallible allocation handling using `result`
+// types, following the conventions of `safe_containers::vector`.
+//
+// Elements are stored in fixed-size chunks of `ChunkBytes` bytes, which are indexed
+// through a circular map of chunk pointers. Unlike `std::deque`, the chunk size is
+// configurable and chunks released by popping are kept in a small cache of spare
+// chunks, so steady-state queue workloads don't allocate at all.
+//
+// References to elements remain valid when pushing or popping at either end,
+// except for references to the popped elements.
+template <typename T, typename AllocatorType = std::allocator<T>, std::size_t ChunkBytes = 4096>
+class deque
+{
+    template <bool Const>
+    class iterator_impl;
+
+    using traits = std::allocator_traits<AllocatorType>;
+    using map_allocator = typename traits::template rebind_alloc<T*>;
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using value_type = T;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = iterator_impl<false>;
+    using const_iterator = iterator_impl<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    // Number of elements per chunk.
+    static constexpr size_type kChunkSize = ChunkBytes / sizeof(T) > 0 ? ChunkBytes / sizeof(T) : 1;
+    // Number of spare chunks cached by default.
+    static constexpr size_type kDefaultMaxSpareChunks = 2;
+
+    static_assert(
+        std::is_same_v<typename traits::pointer, T*>, "Fancy allocator pointers are not supported");
+    static_assert(
+        kChunkSize * sizeof(T) >= sizeof(T*), "A chunk must be able to hold a spare-chunk link");
+
+   public:
+    MAYBE_CONSTEXPR explicit deque(const allocator_type& alloc) noexcept
+        : alloc_(alloc)
+    {
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    deque(const deque&) = delete;
+    deque& operator=(const deque&) = delete;
+
+    deque(deque&& other) noexcept
+        : alloc_(std::move(other.alloc_)),
+          map_(std::exchange(other.map_, nullptr)),
+          map_capacity_(std::exchange(other.map_capacity_, 0)),
+          first_chunk_(std::exchange(other.first_chunk_, 0)),
+          chunk_count_(std::exchange(other.chunk_count_, 0)),
+          begin_(std::exchange(other.begin_, 0)),
+          size_(std::exchange(other.size_, 0)),
+          spare_(std::exchange(other.spare_, nullptr)),
+          spare_count_(std::exchange(other.spare_count_, 0)),
+          max_spare_(other.max_spare_)
+    {
+    }
+
+    deque& operator=(deque&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Destroy();
+            alloc_ = std::move(other.alloc_);
+            map_ = std::exchange(other.map_, nullptr);
+            map_capacity_ = std::exchange(other.map_capacity_, 0);
+            first_chunk_ = std::exchange(other.first_chunk_, 0);
+            chunk_count_ = std::exchange(other.chunk_count_, 0);
+            begin_ = std::exchange(other.begin_, 0);
+            size_ = std::exchange(other.size_, 0);
+            spare_ = std::exchange(other.spare_, nullptr);
+            spare_count_ = std::exchange(other.spare_count_, 0);
+            max_spare_ = other.max_spare_;
+        }
+        return *this;
+    }
+
+    ~deque() { Destroy(); }
+
+    result<deque> Clone() const noexcept { return Create(cbegin(), cend(), alloc_); }
+
+    // Utility wrapper around the plain `deque` so `Create` can be
+    // used regardless of fallibility.
+    static result<deque> Create(const allocator_type& alloc) noexcept
+    {
+        return result<deque>(cpp::in_place, alloc);
+    }
+
+    static result<deque> Create(size_type count, const allocator_type& alloc) noexcept
+    {
+        deque d{alloc};
+        TRY(d.resize(count));
+        return d;
+    }
+
+    static result<deque> Create(
+        size_type count, const T& value, const allocator_type& alloc) noexcept
+    {
+        deque d{alloc};
+        TRY(d.resize(count, value));
+        return d;
+    }
+
+    template <typename InputIt>
+    static result<deque> Create(InputIt first, InputIt last, const allocator_type& alloc) noexcept
+    {
+        deque d{alloc};
+        for (; first != last; ++first)
+        {
+            TRY(d.push_back(*first));
+        }
+        return d;
+    }
+
+    static result<deque> Create(
+        std::initializer_list<T> values, const allocator_type& alloc) noexcept
+    {
+        return Create(values.begin(), values.end(), alloc);
+    }
+
+    allocator_type get_allocator() const noexcept { return alloc_; }
+
+    reference operator[](size_type pos) noexcept { return *Slot(begin_ + pos); }
+    const_reference operator[](size_type pos) const noexcept { return *Slot(begin_ + pos); }
+    reference front() noexcept { return *Slot(begin_); }
+    const_reference front() const noexcept { return *Slot(begin_); }
+    reference back() noexcept { return *Slot(begin_ + size_ - 1); }
+    const_reference back() const noexcept { return *Slot(begin_ + size_ - 1); }
+
+    iterator begin() noexcept { return iterator(this, 0); }
+    const_iterator begin() const noexcept { return const_iterator(this, 0); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return iterator(this, size_); }
+    const_iterator end() const noexcept { return const_iterator(this, size_); }
+    const_iterator cend() const noexcept { return end(); }
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    size_type size() const noexcept { return size_; }
+    size_type chunk_count() const noexcept { return chunk_count_; }
+    size_type spare_chunk_count() const noexcept { return spare_count_; }
+
+    // Sets the maximum number of cached spare chunks, releasing any excess ones.
+    void set_max_spare_chunks(size_type count) noexcept
+    {
+        max_spare_ = count;
+        while (spare_count_ > max_spare_)
+        {
+            detail::Deallocate(alloc_, PopSpare(), kChunkSize);
+        }
+    }
+
+    // Releases all cached spare chunks.
+    void shrink_to_fit() noexcept
+    {
+        while (spare_count_ > 0)
+        {
+            detail::Deallocate(alloc_, PopSpare(), kChunkSize);
+        }
+    }
+
+    template <typename... Args>
+    result<void> push_back(Args&&... args) noexcept
+    {
+        auto res = emplace_back(std::forward<Args>(args)...);
+        if (res.has_error())
+        {
+            return cpp::fail(std::move(res).error());
+        }
+        return {};
+    }
+
+    template <typename... Args>
+    result<void> push_front(Args&&... args) noexcept
+    {
+        auto res = emplace_front(std::forward<Args>(args)...);
+        if (res.has_error())
+        {
+            return cpp::fail(std::move(res).error());
+        }
+        return {};
+    }
+
+    template <typename... Args>
+    result<reference> emplace_back(Args&&... args) noexcept
+    {
+        static_assert(
+            !contains_type<allocator_type, Args...>::value,
+            "Arguments cannot contain an allocator type");
+        TRY(EnsureBackChunk());
+        T* slot = Slot(begin_ + size_);
+        SAFE_CONTAINERS_CATCH_OOM(traits::construct(alloc_, slot, std::forward<Args>(args)...));
+        ++size_;
+        return *slot;
+    }
+
+    template <typename... Args>
+    result<reference> emplace_front(Args&&... args) noexcept
+    {
+        static_assert(
+            !contains_type<allocator_type, Args...>::value,
+            "Arguments cannot contain an allocator type");
+        TRY(EnsureFrontChunk());
+        T* slot = Slot(begin_ - 1);
+        SAFE_CONTAINERS_CATCH_OOM(traits::construct(alloc_, slot, std::forward<Args>(args)...));
+        --begin_;
+        ++size_;
+        return *slot;
+    }
+
+    void pop_back() noexcept
+    {
+        traits::destroy(alloc_, Slot(begin_ + size_ - 1));
+        --size_;
+        TrimBack();
+    }
+
+    void pop_front() noexcept
+    {
+        traits::destroy(alloc_, Slot(begin_));
+        ++begin_;
+        --size_;
+        TrimFront();
+    }
+
+    // Resizes the deque to `count` elements. If growing fails, the deque is left
+    // unchanged.
+    result<void> resize(size_type count) noexcept { return ResizeWith(count); }
+
+    result<void> resize(size_type count, const value_type& value) noexcept
+    {
+        return ResizeWith(count, value);
+    }
+
+    // Destroys all elements. Released chunks are kept as spare chunks, up to the limit.
+    void clear() noexcept
+    {
+        while (size_ > 0)
+        {
+            pop_back();
+        }
+        while (chunk_count_ > 0)
+        {
+            ReleaseChunk(map_[(first_chunk_ + --chunk_count_) & (map_capacity_ - 1)]);
+        }
+        begin_ = 0;
+    }
+
+    void swap(deque& other) noexcept
+    {
+        deque tmp = std::move(other);
+        other = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+   private:
+    // Returns the slot at position `pos`, relative to the start of the first chunk.
+    T* Slot(size_type pos) const noexcept
+    {
+        return map_[(first_chunk_ + pos / kChunkSize) & (map_capacity_ - 1)] + pos % kChunkSize;
+    }
+
+    template <typename... Args>
+    result<void> ResizeWith(size_type count, const Args&... args) noexcept
+    {
+        const size_type original = size_;
+        while (size_ < count)
+        {
+            if (emplace_back(args...).has_error())
+            {
+                while (size_ > original)
+                {
+                    pop_back();
+                }
+                return cpp::fail(ContainerError{});
+            }
+        }
+        while (size_ > count)
+        {
+            pop_back();
+        }
+        return {};
+    }
+
+    // Ensures the map can hold one more chunk pointer.
+    result<void> ReserveMapSlot() noexcept
+    {
+        if (chunk_count_ < map_capacity_)
+        {
+            return {};
+        }
+        map_allocator map_alloc(alloc_);
+        const size_type capacity = map_capacity_ == 0 ? 8 : map_capacity_ * 2;
+        auto map = detail::Allocate(map_alloc, capacity);
+        if (map.has_error())
+        {
+            return cpp::fail(std::move(map).error());
+        }
+        for (size_type i = 0; i < chunk_count_; ++i)
+        {
+            map.value()[i] = map_[(first_chunk_ + i) & (map_capacity_ - 1)];
+        }
+        if (map_ != nullptr)
+        {
+            detail::Deallocate(map_alloc, map_, map_capacity_);
+        }
+        map_ = map.value();
+        map_capacity_ = capacity;
+        first_chunk_ = 0;
+        return {};
+    }
+
+    result<T*> AcquireChunk() noexcept
+    {
+        if (spare_count_ > 0)
+        {
+            return PopSpare();
+        }
+        return detail::Allocate(alloc_, kChunkSize);
+    }
+
+    void ReleaseChunk(T* chunk) noexcept
+    {
+        if (spare_count_ >= max_spare_)
+        {
+            detail::Deallocate(alloc_, chunk, kChunkSize);
+            return;
+        }
+        // Spare chunks form an intrusive list through their first bytes.
+        std::memcpy(static_cast<void*>(chunk), &spare_, sizeof(T*));
+        spare_ = chunk;
+        ++spare_count_;
+    }
+
+    T* PopSpare() noexcept
+    {
+        T* chunk = spare_;
+        std::memcpy(&spare_, static_cast<const void*>(chunk), sizeof(T*));
+        --spare_count_;
+        return chunk;
+    }
+
+    // Appends a chunk if there is no free slot after the last element.
+    result<void> EnsureBackChunk() noexcept
+    {
+        if (begin_ + size_ < chunk_count_ * kChunkSize)
+        {
+            return {};
+        }
+        TRY(ReserveMapSlot());
+        auto chunk = AcquireChunk();
+        if (chunk.has_error())
+        {
+            return cpp::fail(std::move(chunk).error());
+        }
+        map_[(first_chunk_ + chunk_count_) & (map_capacity_ - 1)] = chunk.value();
+        ++chunk_count_;
+        return {};
+    }
+
+    // Prepends a chunk if there is no free slot before the first element.
+    result<void> EnsureFrontChunk() noexcept
+    {
+        if (begin_ > 0)
+        {
+            return {};
+        }
+        TRY(ReserveMapSlot());
+        auto chunk = AcquireChunk();
+        if (chunk.has_error())
+        {
+            return cpp::fail(std::move(chunk).error());
+        }
+        first_chunk_ = (first_chunk_ - 1) & (map_capacity_ - 1);
+        map_[first_chunk_] = chunk.value();
+        ++chunk_count_;
+        begin_ += kChunkSize;
+        return {};
+    }
+
+    // Releases chunks which no longer hold any element at the back.
+    void TrimBack() noexcept
+    {
+        while (chunk_count_ * kChunkSize - (begin_ + size_) >= kChunkSize)
+        {
+            --chunk_count_;
+            ReleaseChunk(map_[(first_chunk_ + chunk_count_) & (map_capacity_ - 1)]);
+        }
+    }
+
+    // Releases chunks which no longer hold any element at the front.
+    void TrimFront() noexcept
+    {
+        while (begin_ >= kChunkSize)
+        {
+            ReleaseChunk(map_[first_chunk_]);
+            first_chunk_ = (first_chunk_ + 1) & (map_capacity_ - 1);
+            --chunk_count_;
+            begin_ -= kChunkSize;
+        }
+    }
+
+    void Destroy() noexcept
+    {
+        clear();
+        shrink_to_fit();
+        if (map_ != nullptr)
+        {
+            map_allocator map_alloc(alloc_);
+            detail::Deallocate(map_alloc, map_, map_capacity_);
+            map_ = nullptr;
+            map_capacity_ = 0;
+        }
+    }
+
+    template <bool Const>
+    class iterator_impl
+    {
+        using owner = std::conditional_t<Const, const deque, deque>;
+
+       public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using reference = std::conditional_t<Const, const T&, T&>;
+
+        iterator_impl() noexcept = default;
+        iterator_impl(owner* d, size_type index) noexcept
+            : deque_(d),
+              index_(index)
+        {
+        }
+
+        // Allow conversion from iterator to const_iterator.
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        iterator_impl(const iterator_impl<false>& other) noexcept
+            : deque_(other.deque_),
+              index_(other.index_)
+        {
+        }
+
+        reference operator*() const noexcept { return (*deque_)[index_]; }
+        pointer operator->() const noexcept { return &(*deque_)[index_]; }
+        reference operator[](difference_type n) const noexcept { return *(*this + n); }
+
+        iterator_impl& operator++() noexcept
+        {
+            ++index_;
+            return *this;
+        }
+        iterator_impl operator++(int) noexcept { return iterator_impl(deque_, index_++); }
+        iterator_impl& operator--() noexcept
+        {
+            --index_;
+            return *this;
+        }
+        iterator_impl operator--(int) noexcept { return iterator_impl(deque_, index_--); }
+        iterator_impl& operator+=(difference_type n) noexcept
+        {
+            index_ = static_cast<size_type>(static_cast<difference_type>(index_) + n);
+            return *this;
+        }
+        iterator_impl& operator-=(difference_type n) noexcept { return *this += -n; }
+        friend iterator_impl operator+(iterator_impl it, difference_type n) noexcept
+        {
+            return it += n;
+        }
+        friend iterator_impl operator+(difference_type n, iterator_impl it) noexcept
+        {
+            return it += n;
+        }
+        friend iterator_impl operator-(iterator_impl it, difference_type n) noexcept
+        {
+            return it -= n;
+        }
+        friend difference_type operator-(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return static_cast<difference_type>(a.index_) - static_cast<difference_type>(b.index_);
+        }
+
+        friend bool operator==(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.index_ == b.index_;
+        }
+        friend bool operator!=(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.index_ != b.index_;
+        }
+        friend bool operator<(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.index_ < b.index_;
+        }
+        friend bool operator>(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.index_ > b.index_;
+        }
+        friend bool operator<=(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.index_ <= b.index_;
+        }
+        friend bool operator>=(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.index_ >= b.index_;
+        }
+
+       private:
+        friend class iterator_impl<!Const>;
+
+        owner* deque_ = nullptr;
+        size_type index_ = 0;
+    };
+
+    allocator_type alloc_;
+    // Circular map of chunk pointers, with a power-of-two capacity.
+    T** map_ = nullptr;
+    size_type map_capacity_ = 0;
+    size_type first_chunk_ = 0;
+    size_type chunk_count_ = 0;
+    // Position of the first element, relative to the start of the first chunk.
+    size_type begin_ = 0;
+    size_type size_ = 0;
+    // Intrusive list of cached spare chunks.
+    T* spare_ = nullptr;
+    size_type spare_count_ = 0;
+    size_type max_spare_ = kDefaultMaxSpareChunks;
+};
+
+}  // namespace safe_containers
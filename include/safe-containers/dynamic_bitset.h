@@ -0,0 +1,395 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+#include <safe-containers/vector.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace safe_containers
+{
+namespace detail
+{
+
+enum class bit_op
+{
+    kAnd,
+    kOr,
+    kXor,
+    kAndNot,
+};
+
+template <bit_op Op>
+inline std::uint64_t ApplyBitOp(std::uint64_t a, std::uint64_t b) noexcept
+{
+    if constexpr (Op == bit_op::kAnd)
+    {
+        return a & b;
+    }
+    else if constexpr (Op == bit_op::kOr)
+    {
+        return a | b;
+    }
+    else if constexpr (Op == bit_op::kXor)
+    {
+        return a ^ b;
+    }
+    else
+    {
+        return a & ~b;
+    }
+}
+
+// Computes `a[i] = a[i] Op b[i]` for `n` words, using the widest vector registers
+// enabled at compile time.
+template <bit_op Op>
+inline void ApplyBitOp(std::uint64_t* a, const std::uint64_t* b, std::size_t n) noexcept
+{
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i r;
+        if constexpr (Op == bit_op::kAnd)
+        {
+            r = _mm256_and_si256(x, y);
+        }
+        else if constexpr (Op == bit_op::kOr)
+        {
+            r = _mm256_or_si256(x, y);
+        }
+        else if constexpr (Op == bit_op::kXor)
+        {
+            r = _mm256_xor_si256(x, y);
+        }
+        else
+        {
+            r = _mm256_andnot_si256(y, x);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), r);
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= n; i += 2)
+    {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i r;
+        if constexpr (Op == bit_op::kAnd)
+        {
+            r = _mm_and_si128(x, y);
+        }
+        else if constexpr (Op == bit_op::kOr)
+        {
+            r = _mm_or_si128(x, y);
+        }
+        else if constexpr (Op == bit_op::kXor)
+        {
+            r = _mm_xor_si128(x, y);
+        }
+        else
+        {
+            r = _mm_andnot_si128(y, x);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(a + i), r);
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        a[i] = ApplyBitOp<Op>(a[i], b[i]);
+    }
+}
+
+inline std::size_t PopCount(const std::uint64_t* words, std::size_t n) noexcept
+{
+    // Independent accumulators keep several `popcnt` instructions in flight.
+    std::size_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        c0 += static_cast<std::size_t>(__builtin_popcountll(words[i]));
+        c1 += static_cast<std::size_t>(__builtin_popcountll(words[i + 1]));
+        c2 += static_cast<std::size_t>(__builtin_popcountll(words[i + 2]));
+        c3 += static_cast<std::size_t>(__builtin_popcountll(words[i + 3]));
+    }
+    for (; i < n; ++i)
+    {
+        c0 += static_cast<std::size_t>(__builtin_popcountll(words[i]));
+    }
+    return c0 + c1 + c2 + c3;
+}
+
+}  // namespace detail
+
+// `dynamic_bitset` is a resizable sequence of bits, stored in 64-bit words in a
+// `safe_containers::vector`, with fallible allocation handling using `result` types.
+//
+// Bulk operations (`&=`, `|=`, `^=`, `and_not`) process whole words using AVX2 or
+// SSE2 when enabled at compile time, and `count`, `find_first` & `find_next` skip
+// through whole words at a time.
+template <typename AllocatorType = std::allocator<std::uint64_t>>
+class dynamic_bitset
+{
+    using words_type = vector<std::uint64_t, AllocatorType>;
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+    using word_type = std::uint64_t;
+
+    static constexpr size_type kWordBits = 64;
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    explicit dynamic_bitset(const allocator_type& alloc) noexcept
+        : words_(alloc)
+    {
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    dynamic_bitset(const dynamic_bitset&) = delete;
+    dynamic_bitset& operator=(const dynamic_bitset&) = delete;
+
+    dynamic_bitset(dynamic_bitset&& other) noexcept
+        : dynamic_bitset(other.get_allocator())
+    {
+        swap(other);
+    }
+
+    dynamic_bitset& operator=(dynamic_bitset&& other) noexcept
+    {
+        dynamic_bitset tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    // Utility wrapper around the plain `dynamic_bitset` so `Create` can be
+    // used regardless of fallibility.
+    static result<dynamic_bitset> Create(const allocator_type& alloc) noexcept
+    {
+        return result<dynamic_bitset>(cpp::in_place, alloc);
+    }
+
+    static result<dynamic_bitset> Create(
+        size_type count, bool value, const allocator_type& alloc) noexcept
+    {
+        dynamic_bitset b(alloc);
+        TRY(b.resize(count, value));
+        return b;
+    }
+
+    result<dynamic_bitset> Clone() const noexcept
+    {
+        dynamic_bitset b(get_allocator());
+        TRY(b.words_.assign(words_.cbegin(), words_.cend()));
+        b.size_ = size_;
+        return b;
+    }
+
+    allocator_type get_allocator() const noexcept { return words_.get_allocator(); }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    size_type size() const noexcept { return size_; }
+    size_type capacity() const noexcept { return words_.capacity() * kWordBits; }
+
+    // The underlying words. Bits past `size()` in the last word are always zero.
+    const word_type* data() const noexcept { return words_.data(); }
+    size_type num_words() const noexcept { return words_.size(); }
+
+    bool test(size_type pos) const noexcept
+    {
+        return (words_[pos / kWordBits] >> (pos % kWordBits)) & 1;
+    }
+
+    bool operator[](size_type pos) const noexcept { return test(pos); }
+
+    void set(size_type pos, bool value = true) noexcept
+    {
+        const word_type bit = word_type{1} << (pos % kWordBits);
+        word_type& word = words_[pos / kWordBits];
+        word = value ? (word | bit) : (word & ~bit);
+    }
+
+    void reset(size_type pos) noexcept { set(pos, false); }
+    void flip(size_type pos) noexcept
+    {
+        words_[pos / kWordBits] ^= word_type{1} << (pos % kWordBits);
+    }
+
+    // Sets all bits.
+    void set() noexcept
+    {
+        std::fill(words_.begin(), words_.end(), ~word_type{0});
+        ClearUnusedBits();
+    }
+
+    // Clears all bits.
+    void reset() noexcept { std::fill(words_.begin(), words_.end(), word_type{0}); }
+
+    result<void> reserve(size_type count) noexcept
+    {
+        SAFE_CONTAINERS_CATCH_OOM(words_.reserve(WordsFor(count)));
+        return {};
+    }
+
+    result<void> push_back(bool value) noexcept
+    {
+        if (size_ % kWordBits == 0)
+        {
+            TRY(words_.push_back(word_type{0}));
+        }
+        ++size_;
+        set(size_ - 1, value);
+        return {};
+    }
+
+    void pop_back() noexcept
+    {
+        reset(--size_);
+        words_.resize(WordsFor(size_)).expect("shrinking never allocates");
+    }
+
+    // Resizes to `count` bits, setting new bits to `value`. On failure, the bitset is
+    // unchanged.
+    result<void> resize(size_type count, bool value = false) noexcept
+    {
+        const size_type old_size = size_;
+        TRY(words_.resize(WordsFor(count), value ? ~word_type{0} : word_type{0}));
+        size_ = count;
+        if (value && count > old_size && old_size % kWordBits != 0)
+        {
+            // Fill the previously unused bits of the old last word.
+            words_[old_size / kWordBits] |= ~word_type{0} << (old_size % kWordBits);
+        }
+        ClearUnusedBits();
+        return {};
+    }
+
+    void clear() noexcept
+    {
+        words_.clear();
+        size_ = 0;
+    }
+
+    size_type count() const noexcept { return detail::PopCount(words_.data(), words_.size()); }
+
+    bool any() const noexcept
+    {
+        return std::any_of(words_.begin(), words_.end(), [](word_type w) { return w != 0; });
+    }
+
+    bool none() const noexcept { return !any(); }
+    bool all() const noexcept { return count() == size_; }
+
+    // Index of the first set bit, or `npos`.
+    size_type find_first() const noexcept { return FindFrom(0, ~word_type{0}); }
+
+    // Index of the first set bit after `pos`, or `npos`.
+    size_type find_next(size_type pos) const noexcept
+    {
+        ++pos;
+        if (pos >= size_)
+        {
+            return npos;
+        }
+        return FindFrom(pos / kWordBits, ~word_type{0} << (pos % kWordBits));
+    }
+
+    // The bulk operations require both bitsets to have the same size.
+    dynamic_bitset& operator&=(const dynamic_bitset& other) noexcept
+    {
+        return Apply<detail::bit_op::kAnd>(other);
+    }
+
+    dynamic_bitset& operator|=(const dynamic_bitset& other) noexcept
+    {
+        return Apply<detail::bit_op::kOr>(other);
+    }
+
+    dynamic_bitset& operator^=(const dynamic_bitset& other) noexcept
+    {
+        return Apply<detail::bit_op::kXor>(other);
+    }
+
+    // Clears every bit which is set in `other`.
+    dynamic_bitset& and_not(const dynamic_bitset& other) noexcept
+    {
+        return Apply<detail::bit_op::kAndNot>(other);
+    }
+
+    void swap(dynamic_bitset& other) noexcept
+    {
+        words_.swap(other.words_);
+        std::swap(size_, other.size_);
+    }
+
+    friend bool operator==(const dynamic_bitset& a, const dynamic_bitset& b) noexcept
+    {
+        return a.size_ == b.size_ && std::equal(a.words_.begin(), a.words_.end(), b.words_.begin());
+    }
+
+    friend bool operator!=(const dynamic_bitset& a, const dynamic_bitset& b) noexcept
+    {
+        return !(a == b);
+    }
+
+   private:
+    static size_type WordsFor(size_type count) noexcept
+    {
+        return (count + kWordBits - 1) / kWordBits;
+    }
+
+    void ClearUnusedBits() noexcept
+    {
+        if (size_ % kWordBits != 0)
+        {
+            words_.back() &= ~(~word_type{0} << (size_ % kWordBits));
+        }
+    }
+
+    // Searches for a set bit, starting at word `w` masked by `mask`.
+    size_type FindFrom(size_type w, word_type mask) const noexcept
+    {
+        if (w >= words_.size())
+        {
+            return npos;
+        }
+        word_type word = words_[w] & mask;
+        while (word == 0)
+        {
+            if (++w == words_.size())
+            {
+                return npos;
+            }
+            word = words_[w];
+        }
+        return w * kWordBits + static_cast<size_type>(__builtin_ctzll(word));
+    }
+
+    template <detail::bit_op Op>
+    dynamic_bitset& Apply(const dynamic_bitset& other) noexcept
+    {
+        detail::ApplyBitOp<Op>(words_.data(), other.words_.data(), words_.size());
+        return *this;
+    }
+
+    words_type words_;
+    size_type size_ = 0;
+};
+
+}  // namespace safe_containers
@@ -0,0 +1,388 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `epoch_domain` implements epoch-based reclamation (EBR): objects unlinked from a
+// shared structure are retired instead of freed, and only reclaimed once no thread
+// can still be reading them.
+//
+// Every thread using the domain registers once, obtaining a `handle`, and pins the
+// handle around each access to the shared structure. Pinning records the global
+// epoch in the thread's own cache line. The global epoch only advances when every
+// pinned thread has observed the current one, so an object retired in epoch `e` is
+// unreachable by any thread once the global epoch reaches `e + 2`.
+//
+// Retired objects are batched per thread in fixed-size segments, which are allocated
+// through the domain's allocator. If a segment can't be allocated, the retiring
+// thread waits for a grace period & reclaims the object synchronously instead, so
+// retiring never fails.
+//
+// All handles must be destroyed before their domain.
+template <typename AllocatorType = std::allocator<std::byte>>
+class epoch_domain
+{
+   public:
+    using reclaim_fn = void (*)(void* object, void* context) noexcept;
+
+   private:
+    static constexpr std::size_t kSegmentSize = 64;
+    // Number of retired objects after which a thread tries to reclaim its batch.
+    static constexpr std::size_t kCollectInterval = kSegmentSize;
+    static constexpr std::uint64_t kPinned = 1;
+
+    struct retired
+    {
+        void* object;
+        reclaim_fn reclaim;
+        void* context;
+        std::uint64_t epoch;
+    };
+
+    struct segment
+    {
+        retired entries[kSegmentSize];
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        segment* next = nullptr;
+    };
+
+    struct alignas(SAFE_CONTAINERS_CACHE_LINE_SIZE) record
+    {
+        // `(epoch << 1) | kPinned` while pinned, 0 otherwise.
+        std::atomic<std::uint64_t> state{0};
+        std::atomic<bool> in_use{true};
+        // Immutable once the record is published.
+        record* next = nullptr;
+
+        // Owner only. Retired objects are ordered by epoch, oldest first.
+        std::size_t nesting = 0;
+        std::size_t since_collect = 0;
+        segment* oldest = nullptr;
+        segment* newest = nullptr;
+        segment* spare = nullptr;
+    };
+
+    using traits = std::allocator_traits<AllocatorType>;
+    using record_allocator = typename traits::template rebind_alloc<record>;
+    using segment_allocator = typename traits::template rebind_alloc<segment>;
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using allocator_type = AllocatorType;
+
+    class guard;
+
+    // A thread's registration with the domain. Must only be used by one thread at a
+    // time. Destroying the handle releases its registration for reuse by later
+    // threads; objects it retired which can't be reclaimed yet stay with the
+    // registration.
+    class handle
+    {
+       public:
+        handle(const handle&) = delete;
+        handle& operator=(const handle&) = delete;
+
+        handle(handle&& other) noexcept
+            : domain_(std::exchange(other.domain_, nullptr)),
+              record_(std::exchange(other.record_, nullptr))
+        {
+        }
+
+        handle& operator=(handle&&) = delete;
+
+        ~handle()
+        {
+            if (record_ != nullptr)
+            {
+                Collect();
+                record_->in_use.store(false, std::memory_order_release);
+            }
+        }
+
+        // Enters a critical section. Pointers loaded from the shared structure stay
+        // valid until the matching `Unpin`. Pins nest.
+        void Pin() noexcept
+        {
+            if (record_->nesting++ == 0)
+            {
+                const std::uint64_t epoch = domain_->epoch_.load(std::memory_order_relaxed);
+                record_->state.store((epoch << 1) | kPinned, std::memory_order_relaxed);
+                // Publish the pin before loading any shared pointer.
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        void Unpin() noexcept
+        {
+            if (--record_->nesting == 0)
+            {
+                record_->state.store(0, std::memory_order_release);
+            }
+        }
+
+        bool is_pinned() const noexcept { return record_->nesting > 0; }
+
+        // Schedules `reclaim(object, context)` to run once no thread can still hold a
+        // reference to `object`, which must already be unreachable for new readers.
+        //
+        // Normally this only appends to the thread's batch. If the batch can't grow,
+        // this waits for a grace period & reclaims `object` before returning, which
+        // would never finish while the calling thread is pinned. Threads which may
+        // retire under memory pressure should therefore retire outside of critical
+        // sections.
+        void Retire(void* object, reclaim_fn reclaim, void* context = nullptr) noexcept
+        {
+            // Order the unlinking of `object` before reading the epoch.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const retired entry{
+                object, reclaim, context, domain_->epoch_.load(std::memory_order_relaxed)};
+            if (++record_->since_collect >= kCollectInterval)
+            {
+                Collect();
+            }
+            if (domain_->Push(*record_, entry))
+            {
+                return;
+            }
+            // Reclaiming may free up a segment.
+            Collect();
+            if (domain_->Push(*record_, entry))
+            {
+                return;
+            }
+            Synchronize();
+            reclaim(object, context);
+            domain_->Reclaim(*record_, domain_->epoch_.load(std::memory_order_acquire));
+        }
+
+        // Retires an object allocated by `new`.
+        template <typename T>
+        void Retire(T* object) noexcept
+        {
+            Retire(object, [](void* p, void*) noexcept { delete static_cast<T*>(p); });
+        }
+
+        // Tries to advance the global epoch, then reclaims this thread's retired
+        // objects which are no longer reachable.
+        void Collect() noexcept
+        {
+            record_->since_collect = 0;
+            domain_->TryAdvance();
+            domain_->Reclaim(*record_, domain_->epoch_.load(std::memory_order_acquire));
+        }
+
+        // Blocks until every thread has left the critical sections it was in when
+        // called. Must not be called while pinned.
+        void Synchronize() noexcept
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const std::uint64_t target = domain_->epoch_.load(std::memory_order_relaxed) + 2;
+            while (domain_->epoch_.load(std::memory_order_acquire) < target)
+            {
+                if (!domain_->TryAdvance())
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+       private:
+        friend class epoch_domain;
+
+        handle(epoch_domain* owner, record* r) noexcept
+            : domain_(owner),
+              record_(r)
+        {
+        }
+
+        epoch_domain* domain_;
+        record* record_;
+    };
+
+    // Pins a handle for the lifetime of the guard.
+    class guard
+    {
+       public:
+        explicit guard(handle& h) noexcept
+            : handle_(h)
+        {
+            handle_.Pin();
+        }
+
+        guard(const guard&) = delete;
+        guard& operator=(const guard&) = delete;
+
+        ~guard() { handle_.Unpin(); }
+
+       private:
+        handle& handle_;
+    };
+
+    MAYBE_CONSTEXPR explicit epoch_domain(const allocator_type& alloc) noexcept
+        : alloc_(alloc)
+    {
+    }
+
+    // Threads hold on to the domain through their handles.
+    epoch_domain(const epoch_domain&) = delete;
+    epoch_domain& operator=(const epoch_domain&) = delete;
+
+    ~epoch_domain()
+    {
+        record_allocator record_alloc(alloc_);
+        record* r = records_.load(std::memory_order_acquire);
+        while (r != nullptr)
+        {
+            record* next = r->next;
+            Reclaim(*r, kReclaimAll);
+            FreeSegment(r->oldest);
+            FreeSegment(r->spare);
+            std::destroy_at(r);
+            detail::Deallocate(record_alloc, r, 1);
+            r = next;
+        }
+    }
+
+    // Registers the calling thread, reusing a released registration if possible.
+    result<handle> Register() noexcept
+    {
+        for (record* r = records_.load(std::memory_order_acquire); r != nullptr; r = r->next)
+        {
+            if (!r->in_use.load(std::memory_order_relaxed) &&
+                !r->in_use.exchange(true, std::memory_order_acquire))
+            {
+                return handle(this, r);
+            }
+        }
+
+        record_allocator record_alloc(alloc_);
+        auto allocated = detail::Allocate(record_alloc, 1);
+        if (allocated.has_error())
+        {
+            return cpp::fail(std::move(allocated).error());
+        }
+        record* r = new (allocated.value()) record();
+        r->next = records_.load(std::memory_order_relaxed);
+        while (!records_.compare_exchange_weak(
+            r->next, r, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+        return handle(this, r);
+    }
+
+    std::uint64_t epoch() const noexcept { return epoch_.load(std::memory_order_acquire); }
+
+   private:
+    static constexpr std::uint64_t kReclaimAll = ~std::uint64_t{0};
+
+    // Advances the global epoch if every pinned thread has observed it. Returns false
+    // if a pinned thread lags behind.
+    bool TryAdvance() noexcept
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+        for (record* r = records_.load(std::memory_order_acquire); r != nullptr; r = r->next)
+        {
+            const std::uint64_t state = r->state.load(std::memory_order_relaxed);
+            if ((state & kPinned) != 0 && (state >> 1) != epoch)
+            {
+                return false;
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Failing means another thread advanced the epoch.
+        epoch_.compare_exchange_strong(
+            epoch, epoch + 1, std::memory_order_release, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Appends to the owner's batch. Returns false if a new segment was needed but
+    // couldn't be allocated.
+    bool Push(record& r, const retired& entry) noexcept
+    {
+        if (r.newest == nullptr || r.newest->end == kSegmentSize)
+        {
+            segment* s = std::exchange(r.spare, nullptr);
+            if (s == nullptr)
+            {
+                segment_allocator segment_alloc(alloc_);
+                auto allocated = detail::Allocate(segment_alloc, 1);
+                if (allocated.has_error())
+                {
+                    return false;
+                }
+                s = new (allocated.value()) segment();
+            }
+            (r.newest != nullptr ? r.newest->next : r.oldest) = s;
+            r.newest = s;
+        }
+        r.newest->entries[r.newest->end++] = entry;
+        return true;
+    }
+
+    // Reclaims the owner's retired objects which are unreachable in `epoch`.
+    void Reclaim(record& r, std::uint64_t epoch) noexcept
+    {
+        while (r.oldest != nullptr)
+        {
+            segment* s = r.oldest;
+            while (s->begin < s->end &&
+                   (epoch == kReclaimAll || s->entries[s->begin].epoch + 2 <= epoch))
+            {
+                const retired& entry = s->entries[s->begin++];
+                entry.reclaim(entry.object, entry.context);
+            }
+            if (s->begin < s->end)
+            {
+                return;
+            }
+            if (s == r.newest)
+            {
+                s->begin = 0;
+                s->end = 0;
+                return;
+            }
+            r.oldest = s->next;
+            // Keep one segment around, so steady-state retiring doesn't allocate.
+            s->begin = 0;
+            s->end = 0;
+            s->next = nullptr;
+            FreeSegment(std::exchange(r.spare, s));
+        }
+    }
+
+    void FreeSegment(segment* s) noexcept
+    {
+        segment_allocator segment_alloc(alloc_);
+        while (s != nullptr)
+        {
+            segment* next = s->next;
+            std::destroy_at(s);
+            detail::Deallocate(segment_alloc, s, 1);
+            s = next;
+        }
+    }
+
+    alignas(SAFE_CONTAINERS_CACHE_LINE_SIZE) std::atomic<std::uint64_t> epoch_{0};
+    // Registrations are never unlinked, only released for reuse.
+    alignas(SAFE_CONTAINERS_CACHE_LINE_SIZE) std::atomic<record*> records_{nullptr};
+    allocator_type alloc_;
+};
+
+}  // namespace safe_containers
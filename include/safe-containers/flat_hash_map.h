@@ -0,0 +1,560 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/hash.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `flat_hash_map` is an open-addressing hash map with linear probing & fallible
+// allocation handling using `result` types.
+//
+// Slots are stored in one contiguous array, next to an array of control bytes. A
+// control byte marks its slot as empty, deleted, or full, in which case it also holds
+// 7 bits of the key's hash, so most mismatching keys are rejected without comparing
+// them.
+//
+// Growing the table rehashes into a freshly allocated table. If that allocation
+// fails, the operation returns an error and the map is left unchanged.
+//
+// Elements are stored as `std::pair<K, V>`, so they can be relocated on rehash
+// without copying the key. Keys must not be modified through iterators.
+template <
+    typename K,
+    typename V,
+    typename Hash = std::hash<K>,
+    typename KeyEqual = std::equal_to<K>,
+    typename AllocatorType = std::allocator<std::pair<K, V>>>
+class flat_hash_map
+{
+    template <bool Const>
+    class iterator_impl;
+
+    using traits = std::allocator_traits<AllocatorType>;
+    using ctrl_allocator = typename traits::template rebind_alloc<std::uint8_t>;
+
+    static constexpr std::uint8_t kEmpty = 0;
+    static constexpr std::uint8_t kDeleted = 1;
+    static constexpr std::uint8_t kFull = 0x80;
+
+   public:
+    template <typename R>
+    using result = cpp::result<R, ContainerError>;
+
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using allocator_type = AllocatorType;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = std::size_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using iterator = iterator_impl<false>;
+    using const_iterator = iterator_impl<true>;
+
+    static_assert(
+        std::is_same_v<typename traits::pointer, value_type*>,
+        "Fancy allocator pointers are not supported");
+
+    MAYBE_CONSTEXPR explicit flat_hash_map(
+        const allocator_type& alloc, const Hash& hash = Hash(), const KeyEqual& eq = KeyEqual())
+        : alloc_(alloc),
+          hash_(hash),
+          eq_(eq)
+    {
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    flat_hash_map(const flat_hash_map&) = delete;
+    flat_hash_map& operator=(const flat_hash_map&) = delete;
+
+    flat_hash_map(flat_hash_map&& other) noexcept
+        : alloc_(std::move(other.alloc_)),
+          hash_(std::move(other.hash_)),
+          eq_(std::move(other.eq_)),
+          ctrl_(std::exchange(other.ctrl_, nullptr)),
+          slots_(std::exchange(other.slots_, nullptr)),
+          capacity_(std::exchange(other.capacity_, 0)),
+          size_(std::exchange(other.size_, 0)),
+          tombstones_(std::exchange(other.tombstones_, 0))
+    {
+    }
+
+    flat_hash_map& operator=(flat_hash_map&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Destroy();
+            alloc_ = std::move(other.alloc_);
+            hash_ = std::move(other.hash_);
+            eq_ = std::move(other.eq_);
+            ctrl_ = std::exchange(other.ctrl_, nullptr);
+            slots_ = std::exchange(other.slots_, nullptr);
+            capacity_ = std::exchange(other.capacity_, 0);
+            size_ = std::exchange(other.size_, 0);
+            tombstones_ = std::exchange(other.tombstones_, 0);
+        }
+        return *this;
+    }
+
+    ~flat_hash_map() { Destroy(); }
+
+    // Utility wrapper around the plain `flat_hash_map` so `Create` can be
+    // used regardless of fallibility.
+    static result<flat_hash_map> Create(const allocator_type& alloc) noexcept
+    {
+        return result<flat_hash_map>(cpp::in_place, alloc);
+    }
+
+    // Creates a map which can hold `count` elements without rehashing.
+    static result<flat_hash_map> Create(size_type count, const allocator_type& alloc) noexcept
+    {
+        flat_hash_map map{alloc};
+        TRY(map.reserve(count));
+        return map;
+    }
+
+    result<flat_hash_map> Clone() const noexcept
+    {
+        auto res = Create(size_, alloc_);
+        if (res.has_error())
+        {
+            return res;
+        }
+        for (const auto& [key, value] : *this)
+        {
+            auto inserted = res.value().try_emplace(key, value);
+            if (inserted.has_error())
+            {
+                return cpp::fail(std::move(inserted).error());
+            }
+        }
+        return res;
+    }
+
+    allocator_type get_allocator() const noexcept { return alloc_; }
+
+    iterator begin() noexcept { return iterator(this, NextFull(0)); }
+    const_iterator begin() const noexcept { return const_iterator(this, NextFull(0)); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return iterator(this, capacity_); }
+    const_iterator end() const noexcept { return const_iterator(this, capacity_); }
+    const_iterator cend() const noexcept { return end(); }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    size_type size() const noexcept { return size_; }
+    size_type capacity() const noexcept { return capacity_; }
+
+    // Ensures `count` elements fit without rehashing.
+    result<void> reserve(size_type count) noexcept
+    {
+        const size_type needed = CapacityFor(count);
+        if (needed == 0)
+        {
+            return cpp::fail(ContainerError{});
+        }
+        if (needed <= capacity_ && (count + tombstones_) <= MaxLoad(capacity_))
+        {
+            return {};
+        }
+        return Rehash(std::max(needed, capacity_));
+    }
+
+    iterator find(const K& key) noexcept { return iterator(this, Find(key, HashOf(key))); }
+    const_iterator find(const K& key) const noexcept
+    {
+        return const_iterator(this, Find(key, HashOf(key)));
+    }
+
+    bool contains(const K& key) const noexcept { return Find(key, HashOf(key)) != capacity_; }
+
+    // Inserts `(key, V(args...))` if `key` is absent. Returns the element with this key
+    // and whether it was inserted.
+    template <typename Key, typename... Args>
+    result<std::pair<iterator, bool>> try_emplace(Key&& key, Args&&... args) noexcept
+    {
+        const std::uint64_t h = HashOf(key);
+        const size_type found = Find(key, h);
+        if (found != capacity_)
+        {
+            return std::pair<iterator, bool>(iterator(this, found), false);
+        }
+        size_type i;
+        if (HasRoomForOneMore())
+        {
+            i = FindInsertSlot(h);
+            TRY(detail::Construct(
+                alloc_,
+                &slots_[i],
+                std::piecewise_construct,
+                std::forward_as_tuple(std::forward<Key>(key)),
+                std::forward_as_tuple(std::forward<Args>(args)...)));
+        }
+        else
+        {
+            // The arguments may refer to an element, which rehashing relocates, so build
+            // the new element first.
+            std::optional<value_type> entry;
+            SAFE_CONTAINERS_CATCH_OOM(entry.emplace(
+                std::piecewise_construct,
+                std::forward_as_tuple(std::forward<Key>(key)),
+                std::forward_as_tuple(std::forward<Args>(args)...)));
+            TRY(ReserveOneMore());
+            i = FindInsertSlot(h);
+            TRY(detail::Construct(alloc_, &slots_[i], std::move_if_noexcept(*entry)));
+        }
+        if (ctrl_[i] == kDeleted)
+        {
+            --tombstones_;
+        }
+        ctrl_[i] = Fragment(h);
+        ++size_;
+        return std::pair<iterator, bool>(iterator(this, i), true);
+    }
+
+    result<std::pair<iterator, bool>> insert(const value_type& value) noexcept
+    {
+        return try_emplace(value.first, value.second);
+    }
+
+    result<std::pair<iterator, bool>> insert(value_type&& value) noexcept
+    {
+        return try_emplace(std::move(value.first), std::move(value.second));
+    }
+
+    template <typename... Args>
+    result<std::pair<iterator, bool>> emplace(const K& key, Args&&... args) noexcept
+    {
+        return try_emplace(key, std::forward<Args>(args)...);
+    }
+
+    template <typename Key, typename M>
+    result<std::pair<iterator, bool>> insert_or_assign(Key&& key, M&& value) noexcept
+    {
+        auto res = try_emplace(std::forward<Key>(key), std::forward<M>(value));
+        if (res.has_value() && !res.value().second)
+        {
+            SAFE_CONTAINERS_CATCH_OOM(res.value().first->second = std::forward<M>(value));
+        }
+        return res;
+    }
+
+    size_type erase(const K& key) noexcept
+    {
+        const size_type i = Find(key, HashOf(key));
+        if (i == capacity_)
+        {
+            return 0;
+        }
+        EraseAt(i);
+        return 1;
+    }
+
+    iterator erase(const_iterator pos) noexcept
+    {
+        EraseAt(pos.index_);
+        return iterator(this, NextFull(pos.index_ + 1));
+    }
+
+    void clear() noexcept
+    {
+        for (size_type i = 0; i < capacity_; ++i)
+        {
+            if (IsFull(ctrl_[i]))
+            {
+                traits::destroy(alloc_, &slots_[i]);
+            }
+        }
+        if (capacity_ > 0)
+        {
+            std::memset(ctrl_, kEmpty, capacity_);
+        }
+        size_ = 0;
+        tombstones_ = 0;
+    }
+
+    void swap(flat_hash_map& other) noexcept
+    {
+        flat_hash_map tmp = std::move(other);
+        other = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+   private:
+    static bool IsFull(std::uint8_t ctrl) noexcept { return (ctrl & kFull) != 0; }
+
+    static std::uint8_t Fragment(std::uint64_t h) noexcept
+    {
+        return static_cast<std::uint8_t>(kFull | (h >> 57));
+    }
+
+    // Keeps the load factor, including tombstones, at most 7/8 so probing always
+    // ends at an empty slot.
+    static size_type MaxLoad(size_type capacity) noexcept { return capacity - capacity / 8; }
+
+    static size_type CapacityFor(size_type count) noexcept
+    {
+        size_type capacity = 8;
+        while (MaxLoad(capacity) < count)
+        {
+            if (capacity > (std::numeric_limits<size_type>::max() >> 1))
+            {
+                return 0;
+            }
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    std::uint64_t HashOf(const K& key) const noexcept
+    {
+        return detail::MixHash(static_cast<std::uint64_t>(hash_(key)));
+    }
+
+    size_type Find(const K& key, std::uint64_t h) const noexcept
+    {
+        if (capacity_ == 0)
+        {
+            return capacity_;
+        }
+        const size_type mask = capacity_ - 1;
+        const std::uint8_t fragment = Fragment(h);
+        for (size_type i = static_cast<size_type>(h) & mask;; i = (i + 1) & mask)
+        {
+            const std::uint8_t ctrl = ctrl_[i];
+            if (ctrl == kEmpty)
+            {
+                return capacity_;
+            }
+            if (ctrl == fragment && eq_(slots_[i].first, key))
+            {
+                return i;
+            }
+        }
+    }
+
+    size_type FindInsertSlot(std::uint64_t h) const noexcept
+    {
+        const size_type mask = capacity_ - 1;
+        size_type i = static_cast<size_type>(h) & mask;
+        while (IsFull(ctrl_[i]))
+        {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    size_type NextFull(size_type i) const noexcept
+    {
+        while (i < capacity_ && !IsFull(ctrl_[i]))
+        {
+            ++i;
+        }
+        return i;
+    }
+
+    void EraseAt(size_type i) noexcept
+    {
+        traits::destroy(alloc_, &slots_[i]);
+        // A slot followed by an empty one ends every probe sequence passing through it,
+        // so it can be marked empty instead of leaving a tombstone.
+        if (ctrl_[(i + 1) & (capacity_ - 1)] == kEmpty)
+        {
+            ctrl_[i] = kEmpty;
+        }
+        else
+        {
+            ctrl_[i] = kDeleted;
+            ++tombstones_;
+        }
+        --size_;
+    }
+
+    bool HasRoomForOneMore() const noexcept
+    {
+        return capacity_ > 0 && size_ + tombstones_ + 1 <= MaxLoad(capacity_);
+    }
+
+    result<void> ReserveOneMore() noexcept
+    {
+        if (HasRoomForOneMore())
+        {
+            return {};
+        }
+        const size_type needed = CapacityFor(size_ + 1);
+        if (needed == 0)
+        {
+            return cpp::fail(ContainerError{});
+        }
+        // Mostly tombstones: clean them up without growing.
+        if (capacity_ > 0 && size_ + 1 <= MaxLoad(capacity_) / 2)
+        {
+            return Rehash(capacity_);
+        }
+        return Rehash(std::max(needed, capacity_ * 2));
+    }
+
+    // Moves all elements into a new table of `capacity` slots. If any allocation
+    // fails, the current table is left unchanged.
+    result<void> Rehash(size_type capacity) noexcept
+    {
+        ctrl_allocator ctrl_alloc(alloc_);
+        auto ctrl = detail::Allocate(ctrl_alloc, capacity);
+        if (ctrl.has_error())
+        {
+            return cpp::fail(std::move(ctrl).error());
+        }
+        auto slots = detail::Allocate(alloc_, capacity);
+        if (slots.has_error())
+        {
+            detail::Deallocate(ctrl_alloc, ctrl.value(), capacity);
+            return cpp::fail(std::move(slots).error());
+        }
+        std::memset(ctrl.value(), kEmpty, capacity);
+
+        const size_type mask = capacity - 1;
+        for (size_type i = 0; i < capacity_; ++i)
+        {
+            if (!IsFull(ctrl_[i]))
+            {
+                continue;
+            }
+            const std::uint64_t h = HashOf(slots_[i].first);
+            size_type j = static_cast<size_type>(h) & mask;
+            while (ctrl.value()[j] != kEmpty)
+            {
+                j = (j + 1) & mask;
+            }
+            // Copies instead of moving if moving may throw, so the current table stays
+            // intact on failure.
+            auto res =
+                detail::Construct(alloc_, &slots.value()[j], std::move_if_noexcept(slots_[i]));
+            if (res.has_error())
+            {
+                for (size_type k = 0; k < capacity; ++k)
+                {
+                    if (IsFull(ctrl.value()[k]))
+                    {
+                        traits::destroy(alloc_, &slots.value()[k]);
+                    }
+                }
+                detail::Deallocate(alloc_, slots.value(), capacity);
+                detail::Deallocate(ctrl_alloc, ctrl.value(), capacity);
+                return res;
+            }
+            ctrl.value()[j] = ctrl_[i];
+        }
+
+        const size_type size = size_;
+        Destroy();
+        ctrl_ = ctrl.value();
+        slots_ = slots.value();
+        capacity_ = capacity;
+        size_ = size;
+        return {};
+    }
+
+    void Destroy() noexcept
+    {
+        clear();
+        if (capacity_ > 0)
+        {
+            ctrl_allocator ctrl_alloc(alloc_);
+            detail::Deallocate(ctrl_alloc, ctrl_, capacity_);
+            detail::Deallocate(alloc_, slots_, capacity_);
+        }
+        ctrl_ = nullptr;
+        slots_ = nullptr;
+        capacity_ = 0;
+    }
+
+    template <bool Const>
+    class iterator_impl
+    {
+        using owner = std::conditional_t<Const, const flat_hash_map, flat_hash_map>;
+
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<K, V>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+        using reference = std::conditional_t<Const, const value_type&, value_type&>;
+
+        iterator_impl() noexcept = default;
+        iterator_impl(owner* map, size_type index) noexcept
+            : map_(map),
+              index_(index)
+        {
+        }
+
+        // Allow conversion from iterator to const_iterator.
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        iterator_impl(const iterator_impl<false>& other) noexcept
+            : map_(other.map_),
+              index_(other.index_)
+        {
+        }
+
+        reference operator*() const noexcept { return map_->slots_[index_]; }
+        pointer operator->() const noexcept { return &map_->slots_[index_]; }
+
+        iterator_impl& operator++() noexcept
+        {
+            index_ = map_->NextFull(index_ + 1);
+            return *this;
+        }
+
+        iterator_impl operator++(int) noexcept
+        {
+            iterator_impl it = *this;
+            ++*this;
+            return it;
+        }
+
+        friend bool operator==(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.index_ == b.index_;
+        }
+        friend bool operator!=(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.index_ != b.index_;
+        }
+
+       private:
+        friend class flat_hash_map;
+        friend class iterator_impl<!Const>;
+
+        owner* map_ = nullptr;
+        size_type index_ = 0;
+    };
+
+    allocator_type alloc_;
+    Hash hash_;
+    KeyEqual eq_;
+    std::uint8_t* ctrl_ = nullptr;
+    value_type* slots_ = nullptr;
+    // 0 or a power of two.
+    size_type capacity_ = 0;
+    size_type size_ = 0;
+    size_type tombstones_ = 0;
+};
+
+}  // namespace safe_containers
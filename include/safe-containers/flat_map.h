@@ -0,0 +1,496 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+#include <safe-containers/vector.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace safe_containers
+{
+namespace detail
+{
+
+struct identity_key
+{
+    template <typename T>
+    const T& operator()(const T& value) const noexcept
+    {
+        return value;
+    }
+};
+
+struct pair_first_key
+{
+    template <typename P>
+    const auto& operator()(const P& value) const noexcept
+    {
+        return value.first;
+    }
+};
+
+// Sorted, contiguous storage shared by `flat_map` & `flat_set`.
+template <typename Key, typename Value, typename KeyOf, typename Compare, typename AllocatorType>
+class flat_tree
+{
+    using storage_type = vector<Value, AllocatorType>;
+    using traits = std::allocator_traits<AllocatorType>;
+    using key_allocator = typename traits::template rebind_alloc<Key>;
+    using rank_allocator = typename traits::template rebind_alloc<std::size_t>;
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using key_type = Key;
+    using value_type = Value;
+    using key_compare = Compare;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+    using iterator = typename storage_type::iterator;
+    using const_iterator = typename storage_type::const_iterator;
+
+    explicit flat_tree(const allocator_type& alloc, const Compare& comp = Compare()) noexcept
+        : items_(alloc),
+          // Passed as lvalues, as `vector` rejects allocator rvalues.
+          index_keys_(static_cast<const key_allocator&>(key_allocator(alloc))),
+          index_ranks_(static_cast<const rank_allocator&>(rank_allocator(alloc))),
+          comp_(comp)
+    {
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    flat_tree(const flat_tree&) = delete;
+    flat_tree& operator=(const flat_tree&) = delete;
+
+    flat_tree(flat_tree&& other) noexcept
+        : flat_tree(other.get_allocator(), other.comp_)
+    {
+        swap(other);
+    }
+
+    flat_tree& operator=(flat_tree&& other) noexcept
+    {
+        flat_tree tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    allocator_type get_allocator() const noexcept { return items_.get_allocator(); }
+
+    iterator begin() noexcept { return items_.begin(); }
+    const_iterator begin() const noexcept { return items_.begin(); }
+    const_iterator cbegin() const noexcept { return items_.cbegin(); }
+    iterator end() noexcept { return items_.end(); }
+    const_iterator end() const noexcept { return items_.end(); }
+    const_iterator cend() const noexcept { return items_.cend(); }
+
+    [[nodiscard]] bool empty() const noexcept { return items_.empty(); }
+    size_type size() const noexcept { return items_.size(); }
+    size_type capacity() const noexcept { return items_.capacity(); }
+
+    result<void> reserve(size_type count) noexcept
+    {
+        SAFE_CONTAINERS_CATCH_OOM(items_.reserve(count));
+        return {};
+    }
+
+    result<void> shrink_to_fit() noexcept { return items_.shrink_to_fit(); }
+
+    void clear() noexcept
+    {
+        items_.clear();
+        index_valid_ = false;
+    }
+
+    iterator lower_bound(const Key& key) noexcept { return At(LowerBound(key)); }
+    const_iterator lower_bound(const Key& key) const noexcept { return At(LowerBound(key)); }
+
+    iterator upper_bound(const Key& key) noexcept { return At(UpperBound(key)); }
+    const_iterator upper_bound(const Key& key) const noexcept { return At(UpperBound(key)); }
+
+    iterator find(const Key& key) noexcept { return At(Find(key)); }
+    const_iterator find(const Key& key) const noexcept { return At(Find(key)); }
+
+    bool contains(const Key& key) const noexcept { return Find(key) != size(); }
+    size_type count(const Key& key) const noexcept { return contains(key) ? 1 : 0; }
+
+    size_type erase(const Key& key) noexcept
+    {
+        const size_type pos = Find(key);
+        if (pos == size())
+        {
+            return 0;
+        }
+        erase(At(pos));
+        return 1;
+    }
+
+    iterator erase(const_iterator pos) noexcept
+    {
+        index_valid_ = false;
+        return items_.erase(pos);
+    }
+
+    result<std::pair<iterator, bool>> insert(const value_type& value) noexcept
+    {
+        return EmplaceUnique(KeyOf()(value), value);
+    }
+
+    result<std::pair<iterator, bool>> insert(value_type&& value) noexcept
+    {
+        return EmplaceUnique(KeyOf()(value), std::move(value));
+    }
+
+    // Merges the range `[first, last)`, which must be sorted, in a single pass into a
+    // single new allocation. Keys already present, or repeated in the range, keep
+    // their first value. Single-pass ranges are buffered first, as their length must be
+    // known up front. On failure, the container is unchanged.
+    template <typename InputIt>
+    result<void> insert_sorted_range(InputIt first, InputIt last) noexcept
+    {
+        if constexpr (!std::is_base_of_v<
+                          std::forward_iterator_tag,
+                          typename std::iterator_traits<InputIt>::iterator_category>)
+        {
+            const allocator_type alloc = get_allocator();
+            storage_type buffered(alloc);
+            for (; first != last; ++first)
+            {
+                auto res = buffered.emplace_back(*first);
+                if (res.has_error())
+                {
+                    return cpp::fail(std::move(res).error());
+                }
+            }
+            return MergeSorted(
+                std::make_move_iterator(buffered.begin()), std::make_move_iterator(buffered.end()));
+        }
+        else
+        {
+            return MergeSorted(first, last);
+        }
+    }
+
+    // Builds an index of the keys in Eytzinger (breadth-first) order, which `find`
+    // uses until the container is modified. Searching the index touches one cache
+    // line per few levels of the implicit tree, instead of one per level.
+    result<void> build_index() noexcept
+    {
+        static_assert(
+            std::is_default_constructible_v<Key> && std::is_copy_assignable_v<Key>,
+            "The lookup index requires default constructible & copyable keys");
+        index_valid_ = false;
+        // Nodes are numbered from 1, so the children of node `k` are `2k` & `2k + 1`.
+        TRY(index_keys_.resize(size() + 1));
+        TRY(index_ranks_.resize(size() + 1));
+        FillIndex(0, 1);
+        index_valid_ = true;
+        return {};
+    }
+
+    bool has_index() const noexcept { return index_valid_; }
+
+    void swap(flat_tree& other) noexcept
+    {
+        items_.swap(other.items_);
+        index_keys_.swap(other.index_keys_);
+        index_ranks_.swap(other.index_ranks_);
+        std::swap(comp_, other.comp_);
+        std::swap(index_valid_, other.index_valid_);
+    }
+
+   protected:
+    iterator At(size_type pos) noexcept { return begin() + static_cast<std::ptrdiff_t>(pos); }
+    const_iterator At(size_type pos) const noexcept
+    {
+        return begin() + static_cast<std::ptrdiff_t>(pos);
+    }
+
+    // Inserts `Value(args...)` at the position of `key`, unless `key` is present.
+    template <typename... Args>
+    result<std::pair<iterator, bool>> EmplaceUnique(const Key& key, Args&&... args) noexcept
+    {
+        const size_type pos = LowerBound(key);
+        iterator it = At(pos);
+        if (pos != size() && !comp_(key, KeyOf()(*it)))
+        {
+            return std::pair<iterator, bool>(it, false);
+        }
+        auto inserted = items_.emplace(it, std::forward<Args>(args)...);
+        if (inserted.has_error())
+        {
+            return cpp::fail(std::move(inserted).error());
+        }
+        index_valid_ = false;
+        return std::pair<iterator, bool>(inserted.value(), true);
+    }
+
+    // Sorts & deduplicates the elements, keeping the first of equal elements.
+    void Normalize() noexcept
+    {
+        std::stable_sort(
+            items_.begin(),
+            items_.end(),
+            [this](const Value& a, const Value& b) { return comp_(KeyOf()(a), KeyOf()(b)); });
+        auto last = std::unique(
+            items_.begin(),
+            items_.end(),
+            [this](const Value& a, const Value& b) { return !comp_(KeyOf()(a), KeyOf()(b)); });
+        items_.erase(last, items_.end());
+    }
+
+    // Merges the sorted range `[first, last)` of forward iterators, see
+    // `insert_sorted_range`.
+    template <typename ForwardIt>
+    result<void> MergeSorted(ForwardIt first, ForwardIt last) noexcept
+    {
+        // Existing elements can only be moved if nothing can throw afterwards.
+        constexpr bool kMoveExisting = std::is_nothrow_move_constructible_v<Value> &&
+                                       std::is_nothrow_constructible_v<Value, decltype(*first)>;
+        const allocator_type alloc = get_allocator();
+        storage_type merged(alloc);
+        SAFE_CONTAINERS_CATCH_OOM({
+            merged.reserve(items_.size() + static_cast<size_type>(std::distance(first, last)));
+            // Appends through the plain `std::vector`, which cannot reallocate from here.
+            typename storage_type::inner& out = merged;
+            auto it = items_.begin();
+            const auto take_existing = [&]()
+            {
+                if constexpr (kMoveExisting)
+                {
+                    out.push_back(std::move(*it++));
+                }
+                else
+                {
+                    out.push_back(*it++);
+                }
+            };
+            for (; first != last; ++first)
+            {
+                // Bind the element first, as `*first` may return a temporary.
+                decltype(auto) elem = *first;
+                const auto& key = KeyOf()(elem);
+                while (it != items_.end() && comp_(KeyOf()(*it), key))
+                {
+                    take_existing();
+                }
+                const bool present =
+                    (it != items_.end() && !comp_(key, KeyOf()(*it))) ||
+                    (!merged.empty() && !comp_(KeyOf()(merged.back()), key));
+                if (!present)
+                {
+                    out.emplace_back(std::forward<decltype(elem)>(elem));
+                }
+            }
+            while (it != items_.end())
+            {
+                take_existing();
+            }
+        });
+        items_.swap(merged);
+        index_valid_ = false;
+        return {};
+    }
+
+    // Branchless binary search: the loop has a fixed trip count of log2(n), and the
+    // comparison result selects the next base without a jump.
+    size_type LowerBound(const Key& key) const noexcept
+    {
+        const Value* base = items_.data();
+        size_type n = items_.size();
+        if (n == 0)
+        {
+            return 0;
+        }
+        while (n > 1)
+        {
+            const size_type half = n / 2;
+            base = comp_(KeyOf()(base[half]), key) ? base + half : base;
+            n -= half;
+        }
+        return static_cast<size_type>(base - items_.data()) + comp_(KeyOf()(*base), key);
+    }
+
+    size_type UpperBound(const Key& key) const noexcept
+    {
+        const size_type pos = LowerBound(key);
+        return pos != size() && !comp_(key, KeyOf()(items_[pos])) ? pos + 1 : pos;
+    }
+
+    size_type Find(const Key& key) const noexcept
+    {
+        const size_type pos = index_valid_ ? IndexLowerBound(key) : LowerBound(key);
+        return pos != size() && !comp_(key, KeyOf()(items_[pos])) ? pos : size();
+    }
+
+    size_type IndexLowerBound(const Key& key) const noexcept
+    {
+        const size_type n = size();
+        size_type k = 1;
+        while (k <= n)
+        {
+            k = 2 * k + comp_(index_keys_[k], key);
+        }
+        // Undo the trailing right turns, which lead past the lower bound.
+        k >>= __builtin_ffsll(static_cast<long long>(~k));
+        return k == 0 ? n : index_ranks_[k];
+    }
+
+    // Lays out the keys in order of an in-order walk of the implicit tree.
+    size_type FillIndex(size_type rank, size_type k) noexcept
+    {
+        if (k <= size())
+        {
+            rank = FillIndex(rank, 2 * k);
+            index_keys_[k] = KeyOf()(items_[rank]);
+            index_ranks_[k] = rank++;
+            rank = FillIndex(rank, 2 * k + 1);
+        }
+        return rank;
+    }
+
+    storage_type items_;
+    vector<Key, key_allocator> index_keys_;
+    vector<std::size_t, rank_allocator> index_ranks_;
+    Compare comp_;
+    bool index_valid_ = false;
+};
+
+}  // namespace detail
+
+// `flat_map` is an ordered map stored as a sorted `safe_containers::vector` of
+// key-value pairs, with fallible allocation handling using `result` types.
+//
+// Lookups are branchless binary searches over contiguous memory, and can use an
+// Eytzinger-ordered index after `build_index()`. Inserting & erasing shift the
+// elements after the affected position, so `insert_sorted_range` should be preferred
+// for bulk loads. Keys must not be modified through iterators.
+template <
+    typename K,
+    typename V,
+    typename Compare = std::less<K>,
+    typename AllocatorType = std::allocator<std::pair<K, V>>>
+class flat_map
+    : public detail::flat_tree<K, std::pair<K, V>, detail::pair_first_key, Compare, AllocatorType>
+{
+    using base =
+        detail::flat_tree<K, std::pair<K, V>, detail::pair_first_key, Compare, AllocatorType>;
+
+   public:
+    template <typename R>
+    using result = cpp::result<R, ContainerError>;
+
+    using mapped_type = V;
+    using typename base::allocator_type;
+    using typename base::const_iterator;
+    using typename base::iterator;
+    using typename base::value_type;
+
+    using base::base;
+
+    // Utility wrapper around the plain `flat_map` so `Create` can be
+    // used regardless of fallibility.
+    static result<flat_map> Create(const allocator_type& alloc) noexcept
+    {
+        return result<flat_map>(cpp::in_place, alloc);
+    }
+
+    // Creates a map from an unsorted range. Of equal keys, the first one is kept.
+    template <typename InputIt>
+    static result<flat_map> Create(
+        InputIt first, InputIt last, const allocator_type& alloc) noexcept
+    {
+        flat_map m(alloc);
+        TRY(m.items_.assign(first, last));
+        m.Normalize();
+        return m;
+    }
+
+    result<flat_map> Clone() const noexcept
+    {
+        flat_map m(this->get_allocator(), this->comp_);
+        TRY(m.items_.assign(this->items_.cbegin(), this->items_.cend()));
+        return m;
+    }
+
+    // Inserts `(key, V(args...))` if `key` is absent. Returns the element with this key
+    // and whether it was inserted.
+    template <typename... Args>
+    result<std::pair<iterator, bool>> try_emplace(const K& key, Args&&... args) noexcept
+    {
+        return this->EmplaceUnique(
+            key,
+            std::piecewise_construct,
+            std::forward_as_tuple(key),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    template <typename M>
+    result<std::pair<iterator, bool>> insert_or_assign(const K& key, M&& value) noexcept
+    {
+        auto res = try_emplace(key, std::forward<M>(value));
+        if (res.has_value() && !res.value().second)
+        {
+            SAFE_CONTAINERS_CATCH_OOM(res.value().first->second = std::forward<M>(value));
+        }
+        return res;
+    }
+};
+
+// `flat_set` is an ordered set stored as a sorted `safe_containers::vector`, see
+// `flat_map`.
+template <
+    typename K,
+    typename Compare = std::less<K>,
+    typename AllocatorType = std::allocator<K>>
+class flat_set : public detail::flat_tree<K, K, detail::identity_key, Compare, AllocatorType>
+{
+    using base = detail::flat_tree<K, K, detail::identity_key, Compare, AllocatorType>;
+
+   public:
+    template <typename R>
+    using result = cpp::result<R, ContainerError>;
+
+    using typename base::allocator_type;
+
+    using base::base;
+
+    // Utility wrapper around the plain `flat_set` so `Create` can be
+    // used regardless of fallibility.
+    static result<flat_set> Create(const allocator_type& alloc) noexcept
+    {
+        return result<flat_set>(cpp::in_place, alloc);
+    }
+
+    // Creates a set from an unsorted range.
+    template <typename InputIt>
+    static result<flat_set> Create(
+        InputIt first, InputIt last, const allocator_type& alloc) noexcept
+    {
+        flat_set s(alloc);
+        TRY(s.items_.assign(first, last));
+        s.Normalize();
+        return s;
+    }
+
+    result<flat_set> Clone() const noexcept
+    {
+        flat_set s(this->get_allocator(), this->comp_);
+        TRY(s.items_.assign(this->items_.cbegin(), this->items_.cend()));
+        return s;
+    }
+};
+
+}  // namespace safe_containers
@@ -0,0 +1,27 @@
+#pragma once
+
+/** Hashing utilities shared by the hashed containers. **/
+
+#include <cstddef>
+#include <cstdint>
+
+namespace safe_containers
+{
+namespace detail
+{
+
+// Finalizer of MurmurHash3, spreading the entropy of `h` over all bits.
+// Some `std::hash` implementations are the identity for integers, which would
+// otherwise cluster keys in power-of-two sized tables.
+constexpr std::uint64_t MixHash(std::uint64_t h) noexcept
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+}  // namespace detail
+}  // namespace safe_containers
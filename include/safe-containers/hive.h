@@ -0,0 +1,557 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `hive` is an unordered collection which never moves its elements, with fallible
+// allocation handling using `result` types. Inserting & erasing are O(1), and
+// pointers to elements stay valid until the element is erased.
+//
+// Elements live in blocks of growing capacity, each a single allocation holding the
+// elements & a skipfield. The skipfield counts erased elements: the first & last
+// entries of every run of erased elements hold the run's length, so iteration jumps
+// over a whole run in one step. Erased runs are reused by later insertions, and
+// blocks which become empty are kept as spare capacity until `trim_capacity`. When
+// a new block can't be allocated, an error is returned and the hive is unchanged.
+template <typename T, typename AllocatorType = std::allocator<T>>
+class hive
+{
+    using traits = std::allocator_traits<AllocatorType>;
+    using skip_type = std::uint16_t;
+
+    static constexpr skip_type kNone = std::numeric_limits<skip_type>::max();
+
+    // Links of the free list of erased runs in a block, stored in the first element of
+    // each run.
+    struct free_links
+    {
+        skip_type prev;
+        skip_type next;
+    };
+
+    struct alignas(std::max(alignof(T), alignof(free_links))) element
+    {
+        unsigned char bytes[std::max(sizeof(T), sizeof(free_links))];
+
+        T* value() noexcept { return std::launder(reinterpret_cast<T*>(bytes)); }
+        free_links* links() noexcept
+        {
+            return std::launder(reinterpret_cast<free_links*>(bytes));
+        }
+    };
+
+    struct block
+    {
+        block* prev;
+        block* next;
+        // Neighbours in the list of blocks with room for insertions.
+        block* prev_open;
+        block* next_open;
+        element* elements;
+        skip_type* skip;
+        std::size_t units;
+        skip_type capacity;
+        skip_type size;
+        // Elements at & after `end` have never been used, or were trimmed off.
+        skip_type end;
+        // First element of the first erased run, or `kNone`.
+        skip_type free_head;
+    };
+
+    static constexpr std::size_t kAlign = std::max(alignof(block), alignof(element));
+
+    struct alignas(kAlign) unit
+    {
+        unsigned char bytes[kAlign];
+    };
+
+    using unit_allocator = typename traits::template rebind_alloc<unit>;
+
+    template <bool Const>
+    class basic_iterator
+    {
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using reference = std::conditional_t<Const, const T&, T&>;
+
+        basic_iterator() noexcept = default;
+
+        // Allow conversion from iterator to const_iterator.
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        basic_iterator(const basic_iterator<false>& other) noexcept
+            : block_(other.block_),
+              pos_(other.pos_)
+        {
+        }
+
+        reference operator*() const noexcept { return *block_->elements[pos_].value(); }
+        pointer operator->() const noexcept { return block_->elements[pos_].value(); }
+
+        basic_iterator& operator++() noexcept
+        {
+            std::size_t pos = pos_ + 1;
+            if (pos < block_->end)
+            {
+                // `pos` is either an element or the first of an erased run.
+                pos += block_->skip[pos];
+            }
+            if (pos >= block_->end)
+            {
+                *this = basic_iterator(block_->next);
+                return *this;
+            }
+            pos_ = static_cast<skip_type>(pos);
+            return *this;
+        }
+
+        basic_iterator operator++(int) noexcept
+        {
+            basic_iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        friend bool operator==(const basic_iterator& a, const basic_iterator& b) noexcept
+        {
+            return a.block_ == b.block_ && a.pos_ == b.pos_;
+        }
+
+        friend bool operator!=(const basic_iterator& a, const basic_iterator& b) noexcept
+        {
+            return !(a == b);
+        }
+
+       private:
+        friend class hive;
+        friend class basic_iterator<true>;
+
+        basic_iterator(block* b, skip_type pos) noexcept
+            : block_(b),
+              pos_(pos)
+        {
+        }
+
+        // The first element of `b` or of the blocks after it.
+        explicit basic_iterator(block* b) noexcept
+        {
+            while (b != nullptr && b->end == 0)
+            {
+                b = b->next;
+            }
+            block_ = b;
+            pos_ = b == nullptr ? 0 : b->skip[0];
+        }
+
+        block* block_ = nullptr;
+        skip_type pos_ = 0;
+    };
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using value_type = T;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    static constexpr size_type kMinBlockCapacity = 8;
+    static constexpr size_type kMaxBlockCapacity = 8192;
+
+    explicit hive(const allocator_type& alloc) noexcept
+        : alloc_(alloc)
+    {
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    hive(const hive&) = delete;
+    hive& operator=(const hive&) = delete;
+
+    hive(hive&& other) noexcept
+        : hive(other.alloc_)
+    {
+        swap(other);
+    }
+
+    hive& operator=(hive&& other) noexcept
+    {
+        hive tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    ~hive() { clear(); }
+
+    // Utility wrapper around the plain `hive` so `Create` can be
+    // used regardless of fallibility.
+    static result<hive> Create(const allocator_type& alloc) noexcept
+    {
+        return result<hive>(cpp::in_place, alloc);
+    }
+
+    // Creates an empty hive with room for `count` elements.
+    static result<hive> Create(size_type count, const allocator_type& alloc) noexcept
+    {
+        hive h(alloc);
+        TRY(h.reserve(count));
+        return h;
+    }
+
+    result<hive> Clone() const noexcept
+    {
+        hive h(alloc_);
+        TRY(h.reserve(size_));
+        for (const T& value : *this)
+        {
+            auto res = h.insert(value);
+            if (res.has_error())
+            {
+                return cpp::fail(std::move(res).error());
+            }
+        }
+        return h;
+    }
+
+    allocator_type get_allocator() const noexcept { return alloc_; }
+
+    iterator begin() noexcept { return iterator(first_); }
+    const_iterator begin() const noexcept { return const_iterator(first_); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return iterator(); }
+    const_iterator end() const noexcept { return const_iterator(); }
+    const_iterator cend() const noexcept { return end(); }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    size_type size() const noexcept { return size_; }
+    size_type capacity() const noexcept { return capacity_; }
+
+    // Allocates blocks until there's room for `count` elements.
+    result<void> reserve(size_type count) noexcept
+    {
+        while (capacity_ < count)
+        {
+            const size_type missing = std::max(count - capacity_, kMinBlockCapacity);
+            TRY(AddBlock(std::min(missing, kMaxBlockCapacity)));
+        }
+        return {};
+    }
+
+    // Inserts `T(args...)` in the first free position. On failure, the hive is
+    // unchanged.
+    template <typename... Args>
+    result<iterator> insert(Args&&... args) noexcept
+    {
+        if (open_ == nullptr)
+        {
+            const size_type grown = std::max(size_, kMinBlockCapacity);
+            TRY(AddBlock(std::min(grown, kMaxBlockCapacity)));
+        }
+        block* b = open_;
+        const skip_type pos = b->free_head != kNone ? b->free_head : b->end;
+        if (pos == b->free_head)
+        {
+            // The new element overwrites the links of the run it's taken from.
+            const free_links links = *b->elements[pos].links();
+            auto constructed =
+                detail::Construct(alloc_, b->elements[pos].value(), std::forward<Args>(args)...);
+            if (constructed.has_error())
+            {
+                ::new (static_cast<void*>(b->elements[pos].bytes)) free_links(links);
+                return cpp::fail(std::move(constructed).error());
+            }
+            TakeRunHead(b, links.next);
+        }
+        else
+        {
+            TRY(detail::Construct(alloc_, b->elements[pos].value(), std::forward<Args>(args)...));
+            b->skip[pos] = 0;
+            ++b->end;
+        }
+        ++b->size;
+        ++size_;
+        if (b->free_head == kNone && b->end == b->capacity)
+        {
+            Close(b);
+        }
+        return iterator(b, pos);
+    }
+
+    // Erases the element at `pos`, returning an iterator to the element after it.
+    iterator erase(const_iterator pos) noexcept
+    {
+        block* b = pos.block_;
+        const skip_type i = pos.pos_;
+        traits::destroy(alloc_, b->elements[i].value());
+        --size_;
+        const bool was_open = b->free_head != kNone || b->end < b->capacity;
+        if (--b->size == 0)
+        {
+            // Keep the block as spare capacity, see `trim_capacity`.
+            b->end = 0;
+            b->free_head = kNone;
+            if (!was_open)
+            {
+                Open(b);
+            }
+            return iterator(b->next);
+        }
+
+        const bool left_erased = i > 0 && b->skip[i - 1] != 0;
+        iterator next;
+        if (i + 1 == b->end)
+        {
+            // Trim the erased tail instead of recording a run.
+            skip_type new_end = i;
+            if (left_erased)
+            {
+                new_end = static_cast<skip_type>(i - b->skip[i - 1]);
+                Unlink(b, new_end);
+            }
+            b->end = new_end;
+            next = iterator(b->next);
+        }
+        else
+        {
+            const bool right_erased = b->skip[i + 1] != 0;
+            const skip_type right_length = right_erased ? b->skip[i + 1] : 0;
+            const skip_type last = static_cast<skip_type>(i + right_length);
+            skip_type first = i;
+            if (left_erased)
+            {
+                first = static_cast<skip_type>(i - b->skip[i - 1]);
+                if (right_erased)
+                {
+                    Unlink(b, static_cast<skip_type>(i + 1));
+                }
+            }
+            else if (right_erased)
+            {
+                Move(b, static_cast<skip_type>(i + 1), i);
+            }
+            else
+            {
+                PushRun(b, i);
+            }
+            const auto length = static_cast<skip_type>(last - first + 1);
+            b->skip[first] = length;
+            b->skip[last] = length;
+            next = iterator(b, static_cast<skip_type>(last + 1));
+        }
+        if (!was_open)
+        {
+            Open(b);
+        }
+        return next;
+    }
+
+    // Frees the blocks without elements.
+    void trim_capacity() noexcept
+    {
+        block* b = first_;
+        while (b != nullptr)
+        {
+            block* next = b->next;
+            if (b->size == 0)
+            {
+                FreeBlock(b);
+            }
+            b = next;
+        }
+    }
+
+    // Destroys all elements & frees all blocks.
+    void clear() noexcept
+    {
+        while (first_ != nullptr)
+        {
+            block* b = first_;
+            for (auto it = iterator(b); it.block_ == b; ++it)
+            {
+                traits::destroy(alloc_, &*it);
+            }
+            first_ = b->next;
+            Deallocate(b);
+        }
+        last_ = nullptr;
+        open_ = nullptr;
+        size_ = 0;
+        capacity_ = 0;
+    }
+
+    void swap(hive& other) noexcept
+    {
+        std::swap(alloc_, other.alloc_);
+        std::swap(first_, other.first_);
+        std::swap(last_, other.last_);
+        std::swap(open_, other.open_);
+        std::swap(size_, other.size_);
+        std::swap(capacity_, other.capacity_);
+    }
+
+   private:
+    static constexpr std::size_t AlignUp(std::size_t n) noexcept
+    {
+        return (n + kAlign - 1) / kAlign * kAlign;
+    }
+
+    result<void> AddBlock(size_type capacity) noexcept
+    {
+        const std::size_t elements_offset = AlignUp(sizeof(block));
+        const std::size_t skip_offset = AlignUp(elements_offset + capacity * sizeof(element));
+        const std::size_t units = AlignUp(skip_offset + capacity * sizeof(skip_type)) / kAlign;
+        unit_allocator alloc(alloc_);
+        auto memory = detail::Allocate(alloc, units);
+        if (memory.has_error())
+        {
+            return cpp::fail(std::move(memory).error());
+        }
+
+        auto* bytes = reinterpret_cast<unsigned char*>(memory.value());
+        auto* b = ::new (static_cast<void*>(bytes)) block{};
+        b->elements = reinterpret_cast<element*>(bytes + elements_offset);
+        b->skip = reinterpret_cast<skip_type*>(bytes + skip_offset);
+        std::uninitialized_fill_n(b->skip, capacity, skip_type{0});
+        b->units = units;
+        b->capacity = static_cast<skip_type>(capacity);
+        b->free_head = kNone;
+        b->prev = last_;
+        if (last_ != nullptr)
+        {
+            last_->next = b;
+        }
+        else
+        {
+            first_ = b;
+        }
+        last_ = b;
+        capacity_ += capacity;
+        Open(b);
+        return {};
+    }
+
+    void Deallocate(block* b) noexcept
+    {
+        unit_allocator alloc(alloc_);
+        const std::size_t units = b->units;
+        b->~block();
+        detail::Deallocate(alloc, reinterpret_cast<unit*>(b), units);
+    }
+
+    // Frees `b`, which must be empty.
+    void FreeBlock(block* b) noexcept
+    {
+        Close(b);
+        (b->prev != nullptr ? b->prev->next : first_) = b->next;
+        (b->next != nullptr ? b->next->prev : last_) = b->prev;
+        capacity_ -= b->capacity;
+        Deallocate(b);
+    }
+
+    // Adds `b` to the blocks with room for insertions.
+    void Open(block* b) noexcept
+    {
+        b->prev_open = nullptr;
+        b->next_open = open_;
+        if (open_ != nullptr)
+        {
+            open_->prev_open = b;
+        }
+        open_ = b;
+    }
+
+    void Close(block* b) noexcept
+    {
+        (b->prev_open != nullptr ? b->prev_open->next_open : open_) = b->next_open;
+        if (b->next_open != nullptr)
+        {
+            b->next_open->prev_open = b->prev_open;
+        }
+    }
+
+    // Starts a run at `pos` & pushes it on the free list of `b`.
+    static void PushRun(block* b, skip_type pos) noexcept
+    {
+        ::new (static_cast<void*>(b->elements[pos].bytes)) free_links{kNone, b->free_head};
+        if (b->free_head != kNone)
+        {
+            b->elements[b->free_head].links()->prev = pos;
+        }
+        b->free_head = pos;
+    }
+
+    // Removes the run starting at `pos` from the free list of `b`.
+    static void Unlink(block* b, skip_type pos) noexcept
+    {
+        const free_links links = *b->elements[pos].links();
+        (links.prev != kNone ? b->elements[links.prev].links()->next : b->free_head) = links.next;
+        if (links.next != kNone)
+        {
+            b->elements[links.next].links()->prev = links.prev;
+        }
+    }
+
+    // Moves the free list entry of the run starting at `from` to `to`.
+    static void Move(block* b, skip_type from, skip_type to) noexcept
+    {
+        const free_links links = *b->elements[from].links();
+        ::new (static_cast<void*>(b->elements[to].bytes)) free_links(links);
+        (links.prev != kNone ? b->elements[links.prev].links()->next : b->free_head) = to;
+        if (links.next != kNone)
+        {
+            b->elements[links.next].links()->prev = to;
+        }
+    }
+
+    // Shortens the first run of `b` by its first element, which was just filled. `next`
+    // is the run after it in the free list.
+    static void TakeRunHead(block* b, skip_type next) noexcept
+    {
+        const skip_type pos = b->free_head;
+        const skip_type length = b->skip[pos];
+        b->skip[pos] = 0;
+        skip_type head = next;
+        if (length > 1)
+        {
+            head = static_cast<skip_type>(pos + 1);
+            const auto rest = static_cast<skip_type>(length - 1);
+            b->skip[head] = rest;
+            b->skip[pos + rest] = rest;
+            ::new (static_cast<void*>(b->elements[head].bytes)) free_links{kNone, next};
+        }
+        if (next != kNone)
+        {
+            b->elements[next].links()->prev = head == next ? kNone : head;
+        }
+        b->free_head = head;
+    }
+
+    allocator_type alloc_;
+    block* first_ = nullptr;
+    block* last_ = nullptr;
+    block* open_ = nullptr;
+    size_type size_ = 0;
+    size_type capacity_ = 0;
+};
+
+}  // namespace safe_containers
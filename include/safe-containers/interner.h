@@ -0,0 +1,340 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/flat_hash_map.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+#include <safe-containers/vector.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+namespace safe_containers
+{
+
+// Compact handle of a string interned in a `string_interner`. Symbols of the same
+// interner compare equal iff their strings do.
+class symbol
+{
+   public:
+    constexpr explicit symbol(std::uint32_t id) noexcept
+        : id_(id)
+    {
+    }
+
+    constexpr std::uint32_t id() const noexcept { return id_; }
+
+    friend constexpr bool operator==(symbol a, symbol b) noexcept { return a.id_ == b.id_; }
+    friend constexpr bool operator!=(symbol a, symbol b) noexcept { return a.id_ != b.id_; }
+    friend constexpr bool operator<(symbol a, symbol b) noexcept { return a.id_ < b.id_; }
+
+   private:
+    std::uint32_t id_;
+};
+
+// `string_interner` deduplicates strings into an arena & hands out a 32-bit `symbol`
+// per distinct string, with fallible allocation handling using `result` types.
+//
+// Strings are copied into chunks of `chunk_size` bytes, which are never moved nor
+// freed before the interner, so views of interned strings stay valid. Strings larger
+// than a quarter chunk get a chunk of their own, so they don't waste the tail of the
+// current one. A `flat_hash_map` from the interned views to their symbols serves
+// lookups, and symbols are dense, so they index a table of views.
+template <typename AllocatorType = std::allocator<char>>
+class string_interner
+{
+    using traits = std::allocator_traits<AllocatorType>;
+
+    struct chunk
+    {
+        char* data;
+        std::size_t size;
+    };
+
+    using chunk_allocator = typename traits::template rebind_alloc<chunk>;
+    using view_allocator = typename traits::template rebind_alloc<std::string_view>;
+    using index_allocator =
+        typename traits::template rebind_alloc<std::pair<std::string_view, std::uint32_t>>;
+    using index_type = flat_hash_map<
+        std::string_view,
+        std::uint32_t,
+        std::hash<std::string_view>,
+        std::equal_to<std::string_view>,
+        index_allocator>;
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+
+    static constexpr size_type kDefaultChunkSize = 64 * 1024;
+    static constexpr size_type kMaxSymbols = std::numeric_limits<std::uint32_t>::max();
+
+    explicit string_interner(
+        const allocator_type& alloc, size_type chunk_size = kDefaultChunkSize) noexcept
+        : alloc_(alloc),
+          chunk_size_(chunk_size),
+          // Passed as lvalues, as `vector` rejects allocator rvalues.
+          chunks_(static_cast<const chunk_allocator&>(chunk_allocator(alloc))),
+          views_(static_cast<const view_allocator&>(view_allocator(alloc))),
+          index_(index_allocator(alloc))
+    {
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    string_interner(const string_interner&) = delete;
+    string_interner& operator=(const string_interner&) = delete;
+
+    string_interner(string_interner&& other) noexcept
+        : string_interner(other.alloc_, other.chunk_size_)
+    {
+        swap(other);
+    }
+
+    string_interner& operator=(string_interner&& other) noexcept
+    {
+        string_interner tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    ~string_interner() { FreeChunks(); }
+
+    // Utility wrapper around the plain `string_interner` so `Create` can be
+    // used regardless of fallibility.
+    static result<string_interner> Create(const allocator_type& alloc) noexcept
+    {
+        return result<string_interner>(cpp::in_place, alloc);
+    }
+
+    // Creates an interner with arena chunks of `chunk_size` bytes & room for `count`
+    // symbols.
+    static result<string_interner> Create(
+        size_type chunk_size, size_type count, const allocator_type& alloc) noexcept
+    {
+        string_interner interner(alloc, chunk_size);
+        TRY(interner.reserve(count));
+        return interner;
+    }
+
+    // Clones the interner, preserving the symbol of every string.
+    result<string_interner> Clone() const noexcept
+    {
+        string_interner interner(alloc_, chunk_size_);
+        TRY(interner.reserve(size()));
+        for (std::string_view str : views_)
+        {
+            auto res = interner.intern(str);
+            if (res.has_error())
+            {
+                return cpp::fail(std::move(res).error());
+            }
+        }
+        return interner;
+    }
+
+    allocator_type get_allocator() const noexcept { return alloc_; }
+
+    [[nodiscard]] bool empty() const noexcept { return views_.empty(); }
+    size_type size() const noexcept { return views_.size(); }
+
+    // Bytes allocated by the arena & the tables.
+    size_type memory_usage() const noexcept
+    {
+        size_type bytes = chunks_.capacity() * sizeof(chunk) +
+                          views_.capacity() * sizeof(std::string_view) +
+                          index_.capacity() * (sizeof(typename index_type::value_type) + 1);
+        for (const chunk& c : chunks_)
+        {
+            bytes += c.size;
+        }
+        return bytes;
+    }
+
+    // Reserves room in the tables for `count` symbols.
+    result<void> reserve(size_type count) noexcept
+    {
+        TRY(index_.reserve(count));
+        SAFE_CONTAINERS_CATCH_OOM(views_.reserve(count));
+        return {};
+    }
+
+    // Returns the symbol of `str`, interning a copy of it if it's new. On failure, the
+    // interner is unchanged.
+    result<symbol> intern(std::string_view str) noexcept
+    {
+        const auto found = index_.find(str);
+        if (found != index_.end())
+        {
+            return symbol(found->second);
+        }
+        if (size() == kMaxSymbols)
+        {
+            return cpp::fail(ContainerError{});
+        }
+
+        // Reserve everything up front, so only the arena needs to be rolled back.
+        TRY(index_.reserve(size() + 1));
+        TRY(detail::ReserveOneMore(views_));
+        TRY(detail::ReserveOneMore(chunks_));
+        auto copy = Store(str);
+        if (copy.has_error())
+        {
+            return cpp::fail(std::move(copy).error());
+        }
+        const auto id = static_cast<std::uint32_t>(size());
+        auto inserted = index_.try_emplace(copy.value(), id);
+        if (inserted.has_error())
+        {
+            Unstore(copy.value());
+            return cpp::fail(std::move(inserted).error());
+        }
+        views_.inner::push_back(copy.value());
+        return symbol(id);
+    }
+
+    // The symbol of `str`, if it was interned.
+    std::optional<symbol> find(std::string_view str) const noexcept
+    {
+        const auto found = index_.find(str);
+        if (found == index_.end())
+        {
+            return std::nullopt;
+        }
+        return symbol(found->second);
+    }
+
+    bool contains(std::string_view str) const noexcept { return index_.contains(str); }
+
+    // The string of `sym`, which must have been returned by this interner.
+    std::string_view operator[](symbol sym) const noexcept { return views_[sym.id()]; }
+    std::string_view view(symbol sym) const noexcept { return views_[sym.id()]; }
+
+    // Forgets all strings & frees the arena. Previously returned symbols & views
+    // become invalid.
+    void clear() noexcept
+    {
+        index_.clear();
+        views_.clear();
+        FreeChunks();
+        chunks_.clear();
+        cursor_ = nullptr;
+        remaining_ = 0;
+    }
+
+    void swap(string_interner& other) noexcept
+    {
+        std::swap(alloc_, other.alloc_);
+        std::swap(chunk_size_, other.chunk_size_);
+        chunks_.swap(other.chunks_);
+        views_.swap(other.views_);
+        index_.swap(other.index_);
+        std::swap(cursor_, other.cursor_);
+        std::swap(remaining_, other.remaining_);
+    }
+
+   private:
+    // Copies `str` into the arena. `chunks_` must have room for one more chunk.
+    result<std::string_view> Store(std::string_view str) noexcept
+    {
+        const size_type n = str.size();
+        if (n == 0)
+        {
+            return std::string_view();
+        }
+        char* out;
+        if (n > chunk_size_ / 4)
+        {
+            auto dedicated = detail::Allocate(alloc_, n);
+            if (dedicated.has_error())
+            {
+                return cpp::fail(std::move(dedicated).error());
+            }
+            out = dedicated.value();
+            chunks_.inner::push_back(chunk{out, n});
+        }
+        else
+        {
+            if (n > remaining_)
+            {
+                auto fresh = detail::Allocate(alloc_, chunk_size_);
+                if (fresh.has_error())
+                {
+                    return cpp::fail(std::move(fresh).error());
+                }
+                chunks_.inner::push_back(chunk{fresh.value(), chunk_size_});
+                cursor_ = fresh.value();
+                remaining_ = chunk_size_;
+            }
+            out = cursor_;
+            cursor_ += n;
+            remaining_ -= n;
+        }
+        std::memcpy(out, str.data(), n);
+        return std::string_view(out, n);
+    }
+
+    // Releases the last string returned by `Store`.
+    void Unstore(std::string_view copy) noexcept
+    {
+        const size_type n = copy.size();
+        if (n == 0)
+        {
+            return;
+        }
+        if (n > chunk_size_ / 4)
+        {
+            detail::Deallocate(alloc_, chunks_.back().data, n);
+            chunks_.pop_back();
+        }
+        else
+        {
+            cursor_ -= n;
+            remaining_ += n;
+        }
+    }
+
+    void FreeChunks() noexcept
+    {
+        for (const chunk& c : chunks_)
+        {
+            detail::Deallocate(alloc_, c.data, c.size);
+        }
+    }
+
+    allocator_type alloc_;
+    size_type chunk_size_;
+    vector<chunk, chunk_allocator> chunks_;
+    vector<std::string_view, view_allocator> views_;
+    index_type index_;
+    char* cursor_ = nullptr;
+    size_type remaining_ = 0;
+};
+
+}  // namespace safe_containers
+
+namespace std
+{
+
+template <>
+struct hash<safe_containers::symbol>
+{
+    std::size_t operator()(safe_containers::symbol sym) const noexcept
+    {
+        return std::hash<std::uint32_t>()(sym.id());
+    }
+};
+
+}  // namespace std
@@ -0,0 +1,807 @@
+#pragma once
+
+#include <safe-containers/span.h>
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace safe_containers
+{
+
+template <typename T, typename Tag>
+class intrusive_list;
+template <typename T, typename Tag>
+class intrusive_slist;
+template <typename T, typename Key, typename KeyOf, typename Hash, typename KeyEqual, typename Tag>
+class intrusive_hash_table;
+
+// The intrusive containers never allocate: an object is linked into a container
+// through a hook it inherits from, so inserting can't fail & needs no `result`. An
+// object may be in several containers at once through hooks with distinct `Tag`s.
+//
+// Containers don't own their objects. An object must stay alive, & must not move,
+// while it's linked, & is unlinked when erased or when its container is cleared or
+// destroyed. Copying an object doesn't copy its links, so the copy is unlinked.
+
+// Hook of `intrusive_list`.
+template <typename Tag = void>
+class list_hook
+{
+   public:
+    list_hook() noexcept = default;
+    list_hook(const list_hook&) noexcept {}
+    list_hook& operator=(const list_hook&) noexcept { return *this; }
+
+    bool is_linked() const noexcept { return next_ != nullptr; }
+
+   private:
+    template <typename, typename>
+    friend class intrusive_list;
+
+    list_hook* prev_ = nullptr;
+    list_hook* next_ = nullptr;
+};
+
+// Hook of `intrusive_slist`.
+template <typename Tag = void>
+class slist_hook
+{
+   public:
+    slist_hook() noexcept = default;
+    slist_hook(const slist_hook&) noexcept {}
+    slist_hook& operator=(const slist_hook&) noexcept { return *this; }
+
+   private:
+    template <typename, typename>
+    friend class intrusive_slist;
+
+    slist_hook* next_ = nullptr;
+};
+
+// Hook of `intrusive_hash_table`, which caches the hash of the object's key.
+template <typename Tag = void>
+class hash_hook
+{
+   public:
+    hash_hook() noexcept = default;
+    hash_hook(const hash_hook&) noexcept {}
+    hash_hook& operator=(const hash_hook&) noexcept { return *this; }
+
+   private:
+    template <typename, typename, typename, typename, typename, typename>
+    friend class intrusive_hash_table;
+
+    hash_hook* next_ = nullptr;
+    std::size_t hash_ = 0;
+};
+
+// `intrusive_list` is a doubly-linked list of objects deriving from `list_hook<Tag>`.
+// Every operation is O(1), except `clear`, including unlinking an object given only a
+// reference to it.
+template <typename T, typename Tag = void>
+class intrusive_list
+{
+    using hook = list_hook<Tag>;
+
+    static_assert(std::is_base_of_v<hook, T>, "Elements must derive from `list_hook<Tag>`");
+
+    template <bool Const>
+    class iterator_impl
+    {
+       public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using reference = std::conditional_t<Const, const T&, T&>;
+
+        iterator_impl() noexcept = default;
+        explicit iterator_impl(hook* node) noexcept
+            : node_(node)
+        {
+        }
+
+        // Allow conversion from iterator to const_iterator.
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        iterator_impl(const iterator_impl<false>& other) noexcept
+            : node_(other.node_)
+        {
+        }
+
+        reference operator*() const noexcept { return static_cast<reference>(*node_); }
+        pointer operator->() const noexcept { return &**this; }
+
+        iterator_impl& operator++() noexcept
+        {
+            node_ = node_->next_;
+            return *this;
+        }
+        iterator_impl operator++(int) noexcept
+        {
+            iterator_impl tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        iterator_impl& operator--() noexcept
+        {
+            node_ = node_->prev_;
+            return *this;
+        }
+        iterator_impl operator--(int) noexcept
+        {
+            iterator_impl tmp = *this;
+            --*this;
+            return tmp;
+        }
+
+        friend bool operator==(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.node_ == b.node_;
+        }
+        friend bool operator!=(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.node_ != b.node_;
+        }
+
+       private:
+        friend class intrusive_list;
+        friend class iterator_impl<!Const>;
+
+        hook* node_ = nullptr;
+    };
+
+   public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using iterator = iterator_impl<false>;
+    using const_iterator = iterator_impl<true>;
+
+    intrusive_list() noexcept { Reset(); }
+
+    intrusive_list(const intrusive_list&) = delete;
+    intrusive_list& operator=(const intrusive_list&) = delete;
+
+    intrusive_list(intrusive_list&& other) noexcept
+    {
+        Reset();
+        TakeFrom(other);
+    }
+
+    intrusive_list& operator=(intrusive_list&& other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            TakeFrom(other);
+        }
+        return *this;
+    }
+
+    ~intrusive_list() { clear(); }
+
+    iterator begin() noexcept { return iterator(root_.next_); }
+    const_iterator begin() const noexcept { return const_iterator(root_.next_); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return iterator(&root_); }
+    const_iterator end() const noexcept { return const_iterator(Root()); }
+    const_iterator cend() const noexcept { return end(); }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    size_type size() const noexcept { return size_; }
+
+    reference front() noexcept { return *begin(); }
+    const_reference front() const noexcept { return *begin(); }
+    reference back() noexcept { return *iterator(root_.prev_); }
+    const_reference back() const noexcept { return *const_iterator(root_.prev_); }
+
+    // The iterator to `value`, which must be linked in this list.
+    iterator iterator_to(T& value) noexcept { return iterator(&static_cast<hook&>(value)); }
+    const_iterator iterator_to(const T& value) const noexcept
+    {
+        return const_iterator(const_cast<hook*>(&static_cast<const hook&>(value)));
+    }
+
+    void push_front(T& value) noexcept { insert(begin(), value); }
+    void push_back(T& value) noexcept { insert(end(), value); }
+
+    // Links `value`, which must be unlinked, before `pos`.
+    iterator insert(const_iterator pos, T& value) noexcept
+    {
+        hook& node = value;
+        hook* next = pos.node_;
+        node.prev_ = next->prev_;
+        node.next_ = next;
+        next->prev_->next_ = &node;
+        next->prev_ = &node;
+        ++size_;
+        return iterator(&node);
+    }
+
+    // Unlinks the object at `pos`, returning an iterator to the next one.
+    iterator erase(const_iterator pos) noexcept
+    {
+        hook* next = pos.node_->next_;
+        Unlink(*pos.node_);
+        return iterator(next);
+    }
+
+    // Unlinks `value`, which must be linked in this list.
+    void remove(T& value) noexcept { Unlink(value); }
+
+    void pop_front() noexcept { Unlink(*root_.next_); }
+    void pop_back() noexcept { Unlink(*root_.prev_); }
+
+    // Moves all objects of `other` before `pos`.
+    void splice(const_iterator pos, intrusive_list& other) noexcept
+    {
+        if (other.empty())
+        {
+            return;
+        }
+        hook* first = other.root_.next_;
+        hook* last = other.root_.prev_;
+        hook* next = pos.node_;
+        first->prev_ = next->prev_;
+        next->prev_->next_ = first;
+        last->next_ = next;
+        next->prev_ = last;
+        size_ += other.size_;
+        other.Reset();
+    }
+
+    // Unlinks all objects.
+    void clear() noexcept
+    {
+        hook* node = root_.next_;
+        while (node != &root_)
+        {
+            hook* next = node->next_;
+            node->prev_ = nullptr;
+            node->next_ = nullptr;
+            node = next;
+        }
+        Reset();
+    }
+
+    void swap(intrusive_list& other) noexcept
+    {
+        intrusive_list tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+   private:
+    hook* Root() const noexcept { return const_cast<hook*>(&root_); }
+
+    void Reset() noexcept
+    {
+        root_.prev_ = &root_;
+        root_.next_ = &root_;
+        size_ = 0;
+    }
+
+    // Takes over the objects of `other`, which this list must not share any with.
+    void TakeFrom(intrusive_list& other) noexcept
+    {
+        if (other.empty())
+        {
+            return;
+        }
+        root_.next_ = other.root_.next_;
+        root_.prev_ = other.root_.prev_;
+        root_.next_->prev_ = &root_;
+        root_.prev_->next_ = &root_;
+        size_ = other.size_;
+        other.Reset();
+    }
+
+    void Unlink(hook& node) noexcept
+    {
+        node.prev_->next_ = node.next_;
+        node.next_->prev_ = node.prev_;
+        node.prev_ = nullptr;
+        node.next_ = nullptr;
+        --size_;
+    }
+
+    // Circular sentinel, before the first & after the last object.
+    hook root_;
+    size_type size_ = 0;
+};
+
+// `intrusive_slist` is a singly-linked list of objects deriving from `slist_hook<Tag>`,
+// with O(1) insertion at both ends, e.g. for free lists & FIFO queues.
+template <typename T, typename Tag = void>
+class intrusive_slist
+{
+    using hook = slist_hook<Tag>;
+
+    static_assert(std::is_base_of_v<hook, T>, "Elements must derive from `slist_hook<Tag>`");
+
+    template <bool Const>
+    class iterator_impl
+    {
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using reference = std::conditional_t<Const, const T&, T&>;
+
+        iterator_impl() noexcept = default;
+        explicit iterator_impl(hook* node) noexcept
+            : node_(node)
+        {
+        }
+
+        // Allow conversion from iterator to const_iterator.
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        iterator_impl(const iterator_impl<false>& other) noexcept
+            : node_(other.node_)
+        {
+        }
+
+        reference operator*() const noexcept { return static_cast<reference>(*node_); }
+        pointer operator->() const noexcept { return &**this; }
+
+        iterator_impl& operator++() noexcept
+        {
+            node_ = node_->next_;
+            return *this;
+        }
+        iterator_impl operator++(int) noexcept
+        {
+            iterator_impl tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        friend bool operator==(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.node_ == b.node_;
+        }
+        friend bool operator!=(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.node_ != b.node_;
+        }
+
+       private:
+        friend class intrusive_slist;
+        friend class iterator_impl<!Const>;
+
+        hook* node_ = nullptr;
+    };
+
+   public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using iterator = iterator_impl<false>;
+    using const_iterator = iterator_impl<true>;
+
+    intrusive_slist() noexcept = default;
+
+    intrusive_slist(const intrusive_slist&) = delete;
+    intrusive_slist& operator=(const intrusive_slist&) = delete;
+
+    intrusive_slist(intrusive_slist&& other) noexcept
+        : head_(std::exchange(other.head_, nullptr)),
+          tail_(std::exchange(other.tail_, nullptr)),
+          size_(std::exchange(other.size_, 0))
+    {
+    }
+
+    intrusive_slist& operator=(intrusive_slist&& other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            head_ = std::exchange(other.head_, nullptr);
+            tail_ = std::exchange(other.tail_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    ~intrusive_slist() { clear(); }
+
+    iterator begin() noexcept { return iterator(head_); }
+    const_iterator begin() const noexcept { return const_iterator(head_); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return iterator(); }
+    const_iterator end() const noexcept { return const_iterator(); }
+    const_iterator cend() const noexcept { return end(); }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    size_type size() const noexcept { return size_; }
+
+    reference front() noexcept { return static_cast<T&>(*head_); }
+    const_reference front() const noexcept { return static_cast<const T&>(*head_); }
+    reference back() noexcept { return static_cast<T&>(*tail_); }
+    const_reference back() const noexcept { return static_cast<const T&>(*tail_); }
+
+    // The iterator to `value`, which must be linked in this list.
+    iterator iterator_to(T& value) noexcept { return iterator(&static_cast<hook&>(value)); }
+
+    void push_front(T& value) noexcept
+    {
+        hook& node = value;
+        node.next_ = head_;
+        head_ = &node;
+        if (tail_ == nullptr)
+        {
+            tail_ = &node;
+        }
+        ++size_;
+    }
+
+    void push_back(T& value) noexcept
+    {
+        hook& node = value;
+        node.next_ = nullptr;
+        (tail_ != nullptr ? tail_->next_ : head_) = &node;
+        tail_ = &node;
+        ++size_;
+    }
+
+    void pop_front() noexcept
+    {
+        hook* node = head_;
+        head_ = node->next_;
+        if (head_ == nullptr)
+        {
+            tail_ = nullptr;
+        }
+        node->next_ = nullptr;
+        --size_;
+    }
+
+    // Links `value`, which must be unlinked, after `pos`.
+    iterator insert_after(const_iterator pos, T& value) noexcept
+    {
+        hook& node = value;
+        node.next_ = pos.node_->next_;
+        pos.node_->next_ = &node;
+        if (tail_ == pos.node_)
+        {
+            tail_ = &node;
+        }
+        ++size_;
+        return iterator(&node);
+    }
+
+    // Unlinks the object after `pos`, returning an iterator to the one after it.
+    iterator erase_after(const_iterator pos) noexcept
+    {
+        hook* node = pos.node_->next_;
+        pos.node_->next_ = node->next_;
+        if (tail_ == node)
+        {
+            tail_ = pos.node_;
+        }
+        node->next_ = nullptr;
+        --size_;
+        return iterator(pos.node_->next_);
+    }
+
+    // Unlinks all objects.
+    void clear() noexcept
+    {
+        while (head_ != nullptr)
+        {
+            hook* next = head_->next_;
+            head_->next_ = nullptr;
+            head_ = next;
+        }
+        tail_ = nullptr;
+        size_ = 0;
+    }
+
+    void swap(intrusive_slist& other) noexcept
+    {
+        std::swap(head_, other.head_);
+        std::swap(tail_, other.tail_);
+        std::swap(size_, other.size_);
+    }
+
+   private:
+    hook* head_ = nullptr;
+    hook* tail_ = nullptr;
+    size_type size_ = 0;
+};
+
+// `intrusive_hash_table` is a hash set of objects deriving from `hash_hook<Tag>`,
+// identified by the key `KeyOf` returns for them.
+//
+// The table doesn't allocate its buckets either: they're provided by the caller,
+// e.g. from a `safe_containers::vector`, & must outlive the table. Objects are chained
+// per bucket, & each hook caches its hash, so `rehash` into a larger bucket array only
+// relinks the objects. The load factor is up to the caller.
+template <
+    typename T,
+    typename Key,
+    typename KeyOf,
+    typename Hash = std::hash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Tag = void>
+class intrusive_hash_table
+{
+    using hook = hash_hook<Tag>;
+
+    static_assert(std::is_base_of_v<hook, T>, "Elements must derive from `hash_hook<Tag>`");
+
+   public:
+    // Head of the chain of a bucket.
+    struct bucket_type
+    {
+        hook* head = nullptr;
+    };
+
+   private:
+    template <bool Const>
+    class iterator_impl
+    {
+        using owner = std::conditional_t<Const, const intrusive_hash_table, intrusive_hash_table>;
+
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using reference = std::conditional_t<Const, const T&, T&>;
+
+        iterator_impl() noexcept = default;
+        iterator_impl(owner* table, std::size_t bucket, hook* node) noexcept
+            : table_(table),
+              bucket_(bucket),
+              node_(node)
+        {
+        }
+
+        // Allow conversion from iterator to const_iterator.
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        iterator_impl(const iterator_impl<false>& other) noexcept
+            : table_(other.table_),
+              bucket_(other.bucket_),
+              node_(other.node_)
+        {
+        }
+
+        reference operator*() const noexcept { return static_cast<reference>(*node_); }
+        pointer operator->() const noexcept { return &**this; }
+
+        iterator_impl& operator++() noexcept
+        {
+            node_ = node_->next_;
+            while (node_ == nullptr && ++bucket_ < table_->buckets_.size())
+            {
+                node_ = table_->buckets_[bucket_].head;
+            }
+            return *this;
+        }
+        iterator_impl operator++(int) noexcept
+        {
+            iterator_impl tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        friend bool operator==(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.node_ == b.node_;
+        }
+        friend bool operator!=(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.node_ != b.node_;
+        }
+
+       private:
+        friend class intrusive_hash_table;
+        friend class iterator_impl<!Const>;
+
+        owner* table_ = nullptr;
+        std::size_t bucket_ = 0;
+        hook* node_ = nullptr;
+    };
+
+   public:
+    using key_type = Key;
+    using value_type = T;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = std::size_t;
+    using iterator = iterator_impl<false>;
+    using const_iterator = iterator_impl<true>;
+
+    // Creates an empty table over `buckets`, which must not be empty.
+    explicit intrusive_hash_table(
+        span<bucket_type> buckets,
+        const Hash& hash = Hash(),
+        const KeyEqual& eq = KeyEqual(),
+        const KeyOf& key_of = KeyOf()) noexcept
+        : buckets_(buckets),
+          hash_(hash),
+          eq_(eq),
+          key_of_(key_of)
+    {
+        for (bucket_type& b : buckets_)
+        {
+            b.head = nullptr;
+        }
+    }
+
+    intrusive_hash_table(const intrusive_hash_table&) = delete;
+    intrusive_hash_table& operator=(const intrusive_hash_table&) = delete;
+
+    ~intrusive_hash_table() { clear(); }
+
+    iterator begin() noexcept { return iterator(this, FirstBucket(), FirstNode()); }
+    const_iterator begin() const noexcept
+    {
+        return const_iterator(this, FirstBucket(), FirstNode());
+    }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return iterator(this, buckets_.size(), nullptr); }
+    const_iterator end() const noexcept { return const_iterator(this, buckets_.size(), nullptr); }
+    const_iterator cend() const noexcept { return end(); }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    size_type size() const noexcept { return size_; }
+    size_type bucket_count() const noexcept { return buckets_.size(); }
+    double load_factor() const noexcept
+    {
+        return static_cast<double>(size_) / static_cast<double>(buckets_.size());
+    }
+
+    // Links `value`, which must be unlinked, unless an object with the same key is
+    // present. Returns the object with this key & whether `value` was inserted.
+    std::pair<iterator, bool> insert(T& value) noexcept
+    {
+        const Key& key = key_of_(static_cast<const T&>(value));
+        const std::size_t h = static_cast<std::size_t>(hash_(key));
+        const std::size_t b = BucketOf(h);
+        if (hook* found = FindIn(b, key, h))
+        {
+            return {iterator(this, b, found), false};
+        }
+        hook& node = value;
+        node.hash_ = h;
+        node.next_ = buckets_[b].head;
+        buckets_[b].head = &node;
+        ++size_;
+        return {iterator(this, b, &node), true};
+    }
+
+    iterator find(const Key& key) noexcept
+    {
+        const std::size_t h = static_cast<std::size_t>(hash_(key));
+        const std::size_t b = BucketOf(h);
+        hook* found = FindIn(b, key, h);
+        return found != nullptr ? iterator(this, b, found) : end();
+    }
+
+    const_iterator find(const Key& key) const noexcept
+    {
+        const std::size_t h = static_cast<std::size_t>(hash_(key));
+        const std::size_t b = BucketOf(h);
+        hook* found = FindIn(b, key, h);
+        return found != nullptr ? const_iterator(this, b, found) : end();
+    }
+
+    bool contains(const Key& key) const noexcept { return find(key) != end(); }
+
+    // Unlinks the object with `key`, if any. Returns the number of unlinked objects.
+    size_type erase(const Key& key) noexcept
+    {
+        const iterator it = find(key);
+        if (it == end())
+        {
+            return 0;
+        }
+        Unlink(it.bucket_, *it.node_);
+        return 1;
+    }
+
+    // Unlinks `value`, which must be linked in this table.
+    void remove(T& value) noexcept
+    {
+        hook& node = value;
+        Unlink(BucketOf(node.hash_), node);
+    }
+
+    // Moves all objects to `buckets`, which must not be empty, & returns the previous
+    // buckets, which are no longer used.
+    span<bucket_type> rehash(span<bucket_type> buckets) noexcept
+    {
+        for (bucket_type& b : buckets)
+        {
+            b.head = nullptr;
+        }
+        const span<bucket_type> previous = buckets_;
+        buckets_ = buckets;
+        for (bucket_type& b : previous)
+        {
+            hook* node = b.head;
+            while (node != nullptr)
+            {
+                hook* next = node->next_;
+                bucket_type& target = buckets_[BucketOf(node->hash_)];
+                node->next_ = target.head;
+                target.head = node;
+                node = next;
+            }
+            b.head = nullptr;
+        }
+        return previous;
+    }
+
+    // Unlinks all objects.
+    void clear() noexcept
+    {
+        for (bucket_type& b : buckets_)
+        {
+            while (b.head != nullptr)
+            {
+                b.head = std::exchange(b.head->next_, nullptr);
+            }
+        }
+        size_ = 0;
+    }
+
+   private:
+    std::size_t BucketOf(std::size_t h) const noexcept { return h % buckets_.size(); }
+
+    hook* FindIn(std::size_t b, const Key& key, std::size_t h) const noexcept
+    {
+        for (hook* node = buckets_[b].head; node != nullptr; node = node->next_)
+        {
+            if (node->hash_ == h && eq_(key_of_(static_cast<const T&>(*node)), key))
+            {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    void Unlink(std::size_t b, hook& node) noexcept
+    {
+        hook** link = &buckets_[b].head;
+        while (*link != &node)
+        {
+            link = &(*link)->next_;
+        }
+        *link = node.next_;
+        node.next_ = nullptr;
+        --size_;
+    }
+
+    std::size_t FirstBucket() const noexcept
+    {
+        std::size_t b = 0;
+        while (b < buckets_.size() && buckets_[b].head == nullptr)
+        {
+            ++b;
+        }
+        return b;
+    }
+
+    hook* FirstNode() const noexcept
+    {
+        const std::size_t b = FirstBucket();
+        return b < buckets_.size() ? buckets_[b].head : nullptr;
+    }
+
+    span<bucket_type> buckets_;
+    hasher hash_;
+    key_equal eq_;
+    KeyOf key_of_;
+    size_type size_ = 0;
+};
+
+}  // namespace safe_containers
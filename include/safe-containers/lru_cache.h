@@ -0,0 +1,506 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/hash.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+#include <safe-containers/vector.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `lru_cache` is a fixed-capacity map which evicts its least recently used entry to
+// make room for a new one. All storage is allocated by `Create`, so lookups, inserts,
+// evictions & erases never allocate afterwards.
+//
+// Entries live in a slot array of `capacity` elements. A parallel
+// `safe_containers::vector` of nodes links them into a recency list by index, most
+// recently used first, & threads unused slots on a free list. Keys are found through
+// an open-addressing index of slot numbers with linear probing, sized for a load
+// factor of at most 1/2. Erasing shifts the following entries of a probe sequence
+// back instead of leaving tombstones, so the index never needs rebuilding.
+//
+// Elements are stored as `std::pair<K, V>`. Keys must not be modified through
+// iterators.
+template <
+    typename K,
+    typename V,
+    typename Hash = std::hash<K>,
+    typename KeyEqual = std::equal_to<K>,
+    typename AllocatorType = std::allocator<std::pair<K, V>>>
+class lru_cache
+{
+    template <bool Const>
+    class iterator_impl;
+
+    using traits = std::allocator_traits<AllocatorType>;
+
+    static constexpr std::uint32_t kNone = std::numeric_limits<std::uint32_t>::max();
+
+    struct node
+    {
+        std::uint32_t prev;
+        std::uint32_t next;
+        std::uint32_t hash;
+    };
+
+    using node_allocator = typename traits::template rebind_alloc<node>;
+    using index_allocator = typename traits::template rebind_alloc<std::uint32_t>;
+
+   public:
+    template <typename R>
+    using result = cpp::result<R, ContainerError>;
+
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using allocator_type = AllocatorType;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = std::size_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    // Iterates from the most to the least recently used entry.
+    using iterator = iterator_impl<false>;
+    using const_iterator = iterator_impl<true>;
+
+    static constexpr size_type kMaxCapacity = size_type{1} << 30;
+
+    static_assert(
+        std::is_same_v<typename traits::pointer, value_type*>,
+        "Fancy allocator pointers are not supported");
+    // A full cache builds a new entry before evicting & then moves it into place,
+    // which must not fail once the old entry is gone.
+    static_assert(
+        std::is_nothrow_move_constructible_v<value_type>,
+        "Entries must be nothrow move constructible");
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    lru_cache(const lru_cache&) = delete;
+    lru_cache& operator=(const lru_cache&) = delete;
+
+    lru_cache(lru_cache&& other) noexcept
+        : lru_cache(other.alloc_, other.hash_, other.eq_)
+    {
+        swap(other);
+    }
+
+    lru_cache& operator=(lru_cache&& other) noexcept
+    {
+        lru_cache tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    ~lru_cache() { Destroy(); }
+
+    // Creates a cache holding up to `capacity` entries, allocating all its storage.
+    static result<lru_cache> Create(
+        size_type capacity,
+        const allocator_type& alloc,
+        const Hash& hash = Hash(),
+        const KeyEqual& eq = KeyEqual()) noexcept
+    {
+        if (capacity == 0 || capacity > kMaxCapacity)
+        {
+            return cpp::fail(ContainerError{});
+        }
+        lru_cache cache(alloc, hash, eq);
+        TRY(cache.nodes_.resize(capacity));
+        TRY(cache.index_.assign(detail::NextPowerOfTwo(2 * capacity), kNone));
+        auto slots = detail::Allocate(cache.alloc_, capacity);
+        if (slots.has_error())
+        {
+            return cpp::fail(std::move(slots).error());
+        }
+        cache.slots_ = slots.value();
+        cache.capacity_ = capacity;
+        cache.ResetFreeList();
+        return cache;
+    }
+
+    // Clones the cache, including the recency order of its entries.
+    result<lru_cache> Clone() const noexcept
+    {
+        auto cache = Create(capacity_, alloc_, hash_, eq_);
+        if (cache.has_error())
+        {
+            return cache;
+        }
+        for (std::uint32_t e = tail_; e != kNone; e = nodes_[e].prev)
+        {
+            auto res = cache.value().try_emplace(slots_[e].first, slots_[e].second);
+            if (res.has_error())
+            {
+                return cpp::fail(std::move(res).error());
+            }
+        }
+        return cache;
+    }
+
+    allocator_type get_allocator() const noexcept { return alloc_; }
+
+    iterator begin() noexcept { return iterator(this, head_); }
+    const_iterator begin() const noexcept { return const_iterator(this, head_); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return iterator(this, kNone); }
+    const_iterator end() const noexcept { return const_iterator(this, kNone); }
+    const_iterator cend() const noexcept { return end(); }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    size_type size() const noexcept { return size_; }
+    size_type capacity() const noexcept { return capacity_; }
+
+    // The value of `key`, which becomes the most recently used entry, or `nullptr`.
+    V* get(const K& key) noexcept
+    {
+        const std::uint32_t e = FindSlot(key);
+        if (e == kNone)
+        {
+            return nullptr;
+        }
+        Touch(e);
+        return &slots_[e].second;
+    }
+
+    // The value of `key` without updating the recency order, or `nullptr`.
+    const V* peek(const K& key) const noexcept
+    {
+        const std::uint32_t e = FindSlot(key);
+        return e == kNone ? nullptr : &slots_[e].second;
+    }
+
+    bool contains(const K& key) const noexcept { return FindSlot(key) != kNone; }
+
+    // The entry which would be evicted next. The cache must not be empty.
+    const_reference lru() const noexcept { return slots_[tail_]; }
+
+    // Inserts `(key, V(args...))` if `key` is absent, evicting the least recently used
+    // entry if the cache is full. Returns the entry with this key, which becomes the
+    // most recently used one, & whether it was inserted. If constructing the entry
+    // fails, an error is returned, but an entry evicted to make room stays evicted.
+    // Inserting into a moved-from cache, which has no capacity, returns an error.
+    template <typename Key, typename... Args>
+    result<std::pair<iterator, bool>> try_emplace(Key&& key, Args&&... args) noexcept
+    {
+        if (capacity_ == 0)
+        {
+            return cpp::fail(ContainerError{});
+        }
+        const std::uint32_t h = HashOf(key);
+        const size_type pos = Find(key, h);
+        if (pos != kNone)
+        {
+            const std::uint32_t e = index_[pos];
+            Touch(e);
+            return std::pair<iterator, bool>(iterator(this, e), false);
+        }
+
+        if (free_head_ == kNone)
+        {
+            // The arguments may refer to the entry about to be evicted, so build the
+            // new entry before destroying it.
+            std::optional<value_type> entry;
+            SAFE_CONTAINERS_CATCH_OOM(entry.emplace(
+                std::piecewise_construct,
+                std::forward_as_tuple(std::forward<Key>(key)),
+                std::forward_as_tuple(std::forward<Args>(args)...)));
+            Evict();
+            traits::construct(alloc_, &slots_[free_head_], std::move(*entry));
+        }
+        else
+        {
+            TRY(detail::Construct(
+                alloc_,
+                &slots_[free_head_],
+                std::piecewise_construct,
+                std::forward_as_tuple(std::forward<Key>(key)),
+                std::forward_as_tuple(std::forward<Args>(args)...)));
+        }
+        const std::uint32_t e = free_head_;
+        free_head_ = nodes_[e].next;
+        nodes_[e].hash = h;
+        size_type i = h & (index_.size() - 1);
+        while (index_[i] != kNone)
+        {
+            i = (i + 1) & (index_.size() - 1);
+        }
+        index_[i] = e;
+        PushFront(e);
+        ++size_;
+        return std::pair<iterator, bool>(iterator(this, e), true);
+    }
+
+    template <typename Key, typename M>
+    result<std::pair<iterator, bool>> insert_or_assign(Key&& key, M&& value) noexcept
+    {
+        auto res = try_emplace(std::forward<Key>(key), std::forward<M>(value));
+        if (res.has_value() && !res.value().second)
+        {
+            SAFE_CONTAINERS_CATCH_OOM(res.value().first->second = std::forward<M>(value));
+        }
+        return res;
+    }
+
+    size_type erase(const K& key) noexcept
+    {
+        const size_type pos = Find(key, HashOf(key));
+        if (pos == kNone)
+        {
+            return 0;
+        }
+        const std::uint32_t e = index_[pos];
+        RemoveFromIndex(pos);
+        Release(e);
+        return 1;
+    }
+
+    // Destroys all entries, keeping the storage.
+    void clear() noexcept
+    {
+        for (std::uint32_t e = head_; e != kNone; e = nodes_[e].next)
+        {
+            traits::destroy(alloc_, &slots_[e]);
+        }
+        std::fill(index_.begin(), index_.end(), kNone);
+        ResetFreeList();
+    }
+
+    void swap(lru_cache& other) noexcept
+    {
+        std::swap(alloc_, other.alloc_);
+        std::swap(hash_, other.hash_);
+        std::swap(eq_, other.eq_);
+        std::swap(slots_, other.slots_);
+        nodes_.swap(other.nodes_);
+        index_.swap(other.index_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(size_, other.size_);
+        std::swap(head_, other.head_);
+        std::swap(tail_, other.tail_);
+        std::swap(free_head_, other.free_head_);
+    }
+
+   private:
+    lru_cache(const allocator_type& alloc, const Hash& hash, const KeyEqual& eq) noexcept
+        : alloc_(alloc),
+          hash_(hash),
+          eq_(eq),
+          // Passed as lvalues, as `vector` rejects allocator rvalues.
+          nodes_(static_cast<const node_allocator&>(node_allocator(alloc))),
+          index_(static_cast<const index_allocator&>(index_allocator(alloc)))
+    {
+    }
+
+    std::uint32_t HashOf(const K& key) const noexcept
+    {
+        return static_cast<std::uint32_t>(detail::MixHash(static_cast<std::uint64_t>(hash_(key))));
+    }
+
+    // Position of `key` in the index, or `kNone`.
+    size_type Find(const K& key, std::uint32_t h) const noexcept
+    {
+        if (capacity_ == 0)
+        {
+            return kNone;
+        }
+        const size_type mask = index_.size() - 1;
+        for (size_type i = h & mask;; i = (i + 1) & mask)
+        {
+            const std::uint32_t e = index_[i];
+            if (e == kNone)
+            {
+                return kNone;
+            }
+            if (nodes_[e].hash == h && eq_(slots_[e].first, key))
+            {
+                return i;
+            }
+        }
+    }
+
+    // Slot of `key`, or `kNone`.
+    std::uint32_t FindSlot(const K& key) const noexcept
+    {
+        const size_type pos = Find(key, HashOf(key));
+        return pos == kNone ? kNone : index_[pos];
+    }
+
+    // Clears position `pos` of the index, shifting back entries of the probe sequence
+    // after it which can move closer to their home position.
+    void RemoveFromIndex(size_type pos) noexcept
+    {
+        const size_type mask = index_.size() - 1;
+        for (size_type i = (pos + 1) & mask; index_[i] != kNone; i = (i + 1) & mask)
+        {
+            const size_type home = nodes_[index_[i]].hash & mask;
+            if (((i - home) & mask) >= ((i - pos) & mask))
+            {
+                index_[pos] = index_[i];
+                pos = i;
+            }
+        }
+        index_[pos] = kNone;
+    }
+
+    void Evict() noexcept
+    {
+        const std::uint32_t e = tail_;
+        const size_type mask = index_.size() - 1;
+        size_type pos = nodes_[e].hash & mask;
+        while (index_[pos] != e)
+        {
+            pos = (pos + 1) & mask;
+        }
+        RemoveFromIndex(pos);
+        Release(e);
+    }
+
+    // Destroys the entry in slot `e` & moves the slot to the free list.
+    void Release(std::uint32_t e) noexcept
+    {
+        Unlink(e);
+        traits::destroy(alloc_, &slots_[e]);
+        nodes_[e].next = free_head_;
+        free_head_ = e;
+        --size_;
+    }
+
+    void Unlink(std::uint32_t e) noexcept
+    {
+        const node n = nodes_[e];
+        (n.prev != kNone ? nodes_[n.prev].next : head_) = n.next;
+        (n.next != kNone ? nodes_[n.next].prev : tail_) = n.prev;
+    }
+
+    void PushFront(std::uint32_t e) noexcept
+    {
+        nodes_[e].prev = kNone;
+        nodes_[e].next = head_;
+        (head_ != kNone ? nodes_[head_].prev : tail_) = e;
+        head_ = e;
+    }
+
+    // Makes `e` the most recently used entry.
+    void Touch(std::uint32_t e) noexcept
+    {
+        if (e != head_)
+        {
+            Unlink(e);
+            PushFront(e);
+        }
+    }
+
+    void ResetFreeList() noexcept
+    {
+        for (size_type e = 0; e < capacity_; ++e)
+        {
+            nodes_[e].next = e + 1 < capacity_ ? static_cast<std::uint32_t>(e + 1) : kNone;
+        }
+        free_head_ = capacity_ > 0 ? 0 : kNone;
+        head_ = kNone;
+        tail_ = kNone;
+        size_ = 0;
+    }
+
+    void Destroy() noexcept
+    {
+        if (slots_ != nullptr)
+        {
+            clear();
+            detail::Deallocate(alloc_, slots_, capacity_);
+            slots_ = nullptr;
+        }
+    }
+
+    template <bool Const>
+    class iterator_impl
+    {
+        using owner = std::conditional_t<Const, const lru_cache, lru_cache>;
+
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename lru_cache::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+        using reference = std::conditional_t<Const, const value_type&, value_type&>;
+
+        iterator_impl() noexcept = default;
+        iterator_impl(owner* parent, std::uint32_t slot) noexcept
+            : cache_(parent),
+              slot_(slot)
+        {
+        }
+
+        // Allow conversion from iterator to const_iterator.
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        iterator_impl(const iterator_impl<false>& other) noexcept
+            : cache_(other.cache_),
+              slot_(other.slot_)
+        {
+        }
+
+        reference operator*() const noexcept { return cache_->slots_[slot_]; }
+        pointer operator->() const noexcept { return &cache_->slots_[slot_]; }
+
+        iterator_impl& operator++() noexcept
+        {
+            slot_ = cache_->nodes_[slot_].next;
+            return *this;
+        }
+        iterator_impl operator++(int) noexcept
+        {
+            iterator_impl tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        friend bool operator==(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.slot_ == b.slot_;
+        }
+        friend bool operator!=(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.slot_ != b.slot_;
+        }
+
+       private:
+        friend class iterator_impl<!Const>;
+
+        owner* cache_ = nullptr;
+        std::uint32_t slot_ = kNone;
+    };
+
+    allocator_type alloc_;
+    hasher hash_;
+    key_equal eq_;
+    // Storage for `capacity_` entries, constructed only in linked slots.
+    value_type* slots_ = nullptr;
+    vector<node, node_allocator> nodes_;
+    // Slot of each entry in the index, or `kNone`. The size is a power of two.
+    vector<std::uint32_t, index_allocator> index_;
+    size_type capacity_ = 0;
+    size_type size_ = 0;
+    // Most & least recently used entries.
+    std::uint32_t head_ = kNone;
+    std::uint32_t tail_ = kNone;
+    // First unused slot, linked through `node::next`.
+    std::uint32_t free_head_ = kNone;
+};
+
+}  // namespace safe_containers
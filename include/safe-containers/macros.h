@@ -30,6 +30,12 @@
 #define SAFE_CONTAINERS_POST_BAD_ALLOC_HOOK
 #endif  // SAFE_CONTAINERS_POST_BAD_ALLOC_HOOK
 
+// Configure the cache line size used to pad data shared between threads, to
+// prevent false sharing in the concurrent containers.
+#ifndef SAFE_CONTAINERS_CACHE_LINE_SIZE
+#define SAFE_CONTAINERS_CACHE_LINE_SIZE 64
+#endif  // SAFE_CONTAINERS_CACHE_LINE_SIZE
+
 #define SAFE_CONTAINERS_CATCH_OOM(F)            \
     {                                           \
         SAFE_CONTAINERS_PRE_ALLOC_HOOK          \
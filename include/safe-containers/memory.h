@@ -0,0 +1,78 @@
+#pragma once
+
+/** Fallible raw allocation utilities shared by the containers. **/
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/result/result_ext.h>
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace safe_containers
+{
+namespace detail
+{
+
+// Allocates uninitialized storage for `n` objects through `alloc`, converting
+// any allocation failure into a `ContainerError`.
+template <typename Alloc>
+cpp::result<typename std::allocator_traits<Alloc>::pointer, ContainerError> Allocate(
+    Alloc& alloc, std::size_t n) noexcept
+{
+    SAFE_CONTAINERS_CATCH_OOM(return std::allocator_traits<Alloc>::allocate(alloc, n));
+}
+
+// Constructs an object at `p` through `alloc`, converting any allocation failure
+// raised by the constructor into a `ContainerError`.
+template <typename Alloc, typename T, typename... Args>
+cpp::result<void, ContainerError> Construct(Alloc& alloc, T* p, Args&&... args) noexcept
+{
+    SAFE_CONTAINERS_CATCH_OOM(
+        std::allocator_traits<Alloc>::construct(alloc, p, std::forward<Args>(args)...));
+    return {};
+}
+
+template <typename Alloc>
+void Deallocate(
+    Alloc& alloc, typename std::allocator_traits<Alloc>::pointer p, std::size_t n) noexcept
+{
+    std::allocator_traits<Alloc>::deallocate(alloc, p, n);
+}
+
+// Rounds `n` up to the next power of two, e.g. to index a ring buffer with a mask.
+// Returns 0 if the result would overflow.
+constexpr std::size_t NextPowerOfTwo(std::size_t n) noexcept
+{
+    std::size_t p = 1;
+    while (p < n && p != 0)
+    {
+        p <<= 1;
+    }
+    return p;
+}
+
+// Returns the index of the highest set bit of `n`, which must not be 0.
+inline std::size_t FloorLog2(std::size_t n) noexcept
+{
+    return sizeof(unsigned long long) * 8 - 1 -
+           static_cast<std::size_t>(__builtin_clzll(static_cast<unsigned long long>(n)));
+}
+
+// Makes room for one more element in `vec`, growing its capacity geometrically, as
+// `reserve` allocates exactly what it's asked for. A following `push_back` won't
+// reallocate, so it can't fail on allocation.
+template <typename Vector>
+cpp::result<void, ContainerError> ReserveOneMore(Vector& vec) noexcept
+{
+    if (vec.size() == vec.capacity())
+    {
+        const std::size_t capacity = vec.capacity() == 0 ? 8 : 2 * vec.capacity();
+        SAFE_CONTAINERS_CATCH_OOM(vec.reserve(capacity));
+    }
+    return {};
+}
+
+}  // namespace detail
+}  // namespace safe_containers
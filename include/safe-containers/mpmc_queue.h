@@ -0,0 +1,221 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `mpmc_queue` is a bounded, lock-free multi-producer/multi-consumer queue, based on
+// Dmitry Vyukov's design: every slot carries a sequence number which tells producers
+// & consumers whether the slot is free for the current lap of the ring.
+//
+// Its storage is allocated once by `Create(...)`, which signals allocation failure
+// using a `result` type. Afterwards, the queue never allocates: `try_push` fails on a
+// full queue and `try_pop` fails on an empty one, without ever blocking.
+//
+// Elements must be nothrow constructible & move assignable, as a claimed slot cannot
+// be handed back to other threads.
+template <typename T, typename AllocatorType = std::allocator<T>>
+class mpmc_queue
+{
+    struct cell
+    {
+        std::atomic<std::size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    using cell_allocator =
+        typename std::allocator_traits<AllocatorType>::template rebind_alloc<cell>;
+    using cell_traits = std::allocator_traits<cell_allocator>;
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using value_type = T;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+
+    static_assert(
+        std::is_same_v<typename cell_traits::pointer, cell*>,
+        "Fancy allocator pointers are not supported");
+    static_assert(std::is_nothrow_destructible_v<T>, "Elements must be nothrow destructible");
+    static_assert(
+        std::is_nothrow_move_assignable_v<T>, "Elements must be nothrow move assignable");
+
+    // Creates a queue holding at least `capacity` elements. The capacity is rounded up
+    // to a power of two, and is at least 2.
+    static result<mpmc_queue> Create(size_type capacity, const allocator_type& alloc) noexcept
+    {
+        const size_type rounded = detail::NextPowerOfTwo(std::max<size_type>(capacity, 2));
+        if (rounded == 0)
+        {
+            return cpp::fail(ContainerError{});
+        }
+        cell_allocator cell_alloc(alloc);
+        auto buffer = detail::Allocate(cell_alloc, rounded);
+        if (buffer.has_error())
+        {
+            return cpp::fail(std::move(buffer).error());
+        }
+        for (size_type i = 0; i < rounded; ++i)
+        {
+            cell* c = new (&buffer.value()[i]) cell;
+            c->sequence.store(i, std::memory_order_relaxed);
+        }
+        return mpmc_queue(cell_alloc, buffer.value(), rounded);
+    }
+
+    mpmc_queue(const mpmc_queue&) = delete;
+    mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+    // Moving is only allowed while no other thread accesses either queue.
+    mpmc_queue(mpmc_queue&& other) noexcept
+        : alloc_(std::move(other.alloc_)),
+          buffer_(std::exchange(other.buffer_, nullptr)),
+          mask_(std::exchange(other.mask_, 0))
+    {
+        enqueue_pos_.store(
+            other.enqueue_pos_.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+        dequeue_pos_.store(
+            other.dequeue_pos_.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    mpmc_queue& operator=(mpmc_queue&&) = delete;
+
+    ~mpmc_queue()
+    {
+        if (buffer_ == nullptr)
+        {
+            return;
+        }
+        const size_type tail = enqueue_pos_.load(std::memory_order_relaxed);
+        for (size_type pos = dequeue_pos_.load(std::memory_order_relaxed); pos != tail; ++pos)
+        {
+            std::destroy_at(buffer_[pos & mask_].value());
+        }
+        for (size_type i = 0; i <= mask_; ++i)
+        {
+            std::destroy_at(&buffer_[i]);
+        }
+        detail::Deallocate(alloc_, buffer_, mask_ + 1);
+    }
+
+    size_type capacity() const noexcept { return mask_ + 1; }
+
+    // Approximate number of elements; exact when no thread is active.
+    size_type size() const noexcept
+    {
+        const size_type tail = enqueue_pos_.load(std::memory_order_acquire);
+        const size_type head = dequeue_pos_.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    // Returns false if the queue is full.
+    template <typename... Args>
+    bool try_emplace(Args&&... args) noexcept
+    {
+        static_assert(
+            std::is_nothrow_constructible_v<T, Args...>,
+            "Elements must be nothrow constructible from the arguments");
+        size_type pos = enqueue_pos_.load(std::memory_order_relaxed);
+        cell* c = nullptr;
+        while (true)
+        {
+            c = &buffer_[pos & mask_];
+            const size_type sequence = c->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+            if (diff == 0)
+            {
+                // The slot is free for this lap; try to claim it.
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                // The slot still holds an element from the previous lap.
+                return false;
+            }
+            else
+            {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        new (c->storage) T(std::forward<Args>(args)...);
+        c->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T& value) noexcept { return try_emplace(value); }
+    bool try_push(T&& value) noexcept { return try_emplace(std::move(value)); }
+
+    // Moves the oldest element into `out`. Returns false if the queue is empty.
+    bool try_pop(T& out) noexcept
+    {
+        size_type pos = dequeue_pos_.load(std::memory_order_relaxed);
+        cell* c = nullptr;
+        while (true)
+        {
+            c = &buffer_[pos & mask_];
+            const size_type sequence = c->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence - (pos + 1));
+            if (diff == 0)
+            {
+                // The slot holds an element for this lap; try to claim it.
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                // The slot has not been filled yet.
+                return false;
+            }
+            else
+            {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        T* value = c->value();
+        out = std::move(*value);
+        std::destroy_at(value);
+        // Free the slot for the next lap.
+        c->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+   private:
+    mpmc_queue(const cell_allocator& alloc, cell* buffer, size_type capacity) noexcept
+        : alloc_(alloc),
+          buffer_(buffer),
+          mask_(capacity - 1)
+    {
+    }
+
+    // Read-only after construction.
+    cell_allocator alloc_;
+    cell* buffer_;
+    size_type mask_;
+
+    alignas(SAFE_CONTAINERS_CACHE_LINE_SIZE) std::atomic<size_type> enqueue_pos_{0};
+    alignas(SAFE_CONTAINERS_CACHE_LINE_SIZE) std::atomic<size_type> dequeue_pos_{0};
+};
+
+}  // namespace safe_containers
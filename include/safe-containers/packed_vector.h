@@ -0,0 +1,536 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+#include <safe-containers/vector.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace safe_containers
+{
+namespace detail
+{
+
+constexpr std::uint64_t LowBits(unsigned bits) noexcept
+{
+    return bits >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << bits) - 1;
+}
+
+// Reads the `bits`-wide value starting at bit `bit` of `words`.
+inline std::uint64_t ExtractBits(
+    const std::uint64_t* words, std::size_t bit, unsigned bits) noexcept
+{
+    if (bits == 0)
+    {
+        return 0;
+    }
+    const std::size_t w = bit / 64;
+    const unsigned offset = bit % 64;
+    std::uint64_t value = words[w] >> offset;
+    if (offset + bits > 64)
+    {
+        value |= words[w + 1] << (64 - offset);
+    }
+    return value & LowBits(bits);
+}
+
+// Ors the `bits`-wide `value` into `words`, starting at bit `bit`. The target bits
+// must be zero.
+inline void DepositBits(
+    std::uint64_t* words, std::size_t bit, unsigned bits, std::uint64_t value) noexcept
+{
+    if (bits == 0)
+    {
+        return;
+    }
+    const std::size_t w = bit / 64;
+    const unsigned offset = bit % 64;
+    words[w] |= value << offset;
+    if (offset + bits > 64)
+    {
+        words[w + 1] |= value >> (64 - offset);
+    }
+}
+
+template <unsigned Bits, std::size_t J>
+inline std::uint64_t ExtractFixed(const std::uint64_t* words) noexcept
+{
+    constexpr std::size_t w = J * Bits / 64;
+    constexpr unsigned offset = J * Bits % 64;
+    if constexpr (Bits == 0)
+    {
+        return 0;
+    }
+    else if constexpr (offset + Bits > 64)
+    {
+        return ((words[w] >> offset) | (words[w + 1] << (64 - offset))) & LowBits(Bits);
+    }
+    else
+    {
+        return (words[w] >> offset) & LowBits(Bits);
+    }
+}
+
+template <unsigned Bits, std::size_t... Js>
+inline void DecodeBlock(
+    const std::uint64_t* words, std::uint64_t* out, std::index_sequence<Js...>) noexcept
+{
+    ((out[Js] = ExtractFixed<Bits, Js>(words)), ...);
+}
+
+// Decodes 64 `Bits`-wide values, which occupy exactly `Bits` words. Every shift is a
+// compile-time constant, which lets the compiler vectorize the straight-line code.
+template <unsigned Bits>
+void DecodeBlock(const std::uint64_t* words, std::uint64_t* out) noexcept
+{
+    DecodeBlock<Bits>(words, out, std::make_index_sequence<64>{});
+}
+
+using decode_block_fn = void (*)(const std::uint64_t*, std::uint64_t*) noexcept;
+
+template <std::size_t... Bits>
+constexpr auto MakeBlockDecoders(std::index_sequence<Bits...>) noexcept
+{
+    return std::array<decode_block_fn, sizeof...(Bits)>{&DecodeBlock<Bits>...};
+}
+
+// `kBlockDecoders[b]` decodes 64 `b`-wide values.
+inline constexpr auto kBlockDecoders = MakeBlockDecoders(std::make_index_sequence<65>{});
+
+}  // namespace detail
+
+// `packed_vector` stores unsigned integers using exactly `Bits` bits each, in a
+// `safe_containers::vector` of 64-bit words, with fallible allocation handling using
+// `result` types. Only the low `Bits` bits of a stored value are kept.
+//
+// `decode` unpacks a range into a caller-provided buffer, 64 values at a time with
+// fixed shifts, which is much faster than reading values one by one.
+template <unsigned Bits, typename AllocatorType = std::allocator<std::uint64_t>>
+class packed_vector
+{
+    static_assert(Bits > 0 && Bits <= 64, "Values must be 1 to 64 bits wide");
+
+    using words_type = vector<std::uint64_t, AllocatorType>;
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using value_type = std::uint64_t;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+
+    static constexpr value_type kMaxValue = detail::LowBits(Bits);
+
+    explicit packed_vector(const allocator_type& alloc) noexcept
+        : words_(alloc)
+    {
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    packed_vector(const packed_vector&) = delete;
+    packed_vector& operator=(const packed_vector&) = delete;
+
+    packed_vector(packed_vector&& other) noexcept
+        : packed_vector(other.get_allocator())
+    {
+        swap(other);
+    }
+
+    packed_vector& operator=(packed_vector&& other) noexcept
+    {
+        packed_vector tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    // Utility wrapper around the plain `packed_vector` so `Create` can be
+    // used regardless of fallibility.
+    static result<packed_vector> Create(const allocator_type& alloc) noexcept
+    {
+        return result<packed_vector>(cpp::in_place, alloc);
+    }
+
+    // Creates a vector of `count` zeros.
+    static result<packed_vector> Create(size_type count, const allocator_type& alloc) noexcept
+    {
+        packed_vector v(alloc);
+        TRY(v.resize(count));
+        return v;
+    }
+
+    result<packed_vector> Clone() const noexcept
+    {
+        packed_vector v(get_allocator());
+        TRY(v.words_.assign(words_.cbegin(), words_.cend()));
+        v.size_ = size_;
+        return v;
+    }
+
+    allocator_type get_allocator() const noexcept { return words_.get_allocator(); }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    size_type size() const noexcept { return size_; }
+    size_type capacity() const noexcept { return words_.capacity() * 64 / Bits; }
+
+    // Number of bytes used by the packed values.
+    size_type memory_usage() const noexcept { return words_.capacity() * sizeof(std::uint64_t); }
+
+    value_type operator[](size_type pos) const noexcept
+    {
+        return detail::ExtractBits(words_.data(), pos * Bits, Bits);
+    }
+
+    void set(size_type pos, value_type value) noexcept
+    {
+        Clear(pos);
+        detail::DepositBits(words_.data(), pos * Bits, Bits, value & kMaxValue);
+    }
+
+    result<void> reserve(size_type count) noexcept
+    {
+        SAFE_CONTAINERS_CATCH_OOM(words_.reserve(WordsFor(count)));
+        return {};
+    }
+
+    result<void> push_back(value_type value) noexcept
+    {
+        if (WordsFor(size_ + 1) > words_.size())
+        {
+            TRY(words_.push_back(std::uint64_t{0}));
+        }
+        detail::DepositBits(words_.data(), size_ * Bits, Bits, value & kMaxValue);
+        ++size_;
+        return {};
+    }
+
+    void pop_back() noexcept
+    {
+        --size_;
+        Clear(size_);
+        words_.resize(WordsFor(size_)).expect("shrinking never allocates");
+    }
+
+    // Resizes to `count` values, appending zeros. On failure, the vector is unchanged.
+    result<void> resize(size_type count) noexcept
+    {
+        if (count < size_)
+        {
+            for (size_type pos = count; pos < size_ && pos * Bits / 64 < WordsFor(count); ++pos)
+            {
+                Clear(pos);
+            }
+        }
+        TRY(words_.resize(WordsFor(count)));
+        size_ = count;
+        return {};
+    }
+
+    void clear() noexcept
+    {
+        words_.clear();
+        size_ = 0;
+    }
+
+    // Unpacks values `[first, first + count)` into `out`.
+    void decode(size_type first, size_type count, value_type* out) const noexcept
+    {
+        const size_type last = first + count;
+        // Unpack single values until `first` is at a multiple of 64 values, which
+        // always starts on a word boundary.
+        for (; first < last && first % 64 != 0; ++first)
+        {
+            *out++ = (*this)[first];
+        }
+        for (; first + 64 <= last; first += 64, out += 64)
+        {
+            detail::DecodeBlock<Bits>(words_.data() + first / 64 * Bits, out);
+        }
+        for (; first < last; ++first)
+        {
+            *out++ = (*this)[first];
+        }
+    }
+
+    void swap(packed_vector& other) noexcept
+    {
+        words_.swap(other.words_);
+        std::swap(size_, other.size_);
+    }
+
+   private:
+    static size_type WordsFor(size_type count) noexcept { return (count * Bits + 63) / 64; }
+
+    void Clear(size_type pos) noexcept
+    {
+        const size_type bit = pos * Bits;
+        const size_type w = bit / 64;
+        const unsigned offset = bit % 64;
+        words_[w] &= ~(kMaxValue << offset);
+        if (offset + Bits > 64)
+        {
+            words_[w + 1] &= ~(kMaxValue >> (64 - offset));
+        }
+    }
+
+    // Bits past `size_` are always zero.
+    words_type words_;
+    size_type size_ = 0;
+};
+
+// `compressed_vector` stores unsigned integers using frame-of-reference encoding:
+// values are grouped in blocks of `kBlockSize`, and each block only stores the
+// difference of its values to the block minimum, using as few bits as the largest
+// difference needs. Columns of IDs or timestamps, whose values are close to their
+// neighbours, typically shrink 2-8x.
+//
+// Values are appended to an uncompressed tail block, which is packed once full.
+// Random access stays O(1), and `decode` unpacks full blocks 64 values at a time.
+template <typename AllocatorType = std::allocator<std::uint64_t>>
+class compressed_vector
+{
+    struct block
+    {
+        std::uint64_t reference;
+        // Offset of the block's first word.
+        std::size_t offset;
+        unsigned bits;
+    };
+
+    using words_type = vector<std::uint64_t, AllocatorType>;
+    using block_allocator =
+        typename std::allocator_traits<AllocatorType>::template rebind_alloc<block>;
+    using blocks_type = vector<block, block_allocator>;
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using value_type = std::uint64_t;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+
+    static constexpr size_type kBlockSize = 128;
+
+    explicit compressed_vector(const allocator_type& alloc) noexcept
+        : words_(alloc),
+          // Passed as an lvalue, as `vector` rejects allocator rvalues.
+          blocks_(static_cast<const block_allocator&>(block_allocator(alloc)))
+    {
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    compressed_vector(const compressed_vector&) = delete;
+    compressed_vector& operator=(const compressed_vector&) = delete;
+
+    compressed_vector(compressed_vector&& other) noexcept
+        : compressed_vector(other.get_allocator())
+    {
+        swap(other);
+    }
+
+    compressed_vector& operator=(compressed_vector&& other) noexcept
+    {
+        compressed_vector tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    // Utility wrapper around the plain `compressed_vector` so `Create` can be
+    // used regardless of fallibility.
+    static result<compressed_vector> Create(const allocator_type& alloc) noexcept
+    {
+        return result<compressed_vector>(cpp::in_place, alloc);
+    }
+
+    template <typename InputIt>
+    static result<compressed_vector> Create(
+        InputIt first, InputIt last, const allocator_type& alloc) noexcept
+    {
+        compressed_vector v(alloc);
+        for (; first != last; ++first)
+        {
+            TRY(v.push_back(*first));
+        }
+        return v;
+    }
+
+    result<compressed_vector> Clone() const noexcept
+    {
+        compressed_vector v(get_allocator());
+        TRY(v.words_.assign(words_.cbegin(), words_.cend()));
+        TRY(v.blocks_.assign(blocks_.cbegin(), blocks_.cend()));
+        std::copy(tail_, tail_ + tail_size_, v.tail_);
+        v.tail_size_ = tail_size_;
+        return v;
+    }
+
+    allocator_type get_allocator() const noexcept { return words_.get_allocator(); }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+    size_type size() const noexcept { return blocks_.size() * kBlockSize + tail_size_; }
+
+    // Number of bytes used by the packed blocks & their headers.
+    size_type memory_usage() const noexcept
+    {
+        return words_.capacity() * sizeof(std::uint64_t) + blocks_.capacity() * sizeof(block);
+    }
+
+    value_type operator[](size_type pos) const noexcept
+    {
+        const size_type b = pos / kBlockSize;
+        if (b == blocks_.size())
+        {
+            return tail_[pos % kBlockSize];
+        }
+        const block& header = blocks_[b];
+        return header.reference +
+               detail::ExtractBits(
+                   words_.data() + header.offset, pos % kBlockSize * header.bits, header.bits);
+    }
+
+    result<void> push_back(value_type value) noexcept
+    {
+        tail_[tail_size_++] = value;
+        if (tail_size_ == kBlockSize)
+        {
+            auto res = PackTail();
+            if (res.has_error())
+            {
+                --tail_size_;
+                return res;
+            }
+        }
+        return {};
+    }
+
+    void pop_back() noexcept
+    {
+        if (tail_size_ == 0)
+        {
+            UnpackLastBlock();
+        }
+        --tail_size_;
+    }
+
+    // Resizes to `count` values, appending zeros. On failure, the vector is unchanged.
+    result<void> resize(size_type count) noexcept
+    {
+        const size_type old_size = size();
+        while (size() > count)
+        {
+            if (tail_size_ == 0)
+            {
+                UnpackLastBlock();
+            }
+            tail_size_ -= std::min(tail_size_, size() - count);
+        }
+        while (size() < count)
+        {
+            auto res = push_back(0);
+            if (res.has_error())
+            {
+                // Shrinking back never allocates.
+                resize(old_size).expect("shrinking never allocates");
+                return res;
+            }
+        }
+        return {};
+    }
+
+    void clear() noexcept
+    {
+        words_.clear();
+        blocks_.clear();
+        tail_size_ = 0;
+    }
+
+    // Unpacks values `[first, first + count)` into `out`.
+    void decode(size_type first, size_type count, value_type* out) const noexcept
+    {
+        const size_type last = first + count;
+        while (first < last)
+        {
+            const size_type b = first / kBlockSize;
+            if (first % kBlockSize != 0 || last - first < kBlockSize || b == blocks_.size())
+            {
+                *out++ = (*this)[first++];
+                continue;
+            }
+            const block& header = blocks_[b];
+            const detail::decode_block_fn decode_block = detail::kBlockDecoders[header.bits];
+            const std::uint64_t* words = words_.data() + header.offset;
+            decode_block(words, out);
+            decode_block(words + header.bits, out + 64);
+            for (size_type i = 0; i < kBlockSize; ++i)
+            {
+                out[i] += header.reference;
+            }
+            first += kBlockSize;
+            out += kBlockSize;
+        }
+    }
+
+    void swap(compressed_vector& other) noexcept
+    {
+        words_.swap(other.words_);
+        blocks_.swap(other.blocks_);
+        std::swap_ranges(tail_, tail_ + kBlockSize, other.tail_);
+        std::swap(tail_size_, other.tail_size_);
+    }
+
+   private:
+    // Packs the full tail block. On failure, the vector is unchanged.
+    result<void> PackTail() noexcept
+    {
+        const auto [min, max] = std::minmax_element(tail_, tail_ + kBlockSize);
+        const std::uint64_t range = *max - *min;
+        const unsigned bits = range == 0 ? 0 : static_cast<unsigned>(detail::FloorLog2(range) + 1);
+        // A block holds 128 values of `bits` bits, i.e. `2 * bits` words.
+        const size_type offset = words_.size();
+        TRY(words_.resize(offset + 2 * bits));
+        auto res = blocks_.push_back(block{*min, offset, bits});
+        if (res.has_error())
+        {
+            words_.resize(offset).expect("shrinking never allocates");
+            return res;
+        }
+        for (size_type i = 0; i < kBlockSize; ++i)
+        {
+            detail::DepositBits(words_.data() + offset, i * bits, bits, tail_[i] - *min);
+        }
+        tail_size_ = 0;
+        return {};
+    }
+
+    // Moves the last packed block back into the empty tail.
+    void UnpackLastBlock() noexcept
+    {
+        const size_type first = (blocks_.size() - 1) * kBlockSize;
+        for (size_type i = 0; i < kBlockSize; ++i)
+        {
+            tail_[i] = (*this)[first + i];
+        }
+        words_.resize(blocks_.back().offset).expect("shrinking never allocates");
+        blocks_.pop_back();
+        tail_size_ = kBlockSize;
+    }
+
+    words_type words_;
+    blocks_type blocks_;
+    value_type tail_[kBlockSize] = {};
+    size_type tail_size_ = 0;
+};
+
+}  // namespace safe_containers
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+#include <safe-containers/type_traits.h>
+#include <safe-containers/vector.h>
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `d_ary_heap` is a priority queue stored as an implicit heap in a
+// `safe_containers::vector`, with fallible allocation handling using `result` types.
+// Like `std::priority_queue`, `top()` is the greatest element according to `Compare`.
+//
+// Every node has `Arity` children, stored contiguously. A wider heap is shallower, so
+// pushing compares fewer elements, & popping compares more, but adjacent ones, which
+// usually share a cache line. Sifting moves elements into a hole instead of swapping
+// them, so elements must be nothrow movable.
+template <
+    typename T,
+    std::size_t Arity = 2,
+    typename Compare = std::less<T>,
+    typename AllocatorType = std::allocator<T>>
+class d_ary_heap
+{
+    static_assert(Arity >= 2, "A heap node needs at least 2 children");
+    static_assert(
+        std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_assignable_v<T>,
+        "Elements must be nothrow movable, so sifting can't leave a broken heap");
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using value_type = T;
+    using allocator_type = AllocatorType;
+    using value_compare = Compare;
+    using size_type = std::size_t;
+    using reference = T&;
+    using const_reference = const T&;
+    // Iterates over the elements in heap order, which is unspecified.
+    using const_iterator = const T*;
+
+    static constexpr size_type kArity = Arity;
+
+    explicit d_ary_heap(const allocator_type& alloc, const Compare& comp = Compare()) noexcept
+        : items_(alloc),
+          comp_(comp)
+    {
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    d_ary_heap(const d_ary_heap&) = delete;
+    d_ary_heap& operator=(const d_ary_heap&) = delete;
+
+    d_ary_heap(d_ary_heap&& other) noexcept
+        : d_ary_heap(other.get_allocator(), other.comp_)
+    {
+        swap(other);
+    }
+
+    d_ary_heap& operator=(d_ary_heap&& other) noexcept
+    {
+        d_ary_heap tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    // Utility wrapper around the plain `d_ary_heap` so `Create` can be
+    // used regardless of fallibility.
+    static result<d_ary_heap> Create(
+        const allocator_type& alloc, const Compare& comp = Compare()) noexcept
+    {
+        return result<d_ary_heap>(cpp::in_place, alloc, comp);
+    }
+
+    // Creates a heap of the elements of `[first, last)`, copied with a single
+    // allocation for forward iterators & ordered in O(n).
+    template <typename InputIt>
+    static result<d_ary_heap> Create(
+        InputIt first,
+        InputIt last,
+        const allocator_type& alloc,
+        const Compare& comp = Compare()) noexcept
+    {
+        d_ary_heap heap(alloc, comp);
+        TRY(heap.items_.assign(first, last));
+        heap.Heapify();
+        return heap;
+    }
+
+    static result<d_ary_heap> Create(
+        std::initializer_list<T> values,
+        const allocator_type& alloc,
+        const Compare& comp = Compare()) noexcept
+    {
+        return Create(values.begin(), values.end(), alloc, comp);
+    }
+
+    result<d_ary_heap> Clone() const noexcept
+    {
+        d_ary_heap heap(get_allocator(), comp_);
+        TRY(heap.items_.assign(items_.cbegin(), items_.cend()));
+        return heap;
+    }
+
+    allocator_type get_allocator() const noexcept { return items_.get_allocator(); }
+    value_compare value_comp() const { return comp_; }
+
+    const_iterator begin() const noexcept { return items_.data(); }
+    const_iterator end() const noexcept { return items_.data() + items_.size(); }
+
+    [[nodiscard]] bool empty() const noexcept { return items_.empty(); }
+    size_type size() const noexcept { return items_.size(); }
+    size_type capacity() const noexcept { return items_.capacity(); }
+
+    // The greatest element. The heap must not be empty.
+    const_reference top() const noexcept { return items_.front(); }
+
+    result<void> reserve(size_type count) noexcept
+    {
+        SAFE_CONTAINERS_CATCH_OOM(items_.reserve(count));
+        return {};
+    }
+
+    result<void> push(const T& value) noexcept { return emplace(value); }
+    result<void> push(T&& value) noexcept { return emplace(std::move(value)); }
+
+    // Inserts `T(args...)`. On failure, the heap is unchanged.
+    template <typename... Args>
+    result<void> emplace(Args&&... args) noexcept
+    {
+        static_assert(
+            !contains_type<allocator_type, Args...>::value,
+            "Arguments cannot contain an allocator type");
+        auto res = items_.emplace_back(std::forward<Args>(args)...);
+        if (res.has_error())
+        {
+            return cpp::fail(std::move(res).error());
+        }
+        SiftUp(items_.size() - 1);
+        return {};
+    }
+
+    // Pushes the elements of `[first, last)`. Appends & re-heapifies in O(n) when
+    // that's cheaper than pushing one at a time. On failure, the heap is unchanged.
+    template <typename InputIt>
+    result<void> push_range(InputIt first, InputIt last) noexcept
+    {
+        const size_type original = items_.size();
+        auto inserted = items_.insert(items_.end(), first, last);
+        if (inserted.has_error())
+        {
+            // Appending leaves the existing elements intact, as they're nothrow movable.
+            while (items_.size() > original)
+            {
+                items_.pop_back();
+            }
+            return cpp::fail(std::move(inserted).error());
+        }
+        const size_type added = items_.size() - original;
+        if (added > original / 2)
+        {
+            Heapify();
+            return {};
+        }
+        for (size_type i = original; i < items_.size(); ++i)
+        {
+            SiftUp(i);
+        }
+        return {};
+    }
+
+    // Removes the greatest element. The heap must not be empty.
+    void pop() noexcept
+    {
+        if (items_.size() > 1)
+        {
+            T last = std::move(items_.back());
+            items_.pop_back();
+            SiftDown(0, std::move(last));
+            return;
+        }
+        items_.pop_back();
+    }
+
+    // Removes & returns the greatest element. The heap must not be empty.
+    T take_top() noexcept
+    {
+        T value = std::move(items_.front());
+        pop();
+        return value;
+    }
+
+    void clear() noexcept { items_.clear(); }
+
+    result<void> shrink_to_fit() noexcept { return items_.shrink_to_fit(); }
+
+    void swap(d_ary_heap& other) noexcept
+    {
+        items_.swap(other.items_);
+        std::swap(comp_, other.comp_);
+    }
+
+   private:
+    // Moves the element at `pos` towards the root until its parent isn't smaller.
+    void SiftUp(size_type pos) noexcept
+    {
+        T value = std::move(items_[pos]);
+        while (pos > 0)
+        {
+            const size_type parent = (pos - 1) / Arity;
+            if (!comp_(items_[parent], value))
+            {
+                break;
+            }
+            items_[pos] = std::move(items_[parent]);
+            pos = parent;
+        }
+        items_[pos] = std::move(value);
+    }
+
+    // Places `value` in the hole at `pos`, moving greater children up as needed.
+    void SiftDown(size_type pos, T value) noexcept
+    {
+        const size_type size = items_.size();
+        while (true)
+        {
+            const size_type first = pos * Arity + 1;
+            if (first >= size)
+            {
+                break;
+            }
+            const size_type last = first + Arity < size ? first + Arity : size;
+            size_type best = first;
+            for (size_type child = first + 1; child < last; ++child)
+            {
+                if (comp_(items_[best], items_[child]))
+                {
+                    best = child;
+                }
+            }
+            if (!comp_(value, items_[best]))
+            {
+                break;
+            }
+            items_[pos] = std::move(items_[best]);
+            pos = best;
+        }
+        items_[pos] = std::move(value);
+    }
+
+    // Orders all elements into a heap bottom-up, in O(n).
+    void Heapify() noexcept
+    {
+        const size_type size = items_.size();
+        if (size < 2)
+        {
+            return;
+        }
+        for (size_type i = (size - 2) / Arity + 1; i-- > 0;)
+        {
+            SiftDown(i, std::move(items_[i]));
+        }
+    }
+
+    vector<T, AllocatorType> items_;
+    Compare comp_;
+};
+
+// Binary heap, with the interface of `std::priority_queue`.
+template <
+    typename T,
+    typename Compare = std::less<T>,
+    typename AllocatorType = std::allocator<T>>
+using priority_queue = d_ary_heap<T, 2, Compare, AllocatorType>;
+
+}  // namespace safe_containers
@@ -0,0 +1,1108 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace safe_containers
+{
+
+// `radix_tree` is an ordered map from byte strings to `V`, stored as an adaptive radix
+// tree (ART), with fallible allocation handling using `result` types.
+//
+// A lookup follows one child per key byte, so it costs O(key length) regardless of the
+// number of keys, & runs of bytes without branches are compressed into the nodes. Inner
+// nodes come in four sizes, picked by their number of children: Node4 & Node16 hold
+// sorted key bytes, with Node16 searched with SSE2 when enabled at compile time, Node48
+// maps bytes to 48 child slots & Node256 indexes its children directly. Nodes grow &
+// shrink between the sizes as children are added & removed. Each key is stored once,
+// in its leaf, so nodes only keep the first `kMaxPrefix` bytes of a compressed path &
+// lookups check the rest against the leaf they end at.
+//
+// When an insertion can't allocate the leaf & node it needs, an error is returned and
+// the tree is unchanged. Erasing never fails: when a node can't be shrunk, it's kept.
+// Values are reached through pointers, which stay valid until their key is erased.
+template <typename V, typename AllocatorType = std::allocator<V>>
+class radix_tree
+{
+    enum class kind : std::uint8_t
+    {
+        leaf,
+        node4,
+        node16,
+        node48,
+        node256,
+    };
+
+    struct node
+    {
+        explicit node(kind k) noexcept
+            : type(k)
+        {
+        }
+
+        kind type;
+    };
+
+    // Followed by the bytes of its key.
+    struct leaf : node
+    {
+        template <typename... Args>
+        explicit leaf(std::size_t size, Args&&... args)
+            : node(kind::leaf),
+              key_size(size),
+              value(std::forward<Args>(args)...)
+        {
+        }
+
+        std::size_t key_size;
+        V value;
+    };
+
+   public:
+    // Number of bytes of a compressed path kept in a node.
+    static constexpr std::size_t kMaxPrefix = 8;
+
+   private:
+    struct inner : node
+    {
+        using node::node;
+
+        std::uint16_t count = 0;
+        std::size_t prefix_len = 0;
+        unsigned char prefix[kMaxPrefix] = {};
+        // The leaf of the key ending at this node, after its prefix.
+        leaf* value = nullptr;
+    };
+
+    template <std::size_t N, kind K>
+    struct sorted_node : inner
+    {
+        sorted_node() noexcept
+            : inner(K)
+        {
+        }
+
+        unsigned char keys[N] = {};
+        node* children[N] = {};
+    };
+
+    using node4 = sorted_node<4, kind::node4>;
+    using node16 = sorted_node<16, kind::node16>;
+
+    struct node48 : inner
+    {
+        node48() noexcept
+            : inner(kind::node48)
+        {
+        }
+
+        // 1 + the slot of the child of each byte, or 0 if there's none.
+        std::uint8_t index[256] = {};
+        node* children[48] = {};
+    };
+
+    struct node256 : inner
+    {
+        node256() noexcept
+            : inner(kind::node256)
+        {
+        }
+
+        node* children[256] = {};
+    };
+
+    using traits = std::allocator_traits<AllocatorType>;
+    using leaf_allocator = typename traits::template rebind_alloc<leaf>;
+
+   public:
+    template <typename R>
+    using result = cpp::result<R, ContainerError>;
+
+    using key_type = std::string_view;
+    using mapped_type = V;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+
+    explicit radix_tree(const allocator_type& alloc) noexcept
+        : alloc_(alloc)
+    {
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    radix_tree(const radix_tree&) = delete;
+    radix_tree& operator=(const radix_tree&) = delete;
+
+    radix_tree(radix_tree&& other) noexcept
+        : radix_tree(other.alloc_)
+    {
+        swap(other);
+    }
+
+    radix_tree& operator=(radix_tree&& other) noexcept
+    {
+        radix_tree tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    ~radix_tree() { clear(); }
+
+    // Utility wrapper around the plain `radix_tree` so `Create` can be
+    // used regardless of fallibility.
+    static result<radix_tree> Create(const allocator_type& alloc) noexcept
+    {
+        return result<radix_tree>(cpp::in_place, alloc);
+    }
+
+    result<radix_tree> Clone() const noexcept
+    {
+        radix_tree tree(alloc_);
+        result<void> status;
+        VisitLeaves(root_, [&](leaf* l) {
+            if (status.has_value())
+            {
+                auto res = tree.try_emplace(KeyOf(l), static_cast<const V&>(l->value));
+                if (res.has_error())
+                {
+                    status = cpp::fail(std::move(res).error());
+                }
+            }
+        });
+        TRY(status);
+        return tree;
+    }
+
+    allocator_type get_allocator() const noexcept { return alloc_; }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    size_type size() const noexcept { return size_; }
+
+    // The value of `key`, or nullptr if it's absent.
+    V* find(std::string_view key) noexcept { return ValueOf(FindLeaf(key)); }
+    const V* find(std::string_view key) const noexcept { return ValueOf(FindLeaf(key)); }
+
+    bool contains(std::string_view key) const noexcept { return FindLeaf(key) != nullptr; }
+
+    // The value of the longest key which is a prefix of `key`, e.g. the most specific
+    // route to an address, or nullptr if there's none.
+    V* longest_prefix(std::string_view key) noexcept { return ValueOf(LongestPrefix(key)); }
+    const V* longest_prefix(std::string_view key) const noexcept
+    {
+        return ValueOf(LongestPrefix(key));
+    }
+
+    // Inserts `(key, V(args...))` if `key` is absent. Returns the value of `key` and
+    // whether it was inserted.
+    template <typename... Args>
+    result<std::pair<V*, bool>> try_emplace(std::string_view key, Args&&... args) noexcept
+    {
+        if (leaf* existing = FindLeaf(key))
+        {
+            return std::pair<V*, bool>(&existing->value, false);
+        }
+        auto made = NewLeaf(key, std::forward<Args>(args)...);
+        if (made.has_error())
+        {
+            return cpp::fail(std::move(made).error());
+        }
+        auto inserted = Insert(made.value(), key);
+        if (inserted.has_error())
+        {
+            FreeLeaf(made.value());
+            return cpp::fail(std::move(inserted).error());
+        }
+        ++size_;
+        return std::pair<V*, bool>(&made.value()->value, true);
+    }
+
+    template <typename M>
+    result<std::pair<V*, bool>> insert_or_assign(std::string_view key, M&& value) noexcept
+    {
+        auto res = try_emplace(key, std::forward<M>(value));
+        if (res.has_value() && !res.value().second)
+        {
+            SAFE_CONTAINERS_CATCH_OOM(*res.value().first = std::forward<M>(value));
+        }
+        return res;
+    }
+
+    // Removes `key`. Returns the number of removed keys.
+    size_type erase(std::string_view key) noexcept
+    {
+        node** ref = &root_;
+        node** parent_ref = nullptr;
+        size_type depth = 0;
+        while (*ref != nullptr)
+        {
+            if ((*ref)->type == kind::leaf)
+            {
+                auto* l = static_cast<leaf*>(*ref);
+                if (!Matches(l, key))
+                {
+                    return 0;
+                }
+                if (parent_ref == nullptr)
+                {
+                    root_ = nullptr;
+                }
+                else
+                {
+                    auto* parent = static_cast<inner*>(*parent_ref);
+                    RemoveChild(parent, Byte(key, depth - 1));
+                    Shrink(parent_ref, parent);
+                }
+                FreeLeaf(l);
+                --size_;
+                return 1;
+            }
+
+            auto* in = static_cast<inner*>(*ref);
+            if (!PrefixMatches(in, key, depth))
+            {
+                return 0;
+            }
+            depth += in->prefix_len;
+            if (depth == key.size())
+            {
+                if (in->value == nullptr || !Matches(in->value, key))
+                {
+                    return 0;
+                }
+                FreeLeaf(std::exchange(in->value, nullptr));
+                Shrink(ref, in);
+                --size_;
+                return 1;
+            }
+            node** child = FindChild(in, Byte(key, depth));
+            if (child == nullptr)
+            {
+                return 0;
+            }
+            parent_ref = ref;
+            ref = child;
+            ++depth;
+        }
+        return 0;
+    }
+
+    // Calls `fn(key, value)` for every key, in lexicographic order of their bytes.
+    template <typename F>
+    void for_each(F&& fn)
+    {
+        VisitLeaves(root_, [&](leaf* l) { fn(KeyOf(l), l->value); });
+    }
+
+    template <typename F>
+    void for_each(F&& fn) const
+    {
+        VisitLeaves(root_, [&](leaf* l) { fn(KeyOf(l), static_cast<const V&>(l->value)); });
+    }
+
+    // Calls `fn(key, value)` for every key starting with `prefix`, in lexicographic
+    // order of their bytes. Only the subtree holding these keys is visited.
+    template <typename F>
+    void for_each_prefix(std::string_view prefix, F&& fn)
+    {
+        VisitLeaves(PrefixRoot(prefix), [&](leaf* l) { fn(KeyOf(l), l->value); });
+    }
+
+    template <typename F>
+    void for_each_prefix(std::string_view prefix, F&& fn) const
+    {
+        VisitLeaves(
+            PrefixRoot(prefix), [&](leaf* l) { fn(KeyOf(l), static_cast<const V&>(l->value)); });
+    }
+
+    void clear() noexcept
+    {
+        if (root_ != nullptr)
+        {
+            FreeTree(root_);
+            root_ = nullptr;
+        }
+        size_ = 0;
+    }
+
+    void swap(radix_tree& other) noexcept
+    {
+        std::swap(alloc_, other.alloc_);
+        std::swap(root_, other.root_);
+        std::swap(size_, other.size_);
+    }
+
+   private:
+    static unsigned char Byte(std::string_view key, size_type i) noexcept
+    {
+        return static_cast<unsigned char>(key[i]);
+    }
+
+    static const unsigned char* KeyBytes(const leaf* l) noexcept
+    {
+        return reinterpret_cast<const unsigned char*>(l + 1);
+    }
+
+    static std::string_view KeyOf(const leaf* l) noexcept
+    {
+        return std::string_view(reinterpret_cast<const char*>(l + 1), l->key_size);
+    }
+
+    static V* ValueOf(leaf* l) noexcept { return l != nullptr ? &l->value : nullptr; }
+
+    static bool Matches(const leaf* l, std::string_view key) noexcept
+    {
+        return l->key_size == key.size() && std::memcmp(l + 1, key.data(), key.size()) == 0;
+    }
+
+    // Whether the key of `l` is a prefix of `key`.
+    static bool IsPrefixOf(const leaf* l, std::string_view key) noexcept
+    {
+        return l->key_size <= key.size() && std::memcmp(l + 1, key.data(), l->key_size) == 0;
+    }
+
+    // Number of `leaf`-sized units holding a leaf & its key of `size` bytes.
+    static size_type LeafUnits(size_type size) noexcept
+    {
+        return 1 + (size + sizeof(leaf) - 1) / sizeof(leaf);
+    }
+
+    template <typename... Args>
+    result<leaf*> NewLeaf(std::string_view key, Args&&... args) noexcept
+    {
+        leaf_allocator alloc(alloc_);
+        const size_type units = LeafUnits(key.size());
+        auto p = detail::Allocate(alloc, units);
+        if (p.has_error())
+        {
+            return cpp::fail(std::move(p).error());
+        }
+        auto constructed =
+            detail::Construct(alloc, p.value(), key.size(), std::forward<Args>(args)...);
+        if (constructed.has_error())
+        {
+            detail::Deallocate(alloc, p.value(), units);
+            return cpp::fail(std::move(constructed).error());
+        }
+        std::memcpy(static_cast<void*>(p.value() + 1), key.data(), key.size());
+        return p.value();
+    }
+
+    void FreeLeaf(leaf* l) noexcept
+    {
+        const size_type units = LeafUnits(l->key_size);
+        leaf_allocator alloc(alloc_);
+        std::allocator_traits<leaf_allocator>::destroy(alloc, l);
+        detail::Deallocate(alloc, l, units);
+    }
+
+    template <typename N>
+    result<N*> NewNode() noexcept
+    {
+        typename traits::template rebind_alloc<N> alloc(alloc_);
+        auto p = detail::Allocate(alloc, 1);
+        if (p.has_error())
+        {
+            return cpp::fail(std::move(p).error());
+        }
+        return ::new (static_cast<void*>(p.value())) N;
+    }
+
+    template <typename N>
+    void FreeNode(N* n) noexcept
+    {
+        n->~N();
+        typename traits::template rebind_alloc<N> alloc(alloc_);
+        detail::Deallocate(alloc, n, 1);
+    }
+
+    // Frees `in` itself, but not its value & children.
+    void FreeInner(inner* in) noexcept
+    {
+        switch (in->type)
+        {
+            case kind::node4:
+                FreeNode(static_cast<node4*>(in));
+                break;
+            case kind::node16:
+                FreeNode(static_cast<node16*>(in));
+                break;
+            case kind::node48:
+                FreeNode(static_cast<node48*>(in));
+                break;
+            default:
+                FreeNode(static_cast<node256*>(in));
+                break;
+        }
+    }
+
+    void FreeTree(node* n) noexcept
+    {
+        if (n->type == kind::leaf)
+        {
+            FreeLeaf(static_cast<leaf*>(n));
+            return;
+        }
+        auto* in = static_cast<inner*>(n);
+        ForEachChild(in, [this](unsigned char, node* child) { FreeTree(child); });
+        if (in->value != nullptr)
+        {
+            FreeLeaf(in->value);
+        }
+        FreeInner(in);
+    }
+
+    // Calls `fn(byte, child)` for the children of `in`, in increasing order of bytes.
+    template <typename F>
+    static void ForEachChild(inner* in, F&& fn)
+    {
+        switch (in->type)
+        {
+            case kind::node4:
+            {
+                auto* n = static_cast<node4*>(in);
+                for (size_type i = 0; i < n->count; ++i)
+                {
+                    fn(n->keys[i], n->children[i]);
+                }
+                break;
+            }
+            case kind::node16:
+            {
+                auto* n = static_cast<node16*>(in);
+                for (size_type i = 0; i < n->count; ++i)
+                {
+                    fn(n->keys[i], n->children[i]);
+                }
+                break;
+            }
+            case kind::node48:
+            {
+                auto* n = static_cast<node48*>(in);
+                for (size_type b = 0; b < 256; ++b)
+                {
+                    if (n->index[b] != 0)
+                    {
+                        fn(static_cast<unsigned char>(b), n->children[n->index[b] - 1]);
+                    }
+                }
+                break;
+            }
+            default:
+            {
+                auto* n = static_cast<node256*>(in);
+                for (size_type b = 0; b < 256; ++b)
+                {
+                    if (n->children[b] != nullptr)
+                    {
+                        fn(static_cast<unsigned char>(b), n->children[b]);
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    // Calls `fn(leaf)` for the leaves under `n`, in order of their keys.
+    template <typename F>
+    static void VisitLeaves(node* n, F&& fn)
+    {
+        if (n == nullptr)
+        {
+            return;
+        }
+        if (n->type == kind::leaf)
+        {
+            fn(static_cast<leaf*>(n));
+            return;
+        }
+        auto* in = static_cast<inner*>(n);
+        if (in->value != nullptr)
+        {
+            fn(in->value);
+        }
+        ForEachChild(in, [&fn](unsigned char, node* child) { VisitLeaves(child, fn); });
+    }
+
+    template <std::size_t N, kind K>
+    static node** FindSorted(sorted_node<N, K>* n, unsigned char b) noexcept
+    {
+        for (size_type i = 0; i < n->count; ++i)
+        {
+            if (n->keys[i] == b)
+            {
+                return &n->children[i];
+            }
+        }
+        return nullptr;
+    }
+
+#if defined(__SSE2__)
+    // Compares `b` with all 16 key bytes at once.
+    static node** FindSorted(node16* n, unsigned char b) noexcept
+    {
+        const __m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i*>(n->keys));
+        const __m128i equal = _mm_cmpeq_epi8(keys, _mm_set1_epi8(static_cast<char>(b)));
+        const unsigned mask =
+            static_cast<unsigned>(_mm_movemask_epi8(equal)) & ((1U << n->count) - 1);
+        return mask != 0 ? &n->children[__builtin_ctz(mask)] : nullptr;
+    }
+#endif
+
+    // The slot of the child of `in` for byte `b`, or nullptr if there's none.
+    static node** FindChild(inner* in, unsigned char b) noexcept
+    {
+        switch (in->type)
+        {
+            case kind::node4:
+                return FindSorted(static_cast<node4*>(in), b);
+            case kind::node16:
+                return FindSorted(static_cast<node16*>(in), b);
+            case kind::node48:
+            {
+                auto* n = static_cast<node48*>(in);
+                return n->index[b] != 0 ? &n->children[n->index[b] - 1] : nullptr;
+            }
+            default:
+            {
+                auto* n = static_cast<node256*>(in);
+                return n->children[b] != nullptr ? &n->children[b] : nullptr;
+            }
+        }
+    }
+
+    // The child with the lowest byte. `in` must have children.
+    static node* FirstChild(inner* in, unsigned char* byte) noexcept
+    {
+        switch (in->type)
+        {
+            case kind::node4:
+                *byte = static_cast<node4*>(in)->keys[0];
+                return static_cast<node4*>(in)->children[0];
+            case kind::node16:
+                *byte = static_cast<node16*>(in)->keys[0];
+                return static_cast<node16*>(in)->children[0];
+            case kind::node48:
+            {
+                auto* n = static_cast<node48*>(in);
+                size_type b = 0;
+                while (n->index[b] == 0)
+                {
+                    ++b;
+                }
+                *byte = static_cast<unsigned char>(b);
+                return n->children[n->index[b] - 1];
+            }
+            default:
+            {
+                auto* n = static_cast<node256*>(in);
+                size_type b = 0;
+                while (n->children[b] == nullptr)
+                {
+                    ++b;
+                }
+                *byte = static_cast<unsigned char>(b);
+                return n->children[b];
+            }
+        }
+    }
+
+    // Any leaf under `n`, which all share the path to `n`.
+    static leaf* MinimumLeaf(node* n) noexcept
+    {
+        while (n->type != kind::leaf)
+        {
+            auto* in = static_cast<inner*>(n);
+            if (in->value != nullptr)
+            {
+                return in->value;
+            }
+            unsigned char byte;
+            n = FirstChild(in, &byte);
+        }
+        return static_cast<leaf*>(n);
+    }
+
+    static bool IsFull(const inner* in) noexcept
+    {
+        switch (in->type)
+        {
+            case kind::node4:
+                return in->count == 4;
+            case kind::node16:
+                return in->count == 16;
+            case kind::node48:
+                return in->count == 48;
+            default:
+                return false;
+        }
+    }
+
+    template <std::size_t N, kind K>
+    static void InsertSorted(sorted_node<N, K>* n, unsigned char b, node* child) noexcept
+    {
+        size_type pos = n->count;
+        while (pos > 0 && n->keys[pos - 1] > b)
+        {
+            n->keys[pos] = n->keys[pos - 1];
+            n->children[pos] = n->children[pos - 1];
+            --pos;
+        }
+        n->keys[pos] = b;
+        n->children[pos] = child;
+    }
+
+    // Adds `child` for byte `b`, which `in` must have room for.
+    static void InsertChild(inner* in, unsigned char b, node* child) noexcept
+    {
+        switch (in->type)
+        {
+            case kind::node4:
+                InsertSorted(static_cast<node4*>(in), b, child);
+                break;
+            case kind::node16:
+                InsertSorted(static_cast<node16*>(in), b, child);
+                break;
+            case kind::node48:
+            {
+                auto* n = static_cast<node48*>(in);
+                std::uint8_t slot = 0;
+                while (n->children[slot] != nullptr)
+                {
+                    ++slot;
+                }
+                n->children[slot] = child;
+                n->index[b] = static_cast<std::uint8_t>(slot + 1);
+                break;
+            }
+            default:
+                static_cast<node256*>(in)->children[b] = child;
+                break;
+        }
+        ++in->count;
+    }
+
+    template <std::size_t N, kind K>
+    static void RemoveSorted(sorted_node<N, K>* n, unsigned char b) noexcept
+    {
+        size_type pos = 0;
+        while (n->keys[pos] != b)
+        {
+            ++pos;
+        }
+        for (; pos + 1 < n->count; ++pos)
+        {
+            n->keys[pos] = n->keys[pos + 1];
+            n->children[pos] = n->children[pos + 1];
+        }
+    }
+
+    // Removes the child for byte `b`, which `in` must have.
+    static void RemoveChild(inner* in, unsigned char b) noexcept
+    {
+        switch (in->type)
+        {
+            case kind::node4:
+                RemoveSorted(static_cast<node4*>(in), b);
+                break;
+            case kind::node16:
+                RemoveSorted(static_cast<node16*>(in), b);
+                break;
+            case kind::node48:
+            {
+                auto* n = static_cast<node48*>(in);
+                n->children[n->index[b] - 1] = nullptr;
+                n->index[b] = 0;
+                break;
+            }
+            default:
+                static_cast<node256*>(in)->children[b] = nullptr;
+                break;
+        }
+        --in->count;
+    }
+
+    // Moves the prefix, value & children of `from` to a new node of type `To`.
+    template <typename To>
+    result<inner*> Resize(inner* from) noexcept
+    {
+        auto made = NewNode<To>();
+        if (made.has_error())
+        {
+            return cpp::fail(std::move(made).error());
+        }
+        To* to = made.value();
+        to->prefix_len = from->prefix_len;
+        std::memcpy(to->prefix, from->prefix, kMaxPrefix);
+        to->value = from->value;
+        ForEachChild(from, [to](unsigned char b, node* child) { InsertChild(to, b, child); });
+        return to;
+    }
+
+    // Adds `child` for byte `b` to the node `in` at `ref`, growing it if it's full.
+    result<void> AddChild(node** ref, inner* in, unsigned char b, node* child) noexcept
+    {
+        if (!IsFull(in))
+        {
+            InsertChild(in, b, child);
+            return {};
+        }
+        auto grown = in->type == kind::node4    ? Resize<node16>(in)
+                     : in->type == kind::node16 ? Resize<node48>(in)
+                                                : Resize<node256>(in);
+        if (grown.has_error())
+        {
+            return cpp::fail(std::move(grown).error());
+        }
+        InsertChild(grown.value(), b, child);
+        *ref = grown.value();
+        FreeInner(in);
+        return {};
+    }
+
+    // Moves the node `in` at `ref` to a smaller one, if it has few enough children. Keeps
+    // it as is if that can't be allocated.
+    template <typename To>
+    void TryResize(node** ref, inner* in) noexcept
+    {
+        auto smaller = Resize<To>(in);
+        if (smaller.has_value())
+        {
+            *ref = smaller.value();
+            FreeInner(in);
+        }
+    }
+
+    // Restores the invariant that inner nodes have at least two entries, counting their
+    // value, after removing one from the node `in` at `ref`, & shrinks it if it's sparse.
+    void Shrink(node** ref, inner* in) noexcept
+    {
+        if (in->count == 0)
+        {
+            *ref = in->value;
+            FreeInner(in);
+            return;
+        }
+        if (in->count == 1 && in->value == nullptr)
+        {
+            Collapse(ref, in);
+            return;
+        }
+        switch (in->type)
+        {
+            case kind::node16:
+                if (in->count <= 3)
+                {
+                    TryResize<node4>(ref, in);
+                }
+                break;
+            case kind::node48:
+                if (in->count <= 12)
+                {
+                    TryResize<node16>(ref, in);
+                }
+                break;
+            case kind::node256:
+                if (in->count <= 37)
+                {
+                    TryResize<node48>(ref, in);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Replaces the node `in` at `ref`, which only has one child, with that child, moving
+    // its prefix & byte in front of the child's prefix.
+    void Collapse(node** ref, inner* in) noexcept
+    {
+        unsigned char byte;
+        node* child = FirstChild(in, &byte);
+        if (child->type != kind::leaf)
+        {
+            auto* c = static_cast<inner*>(child);
+            unsigned char prefix[kMaxPrefix];
+            size_type len = std::min(in->prefix_len, kMaxPrefix);
+            std::memcpy(prefix, in->prefix, len);
+            if (len < kMaxPrefix)
+            {
+                prefix[len++] = byte;
+            }
+            const size_type kept = std::min(c->prefix_len, kMaxPrefix - len);
+            std::memcpy(prefix + len, c->prefix, kept);
+            std::memcpy(c->prefix, prefix, len + kept);
+            c->prefix_len += in->prefix_len + 1;
+        }
+        *ref = child;
+        FreeInner(in);
+    }
+
+    // Whether the prefix of `in` may match `key` at `depth`. Only the bytes kept in the
+    // node are compared, so matches must be confirmed against a leaf.
+    static bool PrefixMatches(const inner* in, std::string_view key, size_type depth) noexcept
+    {
+        const size_type kept = std::min(in->prefix_len, kMaxPrefix);
+        return key.size() - depth >= in->prefix_len &&
+               std::memcmp(in->prefix, key.data() + depth, kept) == 0;
+    }
+
+    // Length of the common prefix of `key` at `depth` & the prefix of `in`, comparing
+    // the bytes beyond those kept in the node against a leaf.
+    static size_type PrefixMismatch(inner* in, std::string_view key, size_type depth) noexcept
+    {
+        const size_type limit = std::min(in->prefix_len, key.size() - depth);
+        const size_type kept = std::min(limit, kMaxPrefix);
+        size_type i = 0;
+        for (; i < kept; ++i)
+        {
+            if (in->prefix[i] != Byte(key, depth + i))
+            {
+                return i;
+            }
+        }
+        if (limit > kMaxPrefix)
+        {
+            const unsigned char* full = KeyBytes(MinimumLeaf(in)) + depth;
+            for (; i < limit; ++i)
+            {
+                if (full[i] != Byte(key, depth + i))
+                {
+                    return i;
+                }
+            }
+        }
+        return limit;
+    }
+
+    leaf* FindLeaf(std::string_view key) const noexcept
+    {
+        node* n = root_;
+        size_type depth = 0;
+        while (n != nullptr)
+        {
+            if (n->type == kind::leaf)
+            {
+                return Matches(static_cast<leaf*>(n), key) ? static_cast<leaf*>(n) : nullptr;
+            }
+            auto* in = static_cast<inner*>(n);
+            if (!PrefixMatches(in, key, depth))
+            {
+                return nullptr;
+            }
+            depth += in->prefix_len;
+            if (depth == key.size())
+            {
+                return in->value != nullptr && Matches(in->value, key) ? in->value : nullptr;
+            }
+            node** child = FindChild(in, Byte(key, depth));
+            n = child != nullptr ? *child : nullptr;
+            ++depth;
+        }
+        return nullptr;
+    }
+
+    leaf* LongestPrefix(std::string_view key) const noexcept
+    {
+        leaf* best = nullptr;
+        node* n = root_;
+        size_type depth = 0;
+        while (n != nullptr)
+        {
+            if (n->type == kind::leaf)
+            {
+                if (IsPrefixOf(static_cast<leaf*>(n), key))
+                {
+                    best = static_cast<leaf*>(n);
+                }
+                break;
+            }
+            auto* in = static_cast<inner*>(n);
+            if (!PrefixMatches(in, key, depth))
+            {
+                break;
+            }
+            depth += in->prefix_len;
+            if (in->value != nullptr && IsPrefixOf(in->value, key))
+            {
+                best = in->value;
+            }
+            if (depth == key.size())
+            {
+                break;
+            }
+            node** child = FindChild(in, Byte(key, depth));
+            n = child != nullptr ? *child : nullptr;
+            ++depth;
+        }
+        return best;
+    }
+
+    // The root of the subtree holding the keys starting with `prefix`, or nullptr.
+    node* PrefixRoot(std::string_view prefix) const noexcept
+    {
+        node* n = root_;
+        size_type depth = 0;
+        while (n != nullptr && depth < prefix.size())
+        {
+            if (n->type == kind::leaf)
+            {
+                break;
+            }
+            auto* in = static_cast<inner*>(n);
+            const size_type len = std::min(in->prefix_len, prefix.size() - depth);
+            if (std::memcmp(in->prefix, prefix.data() + depth, std::min(len, kMaxPrefix)) != 0)
+            {
+                return nullptr;
+            }
+            depth += in->prefix_len;
+            if (depth >= prefix.size())
+            {
+                break;
+            }
+            node** child = FindChild(in, Byte(prefix, depth));
+            n = child != nullptr ? *child : nullptr;
+            ++depth;
+        }
+        // The leaves of the subtree share the path to it, so one confirms them all.
+        if (n == nullptr || !StartsWith(MinimumLeaf(n), prefix))
+        {
+            return nullptr;
+        }
+        return n;
+    }
+
+    // Whether the key of `l` starts with `prefix`.
+    static bool StartsWith(const leaf* l, std::string_view prefix) noexcept
+    {
+        return prefix.size() <= l->key_size &&
+               std::memcmp(l + 1, prefix.data(), prefix.size()) == 0;
+    }
+
+    // Links the leaf `l` of `key`, which must be absent. Allocates at most one node, so
+    // the tree is unchanged on failure.
+    result<void> Insert(leaf* l, std::string_view key) noexcept
+    {
+        node** ref = &root_;
+        size_type depth = 0;
+        while (true)
+        {
+            if (*ref == nullptr)
+            {
+                *ref = l;
+                return {};
+            }
+            if ((*ref)->type == kind::leaf)
+            {
+                return SplitLeaf(ref, static_cast<leaf*>(*ref), l, key, depth);
+            }
+            auto* in = static_cast<inner*>(*ref);
+            if (in->prefix_len > 0)
+            {
+                const size_type common = PrefixMismatch(in, key, depth);
+                if (common < in->prefix_len)
+                {
+                    return SplitPrefix(ref, in, l, depth, common);
+                }
+                depth += in->prefix_len;
+            }
+            if (depth == key.size())
+            {
+                in->value = l;
+                return {};
+            }
+            node** child = FindChild(in, Byte(key, depth));
+            if (child == nullptr)
+            {
+                return AddChild(ref, in, Byte(key, depth), l);
+            }
+            ref = child;
+            ++depth;
+        }
+    }
+
+    // Adds `l` to the new node `n` at `depth`, as its value or as a child.
+    static void Attach(inner* n, leaf* l, size_type depth) noexcept
+    {
+        if (l->key_size == depth)
+        {
+            n->value = l;
+            return;
+        }
+        InsertChild(n, KeyBytes(l)[depth], l);
+    }
+
+    // Replaces the leaf `existing` at `ref` with a node holding it & `l`.
+    result<void> SplitLeaf(
+        node** ref, leaf* existing, leaf* l, std::string_view key, size_type depth) noexcept
+    {
+        const size_type limit = std::min(existing->key_size, key.size());
+        size_type end = depth;
+        while (end < limit && KeyBytes(existing)[end] == Byte(key, end))
+        {
+            ++end;
+        }
+        auto made = NewNode<node4>();
+        if (made.has_error())
+        {
+            return cpp::fail(std::move(made).error());
+        }
+        node4* split = made.value();
+        split->prefix_len = end - depth;
+        std::memcpy(split->prefix, key.data() + depth, std::min(split->prefix_len, kMaxPrefix));
+        Attach(split, existing, end);
+        Attach(split, l, end);
+        *ref = split;
+        return {};
+    }
+
+    // Splits the prefix of the node `in` at `ref` after its first `common` bytes, which
+    // are moved to a new parent node holding `in` & `l`.
+    result<void> SplitPrefix(
+        node** ref, inner* in, leaf* l, size_type depth, size_type common) noexcept
+    {
+        auto made = NewNode<node4>();
+        if (made.has_error())
+        {
+            return cpp::fail(std::move(made).error());
+        }
+        const unsigned char* full =
+            in->prefix_len > kMaxPrefix ? KeyBytes(MinimumLeaf(in)) + depth : in->prefix;
+        node4* split = made.value();
+        split->prefix_len = common;
+        std::memcpy(split->prefix, full, std::min(common, kMaxPrefix));
+        const unsigned char byte = full[common];
+        unsigned char rest[kMaxPrefix];
+        const size_type rest_len = in->prefix_len - common - 1;
+        const size_type kept = std::min(rest_len, kMaxPrefix);
+        std::memcpy(rest, full + common + 1, kept);
+        std::memcpy(in->prefix, rest, kept);
+        in->prefix_len = rest_len;
+        InsertChild(split, byte, in);
+        Attach(split, l, depth + common);
+        *ref = split;
+        return {};
+    }
+
+    allocator_type alloc_;
+    node* root_ = nullptr;
+    size_type size_ = 0;
+};
+
+}  // namespace safe_containers
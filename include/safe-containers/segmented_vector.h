@@ -0,0 +1,430 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+#include <safe-containers/span.h>
+#include <safe-containers/type_traits.h>
+#include <safe-containers/vector.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `segmented_vector` is a vector which never relocates its elements, with fallible
+// allocation handling using `result` types, following the conventions of
+// `safe_containers::vector`.
+//
+// Elements are stored in fixed-size chunks of a power-of-two number of elements, at
+// most `ChunkBytes` bytes, indexed through a directory of chunk pointers. Growing
+// allocates one chunk at a time & never copies existing elements, so references to
+// elements remain valid until they're popped, and large sizes never need a single
+// large allocation. Indexing is a shift & a mask into the directory.
+//
+// Chunks are kept when elements are popped, and only released by `shrink_to_fit`.
+template <typename T, typename AllocatorType = std::allocator<T>, std::size_t ChunkBytes = 4096>
+class segmented_vector
+{
+    template <bool Const>
+    class iterator_impl;
+
+    using traits = std::allocator_traits<AllocatorType>;
+    using directory_allocator = typename traits::template rebind_alloc<T*>;
+
+    static constexpr std::size_t FloorPowerOfTwo(std::size_t n) noexcept
+    {
+        std::size_t power = 1;
+        while (power * 2 <= n)
+        {
+            power *= 2;
+        }
+        return power;
+    }
+
+    static constexpr std::size_t Log2(std::size_t n) noexcept
+    {
+        std::size_t log = 0;
+        while (n >>= 1)
+        {
+            ++log;
+        }
+        return log;
+    }
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using value_type = T;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = iterator_impl<false>;
+    using const_iterator = iterator_impl<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    // Number of elements per chunk.
+    static constexpr size_type kChunkSize = FloorPowerOfTwo(ChunkBytes / sizeof(T));
+    static constexpr size_type kChunkShift = Log2(kChunkSize);
+
+    static_assert(
+        std::is_same_v<typename traits::pointer, T*>, "Fancy allocator pointers are not supported");
+
+    explicit segmented_vector(const allocator_type& alloc) noexcept
+        : alloc_(alloc),
+          // Passed as an lvalue, as `vector` rejects allocator rvalues.
+          chunks_(static_cast<const directory_allocator&>(directory_allocator(alloc)))
+    {
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    segmented_vector(const segmented_vector&) = delete;
+    segmented_vector& operator=(const segmented_vector&) = delete;
+
+    segmented_vector(segmented_vector&& other) noexcept
+        : segmented_vector(other.alloc_)
+    {
+        swap(other);
+    }
+
+    segmented_vector& operator=(segmented_vector&& other) noexcept
+    {
+        segmented_vector tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    ~segmented_vector()
+    {
+        clear();
+        shrink_to_fit();
+    }
+
+    result<segmented_vector> Clone() const noexcept { return Create(cbegin(), cend(), alloc_); }
+
+    // Utility wrapper around the plain `segmented_vector` so `Create` can be
+    // used regardless of fallibility.
+    static result<segmented_vector> Create(const allocator_type& alloc) noexcept
+    {
+        return result<segmented_vector>(cpp::in_place, alloc);
+    }
+
+    static result<segmented_vector> Create(size_type count, const allocator_type& alloc) noexcept
+    {
+        segmented_vector v{alloc};
+        TRY(v.resize(count));
+        return v;
+    }
+
+    static result<segmented_vector> Create(
+        size_type count, const T& value, const allocator_type& alloc) noexcept
+    {
+        segmented_vector v{alloc};
+        TRY(v.resize(count, value));
+        return v;
+    }
+
+    template <typename InputIt>
+    static result<segmented_vector> Create(
+        InputIt first, InputIt last, const allocator_type& alloc) noexcept
+    {
+        segmented_vector v{alloc};
+        if constexpr (std::is_base_of_v<
+                          std::forward_iterator_tag,
+                          typename std::iterator_traits<InputIt>::iterator_category>)
+        {
+            TRY(v.reserve(static_cast<size_type>(std::distance(first, last))));
+        }
+        for (; first != last; ++first)
+        {
+            TRY(v.push_back(*first));
+        }
+        return v;
+    }
+
+    static result<segmented_vector> Create(
+        std::initializer_list<T> values, const allocator_type& alloc) noexcept
+    {
+        return Create(values.begin(), values.end(), alloc);
+    }
+
+    allocator_type get_allocator() const noexcept { return alloc_; }
+
+    reference operator[](size_type pos) noexcept { return *Slot(pos); }
+    const_reference operator[](size_type pos) const noexcept { return *Slot(pos); }
+    reference front() noexcept { return *Slot(0); }
+    const_reference front() const noexcept { return *Slot(0); }
+    reference back() noexcept { return *Slot(size_ - 1); }
+    const_reference back() const noexcept { return *Slot(size_ - 1); }
+
+    iterator begin() noexcept { return iterator(this, 0); }
+    const_iterator begin() const noexcept { return const_iterator(this, 0); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return iterator(this, size_); }
+    const_iterator end() const noexcept { return const_iterator(this, size_); }
+    const_iterator cend() const noexcept { return end(); }
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    size_type size() const noexcept { return size_; }
+    size_type capacity() const noexcept { return chunks_.size() * kChunkSize; }
+    size_type chunk_count() const noexcept { return chunks_.size(); }
+
+    // The elements of chunk `i`, which are contiguous. Iterating chunk by chunk avoids
+    // the directory lookup per element.
+    span<T> chunk(size_type i) noexcept { return span<T>(chunks_[i], ChunkLength(i)); }
+    span<const T> chunk(size_type i) const noexcept
+    {
+        return span<const T>(chunks_[i], ChunkLength(i));
+    }
+
+    // Allocates chunks until there's room for `count` elements.
+    result<void> reserve(size_type count) noexcept
+    {
+        const size_type needed = (count + kChunkSize - 1) >> kChunkShift;
+        if (needed <= chunks_.size())
+        {
+            return {};
+        }
+        SAFE_CONTAINERS_CATCH_OOM(chunks_.reserve(needed));
+        while (chunks_.size() < needed)
+        {
+            auto storage = detail::Allocate(alloc_, kChunkSize);
+            if (storage.has_error())
+            {
+                return cpp::fail(std::move(storage).error());
+            }
+            chunks_.inner::push_back(storage.value());
+        }
+        return {};
+    }
+
+    // Releases all chunks which don't hold any element.
+    void shrink_to_fit() noexcept
+    {
+        const size_type used = (size_ + kChunkSize - 1) >> kChunkShift;
+        while (chunks_.size() > used)
+        {
+            detail::Deallocate(alloc_, chunks_.back(), kChunkSize);
+            chunks_.pop_back();
+        }
+    }
+
+    template <typename... Args>
+    result<void> push_back(Args&&... args) noexcept
+    {
+        auto res = emplace_back(std::forward<Args>(args)...);
+        if (res.has_error())
+        {
+            return cpp::fail(std::move(res).error());
+        }
+        return {};
+    }
+
+    // Appends `T(args...)`. Growing allocates a single chunk, & no element is moved.
+    template <typename... Args>
+    result<reference> emplace_back(Args&&... args) noexcept
+    {
+        static_assert(
+            !contains_type<allocator_type, Args...>::value,
+            "Arguments cannot contain an allocator type");
+        if (size_ == capacity())
+        {
+            TRY(detail::ReserveOneMore(chunks_));
+            TRY(reserve(size_ + 1));
+        }
+        T* slot = Slot(size_);
+        SAFE_CONTAINERS_CATCH_OOM(traits::construct(alloc_, slot, std::forward<Args>(args)...));
+        ++size_;
+        return *slot;
+    }
+
+    void pop_back() noexcept
+    {
+        --size_;
+        traits::destroy(alloc_, Slot(size_));
+    }
+
+    // Resizes the vector to `count` elements. If growing fails, the vector is left
+    // unchanged.
+    result<void> resize(size_type count) noexcept { return ResizeWith(count); }
+
+    result<void> resize(size_type count, const value_type& value) noexcept
+    {
+        return ResizeWith(count, value);
+    }
+
+    // Destroys all elements. Chunks are kept, see `shrink_to_fit`.
+    void clear() noexcept
+    {
+        while (size_ > 0)
+        {
+            pop_back();
+        }
+    }
+
+    void swap(segmented_vector& other) noexcept
+    {
+        std::swap(alloc_, other.alloc_);
+        chunks_.swap(other.chunks_);
+        std::swap(size_, other.size_);
+    }
+
+   private:
+    T* Slot(size_type pos) const noexcept
+    {
+        return chunks_[pos >> kChunkShift] + (pos & (kChunkSize - 1));
+    }
+
+    size_type ChunkLength(size_type i) const noexcept
+    {
+        const size_type first = i << kChunkShift;
+        return size_ <= first ? 0 : std::min(size_ - first, kChunkSize);
+    }
+
+    template <typename... Args>
+    result<void> ResizeWith(size_type count, const Args&... args) noexcept
+    {
+        const size_type original = size_;
+        TRY(reserve(count));
+        while (size_ < count)
+        {
+            if (emplace_back(args...).has_error())
+            {
+                while (size_ > original)
+                {
+                    pop_back();
+                }
+                return cpp::fail(ContainerError{});
+            }
+        }
+        while (size_ > count)
+        {
+            pop_back();
+        }
+        return {};
+    }
+
+    template <bool Const>
+    class iterator_impl
+    {
+        using owner = std::conditional_t<Const, const segmented_vector, segmented_vector>;
+
+       public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using reference = std::conditional_t<Const, const T&, T&>;
+
+        iterator_impl() noexcept = default;
+        iterator_impl(owner* v, size_type index) noexcept
+            : vector_(v),
+              index_(index)
+        {
+        }
+
+        // Allow conversion from iterator to const_iterator.
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        iterator_impl(const iterator_impl<false>& other) noexcept
+            : vector_(other.vector_),
+              index_(other.index_)
+        {
+        }
+
+        reference operator*() const noexcept { return (*vector_)[index_]; }
+        pointer operator->() const noexcept { return &(*vector_)[index_]; }
+        reference operator[](difference_type n) const noexcept { return *(*this + n); }
+
+        iterator_impl& operator++() noexcept
+        {
+            ++index_;
+            return *this;
+        }
+        iterator_impl operator++(int) noexcept { return iterator_impl(vector_, index_++); }
+        iterator_impl& operator--() noexcept
+        {
+            --index_;
+            return *this;
+        }
+        iterator_impl operator--(int) noexcept { return iterator_impl(vector_, index_--); }
+        iterator_impl& operator+=(difference_type n) noexcept
+        {
+            index_ = static_cast<size_type>(static_cast<difference_type>(index_) + n);
+            return *this;
+        }
+        iterator_impl& operator-=(difference_type n) noexcept { return *this += -n; }
+        friend iterator_impl operator+(iterator_impl it, difference_type n) noexcept
+        {
+            return it += n;
+        }
+        friend iterator_impl operator+(difference_type n, iterator_impl it) noexcept
+        {
+            return it += n;
+        }
+        friend iterator_impl operator-(iterator_impl it, difference_type n) noexcept
+        {
+            return it -= n;
+        }
+        friend difference_type operator-(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return static_cast<difference_type>(a.index_) - static_cast<difference_type>(b.index_);
+        }
+
+        friend bool operator==(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.index_ == b.index_;
+        }
+        friend bool operator!=(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.index_ != b.index_;
+        }
+        friend bool operator<(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.index_ < b.index_;
+        }
+        friend bool operator>(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.index_ > b.index_;
+        }
+        friend bool operator<=(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.index_ <= b.index_;
+        }
+        friend bool operator>=(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.index_ >= b.index_;
+        }
+
+       private:
+        friend class iterator_impl<!Const>;
+
+        owner* vector_ = nullptr;
+        size_type index_ = 0;
+    };
+
+    allocator_type alloc_;
+    // Directory of chunk pointers. Chunks beyond the last element are spare.
+    vector<T*, directory_allocator> chunks_;
+    size_type size_ = 0;
+};
+
+}  // namespace safe_containers
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+#include <safe-containers/vector.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `slot_map` stores values densely in a `safe_containers::vector` & hands out
+// generation-checked handles to them, with fallible allocation handling using
+// `result` types.
+//
+// A handle names a slot, which records where its value currently lives in the dense
+// array. Erasing moves the last value into the hole, so values stay contiguous for
+// iteration, & the freed slot is pushed on a free list for reuse. Every slot has a
+// generation which is bumped whenever its value is inserted or erased, so a handle
+// to an erased value is detected as stale, even once its slot is reused. A slot is
+// retired rather than reused once its 32-bit generation would wrap around, i.e.
+// after 2^31 inserts into it, so a stale handle never becomes valid again.
+//
+// Inserting & erasing are O(1). Handles stay valid until their value is erased, but
+// pointers & references to values are invalidated by inserts & erases, like those
+// of a vector.
+template <typename T, typename AllocatorType = std::allocator<T>>
+class slot_map
+{
+    static_assert(
+        std::is_nothrow_move_assignable_v<T>,
+        "Values must be nothrow move assignable, so erasing can fill the hole");
+
+    using traits = std::allocator_traits<AllocatorType>;
+
+    struct slot
+    {
+        // Position of the value in the dense array if occupied, or the next free slot.
+        std::uint32_t index;
+        // Odd while the slot is occupied.
+        std::uint32_t generation;
+    };
+
+    using slot_allocator = typename traits::template rebind_alloc<slot>;
+    using index_allocator = typename traits::template rebind_alloc<std::uint32_t>;
+
+    static constexpr std::uint32_t kNoSlot = std::numeric_limits<std::uint32_t>::max();
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using value_type = T;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    static constexpr size_type kMaxSize = kNoSlot - 1;
+
+    // Generation-checked reference to a value of a `slot_map`.
+    struct handle
+    {
+        std::uint32_t index = kNoSlot;
+        std::uint32_t generation = 0;
+
+        friend bool operator==(handle a, handle b) noexcept
+        {
+            return a.index == b.index && a.generation == b.generation;
+        }
+        friend bool operator!=(handle a, handle b) noexcept { return !(a == b); }
+    };
+
+    explicit slot_map(const allocator_type& alloc) noexcept
+        : values_(alloc),
+          // Passed as lvalues, as `vector` rejects allocator rvalues.
+          owners_(static_cast<const index_allocator&>(index_allocator(alloc))),
+          slots_(static_cast<const slot_allocator&>(slot_allocator(alloc)))
+    {
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    slot_map(const slot_map&) = delete;
+    slot_map& operator=(const slot_map&) = delete;
+
+    slot_map(slot_map&& other) noexcept
+        : slot_map(other.get_allocator())
+    {
+        swap(other);
+    }
+
+    slot_map& operator=(slot_map&& other) noexcept
+    {
+        slot_map tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    // Utility wrapper around the plain `slot_map` so `Create` can be
+    // used regardless of fallibility.
+    static result<slot_map> Create(const allocator_type& alloc) noexcept
+    {
+        return result<slot_map>(cpp::in_place, alloc);
+    }
+
+    // Creates an empty map with room for `count` values.
+    static result<slot_map> Create(size_type count, const allocator_type& alloc) noexcept
+    {
+        slot_map m(alloc);
+        TRY(m.reserve(count));
+        return m;
+    }
+
+    // Clones the map. Handles of this map are valid for the clone too.
+    result<slot_map> Clone() const noexcept
+    {
+        slot_map m(get_allocator());
+        TRY(m.values_.assign(values_.cbegin(), values_.cend()));
+        TRY(m.owners_.assign(owners_.cbegin(), owners_.cend()));
+        TRY(m.slots_.assign(slots_.cbegin(), slots_.cend()));
+        m.free_head_ = free_head_;
+        return m;
+    }
+
+    allocator_type get_allocator() const noexcept { return values_.get_allocator(); }
+
+    [[nodiscard]] bool empty() const noexcept { return values_.empty(); }
+    size_type size() const noexcept { return values_.size(); }
+    size_type capacity() const noexcept { return values_.capacity(); }
+
+    // The values, in no particular order.
+    iterator begin() noexcept { return values_.data(); }
+    const_iterator begin() const noexcept { return values_.data(); }
+    iterator end() noexcept { return values_.data() + values_.size(); }
+    const_iterator end() const noexcept { return values_.data() + values_.size(); }
+    T* data() noexcept { return values_.data(); }
+    const T* data() const noexcept { return values_.data(); }
+
+    // The handle of the value at position `pos` of the dense array.
+    handle handle_at(size_type pos) const noexcept
+    {
+        const std::uint32_t index = owners_[pos];
+        return handle{index, slots_[index].generation};
+    }
+
+    result<void> reserve(size_type count) noexcept
+    {
+        if (count > kMaxSize)
+        {
+            return cpp::fail(ContainerError{});
+        }
+        SAFE_CONTAINERS_CATCH_OOM({
+            values_.reserve(count);
+            owners_.reserve(count);
+            slots_.reserve(count);
+        });
+        return {};
+    }
+
+    // Inserts `T(args...)`, returning its handle. On failure, the map is unchanged.
+    template <typename... Args>
+    result<handle> insert(Args&&... args) noexcept
+    {
+        if (size() == kMaxSize)
+        {
+            return cpp::fail(ContainerError{});
+        }
+        // The arguments may refer to a value, so construct it before anything else can
+        // relocate the values, then make room for its bookkeeping.
+        auto value = values_.emplace_back(std::forward<Args>(args)...);
+        if (value.has_error())
+        {
+            return cpp::fail(std::move(value).error());
+        }
+        auto room = ReserveBookkeeping();
+        if (room.has_error())
+        {
+            values_.pop_back();
+            return cpp::fail(std::move(room).error());
+        }
+
+        std::uint32_t index = free_head_;
+        if (index == kNoSlot)
+        {
+            index = static_cast<std::uint32_t>(slots_.size());
+            slots_.inner::push_back(slot{0, 0});
+        }
+        else
+        {
+            free_head_ = slots_[index].index;
+        }
+        slot& s = slots_[index];
+        s.index = static_cast<std::uint32_t>(values_.size() - 1);
+        ++s.generation;
+        owners_.inner::push_back(index);
+        return handle{index, s.generation};
+    }
+
+    bool contains(handle h) const noexcept { return Valid(h); }
+
+    // The value of `h`, or `nullptr` if it was erased.
+    T* get(handle h) noexcept { return Valid(h) ? &values_[slots_[h.index].index] : nullptr; }
+    const T* get(handle h) const noexcept
+    {
+        return Valid(h) ? &values_[slots_[h.index].index] : nullptr;
+    }
+
+    // The value of `h`, which must be valid.
+    T& operator[](handle h) noexcept { return values_[slots_[h.index].index]; }
+    const T& operator[](handle h) const noexcept { return values_[slots_[h.index].index]; }
+
+    // Erases the value of `h`. Returns whether it was present.
+    bool erase(handle h) noexcept
+    {
+        if (!Valid(h))
+        {
+            return false;
+        }
+        slot& s = slots_[h.index];
+        const std::uint32_t pos = s.index;
+        const std::uint32_t last = static_cast<std::uint32_t>(values_.size() - 1);
+        if (pos != last)
+        {
+            values_[pos] = std::move(values_[last]);
+            owners_[pos] = owners_[last];
+            slots_[owners_[pos]].index = pos;
+        }
+        values_.pop_back();
+        owners_.pop_back();
+        Free(h.index);
+        return true;
+    }
+
+    // Erases all values, invalidating all handles.
+    void clear() noexcept
+    {
+        for (std::uint32_t index : owners_)
+        {
+            Free(index);
+        }
+        values_.clear();
+        owners_.clear();
+    }
+
+    void swap(slot_map& other) noexcept
+    {
+        values_.swap(other.values_);
+        owners_.swap(other.owners_);
+        slots_.swap(other.slots_);
+        std::swap(free_head_, other.free_head_);
+    }
+
+   private:
+    result<void> ReserveBookkeeping() noexcept
+    {
+        TRY(detail::ReserveOneMore(owners_));
+        if (free_head_ == kNoSlot)
+        {
+            TRY(detail::ReserveOneMore(slots_));
+        }
+        return {};
+    }
+
+    bool Valid(handle h) const noexcept
+    {
+        return h.index < slots_.size() && slots_[h.index].generation == h.generation &&
+               (h.generation & 1) != 0;
+    }
+
+    void Free(std::uint32_t index) noexcept
+    {
+        slot& s = slots_[index];
+        // A slot whose generation wraps around is retired instead, as reusing it would
+        // validate stale handles again.
+        if (++s.generation == 0)
+        {
+            return;
+        }
+        s.index = free_head_;
+        free_head_ = index;
+    }
+
+    vector<T, AllocatorType> values_;
+    // The slot of each value in `values_`.
+    vector<std::uint32_t, index_allocator> owners_;
+    vector<slot, slot_allocator> slots_;
+    std::uint32_t free_head_ = kNoSlot;
+};
+
+}  // namespace safe_containers
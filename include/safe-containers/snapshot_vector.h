@@ -0,0 +1,191 @@
+#pragma once
+
+#include <safe-containers/epoch_reclamation.h>
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+#include <safe-containers/vector.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `snapshot_vector` is a copy-on-write vector for read-mostly data, in the style of
+// RCU: readers access an immutable version without locking or waiting, while writers
+// build the next version on the side & publish it with a single atomic store.
+//
+// A writer clones the current version with `vector::Clone()`, modifies the clone &
+// publishes it. If cloning or modifying fails, the current version stays published
+// and the error is returned. Versions replaced by a writer are reclaimed through an
+// `epoch_domain` once no reader can still be accessing them.
+//
+// Every thread accessing the vector registers once, using `Register()`, and passes
+// its handle to `Read` & `Update`. Writers are serialized by a mutex, readers never
+// block writers and vice versa.
+template <typename T, typename AllocatorType = std::allocator<T>>
+class snapshot_vector
+{
+   public:
+    using vector_type = vector<T, AllocatorType>;
+
+   private:
+    struct version
+    {
+        explicit version(const AllocatorType& alloc) noexcept
+            : items(alloc)
+        {
+        }
+
+        vector_type items;
+    };
+
+    using domain_type = epoch_domain<AllocatorType>;
+    using version_allocator =
+        typename std::allocator_traits<AllocatorType>::template rebind_alloc<version>;
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using value_type = T;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+    using handle = typename domain_type::handle;
+
+    // An immutable version of the vector, which stays valid while the snapshot lives.
+    // Holding a snapshot pins the reader's handle, which delays the reclamation of
+    // replaced versions, so snapshots should be short-lived.
+    class snapshot
+    {
+       public:
+        snapshot(const snapshot&) = delete;
+        snapshot& operator=(const snapshot&) = delete;
+
+        const vector_type& operator*() const noexcept { return *items_; }
+        const vector_type* operator->() const noexcept { return items_; }
+
+        auto begin() const noexcept { return items_->cbegin(); }
+        auto end() const noexcept { return items_->cend(); }
+        size_type size() const noexcept { return items_->size(); }
+        [[nodiscard]] bool empty() const noexcept { return items_->empty(); }
+        const T& operator[](size_type pos) const noexcept { return (*items_)[pos]; }
+
+       private:
+        friend class snapshot_vector;
+
+        snapshot(handle& h, const snapshot_vector& owner) noexcept
+            : guard_(h)
+        {
+            const version* v = owner.current_.load(std::memory_order_acquire);
+            items_ = v != nullptr ? &v->items : &owner.empty_;
+        }
+
+        // Pins the handle before the current version is loaded.
+        typename domain_type::guard guard_;
+        const vector_type* items_;
+    };
+
+    explicit snapshot_vector(const allocator_type& alloc) noexcept
+        : alloc_(alloc),
+          empty_(alloc_),
+          domain_(alloc_)
+    {
+    }
+
+    // Readers & writers refer to the vector through their handles & snapshots.
+    snapshot_vector(const snapshot_vector&) = delete;
+    snapshot_vector& operator=(const snapshot_vector&) = delete;
+
+    // All handles & snapshots must be destroyed before the vector.
+    ~snapshot_vector() { FreeVersion(current_.load(std::memory_order_relaxed)); }
+
+    result<handle> Register() noexcept { return domain_.Register(); }
+
+    // Wait-free. Returns the most recently published version.
+    snapshot Read(handle& h) const noexcept { return snapshot(h, *this); }
+
+    // Publishes a modified copy of the current version. `f(vector_type& next)` is
+    // called on the copy & must return a `result<void>`; if it fails, the copy is
+    // discarded and the error returned.
+    //
+    // Must not be called while `h` is pinned, e.g. by a live snapshot: reclaiming
+    // the replaced version may need to wait for a grace period.
+    template <typename F>
+    result<void> Update(handle& h, F&& f) noexcept
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        version* current = current_.load(std::memory_order_relaxed);
+        auto next = AllocateVersion();
+        if (next.has_error())
+        {
+            return cpp::fail(std::move(next).error());
+        }
+        if (current != nullptr)
+        {
+            auto cloned = current->items.Clone();
+            if (cloned.has_error())
+            {
+                FreeVersion(next.value());
+                return cpp::fail(std::move(cloned).error());
+            }
+            next.value()->items.swap(cloned.value());
+        }
+        result<void> res = std::forward<F>(f)(next.value()->items);
+        if (res.has_error())
+        {
+            FreeVersion(next.value());
+            return res;
+        }
+        current_.store(next.value(), std::memory_order_release);
+        if (current != nullptr)
+        {
+            h.Retire(current, &ReclaimVersion, this);
+        }
+        return {};
+    }
+
+   private:
+    result<version*> AllocateVersion() noexcept
+    {
+        version_allocator version_alloc(alloc_);
+        auto v = detail::Allocate(version_alloc, 1);
+        if (v.has_error())
+        {
+            return cpp::fail(std::move(v).error());
+        }
+        return new (v.value()) version(alloc_);
+    }
+
+    void FreeVersion(version* v) noexcept
+    {
+        if (v == nullptr)
+        {
+            return;
+        }
+        std::destroy_at(v);
+        version_allocator version_alloc(alloc_);
+        detail::Deallocate(version_alloc, v, 1);
+    }
+
+    static void ReclaimVersion(void* v, void* owner) noexcept
+    {
+        static_cast<snapshot_vector*>(owner)->FreeVersion(static_cast<version*>(v));
+    }
+
+    allocator_type alloc_;
+    // Returned by readers until the first version is published.
+    vector_type empty_;
+    std::atomic<version*> current_{nullptr};
+    std::mutex writer_mutex_;
+    // Declared last, so replaced versions are reclaimed before the rest is destroyed.
+    domain_type domain_;
+};
+
+}  // namespace safe_containers
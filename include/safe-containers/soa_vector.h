@@ -0,0 +1,418 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+#include <safe-containers/span.h>
+#include <safe-containers/type_traits.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `basic_soa_vector` is a vector of records stored as a structure of arrays: every
+// field of the record lives in its own contiguous array, so a loop touching only a
+// few fields doesn't pull the others into the cache, and each array can be scanned
+// with SIMD instructions through `field<I>()`.
+//
+// All arrays share a single allocation, in which each array starts on its own cache
+// line. Growing allocates one new block & moves every array over, so growth fails as
+// a whole: on allocation failure an error is returned and the vector is unchanged.
+//
+// Fields must be nothrow move constructible, so arrays can be relocated safely.
+template <typename AllocatorType, typename... Fields>
+class basic_soa_vector
+{
+    static constexpr std::size_t kFieldCount = sizeof...(Fields);
+    static constexpr std::size_t kLineSize = SAFE_CONTAINERS_CACHE_LINE_SIZE;
+
+    static_assert(kFieldCount > 0, "A soa_vector needs at least one field");
+    static_assert(
+        (std::is_nothrow_move_constructible_v<Fields> && ...),
+        "Fields must be nothrow move constructible");
+    static_assert(
+        ((alignof(Fields) <= kLineSize) && ...), "Fields cannot be aligned beyond a cache line");
+
+    struct alignas(kLineSize) line
+    {
+        unsigned char bytes[kLineSize];
+    };
+
+    using line_allocator =
+        typename std::allocator_traits<AllocatorType>::template rebind_alloc<line>;
+    using columns = std::tuple<Fields*...>;
+    using indices = std::index_sequence_for<Fields...>;
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+
+    template <std::size_t I>
+    using field_type = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+    MAYBE_CONSTEXPR explicit basic_soa_vector(const allocator_type& alloc) noexcept
+        : alloc_(alloc)
+    {
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    basic_soa_vector(const basic_soa_vector&) = delete;
+    basic_soa_vector& operator=(const basic_soa_vector&) = delete;
+
+    basic_soa_vector(basic_soa_vector&& other) noexcept
+        : alloc_(std::move(other.alloc_)),
+          block_(std::exchange(other.block_, nullptr)),
+          columns_(std::exchange(other.columns_, columns{})),
+          size_(std::exchange(other.size_, 0)),
+          capacity_(std::exchange(other.capacity_, 0))
+    {
+    }
+
+    basic_soa_vector& operator=(basic_soa_vector&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Destroy();
+            alloc_ = std::move(other.alloc_);
+            block_ = std::exchange(other.block_, nullptr);
+            columns_ = std::exchange(other.columns_, columns{});
+            size_ = std::exchange(other.size_, 0);
+            capacity_ = std::exchange(other.capacity_, 0);
+        }
+        return *this;
+    }
+
+    ~basic_soa_vector() { Destroy(); }
+
+    // Utility wrapper around the plain `basic_soa_vector` so `Create` can be
+    // used regardless of fallibility.
+    static result<basic_soa_vector> Create(const allocator_type& alloc) noexcept
+    {
+        return result<basic_soa_vector>(cpp::in_place, alloc);
+    }
+
+    // Creates an empty vector with room for `capacity` records.
+    static result<basic_soa_vector> Create(size_type capacity, const allocator_type& alloc) noexcept
+    {
+        basic_soa_vector v(alloc);
+        TRY(v.reserve(capacity));
+        return v;
+    }
+
+    result<basic_soa_vector> Clone() const noexcept
+    {
+        basic_soa_vector v(alloc_);
+        TRY(v.reserve(size_));
+        TRY(v.CopyFrom(*this, indices{}));
+        return v;
+    }
+
+    allocator_type get_allocator() const noexcept { return alloc_; }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    size_type size() const noexcept { return size_; }
+    size_type capacity() const noexcept { return capacity_; }
+
+    static constexpr size_type max_size() noexcept
+    {
+        return (std::numeric_limits<size_type>::max() - kFieldCount * kLineSize) /
+               (sizeof(Fields) + ...);
+    }
+
+    // The array holding field `I` of every record.
+    template <std::size_t I>
+    span<field_type<I>> field() noexcept
+    {
+        return span<field_type<I>>(std::get<I>(columns_), size_);
+    }
+
+    template <std::size_t I>
+    span<const field_type<I>> field() const noexcept
+    {
+        return span<const field_type<I>>(std::get<I>(columns_), size_);
+    }
+
+    template <std::size_t I>
+    field_type<I>& get(size_type pos) noexcept
+    {
+        return std::get<I>(columns_)[pos];
+    }
+
+    template <std::size_t I>
+    const field_type<I>& get(size_type pos) const noexcept
+    {
+        return std::get<I>(columns_)[pos];
+    }
+
+    result<void> reserve(size_type capacity) noexcept
+    {
+        if (capacity <= capacity_)
+        {
+            return {};
+        }
+        return Reallocate(capacity);
+    }
+
+    // Appends a record, constructing field `I` from `args[I]`.
+    template <typename... Args>
+    result<void> push_back(Args&&... args) noexcept
+    {
+        static_assert(sizeof...(Args) == kFieldCount, "Expected one argument per field");
+        static_assert(
+            !contains_type<allocator_type, Args...>::value,
+            "Arguments cannot contain an allocator type");
+        TRY(GrowFor(size_ + 1));
+        auto values = std::forward_as_tuple(std::forward<Args>(args)...);
+        TRY(ConstructFrom<0>(size_, values));
+        ++size_;
+        return {};
+    }
+
+    void pop_back() noexcept
+    {
+        --size_;
+        DestroyRange(size_, size_ + 1, indices{});
+    }
+
+    // Resizes to `count` records, value-initializing new fields. On failure, the
+    // vector is unchanged.
+    result<void> resize(size_type count) noexcept
+    {
+        if (count <= size_)
+        {
+            DestroyRange(count, size_, indices{});
+            size_ = count;
+            return {};
+        }
+        TRY(GrowFor(count));
+        for (size_type pos = size_; pos < count; ++pos)
+        {
+            auto res = ValueInitialize<0>(pos);
+            if (res.has_error())
+            {
+                DestroyRange(size_, pos, indices{});
+                return res;
+            }
+        }
+        size_ = count;
+        return {};
+    }
+
+    void clear() noexcept
+    {
+        DestroyRange(0, size_, indices{});
+        size_ = 0;
+    }
+
+    // Removes record `pos` by moving the last record into its place, in O(1).
+    void swap_remove(size_type pos) noexcept
+    {
+        if (pos + 1 != size_)
+        {
+            MoveRecord(size_ - 1, pos, indices{});
+        }
+        pop_back();
+    }
+
+    // Releases unused capacity. On failure, the vector is unchanged.
+    result<void> shrink_to_fit() noexcept
+    {
+        if (size_ == capacity_)
+        {
+            return {};
+        }
+        if (size_ == 0)
+        {
+            Destroy();
+            return {};
+        }
+        return Reallocate(size_);
+    }
+
+    void swap(basic_soa_vector& other) noexcept
+    {
+        std::swap(alloc_, other.alloc_);
+        std::swap(block_, other.block_);
+        std::swap(columns_, other.columns_);
+        std::swap(size_, other.size_);
+        std::swap(capacity_, other.capacity_);
+    }
+
+   private:
+    static size_type AlignUp(size_type n) noexcept
+    {
+        return (n + kLineSize - 1) / kLineSize * kLineSize;
+    }
+
+    // Number of bytes needed to hold all arrays for `capacity` records.
+    static size_type BytesFor(size_type capacity) noexcept
+    {
+        size_type offset = 0;
+        ((offset = AlignUp(offset + sizeof(Fields) * capacity)), ...);
+        return offset;
+    }
+
+    // Places the arrays for `capacity` records in the block at `base`.
+    template <std::size_t... Is>
+    static columns Layout(line* base, size_type capacity, std::index_sequence<Is...>) noexcept
+    {
+        auto* bytes = reinterpret_cast<unsigned char*>(base);
+        columns out;
+        size_type offset = 0;
+        ((std::get<Is>(out) = reinterpret_cast<field_type<Is>*>(bytes + offset),
+          offset = AlignUp(offset + sizeof(field_type<Is>) * capacity)),
+         ...);
+        return out;
+    }
+
+    result<void> GrowFor(size_type count) noexcept
+    {
+        if (count <= capacity_)
+        {
+            return {};
+        }
+        if (count > max_size())
+        {
+            return cpp::fail(ContainerError{});
+        }
+        const size_type doubled = capacity_ > max_size() / 2 ? max_size() : capacity_ * 2;
+        return Reallocate(std::max({count, doubled, size_type{8}}));
+    }
+
+    result<void> Reallocate(size_type capacity) noexcept
+    {
+        if (capacity > max_size())
+        {
+            return cpp::fail(ContainerError{});
+        }
+        line_allocator line_alloc(alloc_);
+        auto block = detail::Allocate(line_alloc, BytesFor(capacity) / kLineSize);
+        if (block.has_error())
+        {
+            return cpp::fail(std::move(block).error());
+        }
+        columns next = Layout(block.value(), capacity, indices{});
+        Relocate(next, indices{});
+
+        const size_type size = size_;
+        size_ = 0;
+        Destroy();
+        block_ = block.value();
+        columns_ = next;
+        size_ = size;
+        capacity_ = capacity;
+        return {};
+    }
+
+    template <std::size_t... Is>
+    void Relocate(columns& next, std::index_sequence<Is...>) noexcept
+    {
+        (std::uninitialized_move(
+             std::get<Is>(columns_), std::get<Is>(columns_) + size_, std::get<Is>(next)),
+         ...);
+        DestroyRange(0, size_, indices{});
+    }
+
+    template <std::size_t... Is>
+    void DestroyRange(size_type first, size_type last, std::index_sequence<Is...>) noexcept
+    {
+        (std::destroy(std::get<Is>(columns_) + first, std::get<Is>(columns_) + last), ...);
+    }
+
+    template <std::size_t... Is>
+    void MoveRecord(size_type from, size_type to, std::index_sequence<Is...>) noexcept
+    {
+        ((std::get<Is>(columns_)[to] = std::move(std::get<Is>(columns_)[from])), ...);
+    }
+
+    // Constructs fields `I...` of record `pos`, undoing the fields constructed so far
+    // if one of them fails.
+    template <std::size_t I, typename Tuple>
+    result<void> ConstructFrom(size_type pos, Tuple& values) noexcept
+    {
+        if constexpr (I == kFieldCount)
+        {
+            return {};
+        }
+        else
+        {
+            field_type<I>* p = std::get<I>(columns_) + pos;
+            TRY(detail::Construct(alloc_, p, std::get<I>(std::move(values))));
+            auto res = ConstructFrom<I + 1>(pos, values);
+            if (res.has_error())
+            {
+                std::destroy_at(p);
+            }
+            return res;
+        }
+    }
+
+    template <std::size_t I>
+    result<void> ValueInitialize(size_type pos) noexcept
+    {
+        if constexpr (I == kFieldCount)
+        {
+            return {};
+        }
+        else
+        {
+            field_type<I>* p = std::get<I>(columns_) + pos;
+            TRY(detail::Construct(alloc_, p));
+            auto res = ValueInitialize<I + 1>(pos);
+            if (res.has_error())
+            {
+                std::destroy_at(p);
+            }
+            return res;
+        }
+    }
+
+    template <std::size_t... Is>
+    result<void> CopyFrom(const basic_soa_vector& other, std::index_sequence<Is...>) noexcept
+    {
+        for (size_type pos = 0; pos < other.size_; ++pos)
+        {
+            TRY(push_back(std::get<Is>(other.columns_)[pos]...));
+        }
+        return {};
+    }
+
+    void Destroy() noexcept
+    {
+        DestroyRange(0, size_, indices{});
+        if (block_ != nullptr)
+        {
+            line_allocator line_alloc(alloc_);
+            detail::Deallocate(line_alloc, block_, BytesFor(capacity_) / kLineSize);
+        }
+        block_ = nullptr;
+        columns_ = columns{};
+        size_ = 0;
+        capacity_ = 0;
+    }
+
+    allocator_type alloc_;
+    line* block_ = nullptr;
+    columns columns_{};
+    size_type size_ = 0;
+    size_type capacity_ = 0;
+};
+
+// `soa_vector<Fields...>` allocating through `std::allocator`.
+template <typename... Fields>
+using soa_vector = basic_soa_vector<std::allocator<std::byte>, Fields...>;
+
+}  // namespace safe_containers
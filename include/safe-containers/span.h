@@ -0,0 +1,56 @@
+#pragma once
+
+/** Minimal non-owning view over contiguous elements, until C++20's `std::span`. **/
+
+#include <cstddef>
+#include <type_traits>
+
+namespace safe_containers
+{
+
+template <typename T>
+class span
+{
+   public:
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using size_type = std::size_t;
+    using pointer = T*;
+    using reference = T&;
+    using iterator = T*;
+
+    constexpr span() noexcept = default;
+    constexpr span(T* data, size_type size) noexcept
+        : data_(data),
+          size_(size)
+    {
+    }
+
+    // Allow conversion from span<T> to span<const T>.
+    template <
+        typename U,
+        typename = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>>>
+    constexpr span(const span<U>& other) noexcept
+        : data_(other.data()),
+          size_(other.size())
+    {
+    }
+
+    constexpr T* data() const noexcept { return data_; }
+    constexpr size_type size() const noexcept { return size_; }
+    [[nodiscard]] constexpr bool empty() const noexcept { return size_ == 0; }
+    constexpr T* begin() const noexcept { return data_; }
+    constexpr T* end() const noexcept { return data_ + size_; }
+    constexpr T& operator[](size_type pos) const noexcept { return data_[pos]; }
+
+    constexpr span subspan(size_type offset, size_type count) const noexcept
+    {
+        return span(data_ + offset, count);
+    }
+
+   private:
+    T* data_ = nullptr;
+    size_type size_ = 0;
+};
+
+}  // namespace safe_containers
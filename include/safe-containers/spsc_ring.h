@@ -0,0 +1,261 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `spsc_ring` is a bounded single-producer/single-consumer ring buffer.
+//
+// Its storage is allocated once by `Create(...)`, which signals allocation failure
+// using a `result` type. Afterwards, pushing & popping never allocate: a full ring
+// rejects pushes and an empty ring rejects pops.
+//
+// The producer & consumer indices live on separate cache lines, and each side
+// caches the last observed index of the other side, so the shared indices are only
+// re-read when the cached view can't satisfy a push (producer) or pop (consumer).
+//
+// Exactly one thread may push and exactly one thread may pop concurrently.
+template <typename T, typename AllocatorType = std::allocator<T>>
+class spsc_ring
+{
+    using traits = std::allocator_traits<AllocatorType>;
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using value_type = T;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+
+    static_assert(
+        std::is_same_v<typename traits::pointer, T*>, "Fancy allocator pointers are not supported");
+
+    // Creates a ring holding at least `capacity` elements. The capacity is rounded up
+    // to a power of two.
+    static result<spsc_ring> Create(size_type capacity, const allocator_type& alloc) noexcept
+    {
+        const size_type rounded = detail::NextPowerOfTwo(std::max<size_type>(capacity, 1));
+        if (rounded == 0)
+        {
+            return cpp::fail(ContainerError{});
+        }
+        allocator_type a(alloc);
+        auto buffer = detail::Allocate(a, rounded);
+        if (buffer.has_error())
+        {
+            return cpp::fail(std::move(buffer).error());
+        }
+        return spsc_ring(a, buffer.value(), rounded);
+    }
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator=(const spsc_ring&) = delete;
+
+    // Moving is only allowed while no other thread accesses either ring.
+    spsc_ring(spsc_ring&& other) noexcept
+        : alloc_(std::move(other.alloc_)),
+          buffer_(std::exchange(other.buffer_, nullptr)),
+          mask_(std::exchange(other.mask_, 0))
+    {
+        producer_.tail.store(
+            other.producer_.tail.exchange(0, std::memory_order_relaxed),
+            std::memory_order_relaxed);
+        producer_.cached_head = std::exchange(other.producer_.cached_head, 0);
+        consumer_.head.store(
+            other.consumer_.head.exchange(0, std::memory_order_relaxed),
+            std::memory_order_relaxed);
+        consumer_.cached_tail = std::exchange(other.consumer_.cached_tail, 0);
+    }
+
+    spsc_ring& operator=(spsc_ring&&) = delete;
+
+    ~spsc_ring()
+    {
+        if (buffer_ == nullptr)
+        {
+            return;
+        }
+        const size_type tail = producer_.tail.load(std::memory_order_relaxed);
+        for (size_type head = consumer_.head.load(std::memory_order_relaxed); head != tail; ++head)
+        {
+            traits::destroy(alloc_, &buffer_[head & mask_]);
+        }
+        detail::Deallocate(alloc_, buffer_, mask_ + 1);
+    }
+
+    size_type capacity() const noexcept { return mask_ + 1; }
+
+    // Approximate number of elements; exact when neither side is active.
+    size_type size() const noexcept
+    {
+        return producer_.tail.load(std::memory_order_acquire) -
+               consumer_.head.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    // Producer only. Returns false if the ring is full.
+    template <typename... Args>
+    bool try_emplace(Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args...>)
+    {
+        const size_type tail = producer_.tail.load(std::memory_order_relaxed);
+        if (FreeSlots(tail, 1) == 0)
+        {
+            return false;
+        }
+        traits::construct(alloc_, &buffer_[tail & mask_], std::forward<Args>(args)...);
+        producer_.tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T& value) noexcept(std::is_nothrow_copy_constructible_v<T>)
+    {
+        return try_emplace(value);
+    }
+
+    bool try_push(T&& value) noexcept(std::is_nothrow_move_constructible_v<T>)
+    {
+        return try_emplace(std::move(value));
+    }
+
+    // Producer only. Pushes up to `count` elements from `first`, publishing them all
+    // at once, and returns the number of elements pushed. If constructing one throws,
+    // none are pushed.
+    template <typename InputIt>
+    size_type try_push_n(InputIt first, size_type count) noexcept(
+        std::is_nothrow_constructible_v<T, decltype(*first)>)
+    {
+        const size_type tail = producer_.tail.load(std::memory_order_relaxed);
+        const size_type n = std::min(count, FreeSlots(tail, count));
+        size_type i = 0;
+        if constexpr (std::is_nothrow_constructible_v<T, decltype(*first)>)
+        {
+            for (; i < n; ++i, ++first)
+            {
+                traits::construct(alloc_, &buffer_[(tail + i) & mask_], *first);
+            }
+        }
+        else
+        {
+            try
+            {
+                for (; i < n; ++i, ++first)
+                {
+                    traits::construct(alloc_, &buffer_[(tail + i) & mask_], *first);
+                }
+            }
+            catch (...)
+            {
+                // None of the elements were published yet, so none of them are pushed.
+                while (i > 0)
+                {
+                    traits::destroy(alloc_, &buffer_[(tail + --i) & mask_]);
+                }
+                throw;
+            }
+        }
+        producer_.tail.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer only. Moves the oldest element into `out`. Returns false if the ring
+    // is empty.
+    bool try_pop(T& out) noexcept(std::is_nothrow_move_assignable_v<T>)
+    {
+        const size_type head = consumer_.head.load(std::memory_order_relaxed);
+        if (UsedSlots(head, 1) == 0)
+        {
+            return false;
+        }
+        T& slot = buffer_[head & mask_];
+        out = std::move(slot);
+        traits::destroy(alloc_, &slot);
+        consumer_.head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Moves up to `max_count` elements into `out`, releasing their
+    // slots all at once, and returns the number of elements popped.
+    template <typename OutputIt>
+    size_type try_pop_n(OutputIt out, size_type max_count) noexcept(
+        std::is_nothrow_move_assignable_v<T>)
+    {
+        const size_type head = consumer_.head.load(std::memory_order_relaxed);
+        const size_type n = std::min(max_count, UsedSlots(head, max_count));
+        for (size_type i = 0; i < n; ++i, ++out)
+        {
+            T& slot = buffer_[(head + i) & mask_];
+            *out = std::move(slot);
+            traits::destroy(alloc_, &slot);
+        }
+        consumer_.head.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+   private:
+    spsc_ring(const allocator_type& alloc, T* buffer, size_type capacity) noexcept
+        : alloc_(alloc),
+          buffer_(buffer),
+          mask_(capacity - 1)
+    {
+    }
+
+    // Producer side. Only reloads the consumer index when the cached one shows
+    // fewer than `wanted` free slots.
+    size_type FreeSlots(size_type tail, size_type wanted) noexcept
+    {
+        size_type free = capacity() - (tail - producer_.cached_head);
+        if (free < wanted)
+        {
+            producer_.cached_head = consumer_.head.load(std::memory_order_acquire);
+            free = capacity() - (tail - producer_.cached_head);
+        }
+        return free;
+    }
+
+    // Consumer side. Only reloads the producer index when the cached one shows
+    // fewer than `wanted` used slots.
+    size_type UsedSlots(size_type head, size_type wanted) noexcept
+    {
+        size_type used = consumer_.cached_tail - head;
+        if (used < wanted)
+        {
+            consumer_.cached_tail = producer_.tail.load(std::memory_order_acquire);
+            used = consumer_.cached_tail - head;
+        }
+        return used;
+    }
+
+    struct alignas(SAFE_CONTAINERS_CACHE_LINE_SIZE) producer_state
+    {
+        std::atomic<size_type> tail{0};
+        size_type cached_head = 0;
+    };
+
+    struct alignas(SAFE_CONTAINERS_CACHE_LINE_SIZE) consumer_state
+    {
+        std::atomic<size_type> head{0};
+        size_type cached_tail = 0;
+    };
+
+    // Read-only after construction.
+    allocator_type alloc_;
+    T* buffer_;
+    size_type mask_;
+
+    producer_state producer_;
+    consumer_state consumer_;
+};
+
+}  // namespace safe_containers
@@ -0,0 +1,525 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `basic_string` is a byte string with fallible allocation handling using `result`
+// types, and a small string optimization storing up to `kInlineCapacity` characters
+// (23 on 64-bit targets) inline, without allocating.
+//
+// The object is as large as 3 pointers, plus the allocator. In the inline
+// representation, the last byte holds the number of unused inline characters, so it
+// doubles as the null terminator of a full inline string. In the heap representation,
+// that byte belongs to the capacity, which is encoded so the byte has its high bit set.
+template <typename AllocatorType = std::allocator<char>>
+class basic_string
+{
+    static_assert(
+        std::is_same_v<typename std::allocator_traits<AllocatorType>::value_type, char>,
+        "basic_string stores chars");
+
+    struct heap_rep
+    {
+        char* data;
+        std::size_t size;
+        std::size_t tagged_capacity;
+    };
+
+    static constexpr std::size_t kRepSize = sizeof(heap_rep);
+    static constexpr unsigned char kHeapTag = 0x80;
+
+    union rep
+    {
+        heap_rep heap;
+        char inline_chars[kRepSize];
+    };
+
+    // Stores the allocator alongside the representation, taking no space if empty.
+    struct storage : AllocatorType
+    {
+        explicit storage(const AllocatorType& alloc) noexcept
+            : AllocatorType(alloc)
+        {
+        }
+
+        rep r;
+    };
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using value_type = char;
+    using traits_type = std::char_traits<char>;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = char&;
+    using const_reference = const char&;
+    using pointer = char*;
+    using const_pointer = const char*;
+    using iterator = char*;
+    using const_iterator = const char*;
+
+    static constexpr size_type npos = static_cast<size_type>(-1);
+    static constexpr size_type kInlineCapacity = kRepSize - 1;
+
+    explicit basic_string(const allocator_type& alloc) noexcept
+        : storage_(alloc)
+    {
+        SetInline(0);
+    }
+
+    // Copy constructor and assignment operator would both need to allocate but
+    // do not offer a facility to signal OOM beyond throwing. Consider using
+    // `Clone()` instead.
+    basic_string(const basic_string&) = delete;
+    basic_string& operator=(const basic_string&) = delete;
+
+    basic_string(basic_string&& other) noexcept
+        : storage_(other.get_allocator())
+    {
+        storage_.r = other.storage_.r;
+        other.SetInline(0);
+    }
+
+    basic_string& operator=(basic_string&& other) noexcept
+    {
+        basic_string tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    ~basic_string() { Release(); }
+
+    // Utility wrapper around the plain `basic_string` so `Create` can be
+    // used regardless of fallibility.
+    static result<basic_string> Create(const allocator_type& alloc) noexcept
+    {
+        return result<basic_string>(cpp::in_place, alloc);
+    }
+
+    static result<basic_string> Create(std::string_view str, const allocator_type& alloc) noexcept
+    {
+        basic_string s(alloc);
+        TRY(s.append(str));
+        return s;
+    }
+
+    static result<basic_string> Create(
+        size_type count, char ch, const allocator_type& alloc) noexcept
+    {
+        basic_string s(alloc);
+        TRY(s.append(count, ch));
+        return s;
+    }
+
+    template <typename InputIt>
+    static result<basic_string> Create(
+        InputIt first, InputIt last, const allocator_type& alloc) noexcept
+    {
+        basic_string s(alloc);
+        TRY(s.append(first, last));
+        return s;
+    }
+
+    result<basic_string> Clone() const noexcept { return Create(view(), get_allocator()); }
+
+    allocator_type get_allocator() const noexcept { return storage_; }
+
+    char* data() noexcept { return IsHeap() ? storage_.r.heap.data : storage_.r.inline_chars; }
+    const char* data() const noexcept
+    {
+        return IsHeap() ? storage_.r.heap.data : storage_.r.inline_chars;
+    }
+    const char* c_str() const noexcept { return data(); }
+
+    std::string_view view() const noexcept { return std::string_view(data(), size()); }
+    operator std::string_view() const noexcept { return view(); }
+
+    iterator begin() noexcept { return data(); }
+    const_iterator begin() const noexcept { return data(); }
+    const_iterator cbegin() const noexcept { return data(); }
+    iterator end() noexcept { return data() + size(); }
+    const_iterator end() const noexcept { return data() + size(); }
+    const_iterator cend() const noexcept { return data() + size(); }
+
+    char& operator[](size_type pos) noexcept { return data()[pos]; }
+    const char& operator[](size_type pos) const noexcept { return data()[pos]; }
+    char& front() noexcept { return data()[0]; }
+    const char& front() const noexcept { return data()[0]; }
+    char& back() noexcept { return data()[size() - 1]; }
+    const char& back() const noexcept { return data()[size() - 1]; }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    size_type size() const noexcept
+    {
+        return IsHeap() ? storage_.r.heap.size : kInlineCapacity - InlineRemaining();
+    }
+
+    size_type length() const noexcept { return size(); }
+
+    size_type capacity() const noexcept
+    {
+        return IsHeap() ? DecodeCapacity(storage_.r.heap.tagged_capacity) : kInlineCapacity;
+    }
+
+    // The capacity must leave the tag byte of the heap representation free.
+    static constexpr size_type max_size() noexcept
+    {
+        return (size_type{1} << (8 * (sizeof(size_type) - 1))) - 2;
+    }
+
+    // Whether the characters are stored inline, within the object.
+    bool is_inline() const noexcept { return !IsHeap(); }
+
+    result<void> reserve(size_type count) noexcept
+    {
+        if (count <= capacity())
+        {
+            return {};
+        }
+        return Reallocate(count);
+    }
+
+    // Releases unused capacity, moving the characters inline if they fit. On failure,
+    // the string is unchanged.
+    result<void> shrink_to_fit() noexcept
+    {
+        if (!IsHeap() || capacity() == size())
+        {
+            return {};
+        }
+        if (size() <= kInlineCapacity)
+        {
+            heap_rep heap = storage_.r.heap;
+            SetInline(heap.size);
+            std::memcpy(storage_.r.inline_chars, heap.data, heap.size);
+            FreeBuffer(heap.data, DecodeCapacity(heap.tagged_capacity));
+            return {};
+        }
+        return Reallocate(size());
+    }
+
+    void clear() noexcept { SetSize(0); }
+
+    result<void> push_back(char ch) noexcept
+    {
+        const size_type n = size();
+        if (n < capacity())
+        {
+            data()[n] = ch;
+            SetSize(n + 1);
+            return {};
+        }
+        return append(1, ch);
+    }
+
+    void pop_back() noexcept { SetSize(size() - 1); }
+
+    result<void> append(std::string_view str) noexcept { return insert(size(), str); }
+    result<void> append(size_type count, char ch) noexcept { return insert(size(), count, ch); }
+
+    template <typename InputIt>
+    result<void> append(InputIt first, InputIt last) noexcept
+    {
+        if constexpr (std::is_base_of_v<
+                          std::forward_iterator_tag,
+                          typename std::iterator_traits<InputIt>::iterator_category>)
+        {
+            const auto count = static_cast<size_type>(std::distance(first, last));
+            return Insert(
+                size(), count, false, [&](char* out) { std::copy(first, last, out); });
+        }
+        else
+        {
+            for (; first != last; ++first)
+            {
+                TRY(push_back(*first));
+            }
+            return {};
+        }
+    }
+
+    // Inserts `str` before position `pos`, which must be at most `size()`. On failure,
+    // the string is unchanged.
+    result<void> insert(size_type pos, std::string_view str) noexcept
+    {
+        // Characters of this string would be moved before they are copied.
+        const bool aliases = !str.empty() && std::less_equal<const char*>()(data(), str.data()) &&
+                             std::less<const char*>()(str.data(), data() + size());
+        return Insert(
+            pos,
+            str.size(),
+            aliases,
+            [&](char* out) { std::memcpy(out, str.data(), str.size()); });
+    }
+
+    result<void> insert(size_type pos, size_type count, char ch) noexcept
+    {
+        return Insert(pos, count, false, [&](char* out) { std::memset(out, ch, count); });
+    }
+
+    result<void> assign(std::string_view str) noexcept
+    {
+        if (str.size() > capacity())
+        {
+            basic_string tmp(get_allocator());
+            TRY(tmp.append(str));
+            swap(tmp);
+            return {};
+        }
+        std::memmove(data(), str.data(), str.size());
+        SetSize(str.size());
+        return {};
+    }
+
+    // Resizes to `count` characters, filling new ones with `ch`.
+    result<void> resize(size_type count, char ch = '\0') noexcept
+    {
+        const size_type n = size();
+        if (count <= n)
+        {
+            SetSize(count);
+            return {};
+        }
+        return append(count - n, ch);
+    }
+
+    // Erases up to `count` characters starting at `pos`.
+    void erase(size_type pos, size_type count = npos) noexcept
+    {
+        const size_type n = size();
+        count = std::min(count, n - pos);
+        char* p = data();
+        std::memmove(p + pos, p + pos + count, n - pos - count);
+        SetSize(n - count);
+    }
+
+    size_type find(std::string_view str, size_type pos = 0) const noexcept
+    {
+        return view().find(str, pos);
+    }
+
+    size_type find(char ch, size_type pos = 0) const noexcept { return view().find(ch, pos); }
+
+    int compare(std::string_view str) const noexcept { return view().compare(str); }
+
+    bool starts_with(std::string_view str) const noexcept
+    {
+        return view().substr(0, str.size()) == str;
+    }
+
+    bool ends_with(std::string_view str) const noexcept
+    {
+        return size() >= str.size() && view().substr(size() - str.size()) == str;
+    }
+
+    void swap(basic_string& other) noexcept
+    {
+        using std::swap;
+        swap(static_cast<allocator_type&>(storage_), static_cast<allocator_type&>(other.storage_));
+        swap(storage_.r, other.storage_.r);
+    }
+
+    friend bool operator==(const basic_string& a, const basic_string& b) noexcept
+    {
+        return a.view() == b.view();
+    }
+    friend bool operator==(const basic_string& a, std::string_view b) noexcept
+    {
+        return a.view() == b;
+    }
+    friend bool operator==(std::string_view a, const basic_string& b) noexcept
+    {
+        return a == b.view();
+    }
+    friend bool operator!=(const basic_string& a, const basic_string& b) noexcept
+    {
+        return a.view() != b.view();
+    }
+    friend bool operator!=(const basic_string& a, std::string_view b) noexcept
+    {
+        return a.view() != b;
+    }
+    friend bool operator!=(std::string_view a, const basic_string& b) noexcept
+    {
+        return a != b.view();
+    }
+    friend bool operator<(const basic_string& a, const basic_string& b) noexcept
+    {
+        return a.view() < b.view();
+    }
+    friend bool operator<(const basic_string& a, std::string_view b) noexcept
+    {
+        return a.view() < b;
+    }
+    friend bool operator<(std::string_view a, const basic_string& b) noexcept
+    {
+        return a < b.view();
+    }
+
+   private:
+    using traits = std::allocator_traits<allocator_type>;
+
+    unsigned char TagByte() const noexcept
+    {
+        return static_cast<unsigned char>(storage_.r.inline_chars[kInlineCapacity]);
+    }
+
+    bool IsHeap() const noexcept { return (TagByte() & kHeapTag) != 0; }
+    size_type InlineRemaining() const noexcept { return TagByte(); }
+
+    // Places the tag in the last byte of the capacity, which is its most significant
+    // byte on little endian targets, and its least significant one on big endian ones.
+    static size_type EncodeCapacity(size_type capacity) noexcept
+    {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return (capacity << 8) | kHeapTag;
+#else
+        return capacity | (size_type{kHeapTag} << (8 * (sizeof(size_type) - 1)));
+#endif
+    }
+
+    static size_type DecodeCapacity(size_type tagged) noexcept
+    {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return tagged >> 8;
+#else
+        return tagged & ~(size_type{0xff} << (8 * (sizeof(size_type) - 1)));
+#endif
+    }
+
+    void SetInline(size_type size) noexcept
+    {
+        storage_.r.inline_chars[kInlineCapacity] = static_cast<char>(kInlineCapacity - size);
+        if (size < kInlineCapacity)
+        {
+            storage_.r.inline_chars[size] = '\0';
+        }
+    }
+
+    void SetSize(size_type size) noexcept
+    {
+        if (IsHeap())
+        {
+            storage_.r.heap.size = size;
+            storage_.r.heap.data[size] = '\0';
+        }
+        else
+        {
+            SetInline(size);
+        }
+    }
+
+    result<char*> AllocateBuffer(size_type capacity) noexcept
+    {
+        return detail::Allocate(static_cast<allocator_type&>(storage_), capacity + 1);
+    }
+
+    void FreeBuffer(char* p, size_type capacity) noexcept
+    {
+        detail::Deallocate(static_cast<allocator_type&>(storage_), p, capacity + 1);
+    }
+
+    void Release() noexcept
+    {
+        if (IsHeap())
+        {
+            FreeBuffer(storage_.r.heap.data, capacity());
+        }
+    }
+
+    // Moves the characters into a new heap buffer of `capacity` characters.
+    result<void> Reallocate(size_type capacity) noexcept
+    {
+        if (capacity > max_size())
+        {
+            return cpp::fail(ContainerError{});
+        }
+        auto buffer = AllocateBuffer(capacity);
+        if (buffer.has_error())
+        {
+            return cpp::fail(std::move(buffer).error());
+        }
+        const size_type n = size();
+        std::memcpy(buffer.value(), data(), n);
+        Release();
+        storage_.r.heap = heap_rep{buffer.value(), 0, EncodeCapacity(capacity)};
+        SetSize(n);
+        return {};
+    }
+
+    // Opens a gap of `count` characters at `pos` and fills it with `fill(gap)`. Grows
+    // into a new buffer if needed, or if `reallocate` is set because `fill` reads from
+    // this string.
+    template <typename Fill>
+    result<void> Insert(size_type pos, size_type count, bool reallocate, Fill&& fill) noexcept
+    {
+        const size_type n = size();
+        if (count > max_size() - n)
+        {
+            return cpp::fail(ContainerError{});
+        }
+        if (n + count <= capacity() && !reallocate)
+        {
+            char* p = data();
+            std::memmove(p + pos + count, p + pos, n - pos);
+            fill(p + pos);
+            SetSize(n + count);
+            return {};
+        }
+
+        const size_type doubled = capacity() > max_size() / 2 ? max_size() : 2 * capacity();
+        const size_type new_capacity = std::max(n + count, doubled);
+        auto buffer = AllocateBuffer(new_capacity);
+        if (buffer.has_error())
+        {
+            return cpp::fail(std::move(buffer).error());
+        }
+        char* p = buffer.value();
+        const char* old = data();
+        std::memcpy(p, old, pos);
+        fill(p + pos);
+        std::memcpy(p + pos + count, old + pos, n - pos);
+        Release();
+        storage_.r.heap = heap_rep{p, 0, EncodeCapacity(new_capacity)};
+        SetSize(n + count);
+        return {};
+    }
+
+    storage storage_;
+};
+
+using string = basic_string<>;
+
+}  // namespace safe_containers
+
+namespace std
+{
+
+template <typename AllocatorType>
+struct hash<safe_containers::basic_string<AllocatorType>>
+{
+    std::size_t operator()(const safe_containers::basic_string<AllocatorType>& s) const noexcept
+    {
+        return std::hash<std::string_view>()(s.view());
+    }
+};
+
+}  // namespace std
@@ -4,8 +4,11 @@
 #include <safe-containers/macros.h>
 #include <safe-containers/result/result_ext.h>
 #include <safe-containers/type_traits.h>
+#include <safe-containers/vector_registry.h>
 
+#include <iterator>
 #include <memory>
+#include <type_traits>
 #include <vector>
 
 namespace safe_containers
@@ -17,9 +20,14 @@ namespace safe_containers
 // It is intended to be used in environments where exceptions are not allowed.
 // The `result` type is used to signal allocation failures, which can be handled
 // at the call-site.
+//
+// Every constructor & `Create` takes a trailing `call_site`, which is only recorded
+// when `SAFE_CONTAINERS_VECTOR_REGISTRY` is defined. See `vector_registry.h`.
 template <typename T, typename AllocatorType = std::allocator<T>>
-class vector : public std::vector<T, AllocatorType>
+class vector : public std::vector<T, AllocatorType>, private registry_hook
 {
+    friend struct registry_ops_for<vector>;
+
    public:
     template <typename V>
     using result = cpp::result<V, ContainerError>;
@@ -52,8 +60,9 @@ class vector : public std::vector<T, AllocatorType>
     template <
         typename U = T,
         typename std::enable_if_t<!std::is_same_v<AllocatorType, std::allocator<T>>, U> = nullptr>
-    MAYBE_CONSTEXPR vector() noexcept
-        : inner{}
+    MAYBE_CONSTEXPR vector(call_site site = call_site::Current()) noexcept
+        : inner{},
+          registry_hook{&registry_ops_for<vector>::value, site}
     {
     }
 
@@ -63,18 +72,23 @@ class vector : public std::vector<T, AllocatorType>
     vector(vector const&) = delete;
     void operator=(vector const&) = delete;
 
-    MAYBE_CONSTEXPR explicit vector(const allocator_type& alloc) noexcept
-        : inner{alloc}
+    MAYBE_CONSTEXPR explicit vector(
+        const allocator_type& alloc, call_site site = call_site::Current()) noexcept
+        : inner{alloc},
+          registry_hook{&registry_ops_for<vector>::value, site}
     {
     }
 
-    MAYBE_CONSTEXPR explicit vector(allocator_type& alloc) noexcept
-        : inner{alloc}
+    MAYBE_CONSTEXPR explicit vector(
+        allocator_type& alloc, call_site site = call_site::Current()) noexcept
+        : inner{alloc},
+          registry_hook{&registry_ops_for<vector>::value, site}
     {
     }
 
-    MAYBE_CONSTEXPR explicit vector(inner&& vec) noexcept
-        : inner{std::move(vec)}
+    MAYBE_CONSTEXPR explicit vector(inner&& vec, call_site site = call_site::Current()) noexcept
+        : inner{std::move(vec)},
+          registry_hook{&registry_ops_for<vector>::value, site}
     {
     }
 
@@ -83,52 +97,63 @@ class vector : public std::vector<T, AllocatorType>
     template <typename... Args>
     MAYBE_CONSTEXPR vector(Args&&... args) noexcept = delete;
 
-    MAYBE_CONSTEXPR result<vector> Clone() noexcept
+    MAYBE_CONSTEXPR result<vector> Clone(call_site site = call_site::Current()) noexcept
     {
-        return Create(inner::cbegin(), inner::cend(), inner::get_allocator());
+        return Create(inner::cbegin(), inner::cend(), inner::get_allocator(), site);
     }
 
     // Utility wrapper around the plain `vector`` so `Create` can be
     // used regardless of fallibility.
-    MAYBE_CONSTEXPR static result<vector> Create(const allocator_type& alloc) noexcept
+    MAYBE_CONSTEXPR static result<vector> Create(
+        const allocator_type& alloc, call_site site = call_site::Current()) noexcept
     {
-        SAFE_CONTAINERS_CATCH_OOM(return result<vector>(cpp::in_place, alloc));
+        SAFE_CONTAINERS_CATCH_OOM(return result<vector>(cpp::in_place, alloc, site));
     }
 
     MAYBE_CONSTEXPR static result<vector> Create(
-        size_type count, const allocator_type& alloc) noexcept
+        size_type count,
+        const allocator_type& alloc,
+        call_site site = call_site::Current()) noexcept
     {
         SAFE_CONTAINERS_CATCH_OOM({
             inner vec(count, alloc);
-            return result<vector>(cpp::in_place, std::move(vec));
+            return result<vector>(cpp::in_place, std::move(vec), site);
         });
     }
 
     MAYBE_CONSTEXPR static result<vector> Create(
-        size_type count, const T& value, const allocator_type& alloc) noexcept
+        size_type count,
+        const T& value,
+        const allocator_type& alloc,
+        call_site site = call_site::Current()) noexcept
     {
         SAFE_CONTAINERS_CATCH_OOM({
             inner vec(count, value, alloc);
-            return result<vector>(cpp::in_place, std::move(vec));
+            return result<vector>(cpp::in_place, std::move(vec), site);
         })
     }
 
     template <typename InputIt>
     MAYBE_CONSTEXPR static result<vector> Create(
-        InputIt first, InputIt last, const allocator_type& alloc) noexcept
+        InputIt first,
+        InputIt last,
+        const allocator_type& alloc,
+        call_site site = call_site::Current()) noexcept
     {
         SAFE_CONTAINERS_CATCH_OOM({
             inner vec(first, last, alloc);
-            return result<vector>(cpp::in_place, std::move(vec));
+            return result<vector>(cpp::in_place, std::move(vec), site);
         });
     }
 
     MAYBE_CONSTEXPR static result<vector> Create(
-        std::initializer_list<T> values, const allocator_type& alloc) noexcept
+        std::initializer_list<T> values,
+        const allocator_type& alloc,
+        call_site site = call_site::Current()) noexcept
     {
         SAFE_CONTAINERS_CATCH_OOM({
             inner vec(values, alloc);
-            return result<vector>(cpp::in_place, std::move(vec));
+            return result<vector>(cpp::in_place, std::move(vec), site);
         });
     }
 
@@ -223,6 +248,36 @@ class vector : public std::vector<T, AllocatorType>
         return {};
     }
 
+    // Unlike `std::vector::shrink_to_fit`, this is binding: the capacity is reduced to
+    // `size()` by relocating the elements into an exactly sized buffer, or an error is
+    // returned & the vector is unchanged. Like `std::move_if_noexcept`, elements are
+    // only moved if that cannot throw, or if they cannot be copied.
+    MAYBE_CONSTEXPR result<void> shrink_to_fit() noexcept
+    {
+        if (inner::capacity() == inner::size())
+        {
+            return {};
+        }
+        SAFE_CONTAINERS_CATCH_OOM({
+            inner vec(inner::get_allocator());
+            vec.reserve(inner::size());
+            if constexpr (
+                std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>)
+            {
+                vec.insert(
+                    vec.end(),
+                    std::make_move_iterator(inner::begin()),
+                    std::make_move_iterator(inner::end()));
+            }
+            else
+            {
+                vec.insert(vec.end(), inner::cbegin(), inner::cend());
+            }
+            inner::swap(vec);
+        });
+        return {};
+    }
+
     MAYBE_CONSTEXPR void swap(vector& other) noexcept { inner::swap(other); }
 };
 
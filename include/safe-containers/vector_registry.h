@@ -0,0 +1,365 @@
+#pragma once
+
+/** Optional registry of live `safe_containers::vector` instances. **/
+
+#include <safe-containers/error.h>
+#include <safe-containers/result/result_ext.h>
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string_view>
+
+// Define `SAFE_CONTAINERS_VECTOR_REGISTRY` to make every `safe_containers::vector`
+// register itself in the process-wide `vector_registry` on construction. This allows
+// reporting the slack between `size()` and `capacity()` across all live vectors,
+// grouped by element type & call site, and trimming it in bulk.
+//
+// When disabled, the registry hook & call site are empty types and vectors have the
+// exact same layout & cost as before. Either way, `vector::shrink_to_fit` is binding
+// & returns a `result`, as trimming in bulk relies on it reporting failures.
+//
+// Note: The define must be consistent across all translation units.
+
+namespace safe_containers
+{
+
+#ifdef SAFE_CONTAINERS_VECTOR_REGISTRY
+
+// Source location of the code constructing a container.
+struct call_site
+{
+    const char* file = "";
+    unsigned line = 0;
+
+    // The defaults are evaluated at the call-site of the outermost function
+    // taking a `call_site` default argument.
+    static constexpr call_site Current(
+        const char* file = __builtin_FILE(), unsigned line = __builtin_LINE()) noexcept
+    {
+        return call_site{file, line};
+    }
+};
+
+// Statistics of a (group of) registered vector(s).
+struct registry_entry
+{
+    std::string_view type_name;
+    call_site site;
+    std::size_t count = 0;
+    std::size_t size_bytes = 0;
+    std::size_t capacity_bytes = 0;
+
+    [[nodiscard]] std::size_t slack_bytes() const noexcept { return capacity_bytes - size_bytes; }
+};
+
+class registry_hook;
+
+// Type-erased operations on the vector owning a hook.
+struct registry_ops
+{
+    std::string_view type_name;
+    std::size_t (*size_bytes)(const registry_hook&) noexcept;
+    std::size_t (*capacity_bytes)(const registry_hook&) noexcept;
+    cpp::result<void, ContainerError> (*shrink)(registry_hook&) noexcept;
+};
+
+namespace detail
+{
+template <typename T>
+constexpr std::string_view TypeName() noexcept
+{
+    // Extract `T` from e.g. "... TypeName() [with T = int; ...]" (gcc) or
+    // "... TypeName() [T = int]" (clang).
+    constexpr std::string_view name = __PRETTY_FUNCTION__;
+    constexpr std::string_view prefix = "T = ";
+    constexpr auto start = name.find(prefix) + prefix.size();
+    constexpr auto end = name.find_first_of(";]", start);
+    return name.substr(start, end - start);
+}
+}  // namespace detail
+
+// Process-wide registry of live vectors.
+//
+// Registration is lock-free: new hooks are pushed onto an intrusive pending stack.
+// Unregistration & traversal take a mutex, and first splice the pending stack into
+// an intrusive doubly-linked list so hooks can be unlinked in O(1).
+//
+// Unregistration can't be deferred to a later traversal, as the hook is destroyed with
+// its vector, so every vector destruction takes this process-wide mutex. Destructions
+// on different threads therefore serialize, which is a real cost for programs
+// destroying vectors at a high rate from many threads.
+//
+// Traversal callbacks run with the mutex held, but may still construct & destroy
+// vectors: a vector destroyed by the traversing thread is unlinked without locking,
+// & the traversal skips it if it wasn't visited yet. Callbacks must not traverse the
+// registry themselves.
+//
+// Traversal reads the size & capacity of every live vector. It is the caller's
+// responsibility to only do so at points where no other thread is mutating the
+// registered vectors.
+class vector_registry
+{
+   public:
+    static vector_registry& Instance() noexcept
+    {
+        static vector_registry registry;
+        return registry;
+    }
+
+    void Register(registry_hook& hook) noexcept;
+    void Unregister(registry_hook& hook) noexcept;
+
+    // Invokes `f(const registry_entry&)` for every live vector, with `count == 1`.
+    template <typename F>
+    void ForEach(F&& f) noexcept;
+
+    // Aggregates all live vectors by element type & call site into `out`,
+    // which is any container offering `begin()`/`end()` & a fallible `emplace_back()`,
+    // e.g. `safe_containers::vector<registry_entry>`.
+    template <typename Out>
+    cpp::result<void, ContainerError> Summarize(Out& out) noexcept;
+
+    // Shrinks the capacity of every live vector whose slack exceeds `threshold_bytes`.
+    // Calls `on_error(const registry_entry&, ContainerError)` for every vector that
+    // could not be shrunk & returns the number of failures.
+    template <typename F>
+    std::size_t shrink_all_over(std::size_t threshold_bytes, F&& on_error) noexcept;
+
+   private:
+    vector_registry() noexcept = default;
+
+    // Requires `mutex_` to be held.
+    void DrainPending() noexcept;
+    // Requires `mutex_` to be held.
+    void Unlink(registry_hook& hook) noexcept;
+
+    // Set on the thread traversing the registry while it holds `mutex_`.
+    static inline thread_local bool traversing_ = false;
+
+    std::atomic<registry_hook*> pending_{nullptr};
+    std::mutex mutex_;
+    registry_hook* head_ = nullptr;
+    // Next hook visited by the traversal, advanced when a callback unlinks it.
+    registry_hook* cursor_ = nullptr;
+};
+
+// Intrusive hook embedded in every registered vector.
+class registry_hook
+{
+   public:
+    registry_hook(const registry_ops* ops, call_site site) noexcept
+        : ops_(ops),
+          site_(site)
+    {
+        vector_registry::Instance().Register(*this);
+    }
+
+    ~registry_hook() { vector_registry::Instance().Unregister(*this); }
+
+    registry_hook(const registry_hook&) = delete;
+    registry_hook& operator=(const registry_hook&) = delete;
+
+    [[nodiscard]] registry_entry Entry() const noexcept
+    {
+        return registry_entry{
+            ops_->type_name, site_, 1, ops_->size_bytes(*this), ops_->capacity_bytes(*this)};
+    }
+
+   private:
+    friend class vector_registry;
+
+    const registry_ops* ops_;
+    call_site site_;
+    // Links the pending stack until drained, the live list afterwards.
+    registry_hook* next_ = nullptr;
+    registry_hook* prev_ = nullptr;
+};
+
+// Registry operations of the vector type `Vector`, which must befriend this type
+// so it can downcast from its private `registry_hook` base.
+template <typename Vector>
+struct registry_ops_for
+{
+    using value_type = typename Vector::value_type;
+
+    static std::size_t SizeBytes(const registry_hook& hook) noexcept
+    {
+        return static_cast<const Vector&>(hook).size() * sizeof(value_type);
+    }
+
+    static std::size_t CapacityBytes(const registry_hook& hook) noexcept
+    {
+        return static_cast<const Vector&>(hook).capacity() * sizeof(value_type);
+    }
+
+    static cpp::result<void, ContainerError> Shrink(registry_hook& hook) noexcept
+    {
+        return static_cast<Vector&>(hook).shrink_to_fit();
+    }
+
+    static constexpr registry_ops value{
+        detail::TypeName<value_type>(), &SizeBytes, &CapacityBytes, &Shrink};
+};
+
+inline void vector_registry::Register(registry_hook& hook) noexcept
+{
+    registry_hook* head = pending_.load(std::memory_order_relaxed);
+    do
+    {
+        hook.next_ = head;
+    } while (!pending_.compare_exchange_weak(
+        head, &hook, std::memory_order_release, std::memory_order_relaxed));
+}
+
+inline void vector_registry::Unregister(registry_hook& hook) noexcept
+{
+    if (traversing_)
+    {
+        // Called from a traversal callback, on the thread already holding `mutex_`.
+        DrainPending();
+        Unlink(hook);
+        return;
+    }
+    const std::lock_guard<std::mutex> lock(mutex_);
+    DrainPending();
+    Unlink(hook);
+}
+
+inline void vector_registry::Unlink(registry_hook& hook) noexcept
+{
+    if (cursor_ == &hook)
+    {
+        cursor_ = hook.next_;
+    }
+    if (hook.prev_ != nullptr)
+    {
+        hook.prev_->next_ = hook.next_;
+    }
+    else
+    {
+        head_ = hook.next_;
+    }
+    if (hook.next_ != nullptr)
+    {
+        hook.next_->prev_ = hook.prev_;
+    }
+}
+
+inline void vector_registry::DrainPending() noexcept
+{
+    registry_hook* hook = pending_.exchange(nullptr, std::memory_order_acquire);
+    while (hook != nullptr)
+    {
+        registry_hook* next = hook->next_;
+        hook->prev_ = nullptr;
+        hook->next_ = head_;
+        if (head_ != nullptr)
+        {
+            head_->prev_ = hook;
+        }
+        head_ = hook;
+        hook = next;
+    }
+}
+
+template <typename F>
+void vector_registry::ForEach(F&& f) noexcept
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    DrainPending();
+    traversing_ = true;
+    for (const registry_hook* hook = head_; hook != nullptr; hook = cursor_)
+    {
+        cursor_ = hook->next_;
+        f(hook->Entry());
+    }
+    traversing_ = false;
+}
+
+template <typename Out>
+cpp::result<void, ContainerError> vector_registry::Summarize(Out& out) noexcept
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    DrainPending();
+    for (const registry_hook* hook = head_; hook != nullptr; hook = hook->next_)
+    {
+        const registry_entry entry = hook->Entry();
+        // The number of distinct (type, call site) pairs is expected to be small,
+        // so a linear scan is cheaper than hashing.
+        auto it = out.begin();
+        for (; it != out.end(); ++it)
+        {
+            if (it->type_name == entry.type_name && it->site.line == entry.site.line &&
+                std::string_view(it->site.file) == entry.site.file)
+            {
+                break;
+            }
+        }
+        if (it == out.end())
+        {
+            auto res = out.emplace_back(entry);
+            if (res.has_error())
+            {
+                return cpp::fail(std::move(res).error());
+            }
+            continue;
+        }
+        it->count += 1;
+        it->size_bytes += entry.size_bytes;
+        it->capacity_bytes += entry.capacity_bytes;
+    }
+    return {};
+}
+
+template <typename F>
+std::size_t vector_registry::shrink_all_over(std::size_t threshold_bytes, F&& on_error) noexcept
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    DrainPending();
+    std::size_t failures = 0;
+    traversing_ = true;
+    for (registry_hook* hook = head_; hook != nullptr; hook = cursor_)
+    {
+        cursor_ = hook->next_;
+        const registry_entry entry = hook->Entry();
+        if (entry.slack_bytes() <= threshold_bytes)
+        {
+            continue;
+        }
+        auto res = hook->ops_->shrink(*hook);
+        if (res.has_error())
+        {
+            ++failures;
+            on_error(entry, std::move(res).error());
+        }
+    }
+    traversing_ = false;
+    return failures;
+}
+
+#else  // SAFE_CONTAINERS_VECTOR_REGISTRY
+
+struct call_site
+{
+    static constexpr call_site Current() noexcept { return {}; }
+};
+
+struct registry_ops
+{
+};
+
+struct registry_hook
+{
+    constexpr registry_hook(const registry_ops*, call_site) noexcept {}
+};
+
+template <typename Vector>
+struct registry_ops_for
+{
+    static constexpr registry_ops value{};
+};
+
+#endif  // SAFE_CONTAINERS_VECTOR_REGISTRY
+
+}  // namespace safe_containers
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <safe-containers/error.h>
+#include <safe-containers/macros.h>
+#include <safe-containers/memory.h>
+#include <safe-containers/result/result_ext.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace safe_containers
+{
+
+// `work_stealing_deque` is a Chase-Lev work-stealing deque, as formalized for the
+// C11 memory model by Lê et al. The owner thread pushes & pops at the bottom, while
+// any number of thief threads steal from the top.
+//
+// Growing the underlying ring is fallible: if the larger ring cannot be allocated,
+// `push` returns an error and the deque keeps using the current ring. Rings replaced
+// by growth may still be read by in-flight thieves, so they are retired onto an
+// intrusive list & only released when the deque is destroyed. As every ring is
+// twice the size of the previous one, retired rings never use more memory than the
+// current ring.
+//
+// Elements are read concurrently by thieves, so they must be trivially copyable,
+// e.g. task pointers or indices.
+template <typename T, typename AllocatorType = std::allocator<T>>
+class work_stealing_deque
+{
+    using slot = std::atomic<T>;
+
+    struct ring
+    {
+        std::int64_t mask;
+        slot* slots;
+        // Next ring on the retired list.
+        ring* retired;
+
+        std::int64_t capacity() const noexcept { return mask + 1; }
+        T Load(std::int64_t i) const noexcept
+        {
+            return slots[i & mask].load(std::memory_order_relaxed);
+        }
+        void Store(std::int64_t i, T value) noexcept
+        {
+            slots[i & mask].store(value, std::memory_order_relaxed);
+        }
+    };
+
+    using ring_allocator =
+        typename std::allocator_traits<AllocatorType>::template rebind_alloc<ring>;
+    using slot_allocator =
+        typename std::allocator_traits<AllocatorType>::template rebind_alloc<slot>;
+
+   public:
+    template <typename V>
+    using result = cpp::result<V, ContainerError>;
+
+    using value_type = T;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+
+    static_assert(std::is_trivially_copyable_v<T>, "Elements must be trivially copyable");
+
+    // Creates a deque with an initial capacity of at least `capacity` elements. The
+    // capacity is rounded up to a power of two.
+    static result<work_stealing_deque> Create(
+        size_type capacity, const allocator_type& alloc) noexcept
+    {
+        work_stealing_deque d(alloc);
+        auto r = d.AllocateRing(std::max<size_type>(capacity, 2));
+        if (r.has_error())
+        {
+            return cpp::fail(std::move(r).error());
+        }
+        d.ring_.store(r.value(), std::memory_order_relaxed);
+        return d;
+    }
+
+    work_stealing_deque(const work_stealing_deque&) = delete;
+    work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+    // Moving is only allowed while no other thread accesses either deque.
+    work_stealing_deque(work_stealing_deque&& other) noexcept
+        : alloc_(std::move(other.alloc_)),
+          retired_(std::exchange(other.retired_, nullptr))
+    {
+        top_.store(other.top_.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+        bottom_.store(
+            other.bottom_.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+        ring_.store(
+            other.ring_.exchange(nullptr, std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    work_stealing_deque& operator=(work_stealing_deque&&) = delete;
+
+    ~work_stealing_deque()
+    {
+        FreeRing(ring_.load(std::memory_order_relaxed));
+        while (retired_ != nullptr)
+        {
+            FreeRing(std::exchange(retired_, retired_->retired));
+        }
+    }
+
+    // Approximate number of elements; exact when no thread is active.
+    size_type size() const noexcept
+    {
+        const std::int64_t b = bottom_.load(std::memory_order_relaxed);
+        const std::int64_t t = top_.load(std::memory_order_relaxed);
+        return b > t ? static_cast<size_type>(b - t) : 0;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    // 0 once moved from.
+    size_type capacity() const noexcept
+    {
+        const ring* r = ring_.load(std::memory_order_relaxed);
+        return r != nullptr ? static_cast<size_type>(r->capacity()) : 0;
+    }
+
+    // Owner only. Grows the ring when full; if that fails, the deque is unchanged.
+    result<void> push(T value) noexcept
+    {
+        const std::int64_t b = bottom_.load(std::memory_order_relaxed);
+        const std::int64_t t = top_.load(std::memory_order_acquire);
+        ring* r = ring_.load(std::memory_order_relaxed);
+        if (b - t > r->mask)
+        {
+            auto grown = Grow(r, b, t);
+            if (grown.has_error())
+            {
+                return cpp::fail(std::move(grown).error());
+            }
+            r = grown.value();
+        }
+        r->Store(b, value);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return {};
+    }
+
+    // Owner only. Pops the most recently pushed element into `out`. Returns false if
+    // the deque is empty, or a thief stole the last element.
+    bool try_pop(T& out) noexcept
+    {
+        const std::int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        ring* r = ring_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b)
+        {
+            // Empty.
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        out = r->Load(b);
+        if (t < b)
+        {
+            return true;
+        }
+        // Last element: race the thieves for it.
+        const bool won = top_.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    // Any thread. Steals the least recently pushed element into `out`. Returns false if
+    // the deque is empty, or another thread took the element first.
+    bool try_steal(T& out) noexcept
+    {
+        std::int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b)
+        {
+            return false;
+        }
+        const ring* r = ring_.load(std::memory_order_acquire);
+        const T value = r->Load(t);
+        if (!top_.compare_exchange_strong(
+                t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return false;
+        }
+        out = value;
+        return true;
+    }
+
+   private:
+    explicit work_stealing_deque(const allocator_type& alloc) noexcept
+        : alloc_(alloc)
+    {
+    }
+
+    result<ring*> AllocateRing(size_type capacity) noexcept
+    {
+        const size_type rounded = detail::NextPowerOfTwo(capacity);
+        if (rounded == 0 || rounded > static_cast<size_type>(INT64_MAX))
+        {
+            return cpp::fail(ContainerError{});
+        }
+        ring_allocator ring_alloc(alloc_);
+        auto r = detail::Allocate(ring_alloc, 1);
+        if (r.has_error())
+        {
+            return cpp::fail(std::move(r).error());
+        }
+        slot_allocator slot_alloc(alloc_);
+        auto slots = detail::Allocate(slot_alloc, rounded);
+        if (slots.has_error())
+        {
+            detail::Deallocate(ring_alloc, r.value(), 1);
+            return cpp::fail(std::move(slots).error());
+        }
+        for (size_type i = 0; i < rounded; ++i)
+        {
+            new (&slots.value()[i]) slot();
+        }
+        return new (r.value())
+            ring{static_cast<std::int64_t>(rounded) - 1, slots.value(), nullptr};
+    }
+
+    void FreeRing(ring* r) noexcept
+    {
+        if (r == nullptr)
+        {
+            return;
+        }
+        slot_allocator slot_alloc(alloc_);
+        detail::Deallocate(slot_alloc, r->slots, static_cast<size_type>(r->capacity()));
+        ring_allocator ring_alloc(alloc_);
+        detail::Deallocate(ring_alloc, r, 1);
+    }
+
+    // Owner only. Copies the live elements into a ring of twice the size, publishes it
+    // & retires the old ring.
+    result<ring*> Grow(ring* old, std::int64_t b, std::int64_t t) noexcept
+    {
+        auto grown = AllocateRing(static_cast<size_type>(old->capacity()) * 2);
+        if (grown.has_error())
+        {
+            return cpp::fail(std::move(grown).error());
+        }
+        ring* r = grown.value();
+        for (std::int64_t i = t; i < b; ++i)
+        {
+            r->Store(i, old->Load(i));
+        }
+        ring_.store(r, std::memory_order_release);
+        old->retired = retired_;
+        retired_ = old;
+        return r;
+    }
+
+    alignas(SAFE_CONTAINERS_CACHE_LINE_SIZE) std::atomic<std::int64_t> top_{0};
+    alignas(SAFE_CONTAINERS_CACHE_LINE_SIZE) std::atomic<std::int64_t> bottom_{0};
+    alignas(SAFE_CONTAINERS_CACHE_LINE_SIZE) std::atomic<ring*> ring_{nullptr};
+    // Owner only.
+    allocator_type alloc_;
+    ring* retired_ = nullptr;
+};
+
+}  // namespace safe_containers
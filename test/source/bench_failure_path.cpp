@@ -0,0 +1,113 @@
+// Measures the latency of the allocation failure path.
+//
+// Compares a `bad_alloc` thrown by the allocator & caught by `SAFE_CONTAINERS_CATCH_OOM`
+// against a failure reported without throwing, for an increasing number of threads.
+// Under memory pressure the error path becomes the hot path, and unwinding may
+// contend on the unwinder's global state.
+//
+// Usage: safe-containers_bench_failure_path [iterations-per-thread] [max-threads]
+
+#include <safe-containers/vector.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "fail_alloc.h"
+
+namespace
+{
+template <typename T>
+using result = cpp::result<T, ContainerError>;
+
+using vec = safe_containers::vector<int, fault_injecting_allocator<int>>;
+
+// Failure reported through the allocator throwing `std::bad_alloc`.
+result<void> ThrowingPath(vec& v) noexcept { return v.push_back(1); }
+
+// Failure reported by checking the policy up-front, without any exception.
+result<void> NonThrowingPath(vec& v) noexcept
+{
+    if (v.get_allocator().policy->ShouldFail(sizeof(int)))
+    {
+        return cpp::fail(ContainerError{});
+    }
+    return {};
+}
+
+template <typename F>
+double NanosPerOp(unsigned threads, std::size_t iterations, F&& path)
+{
+    std::atomic<bool> start{false};
+    std::atomic<std::size_t> errors{0};
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        workers.emplace_back(
+            [&]()
+            {
+                fault_policy policy{};
+                policy.fail_probability = 1.0;
+                fault_injecting_allocator<int> alloc{policy};
+                vec v{alloc};
+                while (!start.load(std::memory_order_acquire))
+                {
+                }
+                std::size_t local_errors = 0;
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    if (path(v).has_error())
+                    {
+                        ++local_errors;
+                    }
+                }
+                errors.fetch_add(local_errors, std::memory_order_relaxed);
+            });
+    }
+
+    const auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    if (errors.load() != threads * iterations)
+    {
+        std::fprintf(stderr, "expected every operation to fail\n");
+        std::exit(EXIT_FAILURE);
+    }
+    // Wall time per operation of a single thread, so the numbers are comparable
+    // across thread counts: a flat line means no contention.
+    const auto nanos = std::chrono::duration<double, std::nano>(end - begin).count();
+    return nanos / static_cast<double>(iterations);
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const std::size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    const unsigned max_threads =
+        argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10))
+                 : std::max(1U, std::thread::hardware_concurrency());
+
+    std::printf("%8s %16s %16s %8s\n", "threads", "throw (ns/op)", "no-throw (ns/op)", "ratio");
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+    {
+        const double throwing = NanosPerOp(threads, iterations, ThrowingPath);
+        const double non_throwing = NanosPerOp(threads, iterations, NonThrowingPath);
+        std::printf(
+            "%8u %16.1f %16.1f %8.1f\n",
+            threads,
+            throwing,
+            non_throwing,
+            throwing / non_throwing);
+    }
+    return EXIT_SUCCESS;
+}
@@ -1,5 +1,13 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <tuple>
+
 template <typename T>
 struct fail_allocator
 {
@@ -11,6 +19,13 @@ struct fail_allocator
     using size_type = size_t;
     using difference_type = ptrdiff_t;
 
+    fail_allocator() = default;
+
+    template <typename U>
+    fail_allocator(const fail_allocator<U>&) noexcept
+    {
+    }
+
     pointer allocate(size_type n, const_pointer hint = 0)
     {
         std::ignore = n;
@@ -37,4 +52,93 @@ struct fail_allocator
     {
         (reinterpret_cast<Ty*>(p))->~Ty();
     }
-};
\ No newline at end of file
+
+    friend bool operator==(const fail_allocator&, const fail_allocator&) noexcept { return true; }
+    friend bool operator!=(const fail_allocator&, const fail_allocator&) noexcept { return false; }
+};
+
+// Shared configuration & counters of a `fault_injecting_allocator`.
+// All copies & rebinds of an allocator refer to the same policy, so the
+// "N-th allocation" is counted across the whole container.
+struct fault_policy
+{
+    // Fail the N-th allocation (1-based). 0 disables.
+    std::size_t fail_nth = 0;
+    // Fail every allocation with this probability.
+    double fail_probability = 0.0;
+    // Fail every allocation larger than this number of bytes.
+    std::size_t fail_above_bytes = std::numeric_limits<std::size_t>::max();
+    // Seed of the probabilistic failures. The decision for the N-th allocation only
+    // depends on the seed & N, so failures are reproducible across runs.
+    std::uint64_t seed = 0;
+
+    std::atomic<std::size_t> allocations{0};
+    std::atomic<std::size_t> failures{0};
+
+    bool ShouldFail(std::size_t bytes) noexcept
+    {
+        const std::size_t n = allocations.fetch_add(1, std::memory_order_relaxed) + 1;
+        const bool fail = n == fail_nth || bytes > fail_above_bytes ||
+                          (fail_probability > 0.0 && Uniform(n) < fail_probability);
+        if (fail)
+        {
+            failures.fetch_add(1, std::memory_order_relaxed);
+        }
+        return fail;
+    }
+
+   private:
+    // splitmix64 of (seed, n), mapped onto [0, 1).
+    double Uniform(std::size_t n) const noexcept
+    {
+        std::uint64_t z = seed + static_cast<std::uint64_t>(n) * 0x9e3779b97f4a7c15ULL;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        z = z ^ (z >> 31);
+        return static_cast<double>(z >> 11) * 0x1.0p-53;
+    }
+};
+
+// Allocator which throws `std::bad_alloc` whenever its `fault_policy` says so,
+// and otherwise forwards to `std::allocator`.
+template <typename T>
+struct fault_injecting_allocator
+{
+    using value_type = T;
+
+    explicit fault_injecting_allocator(fault_policy& p) noexcept
+        : policy(&p)
+    {
+    }
+
+    template <typename U>
+    fault_injecting_allocator(const fault_injecting_allocator<U>& other) noexcept
+        : policy(other.policy)
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        if (policy->ShouldFail(n * sizeof(T)))
+        {
+            throw std::bad_alloc();
+        }
+        return std::allocator<T>{}.allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept { std::allocator<T>{}.deallocate(p, n); }
+
+    template <typename U>
+    bool operator==(const fault_injecting_allocator<U>& other) const noexcept
+    {
+        return policy == other.policy;
+    }
+
+    template <typename U>
+    bool operator!=(const fault_injecting_allocator<U>& other) const noexcept
+    {
+        return policy != other.policy;
+    }
+
+    fault_policy* policy;
+};
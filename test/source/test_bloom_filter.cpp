@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <safe-containers/bloom_filter.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using bloom_filter = safe_containers::blocked_bloom_filter<int>;
+using counted_filter =
+    safe_containers::blocked_bloom_filter<int, std::hash<int>, fault_injecting_allocator<int>>;
+using failing_filter =
+    safe_containers::blocked_bloom_filter<int, std::hash<int>, fail_allocator<int>>;
+
+TEST(BloomFilter, NoFalseNegatives)
+{
+    std::allocator<int> alloc{};
+    auto filter = bloom_filter::Create(10000, alloc).expect("Create should work");
+    ASSERT_EQ(filter.bit_count(), 100096);
+    for (int i = 0; i < 10000; ++i)
+    {
+        filter.insert(i).expect("insert should work");
+    }
+    for (int i = 0; i < 10000; ++i)
+    {
+        ASSERT_TRUE(filter.contains(i));
+    }
+
+    // About 1% false positives at 10 bits per key.
+    int false_positives = 0;
+    for (int i = 10000; i < 110000; ++i)
+    {
+        false_positives += filter.contains(i) ? 1 : 0;
+    }
+    ASSERT_LT(false_positives, 2000);
+
+    auto clone = filter.Clone().expect("Clone should work");
+    ASSERT_TRUE(clone.contains(42));
+    filter.clear();
+    ASSERT_FALSE(filter.contains(42));
+    ASSERT_TRUE(clone.contains(42));
+}
+
+TEST(BloomFilter, BulkProbeMatchesSingleProbes)
+{
+    std::allocator<std::string> alloc{};
+    auto filter = safe_containers::blocked_bloom_filter<std::string>::Create(100, 16, alloc)
+                      .expect("Create should work");
+    std::vector<std::string> keys;
+    for (int i = 0; i < 200; ++i)
+    {
+        keys.push_back("key" + std::to_string(i));
+        if (i % 2 == 0)
+        {
+            filter.insert(keys.back()).expect("insert should work");
+        }
+    }
+
+    std::unique_ptr<bool[]> results(new bool[keys.size()]);
+    filter.contains(
+        safe_containers::span<const std::string>(keys.data(), keys.size()),
+        safe_containers::span<bool>(results.get(), keys.size()));
+    for (std::size_t i = 0; i < keys.size(); ++i)
+    {
+        ASSERT_EQ(results[i], filter.contains(keys[i]));
+        if (i % 2 == 0)
+        {
+            ASSERT_TRUE(results[i]);
+        }
+    }
+}
+
+TEST(BloomFilter, EmptyFilterContainsNothing)
+{
+    std::allocator<int> alloc{};
+    auto filter = bloom_filter::Create(100, alloc).expect("Create should work");
+    filter.insert(1).expect("insert should work");
+    bloom_filter moved(std::move(filter));
+    ASSERT_TRUE(moved.contains(1));
+
+    // A moved-from filter has no blocks.
+    ASSERT_EQ(filter.bit_count(), 0);
+    ASSERT_TRUE(filter.insert(1).has_error());
+    ASSERT_FALSE(filter.contains(1));
+    const int keys[] = {1, 2, 3};
+    bool results[] = {true, true, true};
+    filter.contains(
+        safe_containers::span<const int>(keys, 3), safe_containers::span<bool>(results, 3));
+    ASSERT_FALSE(results[0] || results[1] || results[2]);
+}
+
+TEST(BloomFilter, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<int> alloc{};
+        ASSERT_TRUE(failing_filter::Create(100, alloc).has_error());
+    }
+
+    {
+        std::allocator<int> alloc{};
+        ASSERT_TRUE(bloom_filter::Create(100, 0, alloc).has_error());
+
+        fault_policy policy{};
+        fault_injecting_allocator<int> counted{policy};
+        auto filter = counted_filter::Create(100, counted).expect("Create should work");
+        filter.insert(1).expect("insert should work");
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(filter.Clone().has_error());
+        ASSERT_TRUE(filter.contains(1));
+    }
+}
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include <safe-containers/btree.h>
+
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using map = safe_containers::btree_map<int, int>;
+
+namespace
+{
+
+template <typename Map>
+bool SameContents(const Map& m, const std::map<int, int>& expected)
+{
+    return std::equal(
+        m.begin(),
+        m.end(),
+        expected.begin(),
+        expected.end(),
+        [](const auto& a, const auto& b) { return a.first == b.first && a.second == b.second; });
+}
+
+}  // namespace
+
+TEST(BTree, MatchesStdMapUnderRandomInsertsAndErases)
+{
+    std::allocator<std::pair<int, int>> alloc{};
+    auto m = map::Create(alloc).expect("Create should work");
+    std::map<int, int> expected;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> keys(0, 20000);
+
+    for (int i = 0; i < 50000; ++i)
+    {
+        const int key = keys(rng);
+        if (rng() % 3 == 0)
+        {
+            ASSERT_EQ(m.erase(key), expected.erase(key));
+        }
+        else
+        {
+            const bool inserted = m.try_emplace(key, i).expect("try_emplace should work").second;
+            ASSERT_EQ(inserted, expected.emplace(key, i).second);
+        }
+    }
+    ASSERT_EQ(m.size(), expected.size());
+    ASSERT_GT(m.height(), 0);
+    ASSERT_TRUE(SameContents(m, expected));
+
+    for (int key = -1; key <= 20001; key += 7)
+    {
+        const auto it = m.lower_bound(key);
+        const auto e = expected.lower_bound(key);
+        ASSERT_EQ(it == m.end(), e == expected.end());
+        if (e != expected.end())
+        {
+            ASSERT_EQ(it->first, e->first);
+        }
+        ASSERT_EQ(m.contains(key), expected.count(key) == 1);
+    }
+
+    // Erase everything through iterators, collapsing the tree.
+    for (auto it = m.begin(); it != m.end();)
+    {
+        it = m.erase(it);
+    }
+    ASSERT_TRUE(m.empty());
+    ASSERT_EQ(m.height(), 0);
+    ASSERT_EQ(m.begin(), m.end());
+}
+
+TEST(BTree, RangeIterationFollowsLeafLinks)
+{
+    std::allocator<std::string> alloc{};
+    auto s = safe_containers::btree_set<std::string>::Create(alloc).expect("Create should work");
+    for (int i = 999; i >= 0; --i)
+    {
+        s.insert(std::to_string(i)).expect("insert should work");
+    }
+    ASSERT_EQ(s.size(), 1000);
+
+    std::set<std::string> expected;
+    for (int i = 0; i < 1000; ++i)
+    {
+        expected.insert(std::to_string(i));
+    }
+    auto first = s.lower_bound("2");
+    auto last = s.upper_bound("3");
+    ASSERT_TRUE(std::equal(first, last, expected.lower_bound("2"), expected.upper_bound("3")));
+
+    auto clone = s.Clone().expect("Clone should work");
+    ASSERT_TRUE(std::equal(clone.begin(), clone.end(), expected.begin(), expected.end()));
+}
+
+TEST(BTree, InsertOrAssignOverwrites)
+{
+    std::allocator<std::pair<int, int>> alloc{};
+    auto m = map::Create(alloc).expect("Create should work");
+    m.insert({1, 1}).expect("insert should work");
+    ASSERT_FALSE(m.insert_or_assign(1, 5).expect("insert_or_assign should work").second);
+    ASSERT_EQ(m.find(1)->second, 5);
+    ASSERT_EQ(m.find(2), m.end());
+}
+
+TEST(BTree, AllocationFailuresReturnError)
+{
+    using allocator = fault_injecting_allocator<std::pair<int, int>>;
+    using fallible_map = safe_containers::btree_map<int, int, std::less<int>, allocator>;
+
+    {
+        fail_allocator<std::pair<int, int>> alloc{};
+        safe_containers::btree_map<int, int, std::less<int>, fail_allocator<std::pair<int, int>>>
+            m{alloc};
+        ASSERT_TRUE(m.try_emplace(1, 1).has_error());
+        ASSERT_TRUE(m.empty());
+    }
+
+    {
+        // Fail the allocation of a leaf when splitting the root.
+        fault_policy policy{};
+        allocator alloc{policy};
+        fallible_map m{alloc};
+        m.try_emplace(0, 0).expect("try_emplace should work");
+        int key = 1;
+        while (m.height() == 0)
+        {
+            policy.fail_nth = policy.allocations.load() + 1;
+            auto res = m.try_emplace(key, key);
+            if (res.has_error())
+            {
+                break;
+            }
+            ++key;
+        }
+        ASSERT_EQ(m.size(), fallible_map::kLeafCapacity);
+        ASSERT_EQ(m.height(), 0);
+        policy.fail_nth = 0;
+        m.try_emplace(key, key).expect("try_emplace should work");
+        ASSERT_EQ(m.height(), 1);
+    }
+
+    {
+        // Random failures, including the new root of a split, leave the map consistent.
+        fault_policy policy{};
+        policy.fail_probability = 0.2;
+        allocator alloc{policy};
+        fallible_map m{alloc};
+        std::map<int, int> expected;
+        for (int i = 0; i < 20000; ++i)
+        {
+            const int key = (i * 7919) % 20000;
+            if (m.try_emplace(key, i).has_value())
+            {
+                expected.emplace(key, i);
+            }
+        }
+        ASSERT_GT(policy.failures.load(), 0);
+        ASSERT_EQ(m.size(), expected.size());
+        ASSERT_TRUE(SameContents(m, expected));
+    }
+}
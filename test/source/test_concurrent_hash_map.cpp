@@ -0,0 +1,256 @@
+#include <gtest/gtest.h>
+#include <safe-containers/concurrent_hash_map.h>
+#include <safe-containers/flat_hash_map.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using int_map = safe_containers::flat_hash_map<int, int>;
+using concurrent_int_map = safe_containers::concurrent_hash_map<int, int>;
+
+TEST(FlatHashMap, InsertFindErase)
+{
+    std::allocator<std::pair<int, int>> alloc{};
+    auto map = int_map::Create(alloc).expect("Create should work");
+    for (int i = 0; i < 1000; ++i)
+    {
+        ASSERT_TRUE(map.try_emplace(i, i * 2).expect("try_emplace should work").second);
+    }
+    ASSERT_EQ(map.size(), 1000);
+    ASSERT_FALSE(map.try_emplace(7, 0).expect("try_emplace should work").second);
+    ASSERT_EQ(map.find(7)->second, 14);
+    ASSERT_EQ(map.find(1000), map.end());
+
+    for (int i = 0; i < 1000; i += 2)
+    {
+        ASSERT_EQ(map.erase(i), 1);
+    }
+    ASSERT_EQ(map.erase(0), 0);
+    ASSERT_EQ(map.size(), 500);
+    for (int i = 0; i < 1000; ++i)
+    {
+        ASSERT_EQ(map.contains(i), i % 2 == 1);
+    }
+
+    int sum = 0;
+    for (const auto& [key, value] : map)
+    {
+        ASSERT_EQ(value, key * 2);
+        sum += key;
+    }
+    ASSERT_EQ(sum, 250000);
+}
+
+TEST(FlatHashMap, TombstonesAreReclaimed)
+{
+    std::allocator<std::pair<int, int>> alloc{};
+    auto map = int_map::Create(8, alloc).expect("Create should work");
+    const std::size_t capacity = map.capacity();
+    for (int i = 0; i < 10000; ++i)
+    {
+        map.try_emplace(i, i).expect("try_emplace should work");
+        ASSERT_EQ(map.erase(i), 1);
+    }
+    ASSERT_TRUE(map.empty());
+    ASSERT_EQ(map.capacity(), capacity);
+}
+
+TEST(FlatHashMap, InsertOrAssignAndClone)
+{
+    std::allocator<std::pair<std::string, std::string>> alloc{};
+    safe_containers::flat_hash_map<
+        std::string,
+        std::string,
+        std::hash<std::string>,
+        std::equal_to<std::string>,
+        std::allocator<std::pair<std::string, std::string>>>
+        map{alloc};
+    ASSERT_TRUE(map.insert_or_assign("a", "1").expect("insert_or_assign should work").second);
+    ASSERT_FALSE(map.insert_or_assign("a", "2").expect("insert_or_assign should work").second);
+    ASSERT_EQ(map.find("a")->second, "2");
+
+    auto clone = map.Clone().expect("Clone should work");
+    map.clear();
+    ASSERT_EQ(clone.size(), 1);
+    ASSERT_EQ(clone.find("a")->second, "2");
+}
+
+TEST(FlatHashMap, InsertMayCopyAnElementAcrossRehash)
+{
+    std::allocator<std::pair<int, std::string>> alloc{};
+    safe_containers::flat_hash_map<int, std::string> map{alloc};
+    const std::string value(64, 'x');
+    map.try_emplace(0, value).expect("try_emplace should work");
+    int rehashes = 0;
+    for (int i = 1; i < 1000; ++i)
+    {
+        // The value refers to an element, which growing the table relocates.
+        const std::size_t capacity = map.capacity();
+        map.try_emplace(i, map.find(i - 1)->second).expect("try_emplace should work");
+        rehashes += map.capacity() != capacity ? 1 : 0;
+    }
+    ASSERT_GT(rehashes, 0);
+    for (const auto& [key, v] : map)
+    {
+        ASSERT_EQ(v, value);
+    }
+}
+
+TEST(FlatHashMap, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<std::pair<int, int>> alloc{};
+        ASSERT_TRUE((safe_containers::flat_hash_map<
+                         int,
+                         int,
+                         std::hash<int>,
+                         std::equal_to<int>,
+                         fail_allocator<std::pair<int, int>>>::Create(16, alloc)
+                         .has_error()));
+    }
+
+    {
+        // A failed rehash leaves the map unchanged.
+        fault_policy policy{};
+        fault_injecting_allocator<std::pair<int, int>> alloc{policy};
+        safe_containers::flat_hash_map<
+            int,
+            int,
+            std::hash<int>,
+            std::equal_to<int>,
+            fault_injecting_allocator<std::pair<int, int>>>
+            map{alloc};
+        int i = 0;
+        const std::size_t capacity = map.capacity();
+        while (map.capacity() == capacity || map.size() < map.capacity() - map.capacity() / 8)
+        {
+            map.try_emplace(i, i).expect("try_emplace should work");
+            ++i;
+        }
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(map.try_emplace(i, i).has_error());
+        ASSERT_EQ(map.size(), static_cast<std::size_t>(i));
+        for (int j = 0; j < i; ++j)
+        {
+            ASSERT_EQ(map.find(j)->second, j);
+        }
+        map.try_emplace(i, i).expect("try_emplace should work");
+    }
+}
+
+TEST(ConcurrentHashMap, Create)
+{
+    std::allocator<std::pair<int, int>> alloc{};
+    auto map = concurrent_int_map::Create(5, alloc).expect("Create should work");
+    ASSERT_EQ(map.shard_count(), 8);
+    ASSERT_TRUE(map.empty());
+
+    concurrent_int_map moved(std::move(map));
+    ASSERT_EQ(moved.shard_count(), 8);
+    ASSERT_EQ(map.shard_count(), 0);
+    ASSERT_TRUE(map.empty());
+    ASSERT_TRUE(map.reserve(100).has_error());
+}
+
+TEST(ConcurrentHashMap, Operations)
+{
+    std::allocator<std::pair<int, int>> alloc{};
+    auto map = concurrent_int_map::Create(alloc).expect("Create should work");
+    map.reserve(1000).expect("reserve should work");
+    for (int i = 0; i < 1000; ++i)
+    {
+        ASSERT_TRUE(map.insert({i, i}).expect("insert should work"));
+    }
+    ASSERT_FALSE(map.try_emplace(3, 0).expect("try_emplace should work"));
+    ASSERT_FALSE(map.insert_or_assign(3, 30).expect("insert_or_assign should work"));
+    ASSERT_EQ(map.size(), 1000);
+
+    int value = 0;
+    ASSERT_TRUE(map.visit(3, [&](int& v) { value = v++; }));
+    ASSERT_EQ(value, 30);
+    ASSERT_TRUE(map.visit(3, [&](int& v) { value = v; }));
+    ASSERT_EQ(value, 31);
+    ASSERT_FALSE(map.visit(1000, [](int&) {}));
+
+    ASSERT_TRUE(map.erase(3));
+    ASSERT_FALSE(map.erase(3));
+    ASSERT_FALSE(map.contains(3));
+
+    int count = 0;
+    map.for_each([&](const int& key, int& v) { count += key == v; });
+    ASSERT_EQ(count, 999);
+
+    map.clear();
+    ASSERT_TRUE(map.empty());
+}
+
+TEST(ConcurrentHashMap, ConcurrentInserts)
+{
+    constexpr int threads = 4;
+    constexpr int per_thread = 10000;
+    std::allocator<std::pair<int, int>> alloc{};
+    auto map = concurrent_int_map::Create(alloc).expect("Create should work");
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back(
+            [&, t]()
+            {
+                for (int i = 0; i < per_thread; ++i)
+                {
+                    // Every thread inserts every key, and bumps a shared counter.
+                    map.try_emplace(i, 0).expect("try_emplace should work");
+                    map.visit(i, [](int& v) { ++v; });
+                    map.insert_or_assign(per_thread * (t + 1) + i, t)
+                        .expect("insert_or_assign should work");
+                }
+            });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    ASSERT_EQ(map.size(), static_cast<std::size_t>(per_thread * (threads + 1)));
+    for (int i = 0; i < per_thread; ++i)
+    {
+        int value = 0;
+        ASSERT_TRUE(map.visit(i, [&](int& v) { value = v; }));
+        ASSERT_EQ(value, threads);
+    }
+}
+
+TEST(ConcurrentHashMap, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<std::pair<int, int>> alloc{};
+        ASSERT_TRUE((safe_containers::concurrent_hash_map<
+                         int,
+                         int,
+                         std::hash<int>,
+                         std::equal_to<int>,
+                         fail_allocator<std::pair<int, int>>>::Create(alloc)
+                         .has_error()));
+    }
+
+    {
+        fault_policy policy{};
+        fault_injecting_allocator<std::pair<int, int>> alloc{policy};
+        auto map = safe_containers::concurrent_hash_map<
+                       int,
+                       int,
+                       std::hash<int>,
+                       std::equal_to<int>,
+                       fault_injecting_allocator<std::pair<int, int>>>::Create(alloc)
+                       .expect("Create should work");
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(map.insert({1, 1}).has_error());
+        ASSERT_FALSE(map.contains(1));
+        ASSERT_TRUE(map.insert({1, 1}).expect("insert should work"));
+        ASSERT_TRUE(map.contains(1));
+    }
+}
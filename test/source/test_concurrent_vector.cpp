@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include <safe-containers/concurrent_vector.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using int_vec = safe_containers::concurrent_vector<int, std::allocator<int>, 4>;
+
+TEST(ConcurrentVector, Ctor)
+{
+    std::allocator<int> alloc{};
+    const int_vec v{alloc};
+    ASSERT_TRUE(v.empty());
+    ASSERT_EQ(v.capacity(), 0);
+}
+
+TEST(ConcurrentVector, PushBack)
+{
+    std::allocator<int> alloc{};
+    int_vec v{alloc};
+    for (int i = 0; i < 100; ++i)
+    {
+        v.push_back(i).expect("push_back should work");
+    }
+    ASSERT_EQ(v.size(), 100);
+    ASSERT_GE(v.capacity(), 100);
+    for (int i = 0; i < 100; ++i)
+    {
+        ASSERT_TRUE(v.is_ready(static_cast<size_t>(i)));
+        ASSERT_EQ(v[static_cast<size_t>(i)], i);
+    }
+    ASSERT_FALSE(v.is_ready(100));
+}
+
+TEST(ConcurrentVector, ReferencesAreStable)
+{
+    std::allocator<int> alloc{};
+    int_vec v{alloc};
+    int& first = v.emplace_back(42).expect("emplace_back should work");
+    for (int i = 0; i < 1000; ++i)
+    {
+        v.push_back(i).expect("push_back should work");
+    }
+    ASSERT_EQ(&first, &v[0]);
+    ASSERT_EQ(first, 42);
+}
+
+TEST(ConcurrentVector, Reserve)
+{
+    fault_policy policy{};
+    fault_injecting_allocator<int> alloc{policy};
+    safe_containers::concurrent_vector<int, fault_injecting_allocator<int>, 4> v{alloc};
+    v.reserve(60).expect("reserve should work");
+    ASSERT_GE(v.capacity(), 60);
+
+    const std::size_t allocations = policy.allocations.load();
+    for (int i = 0; i < 60; ++i)
+    {
+        v.push_back(i).expect("push_back should work");
+    }
+    ASSERT_EQ(policy.allocations.load(), allocations);
+}
+
+TEST(ConcurrentVector, ConcurrentPushBack)
+{
+    constexpr int threads = 4;
+    constexpr int per_thread = 10000;
+    std::allocator<int> alloc{};
+    int_vec v{alloc};
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back(
+            [&, t]()
+            {
+                for (int i = 0; i < per_thread; ++i)
+                {
+                    v.push_back(t * per_thread + i).expect("push_back should work");
+                }
+            });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    ASSERT_EQ(v.size(), threads * per_thread);
+    std::vector<bool> seen(threads * per_thread, false);
+    for (size_t i = 0; i < v.size(); ++i)
+    {
+        ASSERT_TRUE(v.is_ready(i));
+        seen[static_cast<size_t>(v[i])] = true;
+    }
+    ASSERT_EQ(std::count(seen.begin(), seen.end(), false), 0);
+}
+
+TEST(ConcurrentVector, DestroysElements)
+{
+    auto counter = std::make_shared<int>(0);
+    {
+        std::allocator<std::shared_ptr<int>> alloc{};
+        safe_containers::concurrent_vector<std::shared_ptr<int>> v{alloc};
+        v.push_back(counter).expect("push_back should work");
+        v.push_back(counter).expect("push_back should work");
+        ASSERT_EQ(counter.use_count(), 3);
+    }
+    ASSERT_EQ(counter.use_count(), 1);
+}
+
+TEST(ConcurrentVector, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<int> alloc{};
+        safe_containers::concurrent_vector<int, fail_allocator<int>> v{alloc};
+        ASSERT_TRUE(v.push_back(1).has_error());
+        ASSERT_TRUE(v.emplace_back(1).has_error());
+        ASSERT_TRUE(v.empty());
+    }
+
+    {
+        // Fail the second bucket: the failed push leaves no gap.
+        fault_policy policy{};
+        fault_injecting_allocator<int> alloc{policy};
+        safe_containers::concurrent_vector<int, fault_injecting_allocator<int>, 4> v{alloc};
+        for (int i = 0; i < 4; ++i)
+        {
+            v.push_back(i).expect("push_back should work");
+        }
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(v.push_back(4).has_error());
+        ASSERT_EQ(v.size(), 4);
+        v.push_back(4).expect("push_back should work");
+        ASSERT_EQ(v.size(), 5);
+        ASSERT_EQ(v[4], 4);
+    }
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <safe-containers/cuckoo_filter.h>
+
+#include <memory>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using cuckoo_filter = safe_containers::cuckoo_filter<int>;
+using counted_filter =
+    safe_containers::cuckoo_filter<int, std::hash<int>, fault_injecting_allocator<int>>;
+using failing_filter = safe_containers::cuckoo_filter<int, std::hash<int>, fail_allocator<int>>;
+
+TEST(CuckooFilter, InsertContainsErase)
+{
+    std::allocator<int> alloc{};
+    auto filter = cuckoo_filter::Create(10000, alloc).expect("Create should work");
+    ASSERT_GE(filter.capacity(), 10000);
+    for (int i = 0; i < 10000; ++i)
+    {
+        filter.insert(i).expect("insert should work");
+    }
+    ASSERT_EQ(filter.size(), 10000);
+    for (int i = 0; i < 10000; ++i)
+    {
+        ASSERT_TRUE(filter.contains(i));
+    }
+
+    int false_positives = 0;
+    for (int i = 10000; i < 110000; ++i)
+    {
+        false_positives += filter.contains(i) ? 1 : 0;
+    }
+    ASSERT_LT(false_positives, 100);
+
+    // Erasing the even keys keeps the odd ones.
+    for (int i = 0; i < 10000; i += 2)
+    {
+        ASSERT_TRUE(filter.erase(i));
+    }
+    ASSERT_EQ(filter.size(), 5000);
+    for (int i = 1; i < 10000; i += 2)
+    {
+        ASSERT_TRUE(filter.contains(i));
+    }
+
+    auto clone = filter.Clone().expect("Clone should work");
+    ASSERT_EQ(clone.size(), 5000);
+    filter.clear();
+    ASSERT_TRUE(filter.empty());
+    ASSERT_FALSE(filter.contains(1));
+    ASSERT_TRUE(clone.contains(1));
+}
+
+TEST(CuckooFilter, FullFilterRejectsInsertsUnchanged)
+{
+    std::allocator<int> alloc{};
+    auto filter = cuckoo_filter::Create(64, alloc).expect("Create should work");
+    std::vector<int> inserted;
+    int key = 0;
+    while (filter.insert(key).has_value())
+    {
+        inserted.push_back(key++);
+    }
+    // Fills most slots before failing, & the failed insert keeps every other key.
+    ASSERT_GT(inserted.size(), filter.capacity() * 8 / 10);
+    ASSERT_EQ(filter.size(), inserted.size());
+    for (int k : inserted)
+    {
+        ASSERT_TRUE(filter.contains(k));
+    }
+
+    std::unique_ptr<bool[]> results(new bool[inserted.size()]);
+    filter.contains(
+        safe_containers::span<const int>(inserted.data(), inserted.size()),
+        safe_containers::span<bool>(results.get(), inserted.size()));
+    for (std::size_t i = 0; i < inserted.size(); ++i)
+    {
+        ASSERT_TRUE(results[i]);
+    }
+}
+
+TEST(CuckooFilter, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<int> alloc{};
+        ASSERT_TRUE(failing_filter::Create(100, alloc).has_error());
+        failing_filter empty{alloc};
+        ASSERT_TRUE(empty.insert(1).has_error());
+        ASSERT_FALSE(empty.contains(1));
+    }
+
+    {
+        fault_policy policy{};
+        fault_injecting_allocator<int> alloc{policy};
+        auto filter = counted_filter::Create(100, alloc).expect("Create should work");
+        filter.insert(1).expect("insert should work");
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(filter.Clone().has_error());
+        ASSERT_TRUE(filter.contains(1));
+    }
+}
+
+TEST(CuckooFilter, SmallFiltersHoldTheirCapacity)
+{
+    std::allocator<int> alloc{};
+    for (int n : {1, 5, 8, 9, 17, 35})
+    {
+        auto filter = cuckoo_filter::Create(static_cast<std::size_t>(n), alloc)
+                          .expect("Create should work");
+        ASSERT_GE(filter.capacity(), static_cast<std::size_t>(n));
+        for (int i = 0; i < n; ++i)
+        {
+            filter.insert(i).expect("insert should work");
+        }
+        ASSERT_EQ(filter.size(), static_cast<std::size_t>(n));
+    }
+}
@@ -0,0 +1,223 @@
+#include <gtest/gtest.h>
+#include <safe-containers/deque.h>
+
+#include <vector>
+
+#include "fail_alloc.h"
+
+using int_deque = safe_containers::deque<int, std::allocator<int>>;
+// Small chunks, so tests cross chunk boundaries quickly.
+using small_deque = safe_containers::deque<int, std::allocator<int>, 4 * sizeof(int)>;
+using counted_deque = safe_containers::deque<int, fault_injecting_allocator<int>, 4 * sizeof(int)>;
+
+namespace
+{
+struct MoveOnly
+{
+    explicit MoveOnly(int v)
+        : value(v)
+    {
+    }
+    MoveOnly(const MoveOnly&) = delete;
+    MoveOnly& operator=(const MoveOnly&) = delete;
+    MoveOnly(MoveOnly&&) = default;
+    MoveOnly& operator=(MoveOnly&&) = default;
+    ~MoveOnly() = default;
+
+    int value;
+};
+}  // namespace
+
+TEST(SafeDeque, Ctor)
+{
+    std::allocator<int> alloc{};
+    const int_deque d{alloc};
+    ASSERT_TRUE(d.empty());
+    ASSERT_EQ(d.chunk_count(), 0);
+}
+
+TEST(SafeDeque, Create)
+{
+    std::allocator<int> alloc{};
+    {
+        auto result = int_deque::Create(3, alloc);
+        ASSERT_TRUE(result.has_value());
+        ASSERT_EQ(result.value().size(), 3);
+        ASSERT_EQ(result.value()[2], 0);
+    }
+
+    {
+        auto result = int_deque::Create(static_cast<size_t>(3), 42, alloc);
+        ASSERT_TRUE(result.has_value());
+        ASSERT_EQ(result.value().size(), 3);
+        ASSERT_EQ(result.value()[0], 42);
+    }
+
+    {
+        std::vector<int> vec{1, 2, 3};
+        auto result = int_deque::Create(vec.begin(), vec.end(), alloc);
+        ASSERT_TRUE(result.has_value());
+        ASSERT_TRUE(std::equal(vec.begin(), vec.end(), result.value().begin()));
+    }
+
+    {
+        auto result = int_deque::Create({1, 2, 3}, alloc);
+        ASSERT_TRUE(result.has_value());
+        ASSERT_EQ(result.value().front(), 1);
+        ASSERT_EQ(result.value().back(), 3);
+    }
+}
+
+TEST(SafeDeque, PushAndPopBothEnds)
+{
+    std::allocator<int> alloc{};
+    small_deque d{alloc};
+    for (int i = 0; i < 10; ++i)
+    {
+        d.push_back(i).expect("push_back should work");
+        d.push_front(-i - 1).expect("push_front should work");
+    }
+    ASSERT_EQ(d.size(), 20);
+
+    int expected = -10;
+    for (const int v : d)
+    {
+        ASSERT_EQ(v, expected++);
+    }
+    ASSERT_EQ(*d.rbegin(), 9);
+    ASSERT_EQ(d.end() - d.begin(), 20);
+
+    d.pop_front();
+    d.pop_back();
+    ASSERT_EQ(d.front(), -9);
+    ASSERT_EQ(d.back(), 8);
+    ASSERT_EQ(d.size(), 18);
+}
+
+TEST(SafeDeque, ReferencesAreStable)
+{
+    std::allocator<int> alloc{};
+    small_deque d{alloc};
+    d.push_back(1).expect("push_back should work");
+    const int& first = d.front();
+    for (int i = 0; i < 100; ++i)
+    {
+        d.push_back(i).expect("push_back should work");
+        d.push_front(i).expect("push_front should work");
+    }
+    ASSERT_EQ(first, 1);
+}
+
+TEST(SafeDeque, Emplace)
+{
+    std::allocator<MoveOnly> alloc{};
+    safe_containers::deque<MoveOnly> d{alloc};
+    ASSERT_EQ(d.emplace_back(1).value().value, 1);
+    ASSERT_EQ(d.emplace_front(0).value().value, 0);
+    d.push_back(MoveOnly(2)).expect("push_back should work");
+    ASSERT_EQ(d.size(), 3);
+    ASSERT_EQ(d[0].value, 0);
+    ASSERT_EQ(d[2].value, 2);
+}
+
+TEST(SafeDeque, SteadyStateQueueDoesNotAllocate)
+{
+    fault_policy policy{};
+    fault_injecting_allocator<int> alloc{policy};
+    counted_deque d{alloc};
+
+    // Warm up the map & spare chunk cache.
+    for (int i = 0; i < 16; ++i)
+    {
+        d.push_back(i).expect("push_back should work");
+    }
+    for (int i = 0; i < 1000; ++i)
+    {
+        d.push_back(i).expect("push_back should work");
+        d.pop_front();
+    }
+
+    const std::size_t allocations = policy.allocations.load();
+    for (int i = 0; i < 10000; ++i)
+    {
+        d.push_back(i).expect("push_back should work");
+        d.pop_front();
+    }
+    ASSERT_EQ(policy.allocations.load(), allocations);
+    ASSERT_EQ(d.size(), 16);
+}
+
+TEST(SafeDeque, SpareChunkLimit)
+{
+    std::allocator<int> alloc{};
+    small_deque d{alloc};
+    d.resize(40).expect("resize should work");
+    d.clear();
+    ASSERT_EQ(d.chunk_count(), 0);
+    ASSERT_EQ(d.spare_chunk_count(), small_deque::kDefaultMaxSpareChunks);
+
+    d.set_max_spare_chunks(1);
+    ASSERT_EQ(d.spare_chunk_count(), 1);
+    d.shrink_to_fit();
+    ASSERT_EQ(d.spare_chunk_count(), 0);
+}
+
+TEST(SafeDeque, Resize)
+{
+    std::allocator<int> alloc{};
+    small_deque d{alloc};
+    d.resize(10, 7).expect("resize should work");
+    ASSERT_EQ(d.size(), 10);
+    ASSERT_EQ(d[9], 7);
+    d.resize(2).expect("resize should work");
+    ASSERT_EQ(d.size(), 2);
+    ASSERT_EQ(d.chunk_count(), 1);
+}
+
+TEST(SafeDeque, Clone)
+{
+    std::allocator<int> alloc{};
+    auto d = int_deque::Create({1, 2, 3}, alloc);
+    ASSERT_TRUE(d.has_value());
+    const auto result = d.value().Clone();
+    ASSERT_FALSE(result.has_error());
+    ASSERT_TRUE(std::equal(d.value().begin(), d.value().end(), result.value().begin()));
+}
+
+TEST(SafeDeque, Move)
+{
+    std::allocator<int> alloc{};
+    small_deque a{alloc};
+    a.resize(10, 1).expect("resize should work");
+    small_deque b{std::move(a)};
+    ASSERT_EQ(b.size(), 10);
+    ASSERT_TRUE(a.empty());  // NOLINT(bugprone-use-after-move)
+    a = std::move(b);
+    ASSERT_EQ(a.size(), 10);
+}
+
+TEST(SafeDeque, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<int> alloc{};
+        safe_containers::deque<int, fail_allocator<int>> d{alloc};
+        ASSERT_TRUE(d.push_back(1).has_error());
+        ASSERT_TRUE(d.push_front(1).has_error());
+        ASSERT_TRUE(d.emplace_back(1).has_error());
+        ASSERT_TRUE(d.emplace_front(1).has_error());
+        ASSERT_TRUE(d.empty());
+    }
+
+    {
+        // Fail the allocation of the third chunk, after the map & first chunk.
+        fault_policy policy{};
+        policy.fail_nth = 3;
+        fault_injecting_allocator<int> alloc{policy};
+        counted_deque d{alloc};
+        d.resize(2).expect("resize should work");
+        ASSERT_TRUE(d.resize(8).has_error());
+        ASSERT_EQ(d.size(), 2);
+        d.resize(8).expect("resize should work");
+        ASSERT_EQ(d.size(), 8);
+    }
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <safe-containers/dynamic_bitset.h>
+
+#include <vector>
+
+#include "fail_alloc.h"
+
+using bitset = safe_containers::dynamic_bitset<>;
+
+TEST(DynamicBitset, PushBackAndTest)
+{
+    std::allocator<std::uint64_t> alloc{};
+    auto b = bitset::Create(alloc).expect("Create should work");
+    for (int i = 0; i < 200; ++i)
+    {
+        b.push_back(i % 3 == 0).expect("push_back should work");
+    }
+    ASSERT_EQ(b.size(), 200);
+    ASSERT_EQ(b.num_words(), 4);
+    for (std::size_t i = 0; i < 200; ++i)
+    {
+        ASSERT_EQ(b[i], i % 3 == 0);
+    }
+    ASSERT_EQ(b.count(), 67);
+
+    b.flip(1);
+    b.reset(0);
+    ASSERT_TRUE(b.test(1));
+    ASSERT_FALSE(b.test(0));
+    b.pop_back();
+    ASSERT_EQ(b.size(), 199);
+}
+
+TEST(DynamicBitset, ResizeFillsNewBits)
+{
+    std::allocator<std::uint64_t> alloc{};
+    auto b = bitset::Create(10, false, alloc).expect("Create should work");
+    b.resize(100, true).expect("resize should work");
+    ASSERT_EQ(b.count(), 90);
+    ASSERT_FALSE(b.test(9));
+    ASSERT_TRUE(b.test(10));
+
+    b.resize(70).expect("resize should work");
+    ASSERT_EQ(b.count(), 60);
+    b.set();
+    ASSERT_TRUE(b.all());
+    ASSERT_EQ(b.count(), 70);
+    b.reset();
+    ASSERT_TRUE(b.none());
+}
+
+TEST(DynamicBitset, Find)
+{
+    std::allocator<std::uint64_t> alloc{};
+    auto b = bitset::Create(1000, false, alloc).expect("Create should work");
+    ASSERT_EQ(b.find_first(), bitset::npos);
+    const std::vector<std::size_t> bits{3, 63, 64, 500, 999};
+    for (std::size_t bit : bits)
+    {
+        b.set(bit);
+    }
+    std::vector<std::size_t> found;
+    for (std::size_t i = b.find_first(); i != bitset::npos; i = b.find_next(i))
+    {
+        found.push_back(i);
+    }
+    ASSERT_EQ(found, bits);
+}
+
+TEST(DynamicBitset, BulkOperations)
+{
+    std::allocator<std::uint64_t> alloc{};
+    // Odd sizes exercise both the vector & the scalar tail loops.
+    auto a = bitset::Create(1000, false, alloc).expect("Create should work");
+    auto b = bitset::Create(1000, false, alloc).expect("Create should work");
+    for (std::size_t i = 0; i < 1000; ++i)
+    {
+        a.set(i, i % 2 == 0);
+        b.set(i, i % 3 == 0);
+    }
+
+    auto and_result = a.Clone().expect("Clone should work");
+    and_result &= b;
+    auto or_result = a.Clone().expect("Clone should work");
+    or_result |= b;
+    auto xor_result = a.Clone().expect("Clone should work");
+    xor_result ^= b;
+    auto and_not_result = a.Clone().expect("Clone should work");
+    and_not_result.and_not(b);
+    for (std::size_t i = 0; i < 1000; ++i)
+    {
+        const bool x = i % 2 == 0;
+        const bool y = i % 3 == 0;
+        ASSERT_EQ(and_result[i], x && y);
+        ASSERT_EQ(or_result[i], x || y);
+        ASSERT_EQ(xor_result[i], x != y);
+        ASSERT_EQ(and_not_result[i], x && !y);
+    }
+    ASSERT_EQ(and_result.count(), 167);
+    ASSERT_TRUE(a != b);
+    ASSERT_TRUE(a == a);
+}
+
+TEST(DynamicBitset, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<std::uint64_t> alloc{};
+        safe_containers::dynamic_bitset<fail_allocator<std::uint64_t>> b{alloc};
+        ASSERT_TRUE(b.push_back(true).has_error());
+        ASSERT_TRUE(b.resize(10).has_error());
+        ASSERT_TRUE(b.empty());
+    }
+
+    {
+        fault_policy policy{};
+        fault_injecting_allocator<std::uint64_t> alloc{policy};
+        safe_containers::dynamic_bitset<fault_injecting_allocator<std::uint64_t>> b{alloc};
+        b.resize(64, true).expect("resize should work");
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(b.push_back(true).has_error());
+        ASSERT_EQ(b.size(), 64);
+        ASSERT_EQ(b.count(), 64);
+    }
+}
@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+#include <safe-containers/epoch_reclamation.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using domain = safe_containers::epoch_domain<>;
+
+namespace
+{
+
+void CountReclaim(void*, void* context) noexcept
+{
+    static_cast<std::atomic<int>*>(context)->fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+TEST(EpochReclamation, RegisterReusesReleasedHandles)
+{
+    fault_policy policy{};
+    fault_injecting_allocator<std::byte> alloc{policy};
+    safe_containers::epoch_domain<fault_injecting_allocator<std::byte>> d{alloc};
+    {
+        auto h = d.Register().expect("Register should work");
+    }
+    const std::size_t allocations = policy.allocations.load();
+    {
+        auto h = d.Register().expect("Register should work");
+        auto other = d.Register().expect("Register should work");
+    }
+    ASSERT_EQ(policy.allocations.load(), allocations + 1);
+}
+
+TEST(EpochReclamation, PinNests)
+{
+    std::allocator<std::byte> alloc{};
+    domain d{alloc};
+    auto h = d.Register().expect("Register should work");
+    ASSERT_FALSE(h.is_pinned());
+    {
+        domain::guard outer{h};
+        {
+            domain::guard inner{h};
+            ASSERT_TRUE(h.is_pinned());
+        }
+        ASSERT_TRUE(h.is_pinned());
+    }
+    ASSERT_FALSE(h.is_pinned());
+}
+
+TEST(EpochReclamation, RetireWaitsForPinnedThreads)
+{
+    std::allocator<std::byte> alloc{};
+    domain d{alloc};
+    auto reader = d.Register().expect("Register should work");
+    auto writer = d.Register().expect("Register should work");
+    std::atomic<int> reclaimed{0};
+
+    reader.Pin();
+    writer.Retire(nullptr, CountReclaim, &reclaimed);
+    for (int i = 0; i < 10; ++i)
+    {
+        writer.Collect();
+    }
+    ASSERT_EQ(reclaimed.load(), 0);
+
+    reader.Unpin();
+    for (int i = 0; i < 3; ++i)
+    {
+        writer.Collect();
+    }
+    ASSERT_EQ(reclaimed.load(), 1);
+}
+
+TEST(EpochReclamation, RetireDeletes)
+{
+    std::allocator<std::byte> alloc{};
+    domain d{alloc};
+    auto h = d.Register().expect("Register should work");
+    auto counter = std::make_shared<int>(0);
+    h.Retire(new std::shared_ptr<int>(counter));
+    ASSERT_EQ(counter.use_count(), 2);
+    h.Synchronize();
+    h.Collect();
+    ASSERT_EQ(counter.use_count(), 1);
+}
+
+TEST(EpochReclamation, DestructorReclaimsPending)
+{
+    std::allocator<std::byte> alloc{};
+    std::atomic<int> reclaimed{0};
+    {
+        domain d{alloc};
+        auto reader = d.Register().expect("Register should work");
+        auto writer = d.Register().expect("Register should work");
+        reader.Pin();
+        for (int i = 0; i < 200; ++i)
+        {
+            writer.Retire(nullptr, CountReclaim, &reclaimed);
+        }
+        ASSERT_EQ(reclaimed.load(), 0);
+        reader.Unpin();
+    }
+    ASSERT_EQ(reclaimed.load(), 200);
+}
+
+TEST(EpochReclamation, ConcurrentReadersNeverSeeReclaimedObjects)
+{
+    struct node
+    {
+        std::atomic<bool> alive{true};
+    };
+    constexpr int nodes = 20000;
+    constexpr int readers = 3;
+
+    // Reclaiming only marks nodes, so reading a reclaimed node is detectable. The
+    // nodes must outlive the domain, which reclaims pending nodes on destruction.
+    std::vector<node> storage(nodes);
+    std::allocator<std::byte> alloc{};
+    domain d{alloc};
+    std::atomic<node*> current{&storage[0]};
+    std::atomic<bool> done{false};
+    std::atomic<int> violations{0};
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < readers; ++t)
+    {
+        workers.emplace_back(
+            [&]()
+            {
+                auto h = d.Register().expect("Register should work");
+                while (!done.load(std::memory_order_acquire))
+                {
+                    domain::guard g{h};
+                    node* n = current.load(std::memory_order_acquire);
+                    std::this_thread::yield();
+                    if (!n->alive.load(std::memory_order_relaxed))
+                    {
+                        violations.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            });
+    }
+
+    {
+        auto h = d.Register().expect("Register should work");
+        for (int i = 1; i < nodes; ++i)
+        {
+            node* old = current.exchange(&storage[static_cast<size_t>(i)]);
+            h.Retire(
+                old,
+                [](void* p, void*) noexcept
+                { static_cast<node*>(p)->alive.store(false, std::memory_order_relaxed); });
+        }
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    ASSERT_EQ(violations.load(), 0);
+}
+
+TEST(EpochReclamation, AllocationFailuresReclaimSynchronously)
+{
+    {
+        fail_allocator<std::byte> alloc{};
+        safe_containers::epoch_domain<fail_allocator<std::byte>> d{alloc};
+        ASSERT_TRUE(d.Register().has_error());
+    }
+
+    {
+        fault_policy policy{};
+        fault_injecting_allocator<std::byte> alloc{policy};
+        safe_containers::epoch_domain<fault_injecting_allocator<std::byte>> d{alloc};
+        auto h = d.Register().expect("Register should work");
+        std::atomic<int> reclaimed{0};
+
+        // The retire list can't be allocated, so every retire completes immediately.
+        policy.fail_probability = 1.0;
+        for (int i = 0; i < 3; ++i)
+        {
+            h.Retire(nullptr, CountReclaim, &reclaimed);
+            ASSERT_EQ(reclaimed.load(), i + 1);
+        }
+    }
+}
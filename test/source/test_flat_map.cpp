@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+#include <safe-containers/flat_map.h>
+
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using map = safe_containers::flat_map<int, std::string>;
+using set = safe_containers::flat_set<int>;
+
+namespace
+{
+// Forward iterator over `(i, "value i")` pairs, returned by value.
+struct pair_generator
+{
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::pair<int, std::string>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = value_type;
+
+    value_type operator*() const { return {i, "value " + std::to_string(i)}; }
+    pair_generator& operator++()
+    {
+        ++i;
+        return *this;
+    }
+    pair_generator operator++(int)
+    {
+        pair_generator tmp = *this;
+        ++i;
+        return tmp;
+    }
+    bool operator==(const pair_generator& other) const { return i == other.i; }
+    bool operator!=(const pair_generator& other) const { return i != other.i; }
+
+    int i = 0;
+};
+}  // namespace
+
+TEST(FlatMap, InsertKeepsKeysSorted)
+{
+    std::allocator<std::pair<int, std::string>> alloc{};
+    auto m = map::Create(alloc).expect("Create should work");
+    for (int key : {5, 1, 4, 2, 3})
+    {
+        auto res = m.try_emplace(key, std::to_string(key)).expect("try_emplace should work");
+        ASSERT_TRUE(res.second);
+        ASSERT_EQ(res.first->first, key);
+    }
+    ASSERT_FALSE(m.try_emplace(3, "x").expect("try_emplace should work").second);
+    ASSERT_EQ(m.find(3)->second, "3");
+
+    m.insert_or_assign(3, "three").expect("insert_or_assign should work");
+    ASSERT_EQ(m.find(3)->second, "three");
+    ASSERT_EQ(m.size(), 5);
+
+    int expected = 1;
+    for (const auto& [key, value] : m)
+    {
+        ASSERT_EQ(key, expected++);
+    }
+
+    ASSERT_EQ(m.erase(2), 1);
+    ASSERT_EQ(m.erase(2), 0);
+    ASSERT_FALSE(m.contains(2));
+    ASSERT_EQ(m.lower_bound(2)->first, 3);
+    ASSERT_EQ(m.upper_bound(3)->first, 4);
+    ASSERT_EQ(m.find(42), m.end());
+}
+
+TEST(FlatMap, CreateFromUnsortedRangeKeepsFirstOfEqualKeys)
+{
+    std::allocator<std::pair<int, std::string>> alloc{};
+    std::vector<std::pair<int, std::string>> input{{3, "a"}, {1, "b"}, {3, "c"}, {2, "d"}};
+    auto m = map::Create(input.begin(), input.end(), alloc).expect("Create should work");
+    ASSERT_EQ(m.size(), 3);
+    ASSERT_EQ(m.find(3)->second, "a");
+
+    auto clone = m.Clone().expect("Clone should work");
+    ASSERT_EQ(clone.size(), 3);
+    ASSERT_EQ(clone.begin()->second, "b");
+}
+
+TEST(FlatMap, InsertSortedRangeMergesInOneAllocation)
+{
+    fault_policy policy{};
+    using allocator = fault_injecting_allocator<std::pair<int, int>>;
+    allocator alloc{policy};
+    safe_containers::flat_map<int, int, std::less<int>, allocator> m{alloc};
+    for (int key = 0; key < 100; key += 2)
+    {
+        m.try_emplace(key, key).expect("try_emplace should work");
+    }
+
+    std::vector<std::pair<int, int>> more;
+    for (int key = 0; key < 200; key += 3)
+    {
+        more.emplace_back(key, -key);
+        more.emplace_back(key, -1);
+    }
+    const auto before = policy.allocations.load();
+    m.insert_sorted_range(more.begin(), more.end()).expect("insert_sorted_range should work");
+    ASSERT_EQ(policy.allocations.load(), before + 1);
+
+    int count = 0;
+    int previous = -1;
+    for (const auto& [key, value] : m)
+    {
+        ASSERT_GT(key, previous);
+        previous = key;
+        // Existing keys keep their value, and the first of repeated keys wins.
+        ASSERT_EQ(value, key % 2 == 0 && key < 100 ? key : -key);
+        ++count;
+    }
+    ASSERT_EQ(m.size(), count);
+    ASSERT_EQ(count, 50 + 67 - 17);
+}
+
+TEST(FlatMap, InsertSortedRangeFromSinglePassAndTemporaries)
+{
+    std::allocator<int> alloc{};
+    auto s = set::Create(alloc).expect("Create should work");
+    s.insert(3).expect("insert should work");
+    std::istringstream input("1 2 3 4 5");
+    s.insert_sorted_range(std::istream_iterator<int>(input), std::istream_iterator<int>())
+        .expect("insert_sorted_range should work");
+    ASSERT_EQ(s.size(), 5);
+    ASSERT_EQ(std::vector<int>(s.begin(), s.end()), (std::vector<int>{1, 2, 3, 4, 5}));
+
+    // Elements returned by value are kept alive while their key is compared.
+    auto m = map::Create(std::allocator<std::pair<int, std::string>>{})
+                 .expect("Create should work");
+    m.try_emplace(2, "existing").expect("try_emplace should work");
+    m.insert_sorted_range(pair_generator{0}, pair_generator{4})
+        .expect("insert_sorted_range should work");
+    ASSERT_EQ(m.size(), 4);
+    ASSERT_EQ(m.find(0)->second, "value 0");
+    ASSERT_EQ(m.find(2)->second, "existing");
+    ASSERT_EQ(m.find(3)->second, "value 3");
+}
+
+TEST(FlatSet, EytzingerIndexMatchesBinarySearch)
+{
+    std::allocator<int> alloc{};
+    for (int n : {0, 1, 2, 7, 8, 100, 1000})
+    {
+        auto s = set::Create(alloc).expect("Create should work");
+        for (int i = 0; i < n; ++i)
+        {
+            s.insert(i * 2).expect("insert should work");
+        }
+        s.build_index().expect("build_index should work");
+        ASSERT_TRUE(s.has_index());
+        for (int key = -1; key <= 2 * n; ++key)
+        {
+            const auto it = s.find(key);
+            if (key >= 0 && key % 2 == 0 && key < 2 * n)
+            {
+                ASSERT_NE(it, s.end());
+                ASSERT_EQ(*it, key);
+            }
+            else
+            {
+                ASSERT_EQ(it, s.end());
+            }
+        }
+
+        s.insert(-5).expect("insert should work");
+        ASSERT_FALSE(s.has_index());
+        ASSERT_EQ(*s.find(-5), -5);
+    }
+}
+
+TEST(FlatMap, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<std::pair<int, int>> alloc{};
+        safe_containers::flat_map<int, int, std::less<int>, fail_allocator<std::pair<int, int>>> m{
+            alloc};
+        ASSERT_TRUE(m.try_emplace(1, 1).has_error());
+        std::vector<std::pair<int, int>> input{{1, 1}, {2, 2}};
+        ASSERT_TRUE(m.insert_sorted_range(input.begin(), input.end()).has_error());
+        ASSERT_TRUE(m.empty());
+    }
+
+    {
+        fault_policy policy{};
+        fault_injecting_allocator<int> alloc{policy};
+        safe_containers::flat_set<int, std::less<int>, fault_injecting_allocator<int>> s{alloc};
+        s.insert(1).expect("insert should work");
+        s.insert(3).expect("insert should work");
+
+        std::vector<int> input{0, 2, 4};
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(s.insert_sorted_range(input.begin(), input.end()).has_error());
+        ASSERT_EQ(s.size(), 2);
+        ASSERT_EQ(*s.begin(), 1);
+
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(s.build_index().has_error());
+        ASSERT_FALSE(s.has_index());
+        ASSERT_TRUE(s.contains(3));
+    }
+}
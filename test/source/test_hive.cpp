@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <safe-containers/hive.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fail_alloc.h"
+
+namespace
+{
+
+template <typename Hive>
+std::vector<int> Sorted(const Hive& h)
+{
+    std::vector<int> values(h.begin(), h.end());
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+}  // namespace
+
+TEST(Hive, ElementsNeverMove)
+{
+    std::allocator<std::string> alloc{};
+    auto h = safe_containers::hive<std::string>::Create(alloc).expect("Create should work");
+    std::vector<std::string*> pointers;
+    for (int i = 0; i < 100; ++i)
+    {
+        pointers.push_back(&*h.insert(std::to_string(i)).expect("insert should work"));
+    }
+    ASSERT_EQ(h.size(), 100);
+    ASSERT_GE(h.capacity(), 100);
+
+    // Erase every odd element, then insert more, which reuses the erased slots.
+    for (auto it = h.begin(); it != h.end();)
+    {
+        it = std::stoi(*it) % 2 == 1 ? h.erase(it) : std::next(it);
+    }
+    ASSERT_EQ(h.size(), 50);
+    for (int i = 100; i < 200; ++i)
+    {
+        h.insert(std::to_string(i)).expect("insert should work");
+    }
+    for (std::size_t i = 0; i < 100; i += 2)
+    {
+        ASSERT_EQ(*pointers[i], std::to_string(i));
+    }
+    ASSERT_EQ(std::distance(h.begin(), h.end()), 150);
+
+    auto clone = h.Clone().expect("Clone should work");
+    ASSERT_EQ(clone.size(), h.size());
+    ASSERT_TRUE(std::is_permutation(h.begin(), h.end(), clone.begin()));
+
+    h.clear();
+    ASSERT_TRUE(h.empty());
+    ASSERT_EQ(h.begin(), h.end());
+    ASSERT_EQ(h.capacity(), 0);
+}
+
+TEST(Hive, IterationSkipsErasedRuns)
+{
+    std::allocator<int> alloc{};
+    auto h = safe_containers::hive<int>::Create(1000, alloc).expect("Create should work");
+    const auto capacity = h.capacity();
+    std::vector<int> expected;
+    std::vector<safe_containers::hive<int>::iterator> live;
+    std::mt19937 rng(11);
+    for (int i = 0; i < 20000; ++i)
+    {
+        if (!live.empty() && rng() % 5 < 2)
+        {
+            // Erasing keeps iterators to other elements valid.
+            const std::size_t pos = rng() % live.size();
+            expected.erase(std::find(expected.begin(), expected.end(), *live[pos]));
+            h.erase(live[pos]);
+            live[pos] = live.back();
+            live.pop_back();
+        }
+        else if (h.size() < 1000)
+        {
+            live.push_back(h.insert(i).expect("insert should work"));
+            expected.push_back(i);
+        }
+    }
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(Sorted(h), expected);
+    // Erased slots are always reused before growing.
+    ASSERT_EQ(h.capacity(), capacity);
+
+    // Erase whole runs through the returned iterators.
+    auto it = h.begin();
+    while (it != h.end())
+    {
+        it = h.erase(it);
+    }
+    ASSERT_TRUE(h.empty());
+    ASSERT_EQ(h.capacity(), capacity);
+    h.trim_capacity();
+    ASSERT_EQ(h.capacity(), 0);
+}
+
+TEST(Hive, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<int> alloc{};
+        safe_containers::hive<int, fail_allocator<int>> h{alloc};
+        ASSERT_TRUE(h.insert(1).has_error());
+        ASSERT_TRUE(h.reserve(10).has_error());
+        ASSERT_TRUE(h.empty());
+    }
+
+    {
+        fault_policy policy{};
+        fault_injecting_allocator<int> alloc{policy};
+        safe_containers::hive<int, fault_injecting_allocator<int>> h{alloc};
+        std::vector<int*> pointers;
+        for (int i = 0; i < 8; ++i)
+        {
+            pointers.push_back(&*h.insert(i).expect("insert should work"));
+        }
+
+        // The first block is full, so the next insert allocates a new one.
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(h.insert(8).has_error());
+        ASSERT_EQ(h.size(), 8);
+        ASSERT_EQ(h.capacity(), 8);
+
+        // Erased slots don't need a new block.
+        h.erase(h.begin());
+        policy.fail_nth = policy.allocations.load() + 1;
+        h.insert(8).expect("insert should work");
+
+        policy.fail_nth = 0;
+        h.insert(9).expect("insert should work");
+        for (int i = 1; i < 8; ++i)
+        {
+            ASSERT_EQ(*pointers[static_cast<std::size_t>(i)], i);
+        }
+        ASSERT_EQ(Sorted(h), (std::vector<int>{1, 2, 3, 4, 5, 6, 7, 8, 9}));
+    }
+}
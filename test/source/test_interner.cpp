@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include <safe-containers/interner.h>
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using interner = safe_containers::string_interner<>;
+
+TEST(StringInterner, DeduplicatesStrings)
+{
+    std::allocator<char> alloc{};
+    auto strings = interner::Create(alloc).expect("Create should work");
+
+    const auto a = strings.intern("cpu.usage").expect("intern should work");
+    const auto b = strings.intern("mem.usage").expect("intern should work");
+    std::string copy = "cpu.usage";
+    const auto c = strings.intern(copy).expect("intern should work");
+    ASSERT_EQ(a, c);
+    ASSERT_NE(a, b);
+    ASSERT_EQ(a.id(), 0);
+    ASSERT_EQ(b.id(), 1);
+    ASSERT_EQ(strings.size(), 2);
+
+    // Interned strings don't alias the caller's buffer.
+    copy[0] = 'x';
+    ASSERT_EQ(strings[a], "cpu.usage");
+    ASSERT_EQ(strings.view(b), "mem.usage");
+    ASSERT_EQ(strings.find("mem.usage"), b);
+    ASSERT_FALSE(strings.find("disk.usage").has_value());
+
+    const auto empty = strings.intern("").expect("intern should work");
+    ASSERT_EQ(strings[empty], "");
+    ASSERT_EQ(strings.intern("").expect("intern should work"), empty);
+
+    std::unordered_set<safe_containers::symbol> symbols{a, b, c};
+    ASSERT_EQ(symbols.size(), 2);
+}
+
+TEST(StringInterner, ViewsStayValidAcrossChunks)
+{
+    std::allocator<char> alloc{};
+    auto strings = interner::Create(256, 0, alloc).expect("Create should work");
+    std::vector<std::string_view> views;
+    for (int i = 0; i < 1000; ++i)
+    {
+        const auto sym = strings.intern("label_" + std::to_string(i)).expect("intern works");
+        views.push_back(strings[sym]);
+    }
+    // Large strings get chunks of their own.
+    const std::string large(1000, 'L');
+    const auto big = strings.intern(large).expect("intern should work");
+    ASSERT_EQ(strings[big], large);
+    strings.intern("after_large").expect("intern should work");
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        ASSERT_EQ(views[static_cast<std::size_t>(i)], "label_" + std::to_string(i));
+        ASSERT_EQ(strings.find(views[static_cast<std::size_t>(i)])->id(), i);
+    }
+    ASSERT_GT(strings.memory_usage(), 1000 * 9);
+
+    auto clone = strings.Clone().expect("Clone should work");
+    ASSERT_EQ(clone.size(), strings.size());
+    ASSERT_EQ(clone.find("label_42")->id(), 42);
+    const safe_containers::symbol sym(42);
+    ASSERT_EQ(clone[sym], strings[sym]);
+    ASSERT_NE(clone[sym].data(), strings[sym].data());
+
+    strings.clear();
+    ASSERT_TRUE(strings.empty());
+    ASSERT_EQ(strings.intern("fresh").expect("intern should work").id(), 0);
+}
+
+TEST(StringInterner, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<char> alloc{};
+        safe_containers::string_interner<fail_allocator<char>> strings{alloc};
+        ASSERT_TRUE(strings.intern("anything").has_error());
+        ASSERT_TRUE(strings.empty());
+    }
+
+    {
+        fault_policy policy{};
+        fault_injecting_allocator<char> alloc{policy};
+        safe_containers::string_interner<fault_injecting_allocator<char>> strings{alloc, 64};
+        strings.intern("first").expect("intern should work");
+
+        // Fail each allocation of a new string in turn, which must leave it absent.
+        for (std::size_t nth = 1; nth <= 8; ++nth)
+        {
+            policy.fail_nth = policy.allocations.load() + nth;
+            const std::string str(nth * 10, 'a');
+            auto res = strings.intern(str);
+            if (res.has_error())
+            {
+                ASSERT_FALSE(strings.contains(str));
+            }
+            else
+            {
+                ASSERT_EQ(strings[res.value()], str);
+            }
+        }
+        policy.fail_nth = 0;
+        ASSERT_EQ(strings[strings.intern("first").expect("intern should work")], "first");
+        ASSERT_EQ(strings[strings.intern("second").expect("intern should work")], "second");
+    }
+}
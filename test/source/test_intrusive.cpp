@@ -0,0 +1,296 @@
+#include <gtest/gtest.h>
+#include <safe-containers/intrusive.h>
+#include <safe-containers/vector.h>
+
+#include <functional>
+#include <vector>
+
+#include "fail_alloc.h"
+
+namespace
+{
+
+struct by_id;
+
+// Linked in a list, an slist & a hash table at once.
+struct item : safe_containers::list_hook<>,
+              safe_containers::list_hook<by_id>,
+              safe_containers::slist_hook<>,
+              safe_containers::hash_hook<>
+{
+    explicit item(int v)
+        : id(v)
+    {
+    }
+
+    int id;
+};
+
+struct item_id
+{
+    const int& operator()(const item& i) const noexcept { return i.id; }
+};
+
+using item_list = safe_containers::intrusive_list<item>;
+using item_slist = safe_containers::intrusive_slist<item>;
+using item_table = safe_containers::intrusive_hash_table<item, int, item_id>;
+
+std::vector<int> Ids(const item_list& list)
+{
+    std::vector<int> ids;
+    for (const item& i : list)
+    {
+        ids.push_back(i.id);
+    }
+    return ids;
+}
+
+std::vector<int> Ids(const item_slist& list)
+{
+    std::vector<int> ids;
+    for (const item& i : list)
+    {
+        ids.push_back(i.id);
+    }
+    return ids;
+}
+
+}  // namespace
+
+TEST(IntrusiveList, LinkAndUnlink)
+{
+    item a(1), b(2), c(3), d(4);
+    item_list list;
+    ASSERT_TRUE(list.empty());
+    list.push_back(b);
+    list.push_back(c);
+    list.push_front(a);
+    list.insert(list.iterator_to(c), d);
+    ASSERT_EQ(Ids(list), (std::vector<int>{1, 2, 4, 3}));
+    ASSERT_EQ(list.size(), 4);
+    ASSERT_EQ(list.front().id, 1);
+    ASSERT_EQ(list.back().id, 3);
+    ASSERT_TRUE(static_cast<safe_containers::list_hook<>&>(d).is_linked());
+
+    // Unlinking through a reference is O(1).
+    list.remove(d);
+    ASSERT_FALSE(static_cast<safe_containers::list_hook<>&>(d).is_linked());
+    auto it = list.erase(list.begin());
+    ASSERT_EQ(it->id, 2);
+    list.pop_back();
+    ASSERT_EQ(Ids(list), (std::vector<int>{2}));
+
+    std::vector<int> reversed;
+    list.push_back(a);
+    list.push_back(c);
+    for (auto r = list.end(); r != list.begin();)
+    {
+        reversed.push_back((--r)->id);
+    }
+    ASSERT_EQ(reversed, (std::vector<int>{3, 1, 2}));
+
+    list.clear();
+    ASSERT_TRUE(list.empty());
+    ASSERT_FALSE(static_cast<safe_containers::list_hook<>&>(a).is_linked());
+}
+
+TEST(IntrusiveList, SpliceMoveAndSwap)
+{
+    item a(1), b(2), c(3), d(4);
+    item_list first;
+    item_list second;
+    first.push_back(a);
+    first.push_back(d);
+    second.push_back(b);
+    second.push_back(c);
+    first.splice(first.iterator_to(d), second);
+    ASSERT_EQ(Ids(first), (std::vector<int>{1, 2, 3, 4}));
+    ASSERT_TRUE(second.empty());
+
+    // Moving fixes up the links to the sentinel.
+    item_list moved(std::move(first));
+    ASSERT_TRUE(first.empty());
+    ASSERT_EQ(Ids(moved), (std::vector<int>{1, 2, 3, 4}));
+    moved.pop_front();
+    moved.pop_back();
+    ASSERT_EQ(Ids(moved), (std::vector<int>{2, 3}));
+
+    second.push_back(a);
+    moved.swap(second);
+    ASSERT_EQ(Ids(moved), (std::vector<int>{1}));
+    ASSERT_EQ(Ids(second), (std::vector<int>{2, 3}));
+    second = std::move(moved);
+    ASSERT_EQ(Ids(second), (std::vector<int>{1}));
+    ASSERT_FALSE(static_cast<safe_containers::list_hook<>&>(b).is_linked());
+}
+
+TEST(IntrusiveList, ObjectsCanBeInSeveralContainers)
+{
+    item a(1), b(2);
+    item_list list;
+    safe_containers::intrusive_list<item, by_id> other;
+    item_slist slist;
+    list.push_back(a);
+    list.push_back(b);
+    other.push_back(b);
+    other.push_back(a);
+    slist.push_back(b);
+    ASSERT_EQ(Ids(list), (std::vector<int>{1, 2}));
+    ASSERT_EQ(other.front().id, 2);
+    ASSERT_EQ(slist.front().id, 2);
+
+    // Copies are unlinked.
+    item copy = a;
+    ASSERT_FALSE(static_cast<safe_containers::list_hook<>&>(copy).is_linked());
+    list.push_back(copy);
+    ASSERT_EQ(Ids(list), (std::vector<int>{1, 2, 1}));
+    list.remove(copy);
+}
+
+TEST(IntrusiveSlist, LinkAndUnlink)
+{
+    item a(1), b(2), c(3), d(4);
+    item_slist list;
+    list.push_back(b);
+    list.push_front(a);
+    list.push_back(d);
+    list.insert_after(list.iterator_to(b), c);
+    ASSERT_EQ(Ids(list), (std::vector<int>{1, 2, 3, 4}));
+    ASSERT_EQ(list.size(), 4);
+    ASSERT_EQ(list.back().id, 4);
+
+    // Erasing the last object moves the tail back.
+    auto it = list.erase_after(list.iterator_to(c));
+    ASSERT_TRUE(it == list.end());
+    ASSERT_EQ(list.back().id, 3);
+    list.push_back(d);
+    ASSERT_EQ(Ids(list), (std::vector<int>{1, 2, 3, 4}));
+
+    list.pop_front();
+    list.pop_front();
+    ASSERT_EQ(list.front().id, 3);
+
+    item_slist moved(std::move(list));
+    ASSERT_TRUE(list.empty());
+    ASSERT_EQ(Ids(moved), (std::vector<int>{3, 4}));
+    moved.pop_front();
+    moved.pop_front();
+    ASSERT_TRUE(moved.empty());
+    moved.push_back(a);
+    ASSERT_EQ(moved.front().id, 1);
+    ASSERT_EQ(moved.back().id, 1);
+}
+
+TEST(IntrusiveHashTable, InsertFindErase)
+{
+    std::vector<item> items;
+    for (int i = 0; i < 100; ++i)
+    {
+        items.emplace_back(i);
+    }
+    std::vector<item_table::bucket_type> buckets(16);
+    item_table table({buckets.data(), buckets.size()});
+    for (item& i : items)
+    {
+        ASSERT_TRUE(table.insert(i).second);
+    }
+    ASSERT_EQ(table.size(), 100);
+    ASSERT_EQ(table.bucket_count(), 16);
+
+    // Keys are unique.
+    item duplicate(42);
+    auto [existing, inserted] = table.insert(duplicate);
+    ASSERT_FALSE(inserted);
+    ASSERT_EQ(&*existing, &items[42]);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        ASSERT_EQ(&*table.find(i), &items[static_cast<std::size_t>(i)]);
+    }
+    ASSERT_FALSE(table.contains(100));
+
+    ASSERT_EQ(table.erase(7), 1);
+    ASSERT_EQ(table.erase(7), 0);
+    table.remove(items[8]);
+    ASSERT_FALSE(table.contains(7));
+    ASSERT_FALSE(table.contains(8));
+    ASSERT_EQ(table.size(), 98);
+
+    int sum = 0;
+    std::size_t count = 0;
+    for (const item& i : table)
+    {
+        sum += i.id;
+        ++count;
+    }
+    ASSERT_EQ(count, 98);
+    ASSERT_EQ(sum, 99 * 100 / 2 - 7 - 8);
+
+    table.clear();
+    ASSERT_TRUE(table.empty());
+    ASSERT_TRUE(table.begin() == table.end());
+    ASSERT_TRUE(table.insert(items[7]).second);
+}
+
+TEST(IntrusiveHashTable, Rehash)
+{
+    std::vector<item> items;
+    for (int i = 0; i < 64; ++i)
+    {
+        items.emplace_back(i * 7);
+    }
+    std::vector<item_table::bucket_type> small(4);
+    std::vector<item_table::bucket_type> large(128);
+    item_table table({small.data(), small.size()});
+    for (item& i : items)
+    {
+        table.insert(i);
+    }
+    auto previous = table.rehash({large.data(), large.size()});
+    ASSERT_EQ(previous.data(), small.data());
+    ASSERT_EQ(table.bucket_count(), 128);
+    ASSERT_EQ(table.size(), 64);
+    for (int i = 0; i < 64; ++i)
+    {
+        ASSERT_TRUE(table.contains(i * 7));
+    }
+    ASSERT_FALSE(table.contains(1));
+    ASSERT_EQ(std::distance(table.begin(), table.end()), 64);
+}
+
+TEST(Intrusive, LinkingNeverAllocates)
+{
+    using bucket_allocator = fault_injecting_allocator<item_table::bucket_type>;
+
+    // The buckets are the only allocation, made by the caller.
+    fault_policy policy{};
+    bucket_allocator alloc{policy};
+    safe_containers::vector<item_table::bucket_type, bucket_allocator> buckets(alloc);
+    buckets.resize(64).expect("resize should work");
+
+    // Linking & unlinking never allocates.
+    std::vector<item> items;
+    for (int i = 0; i < 1000; ++i)
+    {
+        items.emplace_back(i);
+    }
+    const auto allocations = policy.allocations.load();
+    item_table table({buckets.data(), buckets.size()});
+    item_list list;
+    item_slist slist;
+    for (item& i : items)
+    {
+        table.insert(i);
+        list.push_back(i);
+        slist.push_front(i);
+    }
+    for (int i = 0; i < 1000; i += 2)
+    {
+        table.erase(i);
+        list.remove(items[static_cast<std::size_t>(i)]);
+    }
+    ASSERT_EQ(policy.allocations.load(), allocations);
+    ASSERT_EQ(table.size(), 500);
+    ASSERT_EQ(list.size(), 500);
+    ASSERT_EQ(slist.size(), 1000);
+}
@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+#include <safe-containers/lru_cache.h>
+
+#include <list>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using cache = safe_containers::lru_cache<int, std::string>;
+using counted_cache = safe_containers::lru_cache<
+    int,
+    int,
+    std::hash<int>,
+    std::equal_to<int>,
+    fault_injecting_allocator<std::pair<int, int>>>;
+
+namespace
+{
+
+template <typename Cache>
+std::vector<int> Keys(const Cache& c)
+{
+    std::vector<int> keys;
+    for (const auto& entry : c)
+    {
+        keys.push_back(entry.first);
+    }
+    return keys;
+}
+
+}  // namespace
+
+TEST(LruCache, EvictsLeastRecentlyUsed)
+{
+    std::allocator<std::pair<int, std::string>> alloc{};
+    auto c = cache::Create(3, alloc).expect("Create should work");
+    ASSERT_TRUE(cache::Create(0, alloc).has_error());
+
+    c.try_emplace(1, "one").expect("try_emplace should work");
+    c.try_emplace(2, "two").expect("try_emplace should work");
+    c.try_emplace(3, "three").expect("try_emplace should work");
+    ASSERT_EQ(Keys(c), (std::vector<int>{3, 2, 1}));
+    ASSERT_EQ(c.lru().first, 1);
+
+    // Reading promotes, peeking doesn't.
+    ASSERT_EQ(*c.get(1), "one");
+    ASSERT_EQ(*c.peek(2), "two");
+    ASSERT_EQ(Keys(c), (std::vector<int>{1, 3, 2}));
+
+    const auto inserted = c.try_emplace(4, "four").expect("try_emplace should work");
+    ASSERT_TRUE(inserted.second);
+    ASSERT_EQ(inserted.first->second, "four");
+    ASSERT_FALSE(c.contains(2));
+    ASSERT_EQ(c.get(2), nullptr);
+    ASSERT_EQ(c.size(), 3);
+
+    const auto existing = c.insert_or_assign(3, "THREE").expect("insert_or_assign works");
+    ASSERT_FALSE(existing.second);
+    ASSERT_EQ(Keys(c), (std::vector<int>{3, 4, 1}));
+    ASSERT_EQ(*c.peek(3), "THREE");
+
+    ASSERT_EQ(c.erase(4), 1);
+    ASSERT_EQ(c.erase(4), 0);
+    c.try_emplace(5, "five").expect("try_emplace should work");
+    ASSERT_EQ(Keys(c), (std::vector<int>{5, 3, 1}));
+
+    auto clone = c.Clone().expect("Clone should work");
+    ASSERT_EQ(Keys(clone), Keys(c));
+
+    c.clear();
+    ASSERT_TRUE(c.empty());
+    ASSERT_EQ(c.begin(), c.end());
+    ASSERT_EQ(Keys(clone), (std::vector<int>{5, 3, 1}));
+}
+
+TEST(LruCache, EvictionMayCopyTheEvictedEntry)
+{
+    std::allocator<std::pair<int, std::string>> alloc{};
+    auto c = cache::Create(2, alloc).expect("Create should work");
+    const std::string value(64, 'x');
+    c.try_emplace(1, value).expect("try_emplace should work");
+    c.try_emplace(2, "two").expect("try_emplace should work");
+
+    // The value refers to the entry evicted to make room for it.
+    c.try_emplace(3, *c.peek(c.lru().first)).expect("try_emplace should work");
+    ASSERT_FALSE(c.contains(1));
+    ASSERT_EQ(*c.peek(3), value);
+    c.insert_or_assign(4, c.lru().second).expect("insert_or_assign should work");
+    ASSERT_FALSE(c.contains(2));
+    ASSERT_EQ(*c.peek(4), "two");
+    ASSERT_EQ(Keys(c), (std::vector<int>{4, 3}));
+}
+
+TEST(LruCache, MovedFromCacheRejectsInserts)
+{
+    std::allocator<std::pair<int, std::string>> alloc{};
+    auto c = cache::Create(2, alloc).expect("Create should work");
+    c.try_emplace(1, "one").expect("try_emplace should work");
+    cache moved(std::move(c));
+    ASSERT_EQ(*moved.peek(1), "one");
+
+    ASSERT_EQ(c.capacity(), 0);
+    ASSERT_TRUE(c.try_emplace(2, "two").has_error());
+    ASSERT_TRUE(c.insert_or_assign(2, "two").has_error());
+    ASSERT_TRUE(c.empty());
+    ASSERT_EQ(c.get(2), nullptr);
+}
+
+TEST(LruCache, MatchesReferenceUnderChurn)
+{
+    std::allocator<std::pair<int, int>> alloc{};
+    auto c = safe_containers::lru_cache<int, int>::Create(100, alloc).expect("Create works");
+    // Reference LRU: a list of keys, most recent first.
+    std::list<int> order;
+    std::unordered_map<int, std::pair<int, std::list<int>::iterator>> reference;
+    std::mt19937 rng(3);
+    for (int i = 0; i < 100000; ++i)
+    {
+        const int key = static_cast<int>(rng() % 300);
+        const auto found = reference.find(key);
+        switch (rng() % 4)
+        {
+            case 0:
+                ASSERT_EQ(c.erase(key), found != reference.end() ? 1 : 0);
+                if (found != reference.end())
+                {
+                    order.erase(found->second.second);
+                    reference.erase(found);
+                }
+                break;
+            case 1:
+            {
+                const int* value = c.get(key);
+                ASSERT_EQ(value != nullptr, found != reference.end());
+                if (found != reference.end())
+                {
+                    ASSERT_EQ(*value, found->second.first);
+                    order.splice(order.begin(), order, found->second.second);
+                }
+                break;
+            }
+            default:
+                c.insert_or_assign(key, i).expect("insert_or_assign should work");
+                if (found != reference.end())
+                {
+                    found->second.first = i;
+                    order.splice(order.begin(), order, found->second.second);
+                    break;
+                }
+                if (reference.size() == 100)
+                {
+                    reference.erase(order.back());
+                    order.pop_back();
+                }
+                order.push_front(key);
+                reference.emplace(key, std::make_pair(i, order.begin()));
+        }
+        ASSERT_EQ(c.size(), reference.size());
+    }
+    ASSERT_EQ(Keys(c), std::vector<int>(order.begin(), order.end()));
+}
+
+TEST(LruCache, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<std::pair<int, int>> alloc{};
+        ASSERT_TRUE((safe_containers::lru_cache<
+                         int,
+                         int,
+                         std::hash<int>,
+                         std::equal_to<int>,
+                         fail_allocator<std::pair<int, int>>>::Create(8, alloc)
+                         .has_error()));
+    }
+
+    {
+        // Storage is allocated up front, so filling & churning never allocates.
+        fault_policy policy{};
+        fault_injecting_allocator<std::pair<int, int>> alloc{policy};
+        auto c = counted_cache::Create(16, alloc).expect("Create should work");
+        const auto allocations = policy.allocations.load();
+        for (int i = 0; i < 1000; ++i)
+        {
+            c.insert_or_assign(i, i).expect("insert_or_assign should work");
+        }
+        ASSERT_EQ(policy.allocations.load(), allocations);
+        ASSERT_EQ(*c.peek(999), 999);
+
+        for (std::size_t nth = 1; nth <= 3; ++nth)
+        {
+            policy.fail_nth = policy.allocations.load() + nth;
+            ASSERT_TRUE(c.Clone().has_error());
+        }
+    }
+}
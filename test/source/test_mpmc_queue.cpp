@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <safe-containers/mpmc_queue.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using int_queue = safe_containers::mpmc_queue<int, std::allocator<int>>;
+
+TEST(MpmcQueue, Create)
+{
+    std::allocator<int> alloc{};
+    {
+        auto result = int_queue::Create(5, alloc);
+        ASSERT_TRUE(result.has_value());
+        ASSERT_EQ(result.value().capacity(), 8);
+        ASSERT_TRUE(result.value().empty());
+    }
+
+    {
+        auto result = int_queue::Create(1, alloc);
+        ASSERT_TRUE(result.has_value());
+        ASSERT_EQ(result.value().capacity(), 2);
+    }
+}
+
+TEST(MpmcQueue, PushPop)
+{
+    std::allocator<int> alloc{};
+    auto queue = int_queue::Create(4, alloc).expect("Create should work");
+    int value = -1;
+    ASSERT_FALSE(queue.try_pop(value));
+
+    // Go around the ring a few times.
+    for (int lap = 0; lap < 3; ++lap)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            ASSERT_TRUE(queue.try_push(i));
+        }
+        ASSERT_FALSE(queue.try_push(4));
+        ASSERT_EQ(queue.size(), 4);
+        for (int i = 0; i < 4; ++i)
+        {
+            ASSERT_TRUE(queue.try_pop(value));
+            ASSERT_EQ(value, i);
+        }
+        ASSERT_FALSE(queue.try_pop(value));
+    }
+}
+
+TEST(MpmcQueue, DestroysRemainingElements)
+{
+    auto counter = std::make_shared<int>(0);
+    {
+        std::allocator<std::shared_ptr<int>> alloc{};
+        auto queue = safe_containers::mpmc_queue<std::shared_ptr<int>>::Create(4, alloc).expect(
+            "Create should work");
+        ASSERT_TRUE(queue.try_push(counter));
+        ASSERT_TRUE(queue.try_emplace(counter));
+        ASSERT_EQ(counter.use_count(), 3);
+    }
+    ASSERT_EQ(counter.use_count(), 1);
+}
+
+TEST(MpmcQueue, MultipleProducersAndConsumers)
+{
+    constexpr int threads = 4;
+    constexpr int per_thread = 20000;
+    std::allocator<int> alloc{};
+    auto queue = int_queue::Create(64, alloc).expect("Create should work");
+
+    std::atomic<long> sum{0};
+    std::atomic<int> popped{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back(
+            [&, t]()
+            {
+                for (int i = 0; i < per_thread;)
+                {
+                    if (queue.try_push(t * per_thread + i))
+                    {
+                        ++i;
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        workers.emplace_back(
+            [&]()
+            {
+                int value = 0;
+                while (popped.load() < threads * per_thread)
+                {
+                    if (queue.try_pop(value))
+                    {
+                        sum += value;
+                        ++popped;
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    constexpr long n = threads * per_thread;
+    ASSERT_EQ(popped.load(), n);
+    ASSERT_EQ(sum.load(), n * (n - 1) / 2);
+    ASSERT_TRUE(queue.empty());
+}
+
+TEST(MpmcQueue, AllocationFailuresReturnError)
+{
+    fail_allocator<int> alloc{};
+    const auto result = safe_containers::mpmc_queue<int, fail_allocator<int>>::Create(4, alloc);
+    ASSERT_TRUE(result.has_error());
+}
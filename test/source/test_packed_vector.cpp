@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include <safe-containers/packed_vector.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using packed13 = safe_containers::packed_vector<13>;
+using compressed = safe_containers::compressed_vector<>;
+
+TEST(PackedVector, PushBackAndRead)
+{
+    std::allocator<std::uint64_t> alloc{};
+    auto v = packed13::Create(alloc).expect("Create should work");
+    for (std::uint64_t i = 0; i < 1000; ++i)
+    {
+        v.push_back(i * 7 % 8192).expect("push_back should work");
+    }
+    ASSERT_EQ(v.size(), 1000);
+    for (std::uint64_t i = 0; i < 1000; ++i)
+    {
+        ASSERT_EQ(v[i], i * 7 % 8192);
+    }
+    // 13 bits per value instead of 64.
+    ASSERT_LE(v.memory_usage(), 1000 * 13 / 8 * 2);
+
+    v.set(500, packed13::kMaxValue);
+    ASSERT_EQ(v[499], 499 * 7 % 8192);
+    ASSERT_EQ(v[500], packed13::kMaxValue);
+    ASSERT_EQ(v[501], 501 * 7 % 8192);
+}
+
+TEST(PackedVector, ResizeZeroesNewValues)
+{
+    std::allocator<std::uint64_t> alloc{};
+    auto v = packed13::Create(10, alloc).expect("Create should work");
+    for (std::size_t i = 0; i < 10; ++i)
+    {
+        v.set(i, packed13::kMaxValue);
+    }
+    v.resize(3).expect("resize should work");
+    v.resize(10).expect("resize should work");
+    ASSERT_EQ(v[2], packed13::kMaxValue);
+    for (std::size_t i = 3; i < 10; ++i)
+    {
+        ASSERT_EQ(v[i], 0);
+    }
+    v.pop_back();
+    v.push_back(0).expect("push_back should work");
+    ASSERT_EQ(v[9], 0);
+}
+
+TEST(PackedVector, Decode)
+{
+    std::allocator<std::uint64_t> alloc{};
+    safe_containers::packed_vector<64> wide{alloc};
+    packed13 v{alloc};
+    for (std::uint64_t i = 0; i < 300; ++i)
+    {
+        v.push_back(i).expect("push_back should work");
+        wide.push_back(~i).expect("push_back should work");
+    }
+    auto clone = v.Clone().expect("Clone should work");
+
+    std::vector<std::uint64_t> out(300);
+    wide.decode(0, 300, out.data());
+    ASSERT_EQ(out[299], ~std::uint64_t{299});
+    clone.decode(5, 290, out.data());
+    for (std::size_t i = 0; i < 290; ++i)
+    {
+        ASSERT_EQ(out[i], i + 5);
+    }
+}
+
+TEST(CompressedVector, PushBackReadAndDecode)
+{
+    std::allocator<std::uint64_t> alloc{};
+    auto v = compressed::Create(alloc).expect("Create should work");
+    // Timestamps: large, but close to their neighbours.
+    const std::uint64_t base = 1'700'000'000'000;
+    for (std::uint64_t i = 0; i < 10000; ++i)
+    {
+        v.push_back(base + i * 3 + i % 5).expect("push_back should work");
+    }
+    ASSERT_EQ(v.size(), 10000);
+    for (std::uint64_t i = 0; i < 10000; ++i)
+    {
+        ASSERT_EQ(v[i], base + i * 3 + i % 5);
+    }
+    ASSERT_LT(v.memory_usage(), 10000 * sizeof(std::uint64_t) / 3);
+
+    std::vector<std::uint64_t> out(10000);
+    v.decode(0, 10000, out.data());
+    for (std::uint64_t i = 0; i < 10000; ++i)
+    {
+        ASSERT_EQ(out[i], base + i * 3 + i % 5);
+    }
+    v.decode(77, 500, out.data());
+    for (std::uint64_t i = 0; i < 500; ++i)
+    {
+        ASSERT_EQ(out[i], v[i + 77]);
+    }
+}
+
+TEST(CompressedVector, ResizeAndPopBack)
+{
+    std::allocator<std::uint64_t> alloc{};
+    std::vector<std::uint64_t> values{5, 9, 1 << 20, 3};
+    auto v = compressed::Create(values.begin(), values.end(), alloc).expect("Create should work");
+    v.resize(300).expect("resize should work");
+    ASSERT_EQ(v[2], 1 << 20);
+    ASSERT_EQ(v[299], 0);
+    v.resize(129).expect("resize should work");
+    ASSERT_EQ(v.size(), 129);
+    v.pop_back();
+    v.pop_back();
+    ASSERT_EQ(v.size(), 127);
+    ASSERT_EQ(v[3], 3);
+
+    auto clone = v.Clone().expect("Clone should work");
+    v.clear();
+    ASSERT_EQ(clone.size(), 127);
+    ASSERT_EQ(clone[1], 9);
+}
+
+TEST(PackedVector, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<std::uint64_t> alloc{};
+        safe_containers::packed_vector<5, fail_allocator<std::uint64_t>> v{alloc};
+        ASSERT_TRUE(v.push_back(1).has_error());
+        ASSERT_TRUE(v.resize(100).has_error());
+        ASSERT_TRUE(v.empty());
+    }
+
+    {
+        // Packing the 128th value fails, so it is rejected.
+        fault_policy policy{};
+        fault_injecting_allocator<std::uint64_t> alloc{policy};
+        safe_containers::compressed_vector<fault_injecting_allocator<std::uint64_t>> v{alloc};
+        for (std::uint64_t i = 0; i < 127; ++i)
+        {
+            v.push_back(i).expect("push_back should work");
+        }
+        policy.fail_nth = policy.allocations.load() + 2;
+        ASSERT_TRUE(v.push_back(127).has_error());
+        ASSERT_EQ(v.size(), 127);
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(v.resize(300).has_error());
+        ASSERT_EQ(v.size(), 127);
+        v.push_back(127).expect("push_back should work");
+        ASSERT_EQ(v[127], 127);
+    }
+}
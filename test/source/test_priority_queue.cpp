@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+#include <safe-containers/priority_queue.h>
+
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using priority_queue = safe_containers::priority_queue<int>;
+
+namespace
+{
+
+// Pops everything, checking the order against `std::priority_queue`.
+template <typename Heap, typename Compare = std::less<int>>
+void ExpectSameOrder(Heap& heap, std::vector<int> values)
+{
+    std::priority_queue<int, std::vector<int>, Compare> reference(
+        Compare(), std::move(values));
+    ASSERT_EQ(heap.size(), reference.size());
+    while (!reference.empty())
+    {
+        ASSERT_EQ(heap.top(), reference.top());
+        heap.pop();
+        reference.pop();
+    }
+    ASSERT_TRUE(heap.empty());
+}
+
+struct DerefLess
+{
+    bool operator()(const std::unique_ptr<int>& a, const std::unique_ptr<int>& b) const
+    {
+        return *a < *b;
+    }
+};
+
+std::vector<int> RandomValues(std::size_t count, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<int> values(count);
+    for (int& v : values)
+    {
+        v = static_cast<int>(rng() % 1000);
+    }
+    return values;
+}
+
+}  // namespace
+
+TEST(PriorityQueue, PushAndPop)
+{
+    std::allocator<int> alloc{};
+    auto heap = priority_queue::Create(alloc).expect("Create should work");
+    const auto values = RandomValues(1000, 1);
+    for (int v : values)
+    {
+        heap.push(v).expect("push should work");
+    }
+    auto clone = heap.Clone().expect("Clone should work");
+    ExpectSameOrder(heap, values);
+    ExpectSameOrder(clone, values);
+
+    heap.emplace(3).expect("emplace should work");
+    heap.push(7).expect("push should work");
+    ASSERT_EQ(heap.take_top(), 7);
+    ASSERT_EQ(heap.take_top(), 3);
+    ASSERT_TRUE(heap.empty());
+}
+
+TEST(PriorityQueue, CreateHeapifiesRange)
+{
+    std::allocator<int> alloc{};
+    const auto values = RandomValues(5000, 2);
+    {
+        auto heap = priority_queue::Create(values.begin(), values.end(), alloc)
+                        .expect("Create should work");
+        ExpectSameOrder(heap, values);
+    }
+    {
+        // 4-ary min-heap.
+        auto heap = safe_containers::d_ary_heap<int, 4, std::greater<int>>::Create(
+                        values.begin(), values.end(), alloc)
+                        .expect("Create should work");
+        ASSERT_EQ(heap.capacity(), values.size());
+        ExpectSameOrder<decltype(heap), std::greater<int>>(heap, values);
+    }
+    {
+        auto heap = safe_containers::d_ary_heap<int, 8>::Create({5, 1, 9, 3}, alloc)
+                        .expect("Create should work");
+        ASSERT_EQ(heap.top(), 9);
+    }
+}
+
+TEST(PriorityQueue, PushRange)
+{
+    std::allocator<int> alloc{};
+    const auto first = RandomValues(100, 3);
+    const auto second = RandomValues(20, 4);
+    const auto third = RandomValues(500, 5);
+    auto heap = safe_containers::d_ary_heap<int, 4>::Create(first.begin(), first.end(), alloc)
+                    .expect("Create should work");
+    // Few elements are sifted up, many re-heapify the whole heap.
+    heap.push_range(second.begin(), second.end()).expect("push_range should work");
+    heap.push_range(third.begin(), third.end()).expect("push_range should work");
+
+    std::vector<int> all = first;
+    all.insert(all.end(), second.begin(), second.end());
+    all.insert(all.end(), third.begin(), third.end());
+    ExpectSameOrder(heap, all);
+}
+
+TEST(PriorityQueue, MoveOnlyElements)
+{
+    std::allocator<std::unique_ptr<int>> alloc{};
+    auto heap = safe_containers::d_ary_heap<std::unique_ptr<int>, 3, DerefLess>::Create(alloc)
+                    .expect("Create should work");
+    for (int i : {4, 8, 1, 6})
+    {
+        heap.push(std::make_unique<int>(i)).expect("push should work");
+    }
+    auto moved = std::move(heap);
+    ASSERT_EQ(*moved.take_top(), 8);
+    ASSERT_EQ(*moved.take_top(), 6);
+    ASSERT_EQ(moved.size(), 2);
+}
+
+TEST(PriorityQueue, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<int> alloc{};
+        safe_containers::priority_queue<int, std::less<int>, fail_allocator<int>> heap{alloc};
+        ASSERT_TRUE(heap.push(1).has_error());
+        ASSERT_TRUE(heap.reserve(10).has_error());
+        const std::vector<int> values{1, 2, 3};
+        ASSERT_TRUE(heap.push_range(values.begin(), values.end()).has_error());
+        ASSERT_TRUE(heap.empty());
+        ASSERT_TRUE((safe_containers::priority_queue<int, std::less<int>, fail_allocator<int>>::
+                         Create(values.begin(), values.end(), alloc)
+                             .has_error()));
+    }
+
+    {
+        fault_policy policy{};
+        fault_injecting_allocator<int> alloc{policy};
+        safe_containers::priority_queue<int, std::less<int>, fault_injecting_allocator<int>> heap{
+            alloc};
+        heap.push(1).expect("push should work");
+        const auto values = RandomValues(100, 6);
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(heap.push_range(values.begin(), values.end()).has_error());
+        ASSERT_EQ(heap.size(), 1);
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(heap.push(2).has_error());
+        ASSERT_EQ(heap.top(), 1);
+
+        policy.fail_nth = 0;
+        heap.push_range(values.begin(), values.end()).expect("push_range should work");
+        heap.reserve(1000).expect("reserve should work");
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(heap.shrink_to_fit().has_error());
+        ASSERT_EQ(heap.capacity(), 1000);
+        policy.fail_nth = 0;
+        heap.shrink_to_fit().expect("shrink_to_fit should work");
+        ASSERT_EQ(heap.capacity(), heap.size());
+
+        std::vector<int> all = values;
+        all.push_back(1);
+        ExpectSameOrder(heap, all);
+    }
+}
@@ -0,0 +1,254 @@
+#include <gtest/gtest.h>
+#include <safe-containers/radix_tree.h>
+
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using radix_tree = safe_containers::radix_tree<int>;
+using counted_tree = safe_containers::radix_tree<int, fault_injecting_allocator<int>>;
+
+namespace
+{
+
+template <typename Tree>
+std::vector<std::pair<std::string, int>> Entries(const Tree& tree)
+{
+    std::vector<std::pair<std::string, int>> entries;
+    tree.for_each([&](std::string_view key, const int& value) {
+        entries.emplace_back(std::string(key), value);
+    });
+    return entries;
+}
+
+std::vector<std::pair<std::string, int>> Entries(const std::map<std::string, int>& model)
+{
+    return std::vector<std::pair<std::string, int>>(model.begin(), model.end());
+}
+
+// Keys sharing long prefixes, which are longer than the bytes kept in the nodes, &
+// keys which are prefixes of others.
+std::string RandomKey(std::mt19937& rng)
+{
+    static const std::string kPrefixes[] = {"", "a", "abcdefghijklmnop", "abcdefghijklmnoq", "z"};
+    std::string key = kPrefixes[rng() % 5];
+    const auto extra = rng() % 4;
+    for (std::size_t i = 0; i < extra; ++i)
+    {
+        key.push_back(static_cast<char>('a' + rng() % 3));
+    }
+    return key;
+}
+
+}  // namespace
+
+TEST(RadixTree, InsertFindErase)
+{
+    std::allocator<int> alloc{};
+    auto tree = radix_tree::Create(alloc).expect("Create should work");
+    ASSERT_TRUE(tree.empty());
+    ASSERT_TRUE(tree.try_emplace("romane", 1).expect("try_emplace should work").second);
+    ASSERT_TRUE(tree.try_emplace("romanus", 2).expect("try_emplace should work").second);
+    ASSERT_TRUE(tree.try_emplace("romulus", 3).expect("try_emplace should work").second);
+    ASSERT_TRUE(tree.try_emplace("rubens", 4).expect("try_emplace should work").second);
+    ASSERT_TRUE(tree.try_emplace("roman", 5).expect("try_emplace should work").second);
+    ASSERT_TRUE(tree.try_emplace("", 6).expect("try_emplace should work").second);
+    ASSERT_FALSE(tree.try_emplace("roman", 7).expect("try_emplace should work").second);
+    ASSERT_EQ(tree.size(), 6);
+
+    ASSERT_EQ(*tree.find("roman"), 5);
+    ASSERT_EQ(*tree.find("romanus"), 2);
+    ASSERT_EQ(*tree.find(""), 6);
+    ASSERT_EQ(tree.find("rom"), nullptr);
+    ASSERT_EQ(tree.find("romanes"), nullptr);
+    ASSERT_FALSE(tree.contains("r"));
+
+    tree.insert_or_assign("roman", 8).expect("insert_or_assign should work");
+    ASSERT_EQ(*tree.find("roman"), 8);
+
+    ASSERT_EQ(tree.erase("roman"), 1);
+    ASSERT_EQ(tree.erase("roman"), 0);
+    ASSERT_EQ(tree.erase("rom"), 0);
+    ASSERT_EQ(*tree.find("romane"), 1);
+    ASSERT_EQ(
+        Entries(tree),
+        (std::vector<std::pair<std::string, int>>{
+            {"", 6}, {"romane", 1}, {"romanus", 2}, {"romulus", 3}, {"rubens", 4}}));
+
+    tree.clear();
+    ASSERT_TRUE(tree.empty());
+    ASSERT_EQ(tree.find("romane"), nullptr);
+}
+
+TEST(RadixTree, BinaryKeysGrowAndShrinkNodes)
+{
+    std::allocator<int> alloc{};
+    radix_tree tree(alloc);
+    // One node passes through all sizes, up to 256 children.
+    for (int b = 0; b < 256; ++b)
+    {
+        const std::string key{'k', static_cast<char>(b), '\0'};
+        tree.try_emplace(key, b).expect("try_emplace should work");
+    }
+    ASSERT_EQ(tree.size(), 256);
+    for (int b = 0; b < 256; ++b)
+    {
+        const std::string key{'k', static_cast<char>(b), '\0'};
+        ASSERT_EQ(*tree.find(key), b);
+    }
+    const auto entries = Entries(tree);
+    for (std::size_t i = 0; i < entries.size(); ++i)
+    {
+        ASSERT_EQ(entries[i].second, static_cast<int>(i));
+    }
+
+    // & back down to a single key.
+    for (int b = 255; b > 0; --b)
+    {
+        const std::string key{'k', static_cast<char>(b), '\0'};
+        ASSERT_EQ(tree.erase(key), 1);
+        ASSERT_EQ(*tree.find(std::string{'k', '\0', '\0'}), 0);
+    }
+    ASSERT_EQ(tree.size(), 1);
+}
+
+TEST(RadixTree, MatchesReferenceModel)
+{
+    std::allocator<int> alloc{};
+    radix_tree tree(alloc);
+    std::map<std::string, int> model;
+    std::mt19937 rng(42);
+    for (int i = 0; i < 20000; ++i)
+    {
+        const std::string key = RandomKey(rng);
+        if (rng() % 3 == 0)
+        {
+            ASSERT_EQ(tree.erase(key), model.erase(key));
+        }
+        else
+        {
+            const bool inserted = model.emplace(key, i).second;
+            ASSERT_EQ(tree.try_emplace(key, i).expect("try_emplace should work").second, inserted);
+        }
+        ASSERT_EQ(tree.size(), model.size());
+    }
+    ASSERT_EQ(Entries(tree), Entries(model));
+    for (int i = 0; i < 1000; ++i)
+    {
+        const std::string key = RandomKey(rng);
+        const auto it = model.find(key);
+        const int* found = tree.find(key);
+        ASSERT_EQ(found != nullptr, it != model.end());
+        if (found != nullptr)
+        {
+            ASSERT_EQ(*found, it->second);
+        }
+    }
+
+    auto clone = tree.Clone().expect("Clone should work");
+    ASSERT_EQ(Entries(clone), Entries(model));
+}
+
+TEST(RadixTree, LongestPrefix)
+{
+    std::allocator<int> alloc{};
+    radix_tree routes(alloc);
+    // Routes as the leading bytes of IPv4 addresses.
+    routes.try_emplace(std::string("\x0a", 1), 8).expect("try_emplace should work");
+    routes.try_emplace(std::string("\x0a\x01", 2), 16).expect("try_emplace should work");
+    routes.try_emplace(std::string("\x0a\x01\x02", 3), 24).expect("try_emplace should work");
+    routes.try_emplace(std::string("\xc0\xa8", 2), 99).expect("try_emplace should work");
+
+    ASSERT_EQ(*routes.longest_prefix(std::string("\x0a\x01\x02\x03", 4)), 24);
+    ASSERT_EQ(*routes.longest_prefix(std::string("\x0a\x01\x03\x03", 4)), 16);
+    ASSERT_EQ(*routes.longest_prefix(std::string("\x0a\x02\x02\x03", 4)), 8);
+    ASSERT_EQ(*routes.longest_prefix(std::string("\xc0\xa8\x00\x01", 4)), 99);
+    ASSERT_EQ(routes.longest_prefix(std::string("\xc0\xa9\x00\x01", 4)), nullptr);
+    ASSERT_EQ(routes.longest_prefix(""), nullptr);
+
+    // Long compressed paths are confirmed against the leaves.
+    routes.try_emplace("abcdefghijklmnopqrstuvwxyz", 1).expect("try_emplace should work");
+    ASSERT_EQ(*routes.longest_prefix("abcdefghijklmnopqrstuvwxyz!"), 1);
+    ASSERT_EQ(routes.longest_prefix("abcdefghijklmnopqrstuvwxyZ!"), nullptr);
+}
+
+TEST(RadixTree, ForEachPrefix)
+{
+    std::allocator<int> alloc{};
+    radix_tree tree(alloc);
+    const char* keys[] = {"user:1", "user:10", "user:2", "users", "group:1", "abcdefghijklm1",
+                          "abcdefghijklm2"};
+    int value = 0;
+    for (const char* key : keys)
+    {
+        tree.try_emplace(key, value++).expect("try_emplace should work");
+    }
+
+    std::vector<std::string> found;
+    const auto collect = [&](std::string_view key, int&) { found.emplace_back(key); };
+    tree.for_each_prefix("user:", collect);
+    ASSERT_EQ(found, (std::vector<std::string>{"user:1", "user:10", "user:2"}));
+    found.clear();
+    tree.for_each_prefix("user:1", collect);
+    ASSERT_EQ(found, (std::vector<std::string>{"user:1", "user:10"}));
+    found.clear();
+    tree.for_each_prefix("abcdefghijk", collect);
+    ASSERT_EQ(found, (std::vector<std::string>{"abcdefghijklm1", "abcdefghijklm2"}));
+    found.clear();
+    tree.for_each_prefix("abcdefghijkX", collect);
+    tree.for_each_prefix("usera", collect);
+    tree.for_each_prefix("user:100", collect);
+    ASSERT_TRUE(found.empty());
+    tree.for_each_prefix("", collect);
+    ASSERT_EQ(found.size(), 7);
+}
+
+TEST(RadixTree, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<int> alloc{};
+        safe_containers::radix_tree<int, fail_allocator<int>> tree(alloc);
+        ASSERT_TRUE(tree.try_emplace("key", 1).has_error());
+        ASSERT_TRUE(tree.empty());
+    }
+
+    {
+        // A failed insertion leaves the tree unchanged, whichever allocation fails.
+        fault_policy policy{};
+        fault_injecting_allocator<int> alloc{policy};
+        counted_tree tree(alloc);
+        std::map<std::string, int> model;
+        std::mt19937 rng(7);
+        for (int i = 0; i < 3000; ++i)
+        {
+            const std::string key = RandomKey(rng) + std::to_string(rng() % 50);
+            policy.fail_nth = policy.allocations.load() + 1 + rng() % 3;
+            auto res = tree.try_emplace(key, i);
+            if (res.has_value())
+            {
+                ASSERT_EQ(res.value().second, model.emplace(key, i).second);
+            }
+            if (rng() % 4 == 0)
+            {
+                policy.fail_nth = policy.allocations.load() + 1;
+                const std::string erased = RandomKey(rng) + std::to_string(rng() % 50);
+                ASSERT_EQ(tree.erase(erased), model.erase(erased));
+            }
+            ASSERT_EQ(tree.size(), model.size());
+        }
+        policy.fail_nth = 0;
+        ASSERT_GT(policy.failures.load(), 0);
+        ASSERT_EQ(Entries(tree), Entries(model));
+
+        policy.fail_nth = policy.allocations.load() + 3;
+        ASSERT_TRUE(tree.Clone().has_error());
+        policy.fail_nth = 0;
+        auto clone = tree.Clone().expect("Clone should work");
+        ASSERT_EQ(Entries(clone), Entries(model));
+    }
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <safe-containers/segmented_vector.h>
+
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "fail_alloc.h"
+
+// Small chunks, so tests cross chunk boundaries quickly.
+using small_vector = safe_containers::segmented_vector<int, std::allocator<int>, 4 * sizeof(int)>;
+using counted_vector =
+    safe_containers::segmented_vector<int, fault_injecting_allocator<int>, 4 * sizeof(int)>;
+
+TEST(SegmentedVector, Create)
+{
+    std::allocator<int> alloc{};
+    {
+        auto v = small_vector::Create(10, alloc).expect("Create should work");
+        ASSERT_EQ(v.size(), 10);
+        ASSERT_EQ(v.chunk_count(), 3);
+        ASSERT_EQ(v[9], 0);
+    }
+
+    {
+        auto v = small_vector::Create(static_cast<size_t>(5), 42, alloc).expect("Create works");
+        ASSERT_EQ(v.front(), 42);
+        ASSERT_EQ(v.back(), 42);
+    }
+
+    {
+        std::vector<int> values(100);
+        std::iota(values.begin(), values.end(), 0);
+        auto v = small_vector::Create(values.begin(), values.end(), alloc).expect("Create works");
+        ASSERT_TRUE(std::equal(values.begin(), values.end(), v.begin(), v.end()));
+        ASSERT_TRUE(std::equal(values.rbegin(), values.rend(), v.rbegin(), v.rend()));
+        ASSERT_EQ(v.end() - v.begin(), 100);
+
+        auto clone = v.Clone().expect("Clone should work");
+        ASSERT_TRUE(std::equal(v.begin(), v.end(), clone.begin(), clone.end()));
+    }
+
+    ASSERT_EQ(safe_containers::segmented_vector<char>::kChunkSize, 4096);
+    ASSERT_EQ((safe_containers::segmented_vector<char[3000]>::kChunkSize), 1);
+    ASSERT_EQ((safe_containers::segmented_vector<int, std::allocator<int>, 100>::kChunkSize), 16);
+}
+
+TEST(SegmentedVector, ReferencesAreStableAcrossGrowth)
+{
+    std::allocator<std::string> alloc{};
+    auto v = safe_containers::segmented_vector<std::string>::Create(alloc).expect("Create works");
+    v.push_back("first").expect("push_back should work");
+    const std::string* first = &v.front();
+    for (int i = 0; i < 10000; ++i)
+    {
+        v.emplace_back(std::to_string(i)).expect("emplace_back should work");
+    }
+    ASSERT_EQ(first, &v[0]);
+    ASSERT_EQ(*first, "first");
+    ASSERT_EQ(v[10000], "9999");
+
+    // Chunks are contiguous runs of elements, covering the vector in order.
+    std::size_t seen = 0;
+    for (std::size_t i = 0; i < v.chunk_count(); ++i)
+    {
+        for (const std::string& s : v.chunk(i))
+        {
+            ASSERT_EQ(&s, &v[seen++]);
+        }
+    }
+    ASSERT_EQ(seen, v.size());
+}
+
+TEST(SegmentedVector, PoppingKeepsChunks)
+{
+    std::allocator<int> alloc{};
+    small_vector v{alloc};
+    v.resize(16).expect("resize should work");
+    ASSERT_EQ(v.capacity(), 16);
+    v.resize(5).expect("resize should work");
+    ASSERT_EQ(v.capacity(), 16);
+    ASSERT_EQ(v.chunk(1).size(), 1);
+    ASSERT_EQ(v.chunk(2).size(), 0);
+
+    v.shrink_to_fit();
+    ASSERT_EQ(v.capacity(), 8);
+    v.clear();
+    ASSERT_TRUE(v.empty());
+    v.shrink_to_fit();
+    ASSERT_EQ(v.chunk_count(), 0);
+
+    small_vector w{std::move(v)};
+    w.push_back(1).expect("push_back should work");
+    v = std::move(w);
+    ASSERT_EQ(v.size(), 1);
+}
+
+TEST(SegmentedVector, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<int> alloc{};
+        safe_containers::segmented_vector<int, fail_allocator<int>> v{alloc};
+        ASSERT_TRUE(v.push_back(1).has_error());
+        ASSERT_TRUE(v.emplace_back(1).has_error());
+        ASSERT_TRUE(v.reserve(1).has_error());
+        ASSERT_TRUE(v.empty());
+    }
+
+    {
+        // Growing needs the directory & then one chunk; fail each in turn.
+        fault_policy policy{};
+        fault_injecting_allocator<int> alloc{policy};
+        counted_vector v{alloc};
+        for (int i = 0; i < 4; ++i)
+        {
+            v.push_back(i).expect("push_back should work");
+        }
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(v.push_back(4).has_error());
+        ASSERT_EQ(v.size(), 4);
+        policy.fail_nth = policy.allocations.load() + 3;
+        ASSERT_TRUE(v.resize(100).has_error());
+        ASSERT_EQ(v.size(), 4);
+
+        policy.fail_nth = 0;
+        v.resize(100).expect("resize should work");
+        ASSERT_EQ(v[3], 3);
+        ASSERT_EQ(v[99], 0);
+    }
+}
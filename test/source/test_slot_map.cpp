@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <safe-containers/slot_map.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using slot_map = safe_containers::slot_map<std::string>;
+
+TEST(SlotMap, StaleHandlesAreDetected)
+{
+    std::allocator<std::string> alloc{};
+    auto m = slot_map::Create(alloc).expect("Create should work");
+    const auto a = m.insert("a").expect("insert should work");
+    const auto b = m.insert(3, 'b').expect("insert should work");
+    ASSERT_EQ(m.size(), 2);
+    ASSERT_EQ(m[a], "a");
+    ASSERT_EQ(*m.get(b), "bbb");
+
+    ASSERT_TRUE(m.erase(a));
+    ASSERT_FALSE(m.erase(a));
+    ASSERT_FALSE(m.contains(a));
+    ASSERT_EQ(m.get(a), nullptr);
+    ASSERT_EQ(m[b], "bbb");
+
+    // The freed slot is reused under a new generation.
+    const auto c = m.insert("c").expect("insert should work");
+    ASSERT_EQ(c.index, a.index);
+    ASSERT_NE(c, a);
+    ASSERT_EQ(m.get(a), nullptr);
+    ASSERT_EQ(m[c], "c");
+
+    ASSERT_FALSE(m.contains(slot_map::handle{}));
+
+    m.clear();
+    ASSERT_TRUE(m.empty());
+    ASSERT_FALSE(m.contains(b));
+    ASSERT_FALSE(m.contains(c));
+}
+
+TEST(SlotMap, InsertMayCopyAValueOfTheMap)
+{
+    std::allocator<std::string> alloc{};
+    auto m = slot_map::Create(alloc).expect("Create should work");
+    const std::string value(64, 'x');
+    auto h = m.insert(value).expect("insert should work");
+    for (int i = 0; i < 100; ++i)
+    {
+        // Inserting into a full map grows the values, which the argument refers to.
+        h = m.insert(m[h]).expect("insert should work");
+    }
+    ASSERT_EQ(m.size(), 101);
+    for (const auto& v : m)
+    {
+        ASSERT_EQ(v, value);
+    }
+}
+
+TEST(SlotMap, ValuesStayDenseUnderChurn)
+{
+    std::allocator<int> alloc{};
+    auto m = safe_containers::slot_map<int>::Create(64, alloc).expect("Create should work");
+    std::unordered_map<int, safe_containers::slot_map<int>::handle> live;
+    std::mt19937 rng(7);
+    for (int i = 0; i < 10000; ++i)
+    {
+        if (!live.empty() && rng() % 2 == 0)
+        {
+            auto it = live.begin();
+            std::advance(it, static_cast<long>(rng() % live.size()));
+            ASSERT_TRUE(m.erase(it->second));
+            live.erase(it);
+        }
+        else
+        {
+            live.emplace(i, m.insert(i).expect("insert should work"));
+        }
+    }
+
+    ASSERT_EQ(m.size(), live.size());
+    for (const auto& [value, h] : live)
+    {
+        ASSERT_EQ(m[h], value);
+    }
+    // Dense iteration sees every live value once, and maps back to its handle.
+    for (std::size_t pos = 0; pos < m.size(); ++pos)
+    {
+        const int value = m.data()[pos];
+        ASSERT_EQ(live.at(value), m.handle_at(pos));
+    }
+
+    auto clone = m.Clone().expect("Clone should work");
+    for (const auto& [value, h] : live)
+    {
+        ASSERT_EQ(clone[h], value);
+    }
+}
+
+TEST(SlotMap, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<int> alloc{};
+        safe_containers::slot_map<int, fail_allocator<int>> m{alloc};
+        ASSERT_TRUE(m.insert(1).has_error());
+        ASSERT_TRUE(m.empty());
+    }
+
+    {
+        fault_policy policy{};
+        fault_injecting_allocator<int> alloc{policy};
+        safe_containers::slot_map<int, fault_injecting_allocator<int>> m{alloc};
+        std::vector<safe_containers::slot_map<int, fault_injecting_allocator<int>>::handle> handles;
+        for (int i = 0; i < 8; ++i)
+        {
+            handles.push_back(m.insert(i).expect("insert should work"));
+        }
+
+        // The 9th insert grows all three arrays. Fail the values, then the owners after
+        // the values grew, then the slots after the owners grew.
+        for (std::size_t nth : {std::size_t{1}, std::size_t{2}, std::size_t{2}})
+        {
+            policy.fail_nth = policy.allocations.load() + nth;
+            ASSERT_TRUE(m.insert(8).has_error());
+            ASSERT_EQ(m.size(), 8);
+        }
+        policy.fail_nth = 0;
+        const auto h = m.insert(8).expect("insert should work");
+        ASSERT_EQ(m[h], 8);
+        for (int i = 0; i < 8; ++i)
+        {
+            ASSERT_EQ(m[handles[static_cast<std::size_t>(i)]], i);
+        }
+    }
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <safe-containers/snapshot_vector.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using int_snapshot_vec = safe_containers::snapshot_vector<int>;
+
+TEST(SnapshotVector, EmptyUntilFirstUpdate)
+{
+    std::allocator<int> alloc{};
+    int_snapshot_vec v{alloc};
+    auto h = v.Register().expect("Register should work");
+    auto s = v.Read(h);
+    ASSERT_TRUE(s.empty());
+    ASSERT_EQ(s.begin(), s.end());
+}
+
+TEST(SnapshotVector, SnapshotsAreImmutable)
+{
+    std::allocator<int> alloc{};
+    int_snapshot_vec v{alloc};
+    auto writer = v.Register().expect("Register should work");
+    auto reader = v.Register().expect("Register should work");
+
+    v.Update(writer, [](int_snapshot_vec::vector_type& next) { return next.push_back(1); })
+        .expect("Update should work");
+    {
+        auto before = v.Read(reader);
+        std::thread(
+            [&]()
+            {
+                v.Update(
+                     writer,
+                     [](int_snapshot_vec::vector_type& next) { return next.push_back(2); })
+                    .expect("Update should work");
+            })
+            .join();
+        ASSERT_EQ(before.size(), 1);
+        ASSERT_EQ(before[0], 1);
+    }
+
+    auto after = v.Read(reader);
+    ASSERT_EQ(after.size(), 2);
+    ASSERT_EQ(after[1], 2);
+}
+
+TEST(SnapshotVector, ConcurrentReadersSeeConsistentVersions)
+{
+    constexpr int readers = 3;
+    constexpr int updates = 500;
+    std::allocator<int> alloc{};
+    int_snapshot_vec v{alloc};
+    std::atomic<bool> done{false};
+    std::atomic<int> violations{0};
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < readers; ++t)
+    {
+        workers.emplace_back(
+            [&]()
+            {
+                auto h = v.Register().expect("Register should work");
+                while (!done.load(std::memory_order_acquire))
+                {
+                    // Version `n` holds `n` copies of `n`.
+                    auto s = v.Read(h);
+                    for (int value : s)
+                    {
+                        if (value != static_cast<int>(s.size()))
+                        {
+                            violations.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                }
+            });
+    }
+
+    auto writer = v.Register().expect("Register should work");
+    for (int n = 1; n <= updates; ++n)
+    {
+        v.Update(
+             writer,
+             [n](int_snapshot_vec::vector_type& next)
+             { return next.assign(static_cast<size_t>(n), n); })
+            .expect("Update should work");
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    ASSERT_EQ(violations.load(), 0);
+    ASSERT_EQ(v.Read(writer).size(), updates);
+}
+
+TEST(SnapshotVector, AllocationFailuresReturnError)
+{
+    fault_policy policy{};
+    fault_injecting_allocator<int> alloc{policy};
+    safe_containers::snapshot_vector<int, fault_injecting_allocator<int>> v{alloc};
+    auto h = v.Register().expect("Register should work");
+    auto push = [](auto& next) { return next.push_back(1); };
+    v.Update(h, push).expect("Update should work");
+
+    // Fail allocating the next version, cloning the current one & modifying the clone.
+    for (std::size_t nth = 1; nth <= 3; ++nth)
+    {
+        policy.fail_nth = policy.allocations.load() + nth;
+        ASSERT_TRUE(v.Update(h, push).has_error());
+        ASSERT_EQ(v.Read(h).size(), 1);
+    }
+    policy.fail_nth = 0;
+    v.Update(h, push).expect("Update should work");
+    ASSERT_EQ(v.Read(h).size(), 2);
+}
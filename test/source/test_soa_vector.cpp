@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <safe-containers/soa_vector.h>
+
+#include <cstdint>
+#include <numeric>
+#include <string>
+
+#include "fail_alloc.h"
+
+using record_vec = safe_containers::soa_vector<std::uint32_t, double, std::string>;
+
+TEST(SoaVector, PushBackAndFields)
+{
+    std::allocator<std::byte> alloc{};
+    auto v = record_vec::Create(alloc).expect("Create should work");
+    for (std::uint32_t i = 0; i < 100; ++i)
+    {
+        v.push_back(i, i * 0.5, std::to_string(i)).expect("push_back should work");
+    }
+    ASSERT_EQ(v.size(), 100);
+
+    auto ids = v.field<0>();
+    ASSERT_EQ(ids.size(), 100);
+    ASSERT_EQ(std::accumulate(ids.begin(), ids.end(), std::uint32_t{0}), 4950u);
+    ASSERT_EQ(v.get<1>(10), 5.0);
+    ASSERT_EQ(v.get<2>(99), "99");
+}
+
+TEST(SoaVector, FieldsAreCacheLineAligned)
+{
+    std::allocator<std::byte> alloc{};
+    auto v = record_vec::Create(3, alloc).expect("Create should work");
+    v.push_back(1u, 1.0, "one").expect("push_back should work");
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(v.field<0>().data()) % 64, 0);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(v.field<1>().data()) % 64, 0);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(v.field<2>().data()) % 64, 0);
+}
+
+TEST(SoaVector, GrowthIsASingleAllocation)
+{
+    fault_policy policy{};
+    fault_injecting_allocator<std::byte> alloc{policy};
+    safe_containers::basic_soa_vector<fault_injecting_allocator<std::byte>, int, float, char> v{
+        alloc};
+    v.reserve(1000).expect("reserve should work");
+    ASSERT_EQ(policy.allocations.load(), 1);
+    ASSERT_GE(v.capacity(), 1000);
+}
+
+TEST(SoaVector, ResizeSwapRemoveAndClone)
+{
+    std::allocator<std::byte> alloc{};
+    safe_containers::soa_vector<int, std::string> v{alloc};
+    v.resize(3).expect("resize should work");
+    ASSERT_EQ(v.get<0>(2), 0);
+    ASSERT_TRUE(v.get<1>(2).empty());
+    v.get<0>(0) = 10;
+    v.get<1>(2) = "last";
+
+    v.swap_remove(0);
+    ASSERT_EQ(v.size(), 2);
+    ASSERT_EQ(v.get<1>(0), "last");
+
+    auto clone = v.Clone().expect("Clone should work");
+    v.clear();
+    ASSERT_EQ(clone.size(), 2);
+    ASSERT_EQ(clone.get<1>(0), "last");
+
+    clone.shrink_to_fit().expect("shrink_to_fit should work");
+    ASSERT_EQ(clone.capacity(), 2);
+}
+
+TEST(SoaVector, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<std::byte> alloc{};
+        safe_containers::basic_soa_vector<fail_allocator<std::byte>, int, double> v{alloc};
+        ASSERT_TRUE(v.push_back(1, 1.0).has_error());
+        ASSERT_TRUE(v.resize(4).has_error());
+        ASSERT_TRUE(v.empty());
+    }
+
+    {
+        fault_policy policy{};
+        fault_injecting_allocator<std::byte> alloc{policy};
+        safe_containers::basic_soa_vector<fault_injecting_allocator<std::byte>, int, double> v{
+            alloc};
+        v.resize(8).expect("resize should work");
+        v.get<0>(7) = 7;
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(v.push_back(8, 8.0).has_error());
+        ASSERT_EQ(v.size(), 8);
+        ASSERT_EQ(v.capacity(), 8);
+        ASSERT_EQ(v.get<0>(7), 7);
+    }
+}
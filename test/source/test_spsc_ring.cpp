@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include <safe-containers/spsc_ring.h>
+
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using int_ring = safe_containers::spsc_ring<int, std::allocator<int>>;
+
+namespace
+{
+
+int copies_left = 0;
+
+// Holds a reference to `counter`, & throws when copied once `copies_left` runs out.
+struct ThrowingCopy
+{
+    explicit ThrowingCopy(std::shared_ptr<int> c)
+        : counter(std::move(c))
+    {
+    }
+
+    ThrowingCopy(const ThrowingCopy& other)
+        : counter(other.counter)
+    {
+        if (copies_left-- == 0)
+        {
+            throw std::runtime_error("copy");
+        }
+    }
+
+    std::shared_ptr<int> counter;
+};
+
+}  // namespace
+
+TEST(SpscRing, Create)
+{
+    std::allocator<int> alloc{};
+    auto result = int_ring::Create(5, alloc);
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(result.value().capacity(), 8);
+    ASSERT_TRUE(result.value().empty());
+}
+
+TEST(SpscRing, PushPop)
+{
+    std::allocator<int> alloc{};
+    auto ring = int_ring::Create(4, alloc).expect("Create should work");
+    for (int i = 0; i < 4; ++i)
+    {
+        ASSERT_TRUE(ring.try_push(i));
+    }
+    ASSERT_FALSE(ring.try_push(4));
+    ASSERT_EQ(ring.size(), 4);
+
+    int value = -1;
+    ASSERT_TRUE(ring.try_pop(value));
+    ASSERT_EQ(value, 0);
+    ASSERT_TRUE(ring.try_push(4));
+
+    for (int i = 1; i <= 4; ++i)
+    {
+        ASSERT_TRUE(ring.try_pop(value));
+        ASSERT_EQ(value, i);
+    }
+    ASSERT_FALSE(ring.try_pop(value));
+}
+
+TEST(SpscRing, BatchPushPop)
+{
+    std::allocator<int> alloc{};
+    auto ring = int_ring::Create(8, alloc).expect("Create should work");
+    const std::array<int, 10> in{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    ASSERT_EQ(ring.try_push_n(in.begin(), in.size()), 8);
+
+    std::array<int, 10> out{};
+    ASSERT_EQ(ring.try_pop_n(out.begin(), 3), 3);
+    ASSERT_EQ(ring.try_push_n(in.begin() + 8, 2), 2);
+    ASSERT_EQ(ring.try_pop_n(out.begin() + 3, out.size()), 7);
+    ASSERT_EQ(in, out);
+}
+
+TEST(SpscRing, DestroysRemainingElements)
+{
+    auto counter = std::make_shared<int>(0);
+    {
+        std::allocator<std::shared_ptr<int>> alloc{};
+        auto ring = safe_containers::spsc_ring<std::shared_ptr<int>>::Create(4, alloc).expect(
+            "Create should work");
+        ASSERT_TRUE(ring.try_push(counter));
+        ASSERT_TRUE(ring.try_push(counter));
+        ASSERT_EQ(counter.use_count(), 3);
+    }
+    ASSERT_EQ(counter.use_count(), 1);
+}
+
+TEST(SpscRing, ThrowingBatchPushPushesNothing)
+{
+    auto counter = std::make_shared<int>(0);
+    std::allocator<ThrowingCopy> alloc{};
+    auto ring =
+        safe_containers::spsc_ring<ThrowingCopy>::Create(8, alloc).expect("Create should work");
+    copies_left = 4;
+    const std::vector<ThrowingCopy> in(4, ThrowingCopy(counter));
+    ASSERT_EQ(counter.use_count(), 5);
+
+    copies_left = 2;
+    ASSERT_THROW(ring.try_push_n(in.begin(), in.size()), std::runtime_error);
+    ASSERT_TRUE(ring.empty());
+    ASSERT_EQ(counter.use_count(), 5);
+}
+
+TEST(SpscRing, ProducerConsumer)
+{
+    constexpr int count = 100000;
+    std::allocator<int> alloc{};
+    auto ring = int_ring::Create(64, alloc).expect("Create should work");
+
+    std::thread producer(
+        [&]()
+        {
+            for (int i = 0; i < count;)
+            {
+                if (ring.try_push(i))
+                {
+                    ++i;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+    std::vector<int> received;
+    received.reserve(count);
+    std::array<int, 16> batch{};
+    while (received.size() < count)
+    {
+        const auto n = ring.try_pop_n(batch.begin(), batch.size());
+        if (n == 0)
+        {
+            std::this_thread::yield();
+        }
+        received.insert(received.end(), batch.begin(), batch.begin() + static_cast<long>(n));
+    }
+    producer.join();
+
+    for (int i = 0; i < count; ++i)
+    {
+        ASSERT_EQ(received[static_cast<size_t>(i)], i);
+    }
+}
+
+TEST(SpscRing, AllocationFailuresReturnError)
+{
+    fail_allocator<int> alloc{};
+    const auto result = safe_containers::spsc_ring<int, fail_allocator<int>>::Create(4, alloc);
+    ASSERT_TRUE(result.has_error());
+}
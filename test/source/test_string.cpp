@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <safe-containers/string.h>
+
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+#include "fail_alloc.h"
+
+using string = safe_containers::string;
+
+TEST(String, ShortStringsStayInline)
+{
+    std::allocator<char> alloc{};
+    ASSERT_EQ(sizeof(string), 3 * sizeof(void*));
+    ASSERT_EQ(string::kInlineCapacity, 3 * sizeof(void*) - 1);
+
+    auto s = string::Create(alloc).expect("Create should work");
+    ASSERT_TRUE(s.empty());
+    ASSERT_STREQ(s.c_str(), "");
+    for (std::size_t i = 0; i < string::kInlineCapacity; ++i)
+    {
+        s.push_back(static_cast<char>('a' + i % 26)).expect("push_back should work");
+        ASSERT_TRUE(s.is_inline());
+        ASSERT_EQ(s.size(), i + 1);
+        ASSERT_EQ(s.c_str()[i + 1], '\0');
+    }
+    ASSERT_EQ(s.capacity(), string::kInlineCapacity);
+
+    s.push_back('!').expect("push_back should work");
+    ASSERT_FALSE(s.is_inline());
+    ASSERT_EQ(s.size(), string::kInlineCapacity + 1);
+    ASSERT_EQ(s.back(), '!');
+    ASSERT_EQ(s.view().substr(0, 3), "abc");
+
+    s.erase(3);
+    s.shrink_to_fit().expect("shrink_to_fit should work");
+    ASSERT_TRUE(s.is_inline());
+    ASSERT_EQ(s, "abc");
+}
+
+TEST(String, AppendInsertAndAssign)
+{
+    std::allocator<char> alloc{};
+    auto s = string::Create("hello", alloc).expect("Create should work");
+    s.append(" world").expect("append should work");
+    s.insert(5, ",").expect("insert should work");
+    ASSERT_EQ(s, "hello, world");
+    s.insert(0, 3, '>').expect("insert should work");
+    ASSERT_EQ(s, ">>>hello, world");
+    ASSERT_EQ(s.find("world"), 10);
+    ASSERT_TRUE(s.starts_with(">>>"));
+    ASSERT_TRUE(s.ends_with("world"));
+
+    // Appending a view of itself reads the characters before moving them.
+    s.append(s.view()).expect("append should work");
+    ASSERT_EQ(s, ">>>hello, world>>>hello, world");
+    s.insert(3, std::string_view(s).substr(0, 3)).expect("insert should work");
+    ASSERT_EQ(s.view().substr(0, 9), ">>>>>>hel");
+
+    s.assign("short").expect("assign should work");
+    ASSERT_EQ(s, "short");
+    s.resize(8, '.').expect("resize should work");
+    ASSERT_EQ(s, "short...");
+    s.resize(2).expect("resize should work");
+    ASSERT_EQ(s, "sh");
+
+    std::list<char> chars{'x', 'y'};
+    s.append(chars.begin(), chars.end()).expect("append should work");
+    ASSERT_EQ(s, "shxy");
+}
+
+TEST(String, MovesCloneAndHash)
+{
+    std::allocator<char> alloc{};
+    auto long_string = string::Create(40, 'z', alloc).expect("Create should work");
+    auto short_string = string::Create("tiny", alloc).expect("Create should work");
+
+    auto clone = long_string.Clone().expect("Clone should work");
+    ASSERT_EQ(clone, long_string);
+    ASSERT_NE(clone.data(), long_string.data());
+
+    string moved(std::move(long_string));
+    ASSERT_EQ(moved.size(), 40);
+    ASSERT_TRUE(long_string.empty());
+
+    moved = std::move(short_string);
+    ASSERT_EQ(moved, "tiny");
+    ASSERT_TRUE(moved < clone);
+
+    std::unordered_set<std::string_view> views{moved};
+    ASSERT_EQ(std::hash<string>()(moved), std::hash<std::string_view>()("tiny"));
+    ASSERT_EQ(views.count("tiny"), 1);
+}
+
+TEST(String, AllocationFailuresReturnError)
+{
+    {
+        fail_allocator<char> alloc{};
+        safe_containers::basic_string<fail_allocator<char>> s{alloc};
+        s.append("fits inline").expect("append should work");
+        ASSERT_TRUE(s.append(std::string(40, 'x')).has_error());
+        ASSERT_TRUE(s.reserve(100).has_error());
+        ASSERT_EQ(s, "fits inline");
+    }
+
+    {
+        fault_policy policy{};
+        fault_injecting_allocator<char> alloc{policy};
+        using fallible_string = safe_containers::basic_string<fault_injecting_allocator<char>>;
+        auto s = fallible_string::Create(30, 'a', alloc).expect("Create should work");
+        const auto capacity = s.capacity();
+        s.resize(capacity, 'b').expect("resize should work");
+
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(s.push_back('c').has_error());
+        policy.fail_nth = policy.allocations.load() + 1;
+        ASSERT_TRUE(s.insert(0, "d").has_error());
+        ASSERT_EQ(s.size(), capacity);
+        ASSERT_EQ(s.back(), 'b');
+    }
+}
@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include <safe-containers/vector.h>
 
+#include <algorithm>
+#include <stdexcept>
+
 #include "fail_alloc.h"
 
 using int_vec = safe_containers::vector<int, std::allocator<int>>;
@@ -21,6 +24,21 @@ struct NotCopyable
 using not_copyable_vec = safe_containers::vector<NotCopyable, std::allocator<NotCopyable>>;
 using not_copyable_allocator = not_copyable_vec::allocator_type;
 
+struct ThrowingMove
+{
+    explicit ThrowingMove(int v)
+        : value(v)
+    {
+    }
+    ThrowingMove(const ThrowingMove&) = default;
+    ThrowingMove& operator=(const ThrowingMove&) = default;
+    ThrowingMove(ThrowingMove&&) { throw std::runtime_error("move"); }
+    ThrowingMove& operator=(ThrowingMove&&) { throw std::runtime_error("move"); }
+    ~ThrowingMove() = default;
+
+    int value;
+};
+
 TEST(SafeVec, DefaultCtorWithStdAllocator)
 {
     int_allocator alloc{};
@@ -290,6 +308,35 @@ TEST(SafeVec, Resize)
     }
 }
 
+TEST(SafeVec, ShrinkToFit)
+{
+    int_allocator alloc{};
+    int_vec v{alloc};
+    v.reserve(16);
+    v.assign({1, 2, 3}).expect("Could not assign values");
+
+    v.shrink_to_fit().expect("shrink_to_fit should work");
+    ASSERT_EQ(v.capacity(), 3);
+    ASSERT_EQ(v.size(), 3);
+    ASSERT_EQ(v[0], 1);
+    ASSERT_EQ(v[1], 2);
+    ASSERT_EQ(v[2], 3);
+}
+
+TEST(SafeVec, ShrinkToFitCopiesElementsWhichMayThrowOnMove)
+{
+    std::allocator<ThrowingMove> alloc{};
+    safe_containers::vector<ThrowingMove> v{alloc};
+    v.reserve(16);
+    v.emplace_back(1).expect("emplace_back should work");
+    v.emplace_back(2).expect("emplace_back should work");
+
+    v.shrink_to_fit().expect("shrink_to_fit should work");
+    ASSERT_EQ(v.capacity(), 2);
+    ASSERT_EQ(v[0].value, 1);
+    ASSERT_EQ(v[1].value, 2);
+}
+
 TEST(SafeVec, Clone)
 {
     int_allocator alloc{};
@@ -327,3 +374,50 @@ TEST(SafeVec, AllocationFailuresReturnError)
         ASSERT_TRUE(result.has_error());
     }
 }
+
+TEST(SafeVec, FailNthAllocation)
+{
+    fault_policy policy{};
+    policy.fail_nth = 2;
+    fault_injecting_allocator<int> alloc{policy};
+    safe_containers::vector<int, fault_injecting_allocator<int>> v{alloc};
+
+    v.push_back(1).expect("first allocation should work");
+    ASSERT_TRUE(v.push_back(2).has_error());
+    ASSERT_EQ(v.size(), 1);
+    v.push_back(2).expect("third allocation should work");
+    ASSERT_EQ(v.size(), 2);
+    ASSERT_EQ(policy.failures.load(), 1);
+}
+
+TEST(SafeVec, FailAllocationsAboveSize)
+{
+    fault_policy policy{};
+    policy.fail_above_bytes = 4 * sizeof(int);
+    fault_injecting_allocator<int> alloc{policy};
+
+    ASSERT_FALSE((safe_containers::vector<int, fault_injecting_allocator<int>>::Create(4, alloc)
+                      .has_error()));
+    ASSERT_TRUE((safe_containers::vector<int, fault_injecting_allocator<int>>::Create(5, alloc)
+                     .has_error()));
+}
+
+TEST(SafeVec, FailAllocationsWithProbabilityIsDeterministic)
+{
+    const auto run = []()
+    {
+        fault_policy policy{};
+        policy.fail_probability = 0.5;
+        policy.seed = 42;
+        std::vector<bool> failed;
+        for (int i = 0; i < 64; ++i)
+        {
+            failed.push_back(policy.ShouldFail(sizeof(int)));
+        }
+        return failed;
+    };
+    const auto first = run();
+    ASSERT_EQ(first, run());
+    ASSERT_NE(std::count(first.begin(), first.end(), true), 0);
+    ASSERT_NE(std::count(first.begin(), first.end(), false), 0);
+}
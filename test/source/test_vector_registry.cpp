@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include <safe-containers/vector.h>
+
+#include <memory>
+#include <vector>
+
+#include "fail_alloc.h"
+
+#ifndef SAFE_CONTAINERS_VECTOR_REGISTRY
+#error "The registry tests require SAFE_CONTAINERS_VECTOR_REGISTRY to be defined"
+#endif
+
+using int_vec = safe_containers::vector<int, std::allocator<int>>;
+using int_allocator = int_vec::allocator_type;
+using entry_vec = safe_containers::
+    vector<safe_containers::registry_entry, std::allocator<safe_containers::registry_entry>>;
+using safe_containers::vector_registry;
+
+namespace
+{
+// Allocator which starts failing once `failing` is set.
+template <typename T>
+struct toggle_allocator : std::allocator<T>
+{
+    static inline bool failing = false;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = toggle_allocator<U>;
+    };
+
+    toggle_allocator() = default;
+    template <typename U>
+    toggle_allocator(const toggle_allocator<U>&) noexcept
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        if (failing)
+        {
+            throw std::bad_alloc();
+        }
+        return std::allocator<T>::allocate(n);
+    }
+};
+
+std::size_t LiveCount()
+{
+    std::size_t count = 0;
+    vector_registry::Instance().ForEach([&](const safe_containers::registry_entry&) { ++count; });
+    return count;
+}
+}  // namespace
+
+TEST(VectorRegistry, TracksLiveVectors)
+{
+    const std::size_t before = LiveCount();
+    int_allocator alloc{};
+    {
+        int_vec a{alloc};
+        auto b = int_vec::Create(3, alloc);
+        ASSERT_TRUE(b.has_value());
+        ASSERT_EQ(LiveCount(), before + 2);
+    }
+    ASSERT_EQ(LiveCount(), before);
+}
+
+TEST(VectorRegistry, RecordsTypeAndCallSite)
+{
+    int_allocator alloc{};
+    const unsigned line = __LINE__ + 1;
+    auto v = int_vec::Create(static_cast<size_t>(4), 1, alloc);
+    ASSERT_TRUE(v.has_value());
+
+    bool found = false;
+    vector_registry::Instance().ForEach(
+        [&](const safe_containers::registry_entry& entry)
+        {
+            if (entry.site.line == line && std::string_view(entry.site.file) == __FILE__)
+            {
+                found = true;
+                ASSERT_EQ(entry.type_name, "int");
+                ASSERT_EQ(entry.size_bytes, 4 * sizeof(int));
+                ASSERT_GE(entry.capacity_bytes, entry.size_bytes);
+            }
+        });
+    ASSERT_TRUE(found);
+}
+
+TEST(VectorRegistry, SummarizeGroupsByCallSite)
+{
+    int_allocator alloc{};
+    std::vector<std::unique_ptr<int_vec>> vecs;
+    const unsigned line = __LINE__ + 3;
+    for (int i = 0; i < 3; ++i)
+    {
+        vecs.emplace_back(new int_vec(alloc));
+        vecs.back()->reserve(8);
+        vecs.back()->push_back(i).expect("push_back should work");
+    }
+
+    std::allocator<safe_containers::registry_entry> summary_alloc{};
+    entry_vec summary{summary_alloc};
+    ASSERT_FALSE(vector_registry::Instance().Summarize(summary).has_error());
+
+    bool found = false;
+    for (const auto& entry : summary)
+    {
+        if (entry.site.line == line && std::string_view(entry.site.file) == __FILE__)
+        {
+            found = true;
+            ASSERT_EQ(entry.count, 3);
+            ASSERT_EQ(entry.size_bytes, 3 * sizeof(int));
+            ASSERT_EQ(entry.capacity_bytes, 3 * 8 * sizeof(int));
+            ASSERT_EQ(entry.slack_bytes(), 3 * 7 * sizeof(int));
+        }
+    }
+    ASSERT_TRUE(found);
+}
+
+TEST(VectorRegistry, ShrinkAllOverThreshold)
+{
+    int_allocator alloc{};
+    int_vec small{alloc};
+    small.reserve(2);
+    small.push_back(1).expect("push_back should work");
+    int_vec large{alloc};
+    large.reserve(1024);
+    large.push_back(1).expect("push_back should work");
+
+    const std::size_t failures = vector_registry::Instance().shrink_all_over(
+        64, [](const safe_containers::registry_entry&, ContainerError) {});
+    ASSERT_EQ(failures, 0);
+    ASSERT_EQ(small.capacity(), 2);
+    ASSERT_EQ(large.capacity(), 1);
+    ASSERT_EQ(large[0], 1);
+}
+
+TEST(VectorRegistry, ShrinkAllOverReportsFailures)
+{
+    toggle_allocator<int> alloc{};
+    safe_containers::vector<int, toggle_allocator<int>> v{alloc};
+    v.reserve(1024);
+    v.push_back(1).expect("push_back should work");
+
+    toggle_allocator<int>::failing = true;
+    std::size_t errors = 0;
+    const std::size_t failures = vector_registry::Instance().shrink_all_over(
+        64, [&](const safe_containers::registry_entry&, ContainerError) { ++errors; });
+    toggle_allocator<int>::failing = false;
+
+    ASSERT_EQ(failures, 1);
+    ASSERT_EQ(errors, 1);
+    ASSERT_EQ(v.capacity(), 1024);
+    ASSERT_EQ(v[0], 1);
+}
+
+TEST(VectorRegistry, CallbacksMayConstructAndDestroyVectors)
+{
+    int_allocator alloc{};
+    int_vec a{alloc};
+    a.reserve(1024);
+    a.push_back(1).expect("push_back should work");
+
+    // A temporary vector registers & unregisters within the traversal.
+    std::size_t visited = 0;
+    vector_registry::Instance().ForEach([&](const safe_containers::registry_entry&) {
+        int_vec tmp{alloc};
+        tmp.push_back(1).expect("push_back should work");
+        ++visited;
+    });
+    ASSERT_EQ(visited, LiveCount());
+
+    toggle_allocator<int> failing{};
+    safe_containers::vector<int, toggle_allocator<int>> v{failing};
+    v.reserve(1024);
+    v.push_back(1).expect("push_back should work");
+    toggle_allocator<int>::failing = true;
+    const std::size_t failures = vector_registry::Instance().shrink_all_over(
+        64, [&](const safe_containers::registry_entry&, ContainerError) { int_vec tmp{alloc}; });
+    toggle_allocator<int>::failing = false;
+    ASSERT_EQ(failures, 1);
+    ASSERT_EQ(a.capacity(), 1);
+}
+
+TEST(VectorRegistry, CallbacksMayDestroyUnvisitedVectors)
+{
+    int_allocator alloc{};
+    std::vector<std::unique_ptr<int_vec>> owned;
+    for (int i = 0; i < 8; ++i)
+    {
+        owned.push_back(std::make_unique<int_vec>(alloc));
+    }
+    const std::size_t before = LiveCount();
+
+    // The first callback destroys all of them, whether visited yet or not.
+    std::size_t visited = 0;
+    vector_registry::Instance().ForEach([&](const safe_containers::registry_entry&) {
+        owned.clear();
+        ++visited;
+    });
+    ASSERT_LT(visited, before);
+    ASSERT_EQ(LiveCount(), before - 8);
+}
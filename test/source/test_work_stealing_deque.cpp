@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include <safe-containers/work_stealing_deque.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "fail_alloc.h"
+
+using int_deque = safe_containers::work_stealing_deque<int, std::allocator<int>>;
+using counted_deque = safe_containers::work_stealing_deque<int, fault_injecting_allocator<int>>;
+
+TEST(WorkStealingDeque, Create)
+{
+    std::allocator<int> alloc{};
+    auto result = int_deque::Create(3, alloc);
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(result.value().capacity(), 4);
+    ASSERT_TRUE(result.value().empty());
+
+    int_deque moved(std::move(result).value());
+    ASSERT_EQ(moved.capacity(), 4);
+    ASSERT_EQ(result.value().capacity(), 0);
+    ASSERT_TRUE(result.value().empty());
+}
+
+TEST(WorkStealingDeque, OwnerPopsLifoThiefStealsFifo)
+{
+    std::allocator<int> alloc{};
+    auto d = int_deque::Create(4, alloc).expect("Create should work");
+    for (int i = 0; i < 4; ++i)
+    {
+        d.push(i).expect("push should work");
+    }
+
+    int value = -1;
+    ASSERT_TRUE(d.try_steal(value));
+    ASSERT_EQ(value, 0);
+    ASSERT_TRUE(d.try_pop(value));
+    ASSERT_EQ(value, 3);
+    ASSERT_TRUE(d.try_pop(value));
+    ASSERT_EQ(value, 2);
+    ASSERT_TRUE(d.try_steal(value));
+    ASSERT_EQ(value, 1);
+    ASSERT_FALSE(d.try_pop(value));
+    ASSERT_FALSE(d.try_steal(value));
+}
+
+TEST(WorkStealingDeque, Grows)
+{
+    std::allocator<int> alloc{};
+    auto d = int_deque::Create(2, alloc).expect("Create should work");
+    for (int i = 0; i < 100; ++i)
+    {
+        d.push(i).expect("push should work");
+    }
+    ASSERT_GE(d.capacity(), 100);
+    ASSERT_EQ(d.size(), 100);
+    int value = -1;
+    for (int i = 99; i >= 0; --i)
+    {
+        ASSERT_TRUE(d.try_pop(value));
+        ASSERT_EQ(value, i);
+    }
+}
+
+TEST(WorkStealingDeque, FailedGrowthKeepsElements)
+{
+    fault_policy policy{};
+    fault_injecting_allocator<int> alloc{policy};
+    auto d = counted_deque::Create(2, alloc).expect("Create should work");
+    d.push(1).expect("push should work");
+    d.push(2).expect("push should work");
+
+    policy.fail_above_bytes = 0;
+    ASSERT_TRUE(d.push(3).has_error());
+    ASSERT_EQ(d.size(), 2);
+    ASSERT_EQ(d.capacity(), 2);
+
+    policy.fail_above_bytes = std::numeric_limits<std::size_t>::max();
+    d.push(3).expect("push should work");
+    int value = -1;
+    ASSERT_TRUE(d.try_steal(value));
+    ASSERT_EQ(value, 1);
+}
+
+TEST(WorkStealingDeque, ConcurrentSteals)
+{
+    constexpr int count = 50000;
+    constexpr int thieves = 3;
+    std::allocator<int> alloc{};
+    auto d = int_deque::Create(2, alloc).expect("Create should work");
+
+    std::atomic<bool> done{false};
+    std::atomic<long> sum{0};
+    std::atomic<int> taken{0};
+    std::vector<std::thread> workers;
+    for (int i = 0; i < thieves; ++i)
+    {
+        workers.emplace_back(
+            [&]()
+            {
+                int value = 0;
+                while (!done.load())
+                {
+                    if (d.try_steal(value))
+                    {
+                        sum += value;
+                        ++taken;
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+    }
+
+    // The owner interleaves pushes & pops, growing the ring while thieves steal.
+    int value = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        d.push(i).expect("push should work");
+        if (i % 3 == 0 && d.try_pop(value))
+        {
+            sum += value;
+            ++taken;
+        }
+    }
+    while (d.try_pop(value))
+    {
+        sum += value;
+        ++taken;
+    }
+    while (taken.load() < count)
+    {
+        std::this_thread::yield();
+    }
+    done.store(true);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    ASSERT_EQ(taken.load(), count);
+    ASSERT_EQ(sum.load(), static_cast<long>(count) * (count - 1) / 2);
+}
+
+TEST(WorkStealingDeque, AllocationFailuresReturnError)
+{
+    fail_allocator<int> alloc{};
+    const auto result =
+        safe_containers::work_stealing_deque<int, fail_allocator<int>>::Create(4, alloc);
+    ASSERT_TRUE(result.has_error());
+}